@@ -7,10 +7,21 @@
 extern "C" {
 #endif
 
+/* buffer kinds for mrb_sdl2_misc_buffer_detach/attach */
+#define MRB_SDL2_MISC_BUFFER_PLAIN 0
+#define MRB_SDL2_MISC_BUFFER_FLOAT 1
+#define MRB_SDL2_MISC_BUFFER_BYTE  2
+#define MRB_SDL2_MISC_BUFFER_INT   3
+
+extern void *mrb_sdl2_misc_buffer_get_ptr(mrb_state *mrb, mrb_value buffer, size_t *size);
+extern mrb_value mrb_sdl2_misc_intbuffer(mrb_state *mrb, int32_t const *values, size_t count);
+extern mrb_bool mrb_sdl2_misc_buffer_detach(mrb_state *mrb, mrb_value value, void **buffer, size_t *size, int *kind);
+extern mrb_value mrb_sdl2_misc_buffer_attach(mrb_state *mrb, int kind, void *buffer, size_t size);
+
 extern void mruby_sdl2_misc_init(mrb_state *mrb);
 extern void mruby_sdl2_misc_final(mrb_state *mrb);
 
-#ifdef __cplusplu
+#ifdef __cplusplus
 }
 #endif
 
@@ -0,0 +1,21 @@
+#ifndef MRUBY_SDL2_DIRTY_REGION_H
+#define MRUBY_SDL2_DIRTY_REGION_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_rect.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool mrb_sdl2_dirty_region_p(mrb_state *mrb, mrb_value obj);
+extern SDL_Rect const *mrb_sdl2_dirty_region_get_rects(mrb_state *mrb, mrb_value region, int *count);
+
+extern void mruby_sdl2_dirty_region_init(mrb_state *mrb);
+extern void mruby_sdl2_dirty_region_final(mrb_state *mrb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_DIRTY_REGION_H */
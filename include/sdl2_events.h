@@ -10,6 +10,9 @@ extern "C" {
 
 extern SDL_Event *mrb_sdl2_input_event_get_ptr(mrb_state *mrb, mrb_value value);
 extern mrb_value mrb_sdl2_input_event(mrb_state *mrb, SDL_Event const *event);
+extern Uint32 mrb_sdl2_input_event_window_id(SDL_Event const *event);
+extern mrb_bool mrb_sdl2_input_event_type_p(Uint32 type);
+extern void mrb_sdl2_input_event_discard(mrb_state *mrb, SDL_Event *event);
 
 extern void mruby_sdl2_events_init(mrb_state *mrb);
 extern void mruby_sdl2_events_final(mrb_state *mrb);
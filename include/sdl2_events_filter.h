@@ -0,0 +1,23 @@
+#ifndef MRUBY_SDL2_EVENTS_FILTER_H
+#define MRUBY_SDL2_EVENTS_FILTER_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_events.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int mrb_sdl2_input_filter_release(void);
+extern int mrb_sdl2_input_filter_wait(SDL_Event *event, int timeout);
+extern bool mrb_sdl2_input_filter_add_watch(SDL_EventFilter callback, void *userdata);
+extern void mrb_sdl2_input_filter_del_watch(SDL_EventFilter callback, void *userdata);
+
+extern void mruby_sdl2_events_filter_init(mrb_state *mrb, struct RClass *mod_Input);
+extern void mruby_sdl2_events_filter_final(mrb_state *mrb, struct RClass *mod_Input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_EVENTS_FILTER_H */
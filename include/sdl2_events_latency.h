@@ -0,0 +1,21 @@
+#ifndef MRUBY_SDL2_EVENTS_LATENCY_H
+#define MRUBY_SDL2_EVENTS_LATENCY_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_events.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mrb_sdl2_input_latency_polled(SDL_Event const *events, int count);
+extern void mrb_sdl2_input_latency_presented(void);
+
+extern void mruby_sdl2_events_latency_init(mrb_state *mrb, struct RClass *mod_Input);
+extern void mruby_sdl2_events_latency_final(mrb_state *mrb, struct RClass *mod_Input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_EVENTS_LATENCY_H */
@@ -0,0 +1,18 @@
+#ifndef MRUBY_SDL2_EVENTS_RECORDER_H
+#define MRUBY_SDL2_EVENTS_RECORDER_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_events.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mruby_sdl2_events_recorder_init(mrb_state *mrb, struct RClass *mod_Input);
+extern void mruby_sdl2_events_recorder_final(mrb_state *mrb, struct RClass *mod_Input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_EVENTS_RECORDER_H */
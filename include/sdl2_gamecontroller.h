@@ -8,6 +8,9 @@
 extern "C" {
 #endif
 
+extern SDL_GameController *mrb_sdl2_gamecontrollers_gamecontroller_get_ptr(mrb_state *mrb, mrb_value gamecontroller);
+extern mrb_value mrb_sdl2_gamecontrollers_gamecontroller(mrb_state *mrb, SDL_GameController *gamecontroller);
+
 extern void mruby_sdl2_gamecontroller_init(mrb_state *mrb);
 extern void mruby_sdl2_gamecontroller_final(mrb_state *mrb);
 
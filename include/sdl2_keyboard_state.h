@@ -0,0 +1,18 @@
+#ifndef MRUBY_SDL2_KEYBOARD_STATE_H
+#define MRUBY_SDL2_KEYBOARD_STATE_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_keyboard.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mruby_sdl2_keyboard_state_init(mrb_state *mrb, struct RClass *mod_Keyboard);
+extern void mruby_sdl2_keyboard_state_final(mrb_state *mrb, struct RClass *mod_Keyboard);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_KEYBOARD_STATE_H */
@@ -0,0 +1,18 @@
+#ifndef MRUBY_SDL2_MOUSE_SAMPLES_H
+#define MRUBY_SDL2_MOUSE_SAMPLES_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_mouse.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mruby_sdl2_mouse_samples_init(mrb_state *mrb, struct RClass *mod_Mouse);
+extern void mruby_sdl2_mouse_samples_final(mrb_state *mrb, struct RClass *mod_Mouse);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_MOUSE_SAMPLES_H */
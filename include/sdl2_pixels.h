@@ -11,6 +11,9 @@ extern "C" {
   
 extern mrb_value mrb_sdl2_pixels_pixelformat_new(mrb_state *mrb, SDL_PixelFormat *format);
 extern SDL_PixelFormat * mrb_sdl2_pixels_pixelformat_get_ptr(mrb_state *mrb, mrb_value pixelformat);
+extern void mrb_sdl2_pixels_map_rgba_buffer(SDL_PixelFormat const *format, Uint8 const *src, void *dst, size_t count);
+extern void mrb_sdl2_pixels_unpack_rgba_buffer(SDL_PixelFormat const *format, void const *src, Uint8 *dst, size_t count);
+extern mrb_bool mrb_sdl2_pixels_buffer_format_p(SDL_PixelFormat const *format);
 extern void mruby_sdl2_pixels_init(mrb_state *mrb);
 extern void mruby_sdl2_pixels_final(mrb_state *mrb);
 
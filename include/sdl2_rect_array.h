@@ -0,0 +1,22 @@
+#ifndef MRUBY_SDL2_RECT_ARRAY_H
+#define MRUBY_SDL2_RECT_ARRAY_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_rect.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool mrb_sdl2_rect_array_p(mrb_state *mrb, mrb_value obj);
+extern SDL_Rect const *mrb_sdl2_rect_array_get_rects(mrb_state *mrb, mrb_value rects, int *count);
+extern mrb_value mrb_sdl2_rect_array(mrb_state *mrb, SDL_Rect const *rects, int count);
+
+extern void mruby_sdl2_rect_array_init(mrb_state *mrb);
+extern void mruby_sdl2_rect_array_final(mrb_state *mrb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_RECT_ARRAY_H */
@@ -0,0 +1,18 @@
+#ifndef MRUBY_SDL2_SPATIAL_HASH_H
+#define MRUBY_SDL2_SPATIAL_HASH_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_rect.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mruby_sdl2_spatial_hash_init(mrb_state *mrb);
+extern void mruby_sdl2_spatial_hash_final(mrb_state *mrb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_SPATIAL_HASH_H */
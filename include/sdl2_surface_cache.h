@@ -0,0 +1,18 @@
+#ifndef MRUBY_SDL2_SURFACE_CACHE_H
+#define MRUBY_SDL2_SURFACE_CACHE_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_surface.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mruby_sdl2_video_surface_cache_init(mrb_state *mrb, struct RClass *mod_Video);
+extern void mruby_sdl2_video_surface_cache_final(mrb_state *mrb, struct RClass *mod_Video);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_SURFACE_CACHE_H */
@@ -0,0 +1,20 @@
+#ifndef MRUBY_SDL2_SURFACE_COMPARE_H
+#define MRUBY_SDL2_SURFACE_COMPARE_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_surface.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern Uint64 mrb_sdl2_video_surface_hash64(SDL_Surface *surface, Uint64 seed);
+
+extern void mruby_sdl2_video_surface_compare_init(mrb_state *mrb, struct RClass *class_Surface);
+extern void mruby_sdl2_video_surface_compare_final(mrb_state *mrb, struct RClass *class_Surface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_SURFACE_COMPARE_H */
@@ -0,0 +1,21 @@
+#ifndef MRUBY_SDL2_SURFACE_CONVERT_H
+#define MRUBY_SDL2_SURFACE_CONVERT_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_surface.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int mrb_sdl2_video_surface_convert_pixels(SDL_Surface *src, SDL_Surface *dst);
+extern SDL_Surface *mrb_sdl2_video_surface_convert_surface(SDL_Surface *src, SDL_PixelFormat const *format);
+
+extern void mruby_sdl2_video_surface_convert_init(mrb_state *mrb, struct RClass *class_Surface);
+extern void mruby_sdl2_video_surface_convert_final(mrb_state *mrb, struct RClass *class_Surface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_SURFACE_CONVERT_H */
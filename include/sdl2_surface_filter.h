@@ -0,0 +1,27 @@
+#ifndef MRUBY_SDL2_SURFACE_FILTER_H
+#define MRUBY_SDL2_SURFACE_FILTER_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_surface.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Work callback for mrb_sdl2_video_surface_parallel_for. Called with a half
+ * open range [begin, end) from worker threads, so it must not touch the
+ * mruby VM; allocate scratch memory with SDL_malloc.
+ */
+typedef void (*mrb_sdl2_video_surface_band_func_t)(void *context, int begin, int end);
+
+extern void mrb_sdl2_video_surface_parallel_for(int count, int grain, mrb_sdl2_video_surface_band_func_t func, void *context);
+
+extern void mruby_sdl2_video_surface_filter_init(mrb_state *mrb, struct RClass *class_Surface);
+extern void mruby_sdl2_video_surface_filter_final(mrb_state *mrb, struct RClass *class_Surface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_SURFACE_FILTER_H */
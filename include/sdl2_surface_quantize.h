@@ -0,0 +1,18 @@
+#ifndef MRUBY_SDL2_SURFACE_QUANTIZE_H
+#define MRUBY_SDL2_SURFACE_QUANTIZE_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_surface.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mruby_sdl2_video_surface_quantize_init(mrb_state *mrb, struct RClass *class_Surface);
+extern void mruby_sdl2_video_surface_quantize_final(mrb_state *mrb, struct RClass *class_Surface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_SURFACE_QUANTIZE_H */
@@ -0,0 +1,17 @@
+#ifndef MRUBY_SDL2_VIDEO_INDEXED_TEXTURE_H
+#define MRUBY_SDL2_VIDEO_INDEXED_TEXTURE_H
+
+#include "sdl2.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mruby_sdl2_video_indexed_texture_init(mrb_state *mrb, struct RClass *mod_Video);
+extern void mruby_sdl2_video_indexed_texture_final(mrb_state *mrb, struct RClass *mod_Video);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_VIDEO_INDEXED_TEXTURE_H */
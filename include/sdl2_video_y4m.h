@@ -0,0 +1,20 @@
+#ifndef MRUBY_SDL2_VIDEO_Y4M_H
+#define MRUBY_SDL2_VIDEO_Y4M_H
+
+#include "sdl2.h"
+#include <SDL2/SDL_surface.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void mrb_sdl2_video_i420_to_surface(Uint8 const *y, Uint8 const *u, Uint8 const *v, int width, int height, SDL_Surface *surface);
+
+extern void mruby_sdl2_video_y4m_init(mrb_state *mrb, struct RClass *mod_Video);
+extern void mruby_sdl2_video_y4m_final(mrb_state *mrb, struct RClass *mod_Video);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of MRUBY_SDL2_VIDEO_Y4M_H */
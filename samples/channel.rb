@@ -0,0 +1,39 @@
+# Posts results from worker threads to the main thread through a channel.
+#
+# Each worker runs in its own VM, so it opens the channel by id instead of
+# using the main thread's object. Also a throughput benchmark: four
+# producers post 400k messages in total.
+
+WORKERS  = 4
+MESSAGES = 100000
+
+SDL2::init
+
+begin
+  channel = SDL2::Input::Channel.new
+  id = channel.id
+
+  start = SDL2::Timer::ticks
+  threads = (0...WORKERS).map do |n|
+    SDL2::Thread.new do
+      out = SDL2::Input::Channel.open(id)
+      MESSAGES.times do |i|
+        out.post(n, { :index => i, :name => "worker #{n}", :squares => [i, i * i] })
+      end
+      0
+    end
+  end
+
+  received = 0
+  while received < WORKERS * MESSAGES
+    SDL2::Input::wait_timeout(100)
+    received += channel.each { |code, payload| payload[:index] }
+  end
+  threads.each { |t| t.wait }
+
+  ms = SDL2::Timer::ticks - start
+  rate = received * 1000 / (ms > 0 ? ms : 1)
+  puts "received #{received} messages in #{ms} ms (#{rate} per second), #{channel.pending} pending"
+ensure
+  SDL2::quit
+end
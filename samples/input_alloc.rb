@@ -0,0 +1,66 @@
+# Compares object allocations of SDL2::Input.poll against poll_into.
+# Needs the mruby-objectspace gem for ObjectSpace.count_objects.
+
+EVENTS = 10000
+
+def live_objects
+  counts = ObjectSpace.count_objects
+  counts[:TOTAL] - counts[:FREE]
+end
+
+def push_events(type, n)
+  ev = SDL2::Input::UserEvent.new(type, 0)
+  i = 0
+  while i < n
+    ev.code = i
+    SDL2::Input::push(ev)
+    i += 1
+  end
+end
+
+def measure(label)
+  GC.start
+  GC.disable
+  before = live_objects
+  n = yield
+  after = live_objects
+  GC.enable
+  puts "#{label}: #{n} events, #{after - before} objects allocated"
+end
+
+SDL2::init
+
+begin
+  type = SDL2::Input::register(1)
+
+  push_events(type, EVENTS)
+  measure("poll") do
+    n = 0
+    until SDL2::Input::poll.nil?
+      n += 1
+    end
+    n
+  end
+
+  push_events(type, EVENTS)
+  target = SDL2::Input::Event.new
+  measure("poll_into") do
+    n = 0
+    until SDL2::Input::poll_into(target).nil?
+      n += 1
+    end
+    n
+  end
+
+  push_events(type, EVENTS)
+  buffer = SDL2::Input::EventBuffer.new(256)
+  measure("poll_all") do
+    n = 0
+    while 0 < (count = SDL2::Input::poll_all(buffer))
+      n += count
+    end
+    n
+  end
+ensure
+  SDL2::quit
+end
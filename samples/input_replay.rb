@@ -0,0 +1,54 @@
+# Records input to a log, or replays a log frame by frame.
+#
+#   record: run with LOG_MODE = :record and use the window, close it to stop.
+#   replay: run with LOG_MODE = :replay, e.g. with SDL_VIDEODRIVER=dummy.
+#
+# In replay the player is not real-time: it advances 16 ms per frame, so
+# every run sees the same events in the same frames.
+
+LOG_PATH = "input.evlog"
+LOG_MODE = :record
+
+SDL2::init
+
+begin
+  SDL2::Video::init
+  begin
+    w = SDL2::Video::Window.new "replay", 100, 100, 640, 480, SDL2::Video::Window::SDL_WINDOW_SHOWN
+    event = SDL2::Input::Event.new
+
+    if LOG_MODE == :record
+      recorder = SDL2::Input::Recorder.new(LOG_PATH)
+      recorder.start
+    else
+      player = SDL2::Input::Player.new(LOG_PATH)
+      player.realtime = false
+      player.frame_ms = 16
+    end
+
+    frames = 0
+    start = SDL2::Timer::ticks
+    running = true
+    while running
+      player.update unless player.nil?
+      until SDL2::Input::poll_into(event).nil?
+        running = false if event.type == SDL2::Input::SDL_QUIT
+      end
+      running = false if !player.nil? && player.finished?
+      frames += 1
+    end
+
+    unless recorder.nil?
+      recorder.close
+      puts "recorded #{recorder.count} events"
+    else
+      puts "replayed #{player.pushed} events in #{frames} frames, #{SDL2::Timer::ticks - start} ms"
+      player.close
+    end
+    w.destroy
+  ensure
+    SDL2::Video::quit
+  end
+ensure
+  SDL2::quit
+end
@@ -3,10 +3,7 @@
 #include "mruby/value.h"
 #include "mruby/data.h"
 #include "mruby/array.h"
-
-static struct RClass *class_Buffer = NULL;
-static struct RClass *class_FloatBuffer = NULL;
-static struct RClass *class_ByteBuffer = NULL;
+#include <string.h>
 
 typedef struct mrb_sdl2_misc_buffer_data_t {
   void  *buffer;
@@ -28,6 +25,102 @@ static struct mrb_data_type const mrb_sdl2_misc_buffer_data_type = {
   "Buffer", &mrb_sdl2_misc_buffer_data_free
 };
 
+/*
+ * Looks a buffer class up in the calling VM. Buffers cross VMs through
+ * SDL2::Channel, and every SDL2::Thread VM defines its own classes, so
+ * class pointers cannot be cached in statics.
+ */
+static struct RClass *
+mrb_sdl2_misc_buffer_class(mrb_state *mrb, char const *name)
+{
+  return mrb_class_get_under(mrb, mrb_module_get(mrb, "SDL2"), name);
+}
+
+/*
+ * Returns the storage of any SDL2::Buffer and its size in bytes.
+ */
+void *
+mrb_sdl2_misc_buffer_get_ptr(mrb_state *mrb, mrb_value buffer, size_t *size)
+{
+  mrb_sdl2_misc_buffer_data_t *data =
+    (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, buffer, &mrb_sdl2_misc_buffer_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Buffer.");
+  }
+  if (NULL != size) {
+    *size = data->size;
+  }
+  return data->buffer;
+}
+
+/*
+ * Takes the storage out of an SDL2::Buffer, leaving the buffer empty, and
+ * returns false if 'value' is not a buffer. 'kind' identifies the buffer
+ * class for mrb_sdl2_misc_buffer_attach. The storage stays allocated with
+ * the VM's allocator and belongs to the caller.
+ */
+mrb_bool
+mrb_sdl2_misc_buffer_detach(mrb_state *mrb, mrb_value value, void **buffer, size_t *size, int *kind)
+{
+  mrb_sdl2_misc_buffer_data_t *data;
+  if ((MRB_TT_DATA != mrb_type(value)) || (&mrb_sdl2_misc_buffer_data_type != DATA_TYPE(value))) {
+    return false;
+  }
+  data = (mrb_sdl2_misc_buffer_data_t*)DATA_PTR(value);
+  if (mrb_obj_is_kind_of(mrb, value, mrb_sdl2_misc_buffer_class(mrb, "IntBuffer"))) {
+    *kind = MRB_SDL2_MISC_BUFFER_INT;
+  } else if (mrb_obj_is_kind_of(mrb, value, mrb_sdl2_misc_buffer_class(mrb, "ByteBuffer"))) {
+    *kind = MRB_SDL2_MISC_BUFFER_BYTE;
+  } else if (mrb_obj_is_kind_of(mrb, value, mrb_sdl2_misc_buffer_class(mrb, "FloatBuffer"))) {
+    *kind = MRB_SDL2_MISC_BUFFER_FLOAT;
+  } else {
+    *kind = MRB_SDL2_MISC_BUFFER_PLAIN;
+  }
+  if (NULL == data) {
+    *buffer = NULL;
+    *size   = 0;
+    return true;
+  }
+  *buffer = data->buffer;
+  *size   = data->size;
+  data->buffer = NULL;
+  data->size   = 0;
+  return true;
+}
+
+/*
+ * Wraps storage taken by mrb_sdl2_misc_buffer_detach in a new buffer of
+ * the same class, which becomes its owner.
+ */
+mrb_value
+mrb_sdl2_misc_buffer_attach(mrb_state *mrb, int kind, void *buffer, size_t size)
+{
+  struct RClass *klass;
+  mrb_sdl2_misc_buffer_data_t *data =
+    (mrb_sdl2_misc_buffer_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_misc_buffer_data_t));
+  if (NULL == data) {
+    mrb_free(mrb, buffer);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  switch (kind) {
+  case MRB_SDL2_MISC_BUFFER_FLOAT:
+    klass = mrb_sdl2_misc_buffer_class(mrb, "FloatBuffer");
+    break;
+  case MRB_SDL2_MISC_BUFFER_BYTE:
+    klass = mrb_sdl2_misc_buffer_class(mrb, "ByteBuffer");
+    break;
+  case MRB_SDL2_MISC_BUFFER_INT:
+    klass = mrb_sdl2_misc_buffer_class(mrb, "IntBuffer");
+    break;
+  default:
+    klass = mrb_sdl2_misc_buffer_class(mrb, "Buffer");
+    break;
+  }
+  data->buffer = buffer;
+  data->size   = size;
+  return mrb_obj_value(Data_Wrap_Struct(mrb, klass, &mrb_sdl2_misc_buffer_data_type, data));
+}
+
 static mrb_value
 mrb_sdl2_misc_buffer_initialize(mrb_state *mrb, mrb_value self)
 {
@@ -311,7 +404,7 @@ mrb_sdl2_misc_floatbuffer_get_at(mrb_state *mrb, mrb_value self)
   mrb_get_args(mrb, "i", &index);
   data =
     (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
-  if ((index < 0) || (index >= (data->size/sizeof(float)))) {
+  if ((index < 0) || ((size_t)index >= (data->size/sizeof(float)))) {
     mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
   }
   return mrb_float_value(mrb, ((float*)data->buffer)[index]);
@@ -326,7 +419,7 @@ mrb_sdl2_misc_floatbuffer_set_at(mrb_state *mrb, mrb_value self)
   mrb_get_args(mrb, "if", &index, &value);
   data =
     (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
-  if ((index < 0) || (index >= (data->size/sizeof(float)))) {
+  if ((index < 0) || ((size_t)index >= (data->size/sizeof(float)))) {
     mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
   }
   ((float*)data->buffer)[index] = (float)value;
@@ -440,7 +533,7 @@ mrb_sdl2_misc_bytebuffer_get_at(mrb_state *mrb, mrb_value self)
   mrb_get_args(mrb, "i", &index);
   data =
     (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
-  if ((index < 0) || (index >= (data->size/sizeof(uint8_t)))) {
+  if ((index < 0) || ((size_t)index >= (data->size/sizeof(uint8_t)))) {
     mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
   }
   return mrb_fixnum_value(((uint8_t*)data->buffer)[index]);
@@ -455,23 +548,154 @@ mrb_sdl2_misc_bytebuffer_set_at(mrb_state *mrb, mrb_value self)
   mrb_get_args(mrb, "ii", &index, &value);
   data =
     (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
-  if ((index < 0) || (index >= (data->size/sizeof(uint8_t)))) {
+  if ((index < 0) || ((size_t)index >= (data->size/sizeof(uint8_t)))) {
     mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
   }
   ((uint8_t*)data->buffer)[index] = (uint8_t)(value & 0xffu);
   return self;
 }
 
+static mrb_value
+mrb_sdl2_misc_intbuffer_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_misc_buffer_data_t *data;
+  mrb_value arg;
+  mrb_int i, n;
+  mrb_get_args(mrb, "o", &arg);
+
+  if (mrb_array_p(arg)) {
+    n = mrb_ary_len(mrb, arg);
+  } else {
+    n = mrb_fixnum(mrb_Integer(mrb, arg));
+  }
+  if (0 > n) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "negative buffer size.");
+  }
+
+  data =
+    (mrb_sdl2_misc_buffer_data_t*)DATA_PTR(self);
+
+  if (NULL == data) {
+    data = (mrb_sdl2_misc_buffer_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_misc_buffer_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+    data->buffer = NULL;
+    data->size   = 0;
+    DATA_PTR(self) = data;
+    DATA_TYPE(self) = &mrb_sdl2_misc_buffer_data_type;
+  }
+
+  mrb_free(mrb, data->buffer);
+  data->buffer = NULL;
+  data->size   = 0;
+  if (0 < n) {
+    data->buffer = mrb_malloc(mrb, sizeof(int32_t) * n);
+    if (NULL == data->buffer) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+    data->size = sizeof(int32_t) * n;
+  }
+
+  for (i = 0; i < n; ++i) {
+    ((int32_t*)data->buffer)[i] =
+      mrb_array_p(arg) ? (int32_t)mrb_fixnum(mrb_Integer(mrb, mrb_ary_ref(mrb, arg, i))) : 0;
+  }
+
+  return self;
+}
+
+/*
+ * Creates an SDL2::IntBuffer holding a copy of 'count' values.
+ */
+mrb_value
+mrb_sdl2_misc_intbuffer(mrb_state *mrb, int32_t const *values, size_t count)
+{
+  mrb_sdl2_misc_buffer_data_t *data =
+    (mrb_sdl2_misc_buffer_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_misc_buffer_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  data->buffer = NULL;
+  data->size   = 0;
+  if (0 < count) {
+    data->buffer = mrb_malloc(mrb, sizeof(int32_t) * count);
+    if (NULL == data->buffer) {
+      mrb_free(mrb, data);
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+    memcpy(data->buffer, values, sizeof(int32_t) * count);
+    data->size = sizeof(int32_t) * count;
+  }
+  return mrb_obj_value(Data_Wrap_Struct(mrb, mrb_sdl2_misc_buffer_class(mrb, "IntBuffer"), &mrb_sdl2_misc_buffer_data_type, data));
+}
+
+static mrb_value
+mrb_sdl2_misc_intbuffer_get_size(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_misc_buffer_data_t *data =
+    (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
+  return mrb_fixnum_value((mrb_int)(data->size/sizeof(int32_t)));
+}
+
+static mrb_value
+mrb_sdl2_misc_intbuffer_get_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_misc_buffer_data_t *data;
+  mrb_int index;
+  mrb_get_args(mrb, "i", &index);
+  data =
+    (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
+  if ((index < 0) || ((size_t)index >= (data->size/sizeof(int32_t)))) {
+    mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
+  }
+  return mrb_fixnum_value(((int32_t*)data->buffer)[index]);
+}
+
+static mrb_value
+mrb_sdl2_misc_intbuffer_set_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_misc_buffer_data_t *data;
+  mrb_int index;
+  mrb_int value;
+  mrb_get_args(mrb, "ii", &index, &value);
+  data =
+    (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
+  if ((index < 0) || ((size_t)index >= (data->size/sizeof(int32_t)))) {
+    mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
+  }
+  ((int32_t*)data->buffer)[index] = (int32_t)value;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_misc_intbuffer_to_a(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_misc_buffer_data_t *data =
+    (mrb_sdl2_misc_buffer_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_misc_buffer_data_type);
+  size_t const n = data->size/sizeof(int32_t);
+  mrb_value ary = mrb_ary_new_capa(mrb, (mrb_int)n);
+  size_t i;
+  for (i = 0; i < n; ++i) {
+    mrb_ary_push(mrb, ary, mrb_fixnum_value(((int32_t*)data->buffer)[i]));
+  }
+  return ary;
+}
+
 void
 mruby_sdl2_misc_init(mrb_state *mrb)
 {
+  struct RClass *class_Buffer, *class_FloatBuffer, *class_ByteBuffer, *class_IntBuffer;
+
   class_Buffer      = mrb_define_class_under(mrb, mod_SDL2, "Buffer",      mrb->object_class);
   class_FloatBuffer = mrb_define_class_under(mrb, mod_SDL2, "FloatBuffer", class_Buffer);
   class_ByteBuffer  = mrb_define_class_under(mrb, mod_SDL2, "ByteBuffer",  class_Buffer);
+  class_IntBuffer   = mrb_define_class_under(mrb, mod_SDL2, "IntBuffer",   class_Buffer);
 
   MRB_SET_INSTANCE_TT(class_Buffer,      MRB_TT_DATA);
   MRB_SET_INSTANCE_TT(class_FloatBuffer, MRB_TT_DATA);
   MRB_SET_INSTANCE_TT(class_ByteBuffer,  MRB_TT_DATA);
+  MRB_SET_INSTANCE_TT(class_IntBuffer,   MRB_TT_DATA);
 
   mrb_define_method(mrb, class_Buffer, "initialize", mrb_sdl2_misc_buffer_initialize,  MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Buffer, "address",    mrb_sdl2_misc_buffer_get_address, MRB_ARGS_NONE());
@@ -486,6 +710,12 @@ mruby_sdl2_misc_init(mrb_state *mrb)
   mrb_define_method(mrb, class_ByteBuffer, "initialize", mrb_sdl2_misc_bytebuffer_initialize, MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_ByteBuffer, "[]",         mrb_sdl2_misc_bytebuffer_get_at,     MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_ByteBuffer, "[]=",        mrb_sdl2_misc_bytebuffer_set_at,     MRB_ARGS_REQ(2));
+
+  mrb_define_method(mrb, class_IntBuffer, "initialize", mrb_sdl2_misc_intbuffer_initialize, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_IntBuffer, "size",       mrb_sdl2_misc_intbuffer_get_size,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_IntBuffer, "[]",         mrb_sdl2_misc_intbuffer_get_at,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_IntBuffer, "[]=",        mrb_sdl2_misc_intbuffer_set_at,     MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_IntBuffer, "to_a",       mrb_sdl2_misc_intbuffer_to_a,       MRB_ARGS_NONE());
 }
 
 void
@@ -0,0 +1,503 @@
+#include "sdl2_dirty_region.h"
+#include "sdl2_rect.h"
+#include "sdl2_rect_array.h"
+#include "sdl2_video.h"
+#include "sdl2_render.h"
+#include "sdl2_surface.h"
+#include "mruby/data.h"
+#include "mruby/class.h"
+#include "mruby/array.h"
+#include <SDL2/SDL_render.h>
+
+static struct RClass *class_DirtyRegion = NULL;
+
+/*
+ * 'rects' holds the coalesced rects, already clipped to the region. Once
+ * the summed area crosses 'threshold' of the region, 'full' is set and
+ * the list is dropped until the next clear.
+ */
+typedef struct mrb_sdl2_dirty_region_data_t {
+  int       width;
+  int       height;
+  double    threshold;
+  int       merge_slack;
+  int       max_rects;
+  bool      full;
+  SDL_Rect  bounds;
+  SDL_Rect *rects;
+  int       count;
+  int       capacity;
+} mrb_sdl2_dirty_region_data_t;
+
+static void
+mrb_sdl2_dirty_region_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_dirty_region_data_t *data =
+    (mrb_sdl2_dirty_region_data_t*)p;
+  if (NULL != data) {
+    mrb_free(mrb, data->rects);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_dirty_region_data_type = {
+  "DirtyRegion", mrb_sdl2_dirty_region_data_free
+};
+
+static mrb_sdl2_dirty_region_data_t *
+mrb_sdl2_dirty_region_get_ptr(mrb_state *mrb, mrb_value region)
+{
+  mrb_sdl2_dirty_region_data_t *data =
+    (mrb_sdl2_dirty_region_data_t*)mrb_data_get_ptr(mrb, region, &mrb_sdl2_dirty_region_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized dirty region.");
+  }
+  return data;
+}
+
+static Sint64
+mrb_sdl2_dirty_region_area(SDL_Rect const *r)
+{
+  return (Sint64)r->w * r->h;
+}
+
+/* pixels a merged rect would refresh without them being dirty. */
+static Sint64
+mrb_sdl2_dirty_region_waste(SDL_Rect const *a, SDL_Rect const *b, SDL_Rect *merged)
+{
+  SDL_Rect overlap;
+  Sint64 covered = mrb_sdl2_dirty_region_area(a) + mrb_sdl2_dirty_region_area(b);
+  if (SDL_IntersectRect(a, b, &overlap)) {
+    covered -= mrb_sdl2_dirty_region_area(&overlap);
+  }
+  SDL_UnionRect(a, b, merged);
+  return mrb_sdl2_dirty_region_area(merged) - covered;
+}
+
+static void
+mrb_sdl2_dirty_region_clear_data(mrb_sdl2_dirty_region_data_t *data)
+{
+  data->count = 0;
+  data->full  = false;
+}
+
+/*
+ * Merges 'rect' with any stored rect whose union wastes no more than
+ * 'merge_slack' pixels, repeating with the grown rect until nothing more
+ * merges. At 'max_rects' the cheapest merge is taken regardless of cost.
+ */
+static void
+mrb_sdl2_dirty_region_add_rect(mrb_state *mrb, mrb_sdl2_dirty_region_data_t *data, SDL_Rect const *rect)
+{
+  SDL_Rect r;
+  Sint64 total = 0;
+  int i;
+  if (data->full || !SDL_IntersectRect(rect, &data->bounds, &r)) {
+    return;
+  }
+  /* grow first so a failed allocation cannot drop already merged rects. */
+  if (data->count == data->capacity) {
+    int const capacity = (0 < data->capacity) ? data->capacity * 2 : 16;
+    data->rects = (SDL_Rect*)mrb_realloc(mrb, data->rects, sizeof(SDL_Rect) * capacity);
+    data->capacity = capacity;
+  }
+  for (;;) {
+    int best = -1;
+    Sint64 best_waste = 0;
+    SDL_Rect best_union;
+    for (i = 0; i < data->count; ++i) {
+      SDL_Rect merged;
+      Sint64 const waste = mrb_sdl2_dirty_region_waste(&data->rects[i], &r, &merged);
+      if ((0 > best) || (waste < best_waste)) {
+        best       = i;
+        best_waste = waste;
+        best_union = merged;
+      }
+    }
+    if ((0 > best) || ((best_waste > data->merge_slack) && (data->count < data->max_rects))) {
+      break;
+    }
+    r = best_union;
+    data->rects[best] = data->rects[--data->count];
+  }
+  data->rects[data->count++] = r;
+
+  for (i = 0; i < data->count; ++i) {
+    total += mrb_sdl2_dirty_region_area(&data->rects[i]);
+  }
+  if ((double)total >= data->threshold * (double)mrb_sdl2_dirty_region_area(&data->bounds)) {
+    data->count = 0;
+    data->full  = true;
+  }
+}
+
+bool
+mrb_sdl2_dirty_region_p(mrb_state *mrb, mrb_value obj)
+{
+  return (MRB_TT_DATA == mrb_type(obj)) && (&mrb_sdl2_dirty_region_data_type == DATA_TYPE(obj));
+}
+
+/*
+ * Returns the rects to refresh; a full region yields its bounds.
+ */
+SDL_Rect const *
+mrb_sdl2_dirty_region_get_rects(mrb_state *mrb, mrb_value region, int *count)
+{
+  mrb_sdl2_dirty_region_data_t *data = mrb_sdl2_dirty_region_get_ptr(mrb, region);
+  if (data->full) {
+    *count = 1;
+    return &data->bounds;
+  }
+  *count = data->count;
+  return data->rects;
+}
+
+/***************************************************************************
+*
+* class SDL2::DirtyRegion
+*
+***************************************************************************/
+
+static double
+mrb_sdl2_dirty_region_check_threshold(mrb_state *mrb, mrb_float threshold)
+{
+  /* written so that NaN fails too. */
+  if (!((0.0 <= threshold) && (threshold <= 1.0))) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "threshold must be between 0.0 and 1.0.");
+  }
+  return (double)threshold;
+}
+
+/*
+ * SDL2::DirtyRegion#initialize(width, height, threshold = 0.5)
+ *
+ * Collects dirty rects within a width x height area. Once the dirty area
+ * reaches 'threshold' of the whole, the region reports a full update.
+ */
+static mrb_value
+mrb_sdl2_dirty_region_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_data_t *data;
+  mrb_int width, height;
+  mrb_float threshold = 0.5;
+  mrb_get_args(mrb, "ii|f", &width, &height, &threshold);
+  if ((0 >= width) || (0 >= height)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "region size must be positive.");
+  }
+  mrb_sdl2_dirty_region_check_threshold(mrb, threshold);
+
+  data = (mrb_sdl2_dirty_region_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_dirty_region_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+  data = (mrb_sdl2_dirty_region_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_dirty_region_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  data->width       = (int)width;
+  data->height      = (int)height;
+  data->bounds.w    = (int)width;
+  data->bounds.h    = (int)height;
+  data->threshold   = threshold;
+  data->merge_slack = 32 * 32;
+  data->max_rects   = 32;
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_dirty_region_data_type;
+  return self;
+}
+
+/*
+ * SDL2::DirtyRegion#add(rect)
+ * SDL2::DirtyRegion#add(x, y, w, h)
+ * SDL2::DirtyRegion#add(rect_array)
+ * SDL2::DirtyRegion#add(array)
+ */
+static mrb_value
+mrb_sdl2_dirty_region_add(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_data_t *data = mrb_sdl2_dirty_region_get_ptr(mrb, self);
+  mrb_value *argv;
+  mrb_int argc;
+  SDL_Rect r;
+  mrb_get_args(mrb, "*", &argv, &argc);
+  if (4 == argc) {
+    r.x = (int)mrb_fixnum(mrb_Integer(mrb, argv[0]));
+    r.y = (int)mrb_fixnum(mrb_Integer(mrb, argv[1]));
+    r.w = (int)mrb_fixnum(mrb_Integer(mrb, argv[2]));
+    r.h = (int)mrb_fixnum(mrb_Integer(mrb, argv[3]));
+    mrb_sdl2_dirty_region_add_rect(mrb, data, &r);
+  } else if (1 != argc) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "wrong number of arguments.");
+  } else if (mrb_sdl2_rect_array_p(mrb, argv[0])) {
+    int count, i;
+    SDL_Rect const *rects = mrb_sdl2_rect_array_get_rects(mrb, argv[0], &count);
+    for (i = 0; i < count; ++i) {
+      mrb_sdl2_dirty_region_add_rect(mrb, data, &rects[i]);
+    }
+  } else if (mrb_array_p(argv[0])) {
+    mrb_int const n = mrb_ary_len(mrb, argv[0]);
+    mrb_int i;
+    for (i = 0; i < n; ++i) {
+      SDL_Rect const *item = mrb_sdl2_rect_get_ptr(mrb, mrb_ary_ref(mrb, argv[0], i));
+      if (NULL == item) {
+        mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Rect.");
+      }
+      mrb_sdl2_dirty_region_add_rect(mrb, data, item);
+    }
+  } else {
+    SDL_Rect const *item = mrb_sdl2_rect_get_ptr(mrb, argv[0]);
+    if (NULL == item) {
+      mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Rect.");
+    }
+    mrb_sdl2_dirty_region_add_rect(mrb, data, item);
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_mark_full(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_data_t *data = mrb_sdl2_dirty_region_get_ptr(mrb, self);
+  data->count = 0;
+  data->full  = true;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_clear(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_clear_data(mrb_sdl2_dirty_region_get_ptr(mrb, self));
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_is_full(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_dirty_region_get_ptr(mrb, self)->full);
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_is_empty(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_data_t *data = mrb_sdl2_dirty_region_get_ptr(mrb, self);
+  return mrb_bool_value(!data->full && (0 == data->count));
+}
+
+/*
+ * SDL2::DirtyRegion#rects
+ *
+ * Returns the rects to refresh as an SDL2::RectArray.
+ */
+static mrb_value
+mrb_sdl2_dirty_region_get_rect_array(mrb_state *mrb, mrb_value self)
+{
+  int count;
+  SDL_Rect const *rects = mrb_sdl2_dirty_region_get_rects(mrb, self, &count);
+  return mrb_sdl2_rect_array(mrb, rects, count);
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_get_count(mrb_state *mrb, mrb_value self)
+{
+  int count;
+  mrb_sdl2_dirty_region_get_rects(mrb, self, &count);
+  return mrb_fixnum_value(count);
+}
+
+/*
+ * SDL2::DirtyRegion#coverage
+ *
+ * Returns the refreshed fraction of the region, counting overlaps between
+ * the stored rects twice.
+ */
+static mrb_value
+mrb_sdl2_dirty_region_get_coverage(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_data_t *data = mrb_sdl2_dirty_region_get_ptr(mrb, self);
+  Sint64 total = 0;
+  int i;
+  if (data->full) {
+    return mrb_float_value(mrb, 1.0);
+  }
+  for (i = 0; i < data->count; ++i) {
+    total += mrb_sdl2_dirty_region_area(&data->rects[i]);
+  }
+  return mrb_float_value(mrb, (mrb_float)total / (mrb_float)mrb_sdl2_dirty_region_area(&data->bounds));
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_get_threshold(mrb_state *mrb, mrb_value self)
+{
+  return mrb_float_value(mrb, mrb_sdl2_dirty_region_get_ptr(mrb, self)->threshold);
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_set_threshold(mrb_state *mrb, mrb_value self)
+{
+  mrb_float threshold;
+  mrb_get_args(mrb, "f", &threshold);
+  mrb_sdl2_dirty_region_get_ptr(mrb, self)->threshold = mrb_sdl2_dirty_region_check_threshold(mrb, threshold);
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_get_merge_slack(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_dirty_region_get_ptr(mrb, self)->merge_slack);
+}
+
+/*
+ * SDL2::DirtyRegion#merge_slack=(pixels)
+ *
+ * Sets how many clean pixels a merge may refresh; this stands for the
+ * fixed cost of pushing one more rect. Defaults to 1024.
+ */
+static mrb_value
+mrb_sdl2_dirty_region_set_merge_slack(mrb_state *mrb, mrb_value self)
+{
+  mrb_int slack;
+  mrb_get_args(mrb, "i", &slack);
+  if (0 > slack) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "merge slack must not be negative.");
+  }
+  mrb_sdl2_dirty_region_get_ptr(mrb, self)->merge_slack = (int)slack;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_get_max_rects(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_dirty_region_get_ptr(mrb, self)->max_rects);
+}
+
+static mrb_value
+mrb_sdl2_dirty_region_set_max_rects(mrb_state *mrb, mrb_value self)
+{
+  mrb_int max_rects;
+  mrb_get_args(mrb, "i", &max_rects);
+  if (0 >= max_rects) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "max rects must be positive.");
+  }
+  mrb_sdl2_dirty_region_get_ptr(mrb, self)->max_rects = (int)max_rects;
+  return self;
+}
+
+/*
+ * SDL2::DirtyRegion#update_window(window)
+ *
+ * Pushes the region to the window surface and clears it. Returns the
+ * number of rects pushed.
+ */
+static mrb_value
+mrb_sdl2_dirty_region_update_window(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_data_t *data = mrb_sdl2_dirty_region_get_ptr(mrb, self);
+  mrb_value window;
+  SDL_Window *w;
+  int result = 0, pushed = 0;
+  mrb_get_args(mrb, "o", &window);
+  w = mrb_sdl2_video_window_get_ptr(mrb, window);
+  if (data->full) {
+    result = SDL_UpdateWindowSurface(w);
+    pushed = 1;
+  } else if (0 < data->count) {
+    result = SDL_UpdateWindowSurfaceRects(w, data->rects, data->count);
+    pushed = data->count;
+  }
+  if (0 != result) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  mrb_sdl2_dirty_region_clear_data(data);
+  return mrb_fixnum_value(pushed);
+}
+
+/*
+ * SDL2::DirtyRegion#update_texture(texture, surface)
+ *
+ * Uploads the dirty parts of 'surface' into the same places of 'texture'
+ * and clears the region. Returns the number of rects uploaded. Both must
+ * cover the region and share one pixel format, since the pixels are
+ * copied as they are.
+ */
+static mrb_value
+mrb_sdl2_dirty_region_update_texture(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_dirty_region_data_t *data = mrb_sdl2_dirty_region_get_ptr(mrb, self);
+  mrb_value texture, surface;
+  SDL_Texture *t;
+  SDL_Surface *s;
+  SDL_Rect const *rects;
+  Uint32 format;
+  int count, i, w, h, result = 0;
+  mrb_get_args(mrb, "oo", &texture, &surface);
+  t = mrb_sdl2_video_texture_get_ptr(mrb, texture);
+  s = mrb_sdl2_video_surface_get_ptr(mrb, surface);
+  if (NULL == s) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  if ((s->w < data->width) || (s->h < data->height)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface is smaller than the region.");
+  }
+  if (0 != SDL_QueryTexture(t, &format, NULL, &w, &h)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  if (format != s->format->format) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "texture pixel format mismatch.");
+  }
+  if ((w < data->width) || (h < data->height)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "texture is smaller than the region.");
+  }
+  rects = mrb_sdl2_dirty_region_get_rects(mrb, self, &count);
+  if (0 == count) {
+    return mrb_fixnum_value(0);
+  }
+  if (SDL_MUSTLOCK(s)) {
+    SDL_LockSurface(s);
+  }
+  for (i = 0; (i < count) && (0 == result); ++i) {
+    Uint8 const *pixels = (Uint8 const*)s->pixels + rects[i].y * s->pitch + rects[i].x * s->format->BytesPerPixel;
+    result = SDL_UpdateTexture(t, &rects[i], pixels, s->pitch);
+  }
+  if (SDL_MUSTLOCK(s)) {
+    SDL_UnlockSurface(s);
+  }
+  if (0 != result) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  mrb_sdl2_dirty_region_clear_data(data);
+  return mrb_fixnum_value(count);
+}
+
+void
+mruby_sdl2_dirty_region_init(mrb_state *mrb)
+{
+  class_DirtyRegion = mrb_define_class_under(mrb, mod_SDL2, "DirtyRegion", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_DirtyRegion, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_DirtyRegion, "initialize",     mrb_sdl2_dirty_region_initialize,      MRB_ARGS_REQ(2) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_DirtyRegion, "add",            mrb_sdl2_dirty_region_add,             MRB_ARGS_ANY());
+  mrb_define_method(mrb, class_DirtyRegion, "<<",             mrb_sdl2_dirty_region_add,             MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_DirtyRegion, "mark_full",      mrb_sdl2_dirty_region_mark_full,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "clear",          mrb_sdl2_dirty_region_clear,           MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "full?",          mrb_sdl2_dirty_region_is_full,         MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "empty?",         mrb_sdl2_dirty_region_is_empty,        MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "rects",          mrb_sdl2_dirty_region_get_rect_array,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "count",          mrb_sdl2_dirty_region_get_count,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "coverage",       mrb_sdl2_dirty_region_get_coverage,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "threshold",      mrb_sdl2_dirty_region_get_threshold,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "threshold=",     mrb_sdl2_dirty_region_set_threshold,   MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_DirtyRegion, "merge_slack",    mrb_sdl2_dirty_region_get_merge_slack, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "merge_slack=",   mrb_sdl2_dirty_region_set_merge_slack, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_DirtyRegion, "max_rects",      mrb_sdl2_dirty_region_get_max_rects,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_DirtyRegion, "max_rects=",     mrb_sdl2_dirty_region_set_max_rects,   MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_DirtyRegion, "update_window",  mrb_sdl2_dirty_region_update_window,   MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_DirtyRegion, "update_texture", mrb_sdl2_dirty_region_update_texture,  MRB_ARGS_REQ(2));
+}
+
+void
+mruby_sdl2_dirty_region_final(mrb_state *mrb)
+{
+}
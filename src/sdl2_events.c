@@ -1,10 +1,18 @@
 #include "sdl2_events.h"
 #include "sdl2_keyboard.h"
+#include "sdl2_events_buffer.h"
+#include "sdl2_events_filter.h"
+#include "sdl2_events_recorder.h"
+#include "sdl2_events_dispatcher.h"
+#include "sdl2_events_latency.h"
+#include "sdl2_events_channel.h"
+#include "sdl2_events_action_map.h"
 #include "mruby/value.h"
 #include "mruby/data.h"
 #include "mruby/class.h"
 #include "mruby/string.h"
 #include <SDL2/SDL_keyboard.h>
+#include <SDL2/SDL_version.h>
 
 static struct RClass *mod_Input = NULL;
 static struct RClass *class_ControllerAxisEvent   = NULL;
@@ -57,100 +65,156 @@ mrb_sdl2_input_event_get_ptr(mrb_state *mrb, mrb_value value)
   return &data->event;
 }
 
-mrb_value
-mrb_sdl2_input_event(mrb_state *mrb, SDL_Event const *event)
+/*
+ * Returns the SDL2::Input::Event subclass for an event type, the Event base
+ * class for known types that have no dedicated class, or NULL for types SDL
+ * does not define.
+ */
+static struct RClass *
+mrb_sdl2_input_event_class(Uint32 type)
 {
-  mrb_sdl2_input_event_data_t *data;
-  if (NULL == event) {
-    return mrb_nil_value();
-  }
-
-  data = (mrb_sdl2_input_event_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_input_event_data_t));
-  if (NULL == data) {
-    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-  }
-  data->event = *event;
-
-  switch (event->type) {
+  switch (type) {
   case SDL_QUIT:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_QuitEvent,   &mrb_sdl2_input_event_data_type, data));
+    return class_QuitEvent;
   case SDL_APP_TERMINATING:
   case SDL_APP_LOWMEMORY:
   case SDL_APP_WILLENTERBACKGROUND:
   case SDL_APP_DIDENTERBACKGROUND:
   case SDL_APP_WILLENTERFOREGROUND:
   case SDL_APP_DIDENTERFOREGROUND:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_OsEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_OsEvent;
   case SDL_WINDOWEVENT:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_WindowEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_WindowEvent;
   case SDL_SYSWMEVENT:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_SysWMEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_SysWMEvent;
   case SDL_KEYDOWN:
   case SDL_KEYUP:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_KeyboardEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_KeyboardEvent;
   case SDL_TEXTEDITING:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_TextEditingEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_TextEditingEvent;
   case SDL_TEXTINPUT:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_TextInputEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_TextInputEvent;
   case SDL_MOUSEMOTION:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_MouseMotionEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_MouseMotionEvent;
   case SDL_MOUSEBUTTONDOWN:
   case SDL_MOUSEBUTTONUP:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_MouseButtonEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_MouseButtonEvent;
   case SDL_MOUSEWHEEL:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_MouseWheelEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_MouseWheelEvent;
   case SDL_JOYAXISMOTION:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_JoyAxisEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_JoyAxisEvent;
   case SDL_JOYBALLMOTION:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_JoyBallEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_JoyBallEvent;
   case SDL_JOYHATMOTION:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_JoyHatEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_JoyHatEvent;
   case SDL_JOYBUTTONDOWN:
   case SDL_JOYBUTTONUP:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_JoyButtonEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_JoyButtonEvent;
   case SDL_JOYDEVICEADDED:
   case SDL_JOYDEVICEREMOVED:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_JoyDeviceEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_JoyDeviceEvent;
   case SDL_CONTROLLERAXISMOTION:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_ControllerAxisEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_ControllerAxisEvent;
   case SDL_CONTROLLERBUTTONDOWN:
   case SDL_CONTROLLERBUTTONUP:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_ControllerButtonEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_ControllerButtonEvent;
   case SDL_CONTROLLERDEVICEADDED:
   case SDL_CONTROLLERDEVICEREMOVED:
   case SDL_CONTROLLERDEVICEREMAPPED:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_ControllerDeviceEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_ControllerDeviceEvent;
   case SDL_FINGERDOWN:
   case SDL_FINGERUP:
   case SDL_FINGERMOTION:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_TouchFingerEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_TouchFingerEvent;
   case SDL_DOLLARGESTURE:
   case SDL_DOLLARRECORD:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_DollarGestureEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_DollarGestureEvent;
   case SDL_MULTIGESTURE:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_MultiGestureEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_MultiGestureEvent;
   case SDL_DROPFILE:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_DropEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_DropEvent;
   case SDL_USEREVENT:
-    return mrb_obj_value(Data_Wrap_Struct(mrb, class_UserEvent, &mrb_sdl2_input_event_data_type, data));
+    return class_UserEvent;
   case SDL_AUDIODEVICEADDED:
   case SDL_AUDIODEVICEREMOVED:
   case SDL_KEYMAPCHANGED:
   case SDL_CLIPBOARDUPDATE:
-    break; /* missing event */
+    return class_Event; /* missing event */
   default:
-    if (event->type > SDL_USEREVENT) {
-      return mrb_obj_value(Data_Wrap_Struct(mrb, class_UserEvent, &mrb_sdl2_input_event_data_type, data));
-    } else {
-      mrb_free(mrb, data);
-      printf("event type is %d, ", event->type);
-      mrb_raise(mrb, E_RUNTIME_ERROR, "undefined event type.");
+    if (type > SDL_USEREVENT) {
+      return class_UserEvent;
     }
     break;
   }
+  return NULL;
+}
 
-  mrb_free(mrb, data);
-  return mrb_nil_value();
+/*
+ * Returns true for event types that SDL2::Input.poll can turn into an
+ * object (possibly nil for types without a class of their own).
+ */
+mrb_bool
+mrb_sdl2_input_event_type_p(Uint32 type)
+{
+  return NULL != mrb_sdl2_input_event_class(type);
+}
+
+/*
+ * Returns the windowID carried by an event, or 0 for event types that are
+ * not bound to a window.
+ */
+Uint32
+mrb_sdl2_input_event_window_id(SDL_Event const *event)
+{
+  switch (event->type) {
+  case SDL_WINDOWEVENT:
+    return event->window.windowID;
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+    return event->key.windowID;
+  case SDL_TEXTEDITING:
+    return event->edit.windowID;
+  case SDL_TEXTINPUT:
+    return event->text.windowID;
+  case SDL_MOUSEMOTION:
+    return event->motion.windowID;
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    return event->button.windowID;
+  case SDL_MOUSEWHEEL:
+    return event->wheel.windowID;
+  default:
+    if (event->type >= SDL_USEREVENT) {
+      return event->user.windowID;
+    }
+    break;
+  }
+  return 0;
+}
+
+mrb_value
+mrb_sdl2_input_event(mrb_state *mrb, SDL_Event const *event)
+{
+  mrb_sdl2_input_event_data_t *data;
+  struct RClass *klass;
+  if (NULL == event) {
+    return mrb_nil_value();
+  }
+
+  klass = mrb_sdl2_input_event_class(event->type);
+  if (NULL == klass) {
+    mrb_raisef(mrb, E_RUNTIME_ERROR, "undefined event type %S.", mrb_fixnum_value(event->type));
+  }
+  if (class_Event == klass) {
+    return mrb_nil_value(); /* missing event */
+  }
+
+  data = (mrb_sdl2_input_event_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_input_event_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  data->event = *event;
+  return mrb_obj_value(Data_Wrap_Struct(mrb, klass, &mrb_sdl2_input_event_data_type, data));
 }
 
 /***************************************************************************
@@ -164,8 +228,11 @@ mrb_sdl2_input_poll(mrb_state *mrb, mrb_value mod)
 {
   SDL_Event event;
   if (0 == SDL_PollEvent(&event)) {
-    return mrb_nil_value();
+    if ((0 == mrb_sdl2_input_filter_release()) || (0 == SDL_PollEvent(&event))) {
+      return mrb_nil_value();
+    }
   }
+  mrb_sdl2_input_latency_polled(&event, 1);
   return mrb_sdl2_input_event(mrb, &event);
 }
 
@@ -173,9 +240,10 @@ static mrb_value
 mrb_sdl2_input_wait(mrb_state *mrb, mrb_value mod)
 {
   SDL_Event event;
-  if (0 == SDL_WaitEvent(&event)) {
+  if (0 == mrb_sdl2_input_filter_wait(&event, -1)) {
     mruby_sdl2_raise_error(mrb);
   }
+  mrb_sdl2_input_latency_polled(&event, 1);
   return mrb_sdl2_input_event(mrb, &event);
 }
 
@@ -185,12 +253,135 @@ mrb_sdl2_input_wait_timeout(mrb_state *mrb, mrb_value mod)
   mrb_int timeout;
   SDL_Event event;
   mrb_get_args(mrb, "i", &timeout);
-  if (0 == SDL_WaitEventTimeout(&event, timeout)) {
+  if (0 == mrb_sdl2_input_filter_wait(&event, (int)timeout)) {
     return mrb_nil_value();
   }
+  mrb_sdl2_input_latency_polled(&event, 1);
   return mrb_sdl2_input_event(mrb, &event);
 }
 
+/*
+ * The *_into variants below write the next event into an existing
+ * SDL2::Input::Event and switch the object's class to the subclass that
+ * matches the new event type, so a loop that reuses one Event object
+ * allocates nothing per event. The object is overwritten by every call:
+ * anything that must outlive the next poll has to be copied out of it
+ * first (or obtained from SDL2::Input.poll instead). Whatever the previous
+ * event still owned (a drop file name, user event data not read yet) is
+ * freed before it is overwritten. Singleton methods defined on the object
+ * are dropped when its class is switched.
+ */
+static mrb_sdl2_input_event_data_t *
+mrb_sdl2_input_event_data_get(mrb_state *mrb, mrb_value value)
+{
+  mrb_sdl2_input_event_data_t *data =
+    (mrb_sdl2_input_event_data_t*)mrb_data_get_ptr(mrb, value, &mrb_sdl2_input_event_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized event.");
+  }
+  return data;
+}
+
+static mrb_value
+mrb_sdl2_input_event_retag(mrb_state *mrb, mrb_value value, mrb_sdl2_input_event_data_t *data)
+{
+  struct RClass *klass = mrb_sdl2_input_event_class(data->event.type);
+  mrb_basic_ptr(value)->c = (NULL == klass) ? class_Event : klass;
+  return value;
+}
+
+/*
+ * SDL2::Input.poll_into(event)
+ *
+ * Returns event refilled with the next pending event, or nil when the queue
+ * is empty (event is left unchanged).
+ */
+static mrb_value
+mrb_sdl2_input_poll_into(mrb_state *mrb, mrb_value mod)
+{
+  mrb_value event;
+  mrb_sdl2_input_event_data_t *data;
+  SDL_Event next;
+  mrb_get_args(mrb, "o", &event);
+  data = mrb_sdl2_input_event_data_get(mrb, event);
+  if (0 == SDL_PollEvent(&next)) {
+    if ((0 == mrb_sdl2_input_filter_release()) || (0 == SDL_PollEvent(&next))) {
+      return mrb_nil_value();
+    }
+  }
+  mrb_sdl2_input_latency_polled(&next, 1);
+  mrb_sdl2_input_event_discard(mrb, &data->event);
+  data->event = next;
+  return mrb_sdl2_input_event_retag(mrb, event, data);
+}
+
+/*
+ * SDL2::Input.wait_into(event)
+ */
+static mrb_value
+mrb_sdl2_input_wait_into(mrb_state *mrb, mrb_value mod)
+{
+  mrb_value event;
+  mrb_sdl2_input_event_data_t *data;
+  SDL_Event next;
+  mrb_get_args(mrb, "o", &event);
+  data = mrb_sdl2_input_event_data_get(mrb, event);
+  if (0 == mrb_sdl2_input_filter_wait(&next, -1)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  mrb_sdl2_input_latency_polled(&next, 1);
+  mrb_sdl2_input_event_discard(mrb, &data->event);
+  data->event = next;
+  return mrb_sdl2_input_event_retag(mrb, event, data);
+}
+
+/*
+ * SDL2::Input.wait_timeout_into(event, timeout)
+ *
+ * Returns event refilled with the next event, or nil if none arrived
+ * within timeout milliseconds.
+ */
+static mrb_value
+mrb_sdl2_input_wait_timeout_into(mrb_state *mrb, mrb_value mod)
+{
+  mrb_value event;
+  mrb_int timeout;
+  mrb_sdl2_input_event_data_t *data;
+  SDL_Event next;
+  mrb_get_args(mrb, "oi", &event, &timeout);
+  data = mrb_sdl2_input_event_data_get(mrb, event);
+  if (0 == mrb_sdl2_input_filter_wait(&next, (int)timeout)) {
+    return mrb_nil_value();
+  }
+  mrb_sdl2_input_latency_polled(&next, 1);
+  mrb_sdl2_input_event_discard(mrb, &data->event);
+  data->event = next;
+  return mrb_sdl2_input_event_retag(mrb, event, data);
+}
+
+/*
+ * SDL2::Input::Event#initialize
+ *
+ * Creates an empty event (type SDL_FIRSTEVENT), mainly as a reusable target
+ * for SDL2::Input.poll_into and friends.
+ */
+static mrb_value
+mrb_sdl2_input_event_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_event_data_t *data =
+    (mrb_sdl2_input_event_data_t*)DATA_PTR(self);
+  if (NULL == data) {
+    data = (mrb_sdl2_input_event_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_input_event_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+  }
+  data->event = (SDL_Event){ 0 };
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_input_event_data_type;
+  return self;
+}
+
 
 static mrb_value
 mrb_sdl2_input_event_get_type(mrb_state *mrb, mrb_value self)
@@ -262,6 +453,11 @@ mrb_sdl2_input_push(mrb_state *mrb, mrb_value self)
   if (0 > ret) {
     mruby_sdl2_raise_error(mrb);
   }
+  if ((0 < ret) && (data->event.type >= SDL_USEREVENT)) {
+    /* the queued copy owns the data now. */
+    data->event.user.data1 = NULL;
+    data->event.user.data2 = NULL;
+  }
   return mrb_fixnum_value(ret);
 }
 
@@ -380,6 +576,28 @@ mrb_sdl2_input_mousebuttonevent_get_y(mrb_state *mrb, mrb_value self)
 *
 ***************************************************************************/
 
+/*
+ * SDL2::Input::MouseMotionEvent#initialize(x = 0, y = 0, xrel = 0, yrel = 0, state = 0)
+ *
+ * Builds a motion event, e.g. to push or to feed a sample recorder.
+ */
+static mrb_value
+mrb_sdl2_input_mousemotionevent_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x = 0, y = 0, xrel = 0, yrel = 0, state = 0;
+  mrb_sdl2_input_event_data_t *data;
+  mrb_get_args(mrb, "|iiiii", &x, &y, &xrel, &yrel, &state);
+  mrb_sdl2_input_event_initialize(mrb, self);
+  data = (mrb_sdl2_input_event_data_t*)DATA_PTR(self);
+  data->event.motion.type  = SDL_MOUSEMOTION;
+  data->event.motion.x     = (Sint32)x;
+  data->event.motion.y     = (Sint32)y;
+  data->event.motion.xrel  = (Sint32)xrel;
+  data->event.motion.yrel  = (Sint32)yrel;
+  data->event.motion.state = (Uint32)state;
+  return self;
+}
+
 static mrb_value
 mrb_sdl2_input_mousemotionevent_get_timestamp(mrb_state *mrb, mrb_value self)
 {
@@ -543,6 +761,7 @@ mrb_sdl2_input_to_voidp(mrb_state *mrb, mrb_value data)
       mrb_free(mrb, udata);
       mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
     }
+    memcpy(str, RSTRING_PTR(data), len);
     str[len] = '\0';
     udata->data.string_value = str;
     break;
@@ -590,6 +809,53 @@ mrb_sdl2_input_to_value(mrb_state *mrb, void *data)
   return value;
 }
 
+static void
+mrb_sdl2_input_free_user_data(mrb_state *mrb, void *data)
+{
+  mrb_sdl2_input_user_data_t *udata =
+    (mrb_sdl2_input_user_data_t*)data;
+  if (NULL == udata) {
+    return;
+  }
+  if (MRB_TT_STRING == udata->type) {
+    mrb_free(mrb, udata->data.string_value);
+  }
+  mrb_free(mrb, udata);
+}
+
+/*
+ * Frees what an event that will never become a Ruby object owns: the
+ * string of drop and long text editing events, and the data attached to
+ * user events by SDL2::Input::UserEvent.
+ */
+void
+mrb_sdl2_input_event_discard(mrb_state *mrb, SDL_Event *event)
+{
+  switch (event->type) {
+  case SDL_DROPFILE:
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+  case SDL_DROPTEXT:
+#endif
+    SDL_free(event->drop.file);
+    event->drop.file = NULL;
+    return;
+#if SDL_VERSION_ATLEAST(2, 0, 22)
+  case SDL_TEXTEDITING_EXT:
+    SDL_free(event->editExt.text);
+    event->editExt.text = NULL;
+    return;
+#endif
+  default:
+    break;
+  }
+  if (event->type >= SDL_USEREVENT) {
+    mrb_sdl2_input_free_user_data(mrb, event->user.data1);
+    mrb_sdl2_input_free_user_data(mrb, event->user.data2);
+    event->user.data1 = NULL;
+    event->user.data2 = NULL;
+  }
+}
+
 static mrb_value
 mrb_sdl2_input_userevent_initialize(mrb_state *mrb, mrb_value self)
 {
@@ -699,7 +965,10 @@ mrb_sdl2_input_userevent_get_data1(mrb_state *mrb, mrb_value self)
 {
   mrb_sdl2_input_event_data_t *data =
     (mrb_sdl2_input_event_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_input_event_data_type);
-  return mrb_sdl2_input_to_value(mrb, data->event.user.data1);
+  void *udata = data->event.user.data1;
+  /* converting frees the data, so the event must not keep it. */
+  data->event.user.data1 = NULL;
+  return mrb_sdl2_input_to_value(mrb, udata);
 }
 
 static mrb_value
@@ -708,8 +977,11 @@ mrb_sdl2_input_userevent_set_data1(mrb_state *mrb, mrb_value self)
   mrb_sdl2_input_event_data_t *data =
     (mrb_sdl2_input_event_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_input_event_data_type);
   mrb_value data1;
+  void *udata;
   mrb_get_args(mrb, "o", &data1);
-  data->event.user.data1 = mrb_sdl2_input_to_voidp(mrb, data1);
+  udata = mrb_sdl2_input_to_voidp(mrb, data1);
+  mrb_sdl2_input_free_user_data(mrb, data->event.user.data1);
+  data->event.user.data1 = udata;
   return self;
 }
 
@@ -718,7 +990,10 @@ mrb_sdl2_input_userevent_get_data2(mrb_state *mrb, mrb_value self)
 {
   mrb_sdl2_input_event_data_t *data =
     (mrb_sdl2_input_event_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_input_event_data_type);
-  return mrb_sdl2_input_to_value(mrb, data->event.user.data2);
+  void *udata = data->event.user.data2;
+  /* converting frees the data, so the event must not keep it. */
+  data->event.user.data2 = NULL;
+  return mrb_sdl2_input_to_value(mrb, udata);
 }
 
 static mrb_value
@@ -727,8 +1002,11 @@ mrb_sdl2_input_userevent_set_data2(mrb_state *mrb, mrb_value self)
   mrb_sdl2_input_event_data_t *data =
     (mrb_sdl2_input_event_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_input_event_data_type);
   mrb_value data2;
+  void *udata;
   mrb_get_args(mrb, "o", &data2);
-  data->event.user.data2 = mrb_sdl2_input_to_voidp(mrb, data2);
+  udata = mrb_sdl2_input_to_voidp(mrb, data2);
+  mrb_sdl2_input_free_user_data(mrb, data->event.user.data2);
+  data->event.user.data2 = udata;
   return self;
 }
 
@@ -839,6 +1117,9 @@ mruby_sdl2_events_init(mrb_state *mrb)
   mrb_define_module_function(mrb, mod_Input, "poll",            mrb_sdl2_input_poll,              MRB_ARGS_NONE());
   mrb_define_module_function(mrb, mod_Input, "wait",            mrb_sdl2_input_wait,              MRB_ARGS_NONE());
   mrb_define_module_function(mrb, mod_Input, "wait_timeout",    mrb_sdl2_input_wait_timeout,      MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Input, "poll_into",         mrb_sdl2_input_poll_into,         MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Input, "wait_into",         mrb_sdl2_input_wait_into,         MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Input, "wait_timeout_into", mrb_sdl2_input_wait_timeout_into, MRB_ARGS_REQ(2));
   mrb_define_module_function(mrb, mod_Input, "event_state",     mrb_sdl2_input_event_state,       MRB_ARGS_REQ(2));
   mrb_define_module_function(mrb, mod_Input, "flush",           mrb_sdl2_input_flush_event,       MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
   mrb_define_module_function(mrb, mod_Input, "has_events?",     mrb_sdl2_input_has_events,        MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
@@ -846,6 +1127,7 @@ mruby_sdl2_events_init(mrb_state *mrb)
   mrb_define_module_function(mrb, mod_Input, "register",        mrb_sdl2_input_register,          MRB_ARGS_REQ(1));
   mrb_define_module_function(mrb, mod_Input, "push",            mrb_sdl2_input_push,              MRB_ARGS_REQ(1));
 
+  mrb_define_method(mrb, class_Event, "initialize", mrb_sdl2_input_event_initialize, MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Event, "type", mrb_sdl2_input_event_get_type, MRB_ARGS_NONE());
 
   mrb_define_method(mrb, class_KeyboardEvent, "timestamp", mrb_sdl2_input_keyboardevent_get_timestamp, MRB_ARGS_NONE());
@@ -862,6 +1144,7 @@ mruby_sdl2_events_init(mrb_state *mrb)
   mrb_define_method(mrb, class_MouseButtonEvent, "x",         mrb_sdl2_input_mousebuttonevent_get_x,         MRB_ARGS_NONE());
   mrb_define_method(mrb, class_MouseButtonEvent, "y",         mrb_sdl2_input_mousebuttonevent_get_y,         MRB_ARGS_NONE());
 
+  mrb_define_method(mrb, class_MouseMotionEvent, "initialize", mrb_sdl2_input_mousemotionevent_initialize, MRB_ARGS_OPT(5));
   mrb_define_method(mrb, class_MouseMotionEvent, "timestamp", mrb_sdl2_input_mousemotionevent_get_timestamp, MRB_ARGS_NONE());
   mrb_define_method(mrb, class_MouseMotionEvent, "window_id", mrb_sdl2_input_mousemotionevent_get_window_id, MRB_ARGS_NONE());
   mrb_define_method(mrb, class_MouseMotionEvent, "which",     mrb_sdl2_input_mousemotionevent_get_which,     MRB_ARGS_NONE());
@@ -970,10 +1253,25 @@ mruby_sdl2_events_init(mrb_state *mrb)
   mrb_define_const(mrb, mod_Input, "SDL_ENABLE",  mrb_fixnum_value(SDL_ENABLE));
 
   mrb_gc_arena_restore(mrb, arena_size);
+
+  mruby_sdl2_events_buffer_init(mrb, mod_Input);
+  mruby_sdl2_events_filter_init(mrb, mod_Input);
+  mruby_sdl2_events_recorder_init(mrb, mod_Input);
+  mruby_sdl2_events_dispatcher_init(mrb, mod_Input);
+  mruby_sdl2_events_latency_init(mrb, mod_Input);
+  mruby_sdl2_events_channel_init(mrb, mod_Input);
+  mruby_sdl2_events_action_map_init(mrb, mod_Input);
 }
 
 void
 mruby_sdl2_events_final(mrb_state *mrb)
 {
+  mruby_sdl2_events_action_map_final(mrb, mod_Input);
+  mruby_sdl2_events_channel_final(mrb, mod_Input);
+  mruby_sdl2_events_latency_final(mrb, mod_Input);
+  mruby_sdl2_events_dispatcher_final(mrb, mod_Input);
+  mruby_sdl2_events_recorder_final(mrb, mod_Input);
+  mruby_sdl2_events_filter_final(mrb, mod_Input);
+  mruby_sdl2_events_buffer_final(mrb, mod_Input);
 }
 
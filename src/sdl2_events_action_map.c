@@ -0,0 +1,736 @@
+#include "sdl2_events_action_map.h"
+#include "sdl2_events.h"
+#include "sdl2_events_filter.h"
+#include "sdl2_gamecontroller.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_keyboard.h>
+#include <SDL2/SDL_mouse.h>
+
+#define MRB_SDL2_ACTION_MAP_MAX_ACTIONS  256
+#define MRB_SDL2_ACTION_MAP_MOUSE        32
+#define MRB_SDL2_ACTION_MAP_JOY_BUTTONS  64
+#define MRB_SDL2_ACTION_MAP_PADS         8
+#define MRB_SDL2_ACTION_MAP_MASK_BITS    ((int)(sizeof(mrb_int) * 8) - 2)
+
+/* bits of an action state */
+#define MRB_SDL2_ACTION_HELD     0x01
+#define MRB_SDL2_ACTION_PRESSED  0x02
+#define MRB_SDL2_ACTION_RELEASED 0x04
+
+typedef struct mrb_sdl2_action_map_axis_t {
+  Uint16 action;      /* action + 1, 0 when unbound */
+  Sint16 threshold;
+} mrb_sdl2_action_map_axis_t;
+
+/*
+ * Which directions of each axis are past their threshold, per controller.
+ * A slot with no active direction is free for the next controller.
+ */
+typedef struct mrb_sdl2_action_map_pad_t {
+  SDL_JoystickID which;
+  int            active_count;
+  mrb_bool       active[SDL_CONTROLLER_AXIS_MAX][2];
+} mrb_sdl2_action_map_pad_t;
+
+/*
+ * Bindings are stored as dense tables indexed by scancode or button that
+ * hold action + 1 (0 = unbound); each input maps to one action, an action
+ * may have many inputs. Axes have one binding per direction, shared by
+ * all controllers; up to MRB_SDL2_ACTION_MAP_PADS controllers can hold
+ * axis actions at the same time.
+ *
+ * 'holders' counts the inputs currently holding each action and 'latches'
+ * collects press/release edges as they happen, so a tap shorter than a
+ * frame is still seen. Both are written by the event watch, possibly from
+ * another thread, and guarded by 'lock'. 'state' is what Ruby reads: it
+ * is rebuilt from them by ActionMap#update and stays fixed in between.
+ */
+typedef struct mrb_sdl2_action_map_data_t {
+  SDL_SpinLock lock;
+  int          count;
+  mrb_bool     attached;
+  Uint16       keys[SDL_NUM_SCANCODES];
+  Uint16       mouse[MRB_SDL2_ACTION_MAP_MOUSE];
+  Uint16       joy_buttons[MRB_SDL2_ACTION_MAP_JOY_BUTTONS];
+  Uint16       buttons[SDL_CONTROLLER_BUTTON_MAX];
+  mrb_sdl2_action_map_axis_t axes[SDL_CONTROLLER_AXIS_MAX][2];
+  mrb_sdl2_action_map_pad_t pads[MRB_SDL2_ACTION_MAP_PADS];
+  Uint8        holders[MRB_SDL2_ACTION_MAP_MAX_ACTIONS];
+  Uint8        latches[MRB_SDL2_ACTION_MAP_MAX_ACTIONS];
+  Uint8        state[MRB_SDL2_ACTION_MAP_MAX_ACTIONS];
+} mrb_sdl2_action_map_data_t;
+
+static int SDLCALL mrb_sdl2_action_map_watch(void *userdata, SDL_Event *event);
+
+static void
+mrb_sdl2_action_map_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_action_map_data_t *data =
+    (mrb_sdl2_action_map_data_t*)p;
+  if (NULL != data) {
+    if (data->attached) {
+      mrb_sdl2_input_filter_del_watch(mrb_sdl2_action_map_watch, data);
+    }
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_action_map_data_type = {
+  "ActionMap", mrb_sdl2_action_map_data_free
+};
+
+static mrb_sdl2_action_map_data_t *
+mrb_sdl2_action_map_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data =
+    (mrb_sdl2_action_map_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_action_map_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized action map.");
+  }
+  return data;
+}
+
+static int
+mrb_sdl2_action_map_action_arg(mrb_state *mrb, mrb_sdl2_action_map_data_t const *data, mrb_int action)
+{
+  if ((0 > action) || (data->count <= action)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "action out of range.");
+  }
+  return (int)action;
+}
+
+static void
+mrb_sdl2_action_map_press(mrb_sdl2_action_map_data_t *data, Uint16 binding)
+{
+  if (0 != binding) {
+    Uint8 *holders = &data->holders[binding - 1];
+    if (0 == *holders) {
+      data->latches[binding - 1] |= MRB_SDL2_ACTION_PRESSED;
+    }
+    if (0xff > *holders) {
+      ++*holders;
+    }
+  }
+}
+
+static void
+mrb_sdl2_action_map_release(mrb_sdl2_action_map_data_t *data, Uint16 binding)
+{
+  if (0 != binding) {
+    Uint8 *holders = &data->holders[binding - 1];
+    if ((0 < *holders) && (0 == --*holders)) {
+      data->latches[binding - 1] |= MRB_SDL2_ACTION_RELEASED;
+    }
+  }
+}
+
+/* releases every action, e.g. after the bindings changed under held inputs. */
+static void
+mrb_sdl2_action_map_release_all(mrb_sdl2_action_map_data_t *data)
+{
+  int i;
+  for (i = 0; i < MRB_SDL2_ACTION_MAP_MAX_ACTIONS; ++i) {
+    if (0 != data->holders[i]) {
+      data->holders[i] = 0;
+      data->latches[i] |= MRB_SDL2_ACTION_RELEASED;
+    }
+  }
+  SDL_memset(data->pads, 0, sizeof(data->pads));
+}
+
+/*
+ * Returns the axis state of a controller, claiming a free slot for it if
+ * it has none, or NULL when every slot is held by other controllers.
+ */
+static mrb_sdl2_action_map_pad_t *
+mrb_sdl2_action_map_pad(mrb_sdl2_action_map_data_t *data, SDL_JoystickID which)
+{
+  mrb_sdl2_action_map_pad_t *free_pad = NULL;
+  int i;
+  for (i = 0; i < MRB_SDL2_ACTION_MAP_PADS; ++i) {
+    mrb_sdl2_action_map_pad_t *pad = &data->pads[i];
+    if (0 == pad->active_count) {
+      if (NULL == free_pad) {
+        free_pad = pad;
+      }
+    } else if (which == pad->which) {
+      return pad;
+    }
+  }
+  if (NULL != free_pad) {
+    free_pad->which = which;
+  }
+  return free_pad;
+}
+
+/* releases the axis actions a controller holds, e.g. once it is removed. */
+static void
+mrb_sdl2_action_map_release_pad(mrb_sdl2_action_map_data_t *data, SDL_JoystickID which)
+{
+  int i, axis, direction;
+  for (i = 0; i < MRB_SDL2_ACTION_MAP_PADS; ++i) {
+    mrb_sdl2_action_map_pad_t *pad = &data->pads[i];
+    if ((0 == pad->active_count) || (which != pad->which)) {
+      continue;
+    }
+    for (axis = 0; axis < SDL_CONTROLLER_AXIS_MAX; ++axis) {
+      for (direction = 0; direction < 2; ++direction) {
+        if (pad->active[axis][direction]) {
+          mrb_sdl2_action_map_release(data, data->axes[axis][direction].action);
+        }
+      }
+    }
+    SDL_memset(pad, 0, sizeof(*pad));
+  }
+}
+
+static mrb_bool
+mrb_sdl2_action_map_axis_active(mrb_sdl2_action_map_axis_t const *binding, Sint16 value)
+{
+  if (0 < binding->threshold) {
+    return value >= binding->threshold;
+  }
+  return value <= binding->threshold;
+}
+
+/* updates holders and latches from one event; the lock is held. */
+static void
+mrb_sdl2_action_map_handle(mrb_sdl2_action_map_data_t *data, SDL_Event const *event)
+{
+  switch (event->type) {
+  case SDL_KEYDOWN:
+    if ((0 == event->key.repeat) && (SDL_NUM_SCANCODES > (unsigned)event->key.keysym.scancode)) {
+      mrb_sdl2_action_map_press(data, data->keys[event->key.keysym.scancode]);
+    }
+    break;
+  case SDL_KEYUP:
+    if (SDL_NUM_SCANCODES > (unsigned)event->key.keysym.scancode) {
+      mrb_sdl2_action_map_release(data, data->keys[event->key.keysym.scancode]);
+    }
+    break;
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    if (MRB_SDL2_ACTION_MAP_MOUSE > event->button.button) {
+      if (SDL_MOUSEBUTTONDOWN == event->type) {
+        mrb_sdl2_action_map_press(data, data->mouse[event->button.button]);
+      } else {
+        mrb_sdl2_action_map_release(data, data->mouse[event->button.button]);
+      }
+    }
+    break;
+  case SDL_JOYBUTTONDOWN:
+  case SDL_JOYBUTTONUP:
+    if (MRB_SDL2_ACTION_MAP_JOY_BUTTONS > event->jbutton.button) {
+      if (SDL_JOYBUTTONDOWN == event->type) {
+        mrb_sdl2_action_map_press(data, data->joy_buttons[event->jbutton.button]);
+      } else {
+        mrb_sdl2_action_map_release(data, data->joy_buttons[event->jbutton.button]);
+      }
+    }
+    break;
+  case SDL_CONTROLLERBUTTONDOWN:
+  case SDL_CONTROLLERBUTTONUP:
+    if (SDL_CONTROLLER_BUTTON_MAX > event->cbutton.button) {
+      if (SDL_CONTROLLERBUTTONDOWN == event->type) {
+        mrb_sdl2_action_map_press(data, data->buttons[event->cbutton.button]);
+      } else {
+        mrb_sdl2_action_map_release(data, data->buttons[event->cbutton.button]);
+      }
+    }
+    break;
+  case SDL_CONTROLLERAXISMOTION:
+    if (SDL_CONTROLLER_AXIS_MAX > event->caxis.axis) {
+      mrb_sdl2_action_map_pad_t *pad = mrb_sdl2_action_map_pad(data, event->caxis.which);
+      int direction;
+      for (direction = 0; (NULL != pad) && (direction < 2); ++direction) {
+        mrb_sdl2_action_map_axis_t const *binding = &data->axes[event->caxis.axis][direction];
+        mrb_bool *active = &pad->active[event->caxis.axis][direction];
+        mrb_bool now;
+        if (0 == binding->action) {
+          continue;
+        }
+        now = mrb_sdl2_action_map_axis_active(binding, event->caxis.value);
+        if (now && !*active) {
+          mrb_sdl2_action_map_press(data, binding->action);
+          ++pad->active_count;
+        } else if (!now && *active) {
+          mrb_sdl2_action_map_release(data, binding->action);
+          --pad->active_count;
+        }
+        *active = now;
+      }
+    }
+    break;
+  case SDL_CONTROLLERDEVICEREMOVED:
+    mrb_sdl2_action_map_release_pad(data, event->cdevice.which);
+    break;
+  default:
+    break;
+  }
+}
+
+static int SDLCALL
+mrb_sdl2_action_map_watch(void *userdata, SDL_Event *event)
+{
+  mrb_sdl2_action_map_data_t *data = (mrb_sdl2_action_map_data_t*)userdata;
+  SDL_AtomicLock(&data->lock);
+  mrb_sdl2_action_map_handle(data, event);
+  SDL_AtomicUnlock(&data->lock);
+  return 1;
+}
+
+/***************************************************************************
+*
+* class SDL2::Input::ActionMap
+*
+***************************************************************************/
+
+/*
+ * SDL2::Input::ActionMap#initialize(count = 64)
+ *
+ * Creates a map for actions 0...count (at most 256), with no bindings.
+ */
+static mrb_value
+mrb_sdl2_action_map_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data;
+  mrb_int count = 64;
+  mrb_get_args(mrb, "|i", &count);
+  if ((0 >= count) || (MRB_SDL2_ACTION_MAP_MAX_ACTIONS < count)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "action count out of range.");
+  }
+
+  data = (mrb_sdl2_action_map_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_action_map_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+
+  data = (mrb_sdl2_action_map_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_action_map_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  SDL_memset(data, 0, sizeof(mrb_sdl2_action_map_data_t));
+  data->count = (int)count;
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_action_map_data_type;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_action_map_get_count(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_action_map_get_ptr(mrb, self)->count);
+}
+
+/*
+ * Stores 'action' into one slot of a binding table. Changing bindings
+ * releases every held action.
+ */
+static mrb_value
+mrb_sdl2_action_map_bind_in(mrb_state *mrb, mrb_value self, Uint16 *table, mrb_int size)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  mrb_int action, code;
+  mrb_get_args(mrb, "ii", &action, &code);
+  mrb_sdl2_action_map_action_arg(mrb, data, action);
+  if ((0 > code) || (size <= code)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "key or button out of range.");
+  }
+  SDL_AtomicLock(&data->lock);
+  table[code] = (Uint16)(action + 1);
+  mrb_sdl2_action_map_release_all(data);
+  SDL_AtomicUnlock(&data->lock);
+  return self;
+}
+
+/*
+ * SDL2::Input::ActionMap#bind_key(action, scancode)
+ */
+static mrb_value
+mrb_sdl2_action_map_bind_key(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  return mrb_sdl2_action_map_bind_in(mrb, self, data->keys, SDL_NUM_SCANCODES);
+}
+
+/*
+ * SDL2::Input::ActionMap#bind_mouse(action, button)
+ */
+static mrb_value
+mrb_sdl2_action_map_bind_mouse(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  return mrb_sdl2_action_map_bind_in(mrb, self, data->mouse, MRB_SDL2_ACTION_MAP_MOUSE);
+}
+
+/*
+ * SDL2::Input::ActionMap#bind_joy_button(action, button)
+ */
+static mrb_value
+mrb_sdl2_action_map_bind_joy_button(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  return mrb_sdl2_action_map_bind_in(mrb, self, data->joy_buttons, MRB_SDL2_ACTION_MAP_JOY_BUTTONS);
+}
+
+/*
+ * SDL2::Input::ActionMap#bind_button(action, controller_button)
+ */
+static mrb_value
+mrb_sdl2_action_map_bind_button(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  return mrb_sdl2_action_map_bind_in(mrb, self, data->buttons, SDL_CONTROLLER_BUTTON_MAX);
+}
+
+/*
+ * SDL2::Input::ActionMap#bind_axis(action, controller_axis, threshold)
+ *
+ * The action is held while the axis value is at or beyond threshold: at
+ * or above a positive threshold, at or below a negative one. Each axis
+ * takes one binding per direction.
+ */
+static mrb_value
+mrb_sdl2_action_map_bind_axis(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  mrb_sdl2_action_map_axis_t *binding;
+  mrb_int action, axis, threshold;
+  mrb_get_args(mrb, "iii", &action, &axis, &threshold);
+  mrb_sdl2_action_map_action_arg(mrb, data, action);
+  if ((0 > axis) || (SDL_CONTROLLER_AXIS_MAX <= axis)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "axis out of range.");
+  }
+  if ((0 == threshold) || (-32768 > threshold) || (32767 < threshold)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "threshold out of range.");
+  }
+  SDL_AtomicLock(&data->lock);
+  binding = &data->axes[axis][(0 < threshold) ? 0 : 1];
+  binding->action    = (Uint16)(action + 1);
+  binding->threshold = (Sint16)threshold;
+  mrb_sdl2_action_map_release_all(data);
+  SDL_AtomicUnlock(&data->lock);
+  return self;
+}
+
+static void
+mrb_sdl2_action_map_unbind_table(Uint16 *table, int size, Uint16 binding)
+{
+  int i;
+  for (i = 0; i < size; ++i) {
+    if (binding == table[i]) {
+      table[i] = 0;
+    }
+  }
+}
+
+/*
+ * SDL2::Input::ActionMap#unbind(action)
+ *
+ * Removes every binding of the action.
+ */
+static mrb_value
+mrb_sdl2_action_map_unbind(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  mrb_int action;
+  Uint16 binding;
+  int i;
+  mrb_get_args(mrb, "i", &action);
+  binding = (Uint16)(mrb_sdl2_action_map_action_arg(mrb, data, action) + 1);
+  SDL_AtomicLock(&data->lock);
+  mrb_sdl2_action_map_unbind_table(data->keys,        SDL_NUM_SCANCODES,                binding);
+  mrb_sdl2_action_map_unbind_table(data->mouse,       MRB_SDL2_ACTION_MAP_MOUSE,        binding);
+  mrb_sdl2_action_map_unbind_table(data->joy_buttons, MRB_SDL2_ACTION_MAP_JOY_BUTTONS,  binding);
+  mrb_sdl2_action_map_unbind_table(data->buttons,     SDL_CONTROLLER_BUTTON_MAX,        binding);
+  for (i = 0; i < SDL_CONTROLLER_AXIS_MAX; ++i) {
+    if (binding == data->axes[i][0].action) {
+      data->axes[i][0].action = 0;
+    }
+    if (binding == data->axes[i][1].action) {
+      data->axes[i][1].action = 0;
+    }
+  }
+  mrb_sdl2_action_map_release_all(data);
+  SDL_AtomicUnlock(&data->lock);
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_action_map_clear(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  SDL_AtomicLock(&data->lock);
+  SDL_memset(data->keys,        0, sizeof(data->keys));
+  SDL_memset(data->mouse,       0, sizeof(data->mouse));
+  SDL_memset(data->joy_buttons, 0, sizeof(data->joy_buttons));
+  SDL_memset(data->buttons,     0, sizeof(data->buttons));
+  SDL_memset(data->axes,        0, sizeof(data->axes));
+  mrb_sdl2_action_map_release_all(data);
+  SDL_AtomicUnlock(&data->lock);
+  return self;
+}
+
+/*
+ * SDL2::Input::ActionMap#attach
+ *
+ * Feeds every event SDL queues into the map from an event watch, so the
+ * map stays current whatever the application does with its events. Axis
+ * events held by SDL2::Input::Filter reach the map when they are released.
+ */
+static mrb_value
+mrb_sdl2_action_map_attach(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  if (!data->attached) {
+    if (!mrb_sdl2_input_filter_add_watch(mrb_sdl2_action_map_watch, data)) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "too many event watches.");
+    }
+    data->attached = true;
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_action_map_detach(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  if (data->attached) {
+    mrb_sdl2_input_filter_del_watch(mrb_sdl2_action_map_watch, data);
+    data->attached = false;
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_action_map_is_attached(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_action_map_get_ptr(mrb, self)->attached);
+}
+
+/*
+ * SDL2::Input::ActionMap#feed(event)
+ *
+ * Applies one SDL2::Input::Event, for maps that are not attached.
+ */
+static mrb_value
+mrb_sdl2_action_map_feed(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  mrb_value event;
+  mrb_get_args(mrb, "o", &event);
+  mrb_sdl2_action_map_watch(data, mrb_sdl2_input_event_get_ptr(mrb, event));
+  return self;
+}
+
+/*
+ * SDL2::Input::ActionMap#sync(controller = nil)
+ *
+ * Recomputes the held actions from the current keyboard and mouse state
+ * and, if given, the state of an SDL2::GameControllers::GameController,
+ * instead of from events. Joystick button bindings are not polled.
+ */
+static mrb_value
+mrb_sdl2_action_map_sync(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  mrb_value controller = mrb_nil_value();
+  SDL_GameController *pad;
+  Uint16 holders[MRB_SDL2_ACTION_MAP_MAX_ACTIONS];
+  mrb_sdl2_action_map_pad_t pads[MRB_SDL2_ACTION_MAP_PADS];
+  Uint8 const *keys;
+  Uint32 buttons;
+  int i, n;
+  mrb_get_args(mrb, "|o", &controller);
+  pad = mrb_sdl2_gamecontrollers_gamecontroller_get_ptr(mrb, controller);
+
+  SDL_memset(holders, 0, sizeof(holders));
+  SDL_memset(pads, 0, sizeof(pads));
+  keys = SDL_GetKeyboardState(&n);
+  buttons = SDL_GetMouseState(NULL, NULL);
+
+  SDL_AtomicLock(&data->lock);
+  n = SDL_min(n, SDL_NUM_SCANCODES);
+  for (i = 0; i < n; ++i) {
+    if ((0 != data->keys[i]) && (0 != keys[i])) {
+      ++holders[data->keys[i] - 1];
+    }
+  }
+  for (i = 1; i < MRB_SDL2_ACTION_MAP_MOUSE; ++i) {
+    if ((0 != data->mouse[i]) && (0 != (buttons & SDL_BUTTON(i)))) {
+      ++holders[data->mouse[i] - 1];
+    }
+  }
+  if (NULL != pad) {
+    pads[0].which = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(pad));
+    for (i = 0; i < SDL_CONTROLLER_BUTTON_MAX; ++i) {
+      if ((0 != data->buttons[i]) && (0 != SDL_GameControllerGetButton(pad, (SDL_GameControllerButton)i))) {
+        ++holders[data->buttons[i] - 1];
+      }
+    }
+    for (i = 0; i < SDL_CONTROLLER_AXIS_MAX; ++i) {
+      Sint16 const value = SDL_GameControllerGetAxis(pad, (SDL_GameControllerAxis)i);
+      int direction;
+      for (direction = 0; direction < 2; ++direction) {
+        mrb_sdl2_action_map_axis_t const *binding = &data->axes[i][direction];
+        if ((0 != binding->action) && mrb_sdl2_action_map_axis_active(binding, value)) {
+          pads[0].active[i][direction] = true;
+          ++pads[0].active_count;
+          ++holders[binding->action - 1];
+        }
+      }
+    }
+  }
+  for (i = 0; i < data->count; ++i) {
+    Uint8 const count = (Uint8)SDL_min(holders[i], 0xff);
+    if ((0 == data->holders[i]) && (0 != count)) {
+      data->latches[i] |= MRB_SDL2_ACTION_PRESSED;
+    } else if ((0 != data->holders[i]) && (0 == count)) {
+      data->latches[i] |= MRB_SDL2_ACTION_RELEASED;
+    }
+    data->holders[i] = count;
+  }
+  SDL_memcpy(data->pads, pads, sizeof(pads));
+  SDL_AtomicUnlock(&data->lock);
+  return self;
+}
+
+/*
+ * SDL2::Input::ActionMap#update
+ *
+ * Publishes the input seen since the previous update: call it once per
+ * frame, after the events were pumped. An action pressed and released
+ * within one frame reads as pressed and released but not held.
+ */
+static mrb_value
+mrb_sdl2_action_map_update(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  int i;
+  SDL_AtomicLock(&data->lock);
+  for (i = 0; i < data->count; ++i) {
+    data->state[i] = data->latches[i] | ((0 != data->holders[i]) ? MRB_SDL2_ACTION_HELD : 0);
+    data->latches[i] = 0;
+  }
+  SDL_AtomicUnlock(&data->lock);
+  return self;
+}
+
+static Uint8
+mrb_sdl2_action_map_state_of(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  mrb_int action;
+  mrb_get_args(mrb, "i", &action);
+  return data->state[mrb_sdl2_action_map_action_arg(mrb, data, action)];
+}
+
+/*
+ * SDL2::Input::ActionMap#state(action)
+ *
+ * Returns the action's HELD | PRESSED | RELEASED bits as of the last
+ * update.
+ */
+static mrb_value
+mrb_sdl2_action_map_state(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_action_map_state_of(mrb, self));
+}
+
+static mrb_value
+mrb_sdl2_action_map_is_held(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(0 != (mrb_sdl2_action_map_state_of(mrb, self) & MRB_SDL2_ACTION_HELD));
+}
+
+static mrb_value
+mrb_sdl2_action_map_is_pressed(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(0 != (mrb_sdl2_action_map_state_of(mrb, self) & MRB_SDL2_ACTION_PRESSED));
+}
+
+static mrb_value
+mrb_sdl2_action_map_is_released(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(0 != (mrb_sdl2_action_map_state_of(mrb, self) & MRB_SDL2_ACTION_RELEASED));
+}
+
+/*
+ * Bit i of the result is set when action i has the state bit; only the
+ * first 62 actions fit (30 on builds with a 32 bit mrb_int).
+ */
+static mrb_value
+mrb_sdl2_action_map_mask(mrb_state *mrb, mrb_value self, Uint8 bit)
+{
+  mrb_sdl2_action_map_data_t *data = mrb_sdl2_action_map_get_ptr(mrb, self);
+  int const n = SDL_min(data->count, MRB_SDL2_ACTION_MAP_MASK_BITS);
+  mrb_int mask = 0;
+  int i;
+  for (i = 0; i < n; ++i) {
+    if (0 != (data->state[i] & bit)) {
+      mask |= (mrb_int)1 << i;
+    }
+  }
+  return mrb_fixnum_value(mask);
+}
+
+static mrb_value
+mrb_sdl2_action_map_held_mask(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_action_map_mask(mrb, self, MRB_SDL2_ACTION_HELD);
+}
+
+static mrb_value
+mrb_sdl2_action_map_pressed_mask(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_action_map_mask(mrb, self, MRB_SDL2_ACTION_PRESSED);
+}
+
+static mrb_value
+mrb_sdl2_action_map_released_mask(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_action_map_mask(mrb, self, MRB_SDL2_ACTION_RELEASED);
+}
+
+void
+mruby_sdl2_events_action_map_init(mrb_state *mrb, struct RClass *mod_Input)
+{
+  struct RClass *class_ActionMap = mrb_define_class_under(mrb, mod_Input, "ActionMap", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_ActionMap, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_ActionMap, "initialize",      mrb_sdl2_action_map_initialize,      MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_ActionMap, "count",           mrb_sdl2_action_map_get_count,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "bind_key",        mrb_sdl2_action_map_bind_key,        MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_ActionMap, "bind_mouse",      mrb_sdl2_action_map_bind_mouse,      MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_ActionMap, "bind_joy_button", mrb_sdl2_action_map_bind_joy_button, MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_ActionMap, "bind_button",     mrb_sdl2_action_map_bind_button,     MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_ActionMap, "bind_axis",       mrb_sdl2_action_map_bind_axis,       MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, class_ActionMap, "unbind",          mrb_sdl2_action_map_unbind,          MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_ActionMap, "clear",           mrb_sdl2_action_map_clear,           MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "attach",          mrb_sdl2_action_map_attach,          MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "detach",          mrb_sdl2_action_map_detach,          MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "attached?",       mrb_sdl2_action_map_is_attached,     MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "feed",            mrb_sdl2_action_map_feed,            MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_ActionMap, "sync",            mrb_sdl2_action_map_sync,            MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_ActionMap, "update",          mrb_sdl2_action_map_update,          MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "state",           mrb_sdl2_action_map_state,           MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_ActionMap, "held?",           mrb_sdl2_action_map_is_held,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_ActionMap, "pressed?",        mrb_sdl2_action_map_is_pressed,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_ActionMap, "released?",       mrb_sdl2_action_map_is_released,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_ActionMap, "held_mask",       mrb_sdl2_action_map_held_mask,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "pressed_mask",    mrb_sdl2_action_map_pressed_mask,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ActionMap, "released_mask",   mrb_sdl2_action_map_released_mask,   MRB_ARGS_NONE());
+
+  mrb_define_const(mrb, class_ActionMap, "HELD",     mrb_fixnum_value(MRB_SDL2_ACTION_HELD));
+  mrb_define_const(mrb, class_ActionMap, "PRESSED",  mrb_fixnum_value(MRB_SDL2_ACTION_PRESSED));
+  mrb_define_const(mrb, class_ActionMap, "RELEASED", mrb_fixnum_value(MRB_SDL2_ACTION_RELEASED));
+}
+
+void
+mruby_sdl2_events_action_map_final(mrb_state *mrb, struct RClass *mod_Input)
+{
+}
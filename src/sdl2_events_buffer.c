@@ -0,0 +1,625 @@
+#include "sdl2_events_buffer.h"
+#include "sdl2_events.h"
+#include "sdl2_events_filter.h"
+#include "sdl2_events_latency.h"
+#include "mruby/data.h"
+#include "mruby/class.h"
+#include "mruby/string.h"
+#include "mruby/array.h"
+#include "mruby/variable.h"
+
+#define MRB_SDL2_EVENTS_BUFFER_DEFAULT_CAPACITY 256
+#define MRB_SDL2_EVENTS_BUFFER_MAX_CAPACITY     65536
+
+static struct RClass *class_EventBuffer = NULL;
+
+/*
+ * 'events' holds raw SDL_Event structs filled by SDL_PeepEvents; only the
+ * first 'size' entries are valid. The accessors below read fields straight
+ * out of it, so draining a frame's worth of input creates no Ruby objects
+ * except for SDL2::Input::EventBuffer#[]. The valid entries own their drop
+ * strings and user event data until they are discarded or handed to an
+ * object.
+ */
+typedef struct mrb_sdl2_events_buffer_data_t {
+  SDL_Event *events;
+  int        size;
+  int        capacity;
+} mrb_sdl2_events_buffer_data_t;
+
+static void
+mrb_sdl2_events_buffer_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_events_buffer_data_t *data =
+    (mrb_sdl2_events_buffer_data_t*)p;
+  if (NULL != data) {
+    int i;
+    for (i = 0; i < data->size; ++i) {
+      mrb_sdl2_input_event_discard(mrb, &data->events[i]);
+    }
+    mrb_free(mrb, data->events);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_events_buffer_data_type = {
+  "EventBuffer", mrb_sdl2_events_buffer_data_free
+};
+
+static mrb_sdl2_events_buffer_data_t *
+mrb_sdl2_events_buffer_get_ptr(mrb_state *mrb, mrb_value buffer)
+{
+  mrb_sdl2_events_buffer_data_t *data =
+    (mrb_sdl2_events_buffer_data_t*)mrb_data_get_ptr(mrb, buffer, &mrb_sdl2_events_buffer_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized event buffer.");
+  }
+  return data;
+}
+
+/*
+ * Drops the previous contents: frees what the events still own and
+ * forgets the SDL2::Input::UserEvent objects made by EventBuffer#[]. The
+ * data of those events already belongs to the objects.
+ */
+static void
+mrb_sdl2_events_buffer_reset(mrb_state *mrb, mrb_value buffer, mrb_sdl2_events_buffer_data_t *data)
+{
+  int i;
+  for (i = 0; i < data->size; ++i) {
+    mrb_sdl2_input_event_discard(mrb, &data->events[i]);
+  }
+  data->size = 0;
+  mrb_iv_set(mrb, buffer, mrb_intern_lit(mrb, "__user_events__"), mrb_nil_value());
+}
+
+/*
+ * Reads the index argument of a flyweight accessor and returns the event
+ * stored there.
+ */
+static SDL_Event const *
+mrb_sdl2_events_buffer_event_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_events_buffer_data_t *data = mrb_sdl2_events_buffer_get_ptr(mrb, self);
+  mrb_int index;
+  mrb_get_args(mrb, "i", &index);
+  if (0 > index) {
+    index += data->size;
+  }
+  if ((0 > index) || (data->size <= index)) {
+    mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
+  }
+  return &data->events[index];
+}
+
+/***************************************************************************
+*
+* module SDL2::Input
+*
+***************************************************************************/
+
+/*
+ * SDL2::Input.poll_all(buffer, min_type = SDL_FIRSTEVENT, max_type = SDL_LASTEVENT)
+ *
+ * Pumps the event loop, releases events held by SDL2::Input::Filter and
+ * moves up to buffer.capacity pending events into the buffer, replacing its
+ * previous contents. Returns the number of events copied; when it equals
+ * the capacity more events may still be queued.
+ */
+static mrb_value
+mrb_sdl2_input_poll_all(mrb_state *mrb, mrb_value mod)
+{
+  mrb_value buffer;
+  mrb_int min_type = SDL_FIRSTEVENT;
+  mrb_int max_type = SDL_LASTEVENT;
+  mrb_sdl2_events_buffer_data_t *data;
+  int count;
+  mrb_get_args(mrb, "o|ii", &buffer, &min_type, &max_type);
+  data = mrb_sdl2_events_buffer_get_ptr(mrb, buffer);
+
+  mrb_sdl2_events_buffer_reset(mrb, buffer, data);
+  SDL_PumpEvents();
+  mrb_sdl2_input_filter_release();
+  count = SDL_PeepEvents(data->events, data->capacity, SDL_GETEVENT,
+                         (Uint32)min_type, (Uint32)max_type);
+  if (0 > count) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  data->size = count;
+  mrb_sdl2_input_latency_polled(data->events, count);
+  return mrb_fixnum_value(count);
+}
+
+/***************************************************************************
+*
+* class SDL2::Input::EventBuffer
+*
+***************************************************************************/
+
+/*
+ * SDL2::Input::EventBuffer#initialize(capacity = 256)
+ */
+static mrb_value
+mrb_sdl2_events_buffer_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_events_buffer_data_t *data;
+  mrb_int capacity = MRB_SDL2_EVENTS_BUFFER_DEFAULT_CAPACITY;
+  mrb_get_args(mrb, "|i", &capacity);
+  if ((0 >= capacity) || (MRB_SDL2_EVENTS_BUFFER_MAX_CAPACITY < capacity)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "capacity out of range.");
+  }
+
+  data = (mrb_sdl2_events_buffer_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_events_buffer_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+
+  data = (mrb_sdl2_events_buffer_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_events_buffer_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  data->events   = NULL;
+  data->size     = 0;
+  data->capacity = 0;
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_events_buffer_data_type;
+
+  data->events = (SDL_Event*)mrb_malloc(mrb, sizeof(SDL_Event) * capacity);
+  if (NULL == data->events) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  data->capacity = (int)capacity;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_size(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_events_buffer_get_ptr(mrb, self)->size);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_capacity(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_events_buffer_get_ptr(mrb, self)->capacity);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_clear(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_events_buffer_reset(mrb, self, mrb_sdl2_events_buffer_get_ptr(mrb, self));
+  return self;
+}
+
+/*
+ * SDL2::Input::EventBuffer#each { |index| ... }
+ *
+ * Yields the index of every buffered event, for use with the accessors.
+ */
+static mrb_value
+mrb_sdl2_events_buffer_each(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_events_buffer_data_t *data = mrb_sdl2_events_buffer_get_ptr(mrb, self);
+  mrb_value block;
+  int i;
+  mrb_get_args(mrb, "&", &block);
+  if (mrb_nil_p(block)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "no block given.");
+  }
+  /* re-read size: the block may drain into this buffer again. */
+  for (i = 0; i < data->size; ++i) {
+    mrb_yield(mrb, block, mrb_fixnum_value(i));
+  }
+  return self;
+}
+
+/*
+ * SDL2::Input::EventBuffer#count(type)
+ */
+static mrb_value
+mrb_sdl2_events_buffer_count(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_events_buffer_data_t *data = mrb_sdl2_events_buffer_get_ptr(mrb, self);
+  mrb_int type;
+  int i, count = 0;
+  mrb_get_args(mrb, "i", &type);
+  for (i = 0; i < data->size; ++i) {
+    count += (data->events[i].type == (Uint32)type);
+  }
+  return mrb_fixnum_value(count);
+}
+
+/*
+ * SDL2::Input::EventBuffer#[](index)
+ *
+ * Returns a copy of the event as a regular SDL2::Input::Event subclass.
+ * UserEvent#data1/data2 consume the attached data, so user events are
+ * materialized once, the data moves to the object, and later reads return
+ * the same object.
+ */
+static mrb_value
+mrb_sdl2_events_buffer_get_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_events_buffer_data_t *data = mrb_sdl2_events_buffer_get_ptr(mrb, self);
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  mrb_sym const sym = mrb_intern_lit(mrb, "__user_events__");
+  mrb_int const index = (mrb_int)(event - data->events);
+  mrb_value cache, value;
+  if (event->type < SDL_USEREVENT) {
+    return mrb_sdl2_input_event(mrb, event);
+  }
+  cache = mrb_iv_get(mrb, self, sym);
+  if (!mrb_array_p(cache)) {
+    cache = mrb_ary_new(mrb);
+    mrb_iv_set(mrb, self, sym, cache);
+  }
+  value = mrb_ary_ref(mrb, cache, index);
+  if (mrb_nil_p(value)) {
+    value = mrb_sdl2_input_event(mrb, event);
+    mrb_ary_set(mrb, cache, index, value);
+    data->events[index].user.data1 = NULL;
+    data->events[index].user.data2 = NULL;
+  }
+  return value;
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_type(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_events_buffer_event_at(mrb, self)->type);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_timestamp(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_events_buffer_event_at(mrb, self)->common.timestamp);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_window_id(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_event_window_id(mrb_sdl2_events_buffer_event_at(mrb, self)));
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_which(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_MOUSEMOTION:
+    return mrb_fixnum_value(event->motion.which);
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    return mrb_fixnum_value(event->button.which);
+  case SDL_MOUSEWHEEL:
+    return mrb_fixnum_value(event->wheel.which);
+  case SDL_JOYAXISMOTION:
+    return mrb_fixnum_value(event->jaxis.which);
+  case SDL_JOYBALLMOTION:
+    return mrb_fixnum_value(event->jball.which);
+  case SDL_JOYHATMOTION:
+    return mrb_fixnum_value(event->jhat.which);
+  case SDL_JOYBUTTONDOWN:
+  case SDL_JOYBUTTONUP:
+    return mrb_fixnum_value(event->jbutton.which);
+  case SDL_JOYDEVICEADDED:
+  case SDL_JOYDEVICEREMOVED:
+    return mrb_fixnum_value(event->jdevice.which);
+  case SDL_CONTROLLERAXISMOTION:
+    return mrb_fixnum_value(event->caxis.which);
+  case SDL_CONTROLLERBUTTONDOWN:
+  case SDL_CONTROLLERBUTTONUP:
+    return mrb_fixnum_value(event->cbutton.which);
+  case SDL_CONTROLLERDEVICEADDED:
+  case SDL_CONTROLLERDEVICEREMOVED:
+  case SDL_CONTROLLERDEVICEREMAPPED:
+    return mrb_fixnum_value(event->cdevice.which);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_state(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+    return mrb_fixnum_value(event->key.state);
+  case SDL_MOUSEMOTION:
+    return mrb_fixnum_value(event->motion.state);
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    return mrb_fixnum_value(event->button.state);
+  case SDL_JOYBUTTONDOWN:
+  case SDL_JOYBUTTONUP:
+    return mrb_fixnum_value(event->jbutton.state);
+  case SDL_CONTROLLERBUTTONDOWN:
+  case SDL_CONTROLLERBUTTONUP:
+    return mrb_fixnum_value(event->cbutton.state);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_sym(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if ((SDL_KEYDOWN == event->type) || (SDL_KEYUP == event->type)) {
+    return mrb_fixnum_value(event->key.keysym.sym);
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_scancode(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if ((SDL_KEYDOWN == event->type) || (SDL_KEYUP == event->type)) {
+    return mrb_fixnum_value(event->key.keysym.scancode);
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_mod(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if ((SDL_KEYDOWN == event->type) || (SDL_KEYUP == event->type)) {
+    return mrb_fixnum_value(event->key.keysym.mod);
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_repeat(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if ((SDL_KEYDOWN == event->type) || (SDL_KEYUP == event->type)) {
+    return mrb_fixnum_value(event->key.repeat);
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_button(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    return mrb_fixnum_value(event->button.button);
+  case SDL_JOYBUTTONDOWN:
+  case SDL_JOYBUTTONUP:
+    return mrb_fixnum_value(event->jbutton.button);
+  case SDL_CONTROLLERBUTTONDOWN:
+  case SDL_CONTROLLERBUTTONUP:
+    return mrb_fixnum_value(event->cbutton.button);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_x(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_MOUSEMOTION:
+    return mrb_fixnum_value(event->motion.x);
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    return mrb_fixnum_value(event->button.x);
+  case SDL_MOUSEWHEEL:
+    return mrb_fixnum_value(event->wheel.x);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_y(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_MOUSEMOTION:
+    return mrb_fixnum_value(event->motion.y);
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    return mrb_fixnum_value(event->button.y);
+  case SDL_MOUSEWHEEL:
+    return mrb_fixnum_value(event->wheel.y);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_xrel(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_MOUSEMOTION:
+    return mrb_fixnum_value(event->motion.xrel);
+  case SDL_JOYBALLMOTION:
+    return mrb_fixnum_value(event->jball.xrel);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_yrel(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_MOUSEMOTION:
+    return mrb_fixnum_value(event->motion.yrel);
+  case SDL_JOYBALLMOTION:
+    return mrb_fixnum_value(event->jball.yrel);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+/*
+ * SDL2::Input::EventBuffer#axis(index)
+ *
+ * Axis number of joystick/controller axis events, hat number of joystick
+ * hat events.
+ */
+static mrb_value
+mrb_sdl2_events_buffer_get_axis(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_JOYAXISMOTION:
+    return mrb_fixnum_value(event->jaxis.axis);
+  case SDL_JOYHATMOTION:
+    return mrb_fixnum_value(event->jhat.hat);
+  case SDL_CONTROLLERAXISMOTION:
+    return mrb_fixnum_value(event->caxis.axis);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_value(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_JOYAXISMOTION:
+    return mrb_fixnum_value(event->jaxis.value);
+  case SDL_JOYHATMOTION:
+    return mrb_fixnum_value(event->jhat.value);
+  case SDL_CONTROLLERAXISMOTION:
+    return mrb_fixnum_value(event->caxis.value);
+  default:
+    break;
+  }
+  return mrb_fixnum_value(0);
+}
+
+/*
+ * SDL2::Input::EventBuffer#event(index)
+ *
+ * SDL_WindowEventID of window events.
+ */
+static mrb_value
+mrb_sdl2_events_buffer_get_event(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if (SDL_WINDOWEVENT == event->type) {
+    return mrb_fixnum_value(event->window.event);
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_data1(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if (SDL_WINDOWEVENT == event->type) {
+    return mrb_fixnum_value(event->window.data1);
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_data2(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if (SDL_WINDOWEVENT == event->type) {
+    return mrb_fixnum_value(event->window.data2);
+  }
+  return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_sdl2_events_buffer_get_code(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  if (event->type >= SDL_USEREVENT) {
+    return mrb_fixnum_value(event->user.code);
+  }
+  return mrb_fixnum_value(0);
+}
+
+/*
+ * SDL2::Input::EventBuffer#text(index)
+ *
+ * Text of text input/editing events, nil for other types. Allocates a
+ * String.
+ */
+static mrb_value
+mrb_sdl2_events_buffer_get_text(mrb_state *mrb, mrb_value self)
+{
+  SDL_Event const *event = mrb_sdl2_events_buffer_event_at(mrb, self);
+  switch (event->type) {
+  case SDL_TEXTINPUT:
+    return mrb_str_new_cstr(mrb, event->text.text);
+  case SDL_TEXTEDITING:
+    return mrb_str_new_cstr(mrb, event->edit.text);
+  default:
+    break;
+  }
+  return mrb_nil_value();
+}
+
+void
+mruby_sdl2_events_buffer_init(mrb_state *mrb, struct RClass *mod_Input)
+{
+  class_EventBuffer = mrb_define_class_under(mrb, mod_Input, "EventBuffer", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_EventBuffer, MRB_TT_DATA);
+
+  mrb_define_module_function(mrb, mod_Input, "poll_all", mrb_sdl2_input_poll_all, MRB_ARGS_REQ(1) | MRB_ARGS_OPT(2));
+
+  mrb_define_method(mrb, class_EventBuffer, "initialize", mrb_sdl2_events_buffer_initialize,    MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_EventBuffer, "size",       mrb_sdl2_events_buffer_get_size,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_EventBuffer, "length",     mrb_sdl2_events_buffer_get_size,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_EventBuffer, "capacity",   mrb_sdl2_events_buffer_get_capacity,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_EventBuffer, "clear",      mrb_sdl2_events_buffer_clear,         MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_EventBuffer, "each",       mrb_sdl2_events_buffer_each,          MRB_ARGS_BLOCK());
+  mrb_define_method(mrb, class_EventBuffer, "count",      mrb_sdl2_events_buffer_count,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "[]",         mrb_sdl2_events_buffer_get_at,        MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "type",       mrb_sdl2_events_buffer_get_type,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "timestamp",  mrb_sdl2_events_buffer_get_timestamp, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "window_id",  mrb_sdl2_events_buffer_get_window_id, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "which",      mrb_sdl2_events_buffer_get_which,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "state",      mrb_sdl2_events_buffer_get_state,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "sym",        mrb_sdl2_events_buffer_get_sym,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "key",        mrb_sdl2_events_buffer_get_sym,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "scancode",   mrb_sdl2_events_buffer_get_scancode,  MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "mod",        mrb_sdl2_events_buffer_get_mod,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "repeat",     mrb_sdl2_events_buffer_get_repeat,    MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "button",     mrb_sdl2_events_buffer_get_button,    MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "x",          mrb_sdl2_events_buffer_get_x,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "y",          mrb_sdl2_events_buffer_get_y,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "xrel",       mrb_sdl2_events_buffer_get_xrel,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "yrel",       mrb_sdl2_events_buffer_get_yrel,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "axis",       mrb_sdl2_events_buffer_get_axis,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "value",      mrb_sdl2_events_buffer_get_value,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "event",      mrb_sdl2_events_buffer_get_event,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "data1",      mrb_sdl2_events_buffer_get_data1,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "data2",      mrb_sdl2_events_buffer_get_data2,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "code",       mrb_sdl2_events_buffer_get_code,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_EventBuffer, "text",       mrb_sdl2_events_buffer_get_text,      MRB_ARGS_REQ(1));
+}
+
+void
+mruby_sdl2_events_buffer_final(mrb_state *mrb, struct RClass *mod_Input)
+{
+}
@@ -0,0 +1,742 @@
+#include "sdl2_events_channel.h"
+#include "misc.h"
+#include "mruby/array.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/hash.h"
+#include "mruby/string.h"
+#include <SDL2/SDL_atomic.h>
+
+#define MRB_SDL2_CHANNEL_MAX          32
+#define MRB_SDL2_CHANNEL_MAX_DEPTH    32
+#define MRB_SDL2_CHANNEL_MIN_CAPACITY 256
+#define MRB_SDL2_CHANNEL_POOL_MAX     1024
+#define MRB_SDL2_CHANNEL_POOL_BLOCK   (64 * 1024)
+
+/* payload value tags */
+enum {
+  MRB_SDL2_CHANNEL_TAG_NIL,
+  MRB_SDL2_CHANNEL_TAG_TRUE,
+  MRB_SDL2_CHANNEL_TAG_FALSE,
+  MRB_SDL2_CHANNEL_TAG_FIXNUM,
+  MRB_SDL2_CHANNEL_TAG_FLOAT,
+  MRB_SDL2_CHANNEL_TAG_STRING,
+  MRB_SDL2_CHANNEL_TAG_SYMBOL,
+  MRB_SDL2_CHANNEL_TAG_ARRAY,
+  MRB_SDL2_CHANNEL_TAG_HASH,
+  MRB_SDL2_CHANNEL_TAG_BUFFER
+};
+
+/*
+ * A posted message: this header followed by 'size' bytes of serialized
+ * payload, allocated as one block with SDL_malloc so that any VM can free
+ * it. Blocks are recycled through the channel's pool.
+ */
+typedef struct mrb_sdl2_channel_message_t {
+  struct mrb_sdl2_channel_message_t *next;
+  mrb_int code;
+  size_t  size;
+  size_t  capacity;
+} mrb_sdl2_channel_message_t;
+
+#define MRB_SDL2_CHANNEL_PAYLOAD(message) ((Uint8*)((message) + 1))
+
+/*
+ * A channel is shared by every VM that opened it and lives outside all of
+ * them; it is freed when the last handle is collected. 'lock' guards the
+ * message queue, the pool and the counters, and is only held for a few
+ * pointer updates: payloads are serialized and rebuilt outside of it.
+ *
+ * Messages are not carried inside SDL events. The first post into an
+ * empty channel pushes one SDL event of the channel's type, so a loop
+ * blocked in SDL2::Input.wait wakes up; further posts do not push more
+ * until the channel has been drained.
+ */
+typedef struct mrb_sdl2_channel_t {
+  SDL_SpinLock lock;
+  Uint32       type;
+  int          refs;
+  mrb_sdl2_channel_message_t *head;
+  mrb_sdl2_channel_message_t *tail;
+  mrb_sdl2_channel_message_t *pool;
+  int          pool_count;
+  int          pending;
+  mrb_bool     notified;
+  mrb_int      posted;
+  mrb_int      received;
+} mrb_sdl2_channel_t;
+
+/* open channels by event type; also guards every channel's 'refs'. */
+static SDL_SpinLock        mrb_sdl2_channel_registry_lock = 0;
+static mrb_sdl2_channel_t *mrb_sdl2_channel_registry[MRB_SDL2_CHANNEL_MAX];
+
+typedef struct mrb_sdl2_channel_data_t {
+  mrb_sdl2_channel_t *channel;
+} mrb_sdl2_channel_data_t;
+
+static void
+mrb_sdl2_channel_write32(Uint8 **cursor, Uint32 value)
+{
+  SDL_memcpy(*cursor, &value, sizeof(value));
+  *cursor += sizeof(value);
+}
+
+static Uint32
+mrb_sdl2_channel_read32(Uint8 const **cursor)
+{
+  Uint32 value;
+  SDL_memcpy(&value, *cursor, sizeof(value));
+  *cursor += sizeof(value);
+  return value;
+}
+
+/*
+ * Returns the serialized size of a payload, raising for anything that
+ * cannot be sent. Run before serializing so a rejected payload leaves
+ * its buffers untouched. 'buffers' collects the buffers seen so far: a
+ * buffer's storage can only move once, so one that appears twice is
+ * rejected.
+ */
+static size_t
+mrb_sdl2_channel_measure(mrb_state *mrb, mrb_value value, mrb_value buffers, int depth)
+{
+  size_t size = 1;
+  mrb_int i, n;
+  if (MRB_SDL2_CHANNEL_MAX_DEPTH < depth) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "payload nested too deeply.");
+  }
+  switch (mrb_type(value)) {
+  case MRB_TT_FALSE:
+  case MRB_TT_TRUE:
+    return size;
+  case MRB_TT_FIXNUM:
+    return size + sizeof(mrb_int);
+  case MRB_TT_FLOAT:
+    return size + sizeof(mrb_float);
+  case MRB_TT_STRING:
+    return size + sizeof(Uint32) + RSTRING_LEN(value);
+  case MRB_TT_SYMBOL:
+    /* the bare name; mrb_sym2name would quote symbols like :"a b". */
+    mrb_sym2name_len(mrb, mrb_symbol(value), &n);
+    return size + sizeof(Uint32) + (size_t)n;
+  case MRB_TT_ARRAY:
+    size += sizeof(Uint32);
+    n = mrb_ary_len(mrb, value);
+    for (i = 0; i < n; ++i) {
+      size += mrb_sdl2_channel_measure(mrb, mrb_ary_ref(mrb, value, i), buffers, depth + 1);
+    }
+    return size;
+  case MRB_TT_HASH: {
+    mrb_value const keys = mrb_hash_keys(mrb, value);
+    size += sizeof(Uint32);
+    n = mrb_ary_len(mrb, keys);
+    for (i = 0; i < n; ++i) {
+      mrb_value const key = mrb_ary_ref(mrb, keys, i);
+      size += mrb_sdl2_channel_measure(mrb, key, buffers, depth + 1);
+      size += mrb_sdl2_channel_measure(mrb, mrb_hash_get(mrb, value, key), buffers, depth + 1);
+    }
+    return size;
+  }
+  case MRB_TT_DATA:
+    /* raises for anything but an SDL2::Buffer. */
+    mrb_sdl2_misc_buffer_get_ptr(mrb, value, NULL);
+    n = mrb_ary_len(mrb, buffers);
+    for (i = 0; i < n; ++i) {
+      if (mrb_obj_equal(mrb, mrb_ary_ref(mrb, buffers, i), value)) {
+        mrb_raise(mrb, E_ARGUMENT_ERROR, "buffer appears twice in the payload.");
+      }
+    }
+    mrb_ary_push(mrb, buffers, value);
+    return size + 1 + sizeof(size_t) + sizeof(void*);
+  default:
+    break;
+  }
+  mrb_raise(mrb, E_TYPE_ERROR, "unsupported payload type.");
+  return 0;
+}
+
+/*
+ * Serializes a payload accepted by mrb_sdl2_channel_measure. Buffers are
+ * not copied: their storage is detached and travels with the message.
+ */
+static void
+mrb_sdl2_channel_write(mrb_state *mrb, Uint8 **cursor, mrb_value value)
+{
+  mrb_int i, n;
+  switch (mrb_type(value)) {
+  case MRB_TT_FALSE:
+    *(*cursor)++ = mrb_nil_p(value) ? MRB_SDL2_CHANNEL_TAG_NIL : MRB_SDL2_CHANNEL_TAG_FALSE;
+    break;
+  case MRB_TT_TRUE:
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_TRUE;
+    break;
+  case MRB_TT_FIXNUM: {
+    mrb_int const fixnum = mrb_fixnum(value);
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_FIXNUM;
+    SDL_memcpy(*cursor, &fixnum, sizeof(fixnum));
+    *cursor += sizeof(fixnum);
+    break;
+  }
+  case MRB_TT_FLOAT: {
+    mrb_float const number = mrb_float(value);
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_FLOAT;
+    SDL_memcpy(*cursor, &number, sizeof(number));
+    *cursor += sizeof(number);
+    break;
+  }
+  case MRB_TT_STRING:
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_STRING;
+    mrb_sdl2_channel_write32(cursor, (Uint32)RSTRING_LEN(value));
+    SDL_memcpy(*cursor, RSTRING_PTR(value), RSTRING_LEN(value));
+    *cursor += RSTRING_LEN(value);
+    break;
+  case MRB_TT_SYMBOL: {
+    mrb_int len;
+    char const *name = mrb_sym2name_len(mrb, mrb_symbol(value), &len);
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_SYMBOL;
+    mrb_sdl2_channel_write32(cursor, (Uint32)len);
+    SDL_memcpy(*cursor, name, len);
+    *cursor += len;
+    break;
+  }
+  case MRB_TT_ARRAY:
+    n = mrb_ary_len(mrb, value);
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_ARRAY;
+    mrb_sdl2_channel_write32(cursor, (Uint32)n);
+    for (i = 0; i < n; ++i) {
+      mrb_sdl2_channel_write(mrb, cursor, mrb_ary_ref(mrb, value, i));
+    }
+    break;
+  case MRB_TT_HASH: {
+    mrb_value const keys = mrb_hash_keys(mrb, value);
+    n = mrb_ary_len(mrb, keys);
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_HASH;
+    mrb_sdl2_channel_write32(cursor, (Uint32)n);
+    for (i = 0; i < n; ++i) {
+      mrb_value const key = mrb_ary_ref(mrb, keys, i);
+      mrb_sdl2_channel_write(mrb, cursor, key);
+      mrb_sdl2_channel_write(mrb, cursor, mrb_hash_get(mrb, value, key));
+    }
+    break;
+  }
+  default: {
+    void *buffer = NULL;
+    size_t size = 0;
+    int kind = MRB_SDL2_MISC_BUFFER_PLAIN;
+    if (!mrb_sdl2_misc_buffer_detach(mrb, value, &buffer, &size, &kind)) {
+      /* measure rejects non-buffers; never leave the stream unparseable. */
+      *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_NIL;
+      break;
+    }
+    *(*cursor)++ = MRB_SDL2_CHANNEL_TAG_BUFFER;
+    *(*cursor)++ = (Uint8)kind;
+    SDL_memcpy(*cursor, &size, sizeof(size));
+    *cursor += sizeof(size);
+    SDL_memcpy(*cursor, &buffer, sizeof(buffer));
+    *cursor += sizeof(buffer);
+    break;
+  }
+  }
+}
+
+/*
+ * Rebuilds a payload in the receiving VM. With 'discard' set nothing is
+ * built and only the detached buffers are freed, for messages that are
+ * never received. Buffer storage is freed with the receiving VM's
+ * allocator; SDL2::Thread VMs share the allocator of their parent.
+ */
+static mrb_value
+mrb_sdl2_channel_read(mrb_state *mrb, Uint8 const **cursor, mrb_bool discard)
+{
+  Uint8 const tag = *(*cursor)++;
+  mrb_value value = mrb_nil_value();
+  Uint32 i, n;
+  switch (tag) {
+  case MRB_SDL2_CHANNEL_TAG_TRUE:
+    value = mrb_true_value();
+    break;
+  case MRB_SDL2_CHANNEL_TAG_FALSE:
+    value = mrb_false_value();
+    break;
+  case MRB_SDL2_CHANNEL_TAG_FIXNUM: {
+    mrb_int fixnum;
+    SDL_memcpy(&fixnum, *cursor, sizeof(fixnum));
+    *cursor += sizeof(fixnum);
+    value = mrb_fixnum_value(fixnum);
+    break;
+  }
+  case MRB_SDL2_CHANNEL_TAG_FLOAT: {
+    mrb_float number;
+    SDL_memcpy(&number, *cursor, sizeof(number));
+    *cursor += sizeof(number);
+    if (!discard) {
+      value = mrb_float_value(mrb, number);
+    }
+    break;
+  }
+  case MRB_SDL2_CHANNEL_TAG_STRING:
+  case MRB_SDL2_CHANNEL_TAG_SYMBOL:
+    n = mrb_sdl2_channel_read32(cursor);
+    if (!discard) {
+      value = (MRB_SDL2_CHANNEL_TAG_STRING == tag)
+        ? mrb_str_new(mrb, (char const*)*cursor, n)
+        : mrb_symbol_value(mrb_intern(mrb, (char const*)*cursor, n));
+    }
+    *cursor += n;
+    break;
+  case MRB_SDL2_CHANNEL_TAG_ARRAY:
+    n = mrb_sdl2_channel_read32(cursor);
+    if (!discard) {
+      value = mrb_ary_new_capa(mrb, (mrb_int)n);
+    }
+    for (i = 0; i < n; ++i) {
+      mrb_value const item = mrb_sdl2_channel_read(mrb, cursor, discard);
+      if (!discard) {
+        mrb_ary_push(mrb, value, item);
+      }
+    }
+    break;
+  case MRB_SDL2_CHANNEL_TAG_HASH:
+    n = mrb_sdl2_channel_read32(cursor);
+    if (!discard) {
+      value = mrb_hash_new(mrb);
+    }
+    for (i = 0; i < n; ++i) {
+      mrb_value const key = mrb_sdl2_channel_read(mrb, cursor, discard);
+      mrb_value const item = mrb_sdl2_channel_read(mrb, cursor, discard);
+      if (!discard) {
+        mrb_hash_set(mrb, value, key, item);
+      }
+    }
+    break;
+  case MRB_SDL2_CHANNEL_TAG_BUFFER: {
+    int const kind = *(*cursor)++;
+    size_t size;
+    void *buffer;
+    SDL_memcpy(&size, *cursor, sizeof(size));
+    *cursor += sizeof(size);
+    SDL_memcpy(&buffer, *cursor, sizeof(buffer));
+    *cursor += sizeof(buffer);
+    if (discard) {
+      mrb_free(mrb, buffer);
+    } else {
+      value = mrb_sdl2_misc_buffer_attach(mrb, kind, buffer, size);
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  return value;
+}
+
+/*
+ * Takes a block with room for 'size' payload bytes from the pool, or
+ * allocates one.
+ */
+static mrb_sdl2_channel_message_t *
+mrb_sdl2_channel_message_acquire(mrb_sdl2_channel_t *channel, size_t size)
+{
+  mrb_sdl2_channel_message_t *message;
+  size_t capacity;
+
+  SDL_AtomicLock(&channel->lock);
+  message = channel->pool;
+  if (NULL != message) {
+    channel->pool = message->next;
+    --channel->pool_count;
+  }
+  SDL_AtomicUnlock(&channel->lock);
+
+  if ((NULL != message) && (message->capacity >= size)) {
+    return message;
+  }
+  SDL_free(message);
+  capacity = (MRB_SDL2_CHANNEL_MIN_CAPACITY > size) ? MRB_SDL2_CHANNEL_MIN_CAPACITY : size;
+  message = (mrb_sdl2_channel_message_t*)SDL_malloc(sizeof(mrb_sdl2_channel_message_t) + capacity);
+  if (NULL != message) {
+    message->capacity = capacity;
+  }
+  return message;
+}
+
+static void
+mrb_sdl2_channel_message_recycle(mrb_sdl2_channel_t *channel, mrb_sdl2_channel_message_t *message)
+{
+  if (MRB_SDL2_CHANNEL_POOL_BLOCK >= message->capacity) {
+    SDL_AtomicLock(&channel->lock);
+    if (MRB_SDL2_CHANNEL_POOL_MAX > channel->pool_count) {
+      message->next = channel->pool;
+      channel->pool = message;
+      ++channel->pool_count;
+      message = NULL;
+    }
+    SDL_AtomicUnlock(&channel->lock);
+  }
+  SDL_free(message);
+}
+
+static mrb_sdl2_channel_message_t *
+mrb_sdl2_channel_message_pop(mrb_sdl2_channel_t *channel)
+{
+  mrb_sdl2_channel_message_t *message;
+  SDL_AtomicLock(&channel->lock);
+  message = channel->head;
+  if (NULL != message) {
+    channel->head = message->next;
+    if (NULL == channel->head) {
+      channel->tail = NULL;
+    }
+    --channel->pending;
+    ++channel->received;
+  }
+  if (NULL == channel->head) {
+    channel->notified = false;
+  }
+  SDL_AtomicUnlock(&channel->lock);
+  return message;
+}
+
+static void
+mrb_sdl2_channel_release(mrb_state *mrb, mrb_sdl2_channel_t *channel)
+{
+  mrb_sdl2_channel_message_t *message;
+  mrb_bool last;
+  int i;
+
+  SDL_AtomicLock(&mrb_sdl2_channel_registry_lock);
+  last = (0 == --channel->refs);
+  if (last) {
+    for (i = 0; i < MRB_SDL2_CHANNEL_MAX; ++i) {
+      if (channel == mrb_sdl2_channel_registry[i]) {
+        mrb_sdl2_channel_registry[i] = NULL;
+      }
+    }
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_channel_registry_lock);
+  if (!last) {
+    return;
+  }
+
+  while (NULL != channel->head) {
+    Uint8 const *cursor;
+    message = channel->head;
+    channel->head = message->next;
+    cursor = MRB_SDL2_CHANNEL_PAYLOAD(message);
+    mrb_sdl2_channel_read(mrb, &cursor, true);
+    SDL_free(message);
+  }
+  while (NULL != channel->pool) {
+    message = channel->pool;
+    channel->pool = message->next;
+    SDL_free(message);
+  }
+  SDL_free(channel);
+}
+
+static void
+mrb_sdl2_channel_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_channel_data_t *data =
+    (mrb_sdl2_channel_data_t*)p;
+  if (NULL != data) {
+    if (NULL != data->channel) {
+      mrb_sdl2_channel_release(mrb, data->channel);
+    }
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_channel_data_type = {
+  "Channel", mrb_sdl2_channel_data_free
+};
+
+static mrb_sdl2_channel_t *
+mrb_sdl2_channel_get_ptr(mrb_state *mrb, mrb_value channel)
+{
+  mrb_sdl2_channel_data_t *data =
+    (mrb_sdl2_channel_data_t*)mrb_data_get_ptr(mrb, channel, &mrb_sdl2_channel_data_type);
+  if ((NULL == data) || (NULL == data->channel)) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized channel.");
+  }
+  return data->channel;
+}
+
+/***************************************************************************
+*
+* class SDL2::Input::Channel
+*
+***************************************************************************/
+
+/*
+ * SDL2::Input::Channel#initialize
+ *
+ * Creates a channel with a newly registered user event type, which is also
+ * its id. SDL does not give event types back, so create channels once and
+ * keep them.
+ */
+static mrb_value
+mrb_sdl2_channel_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_channel_data_t *data =
+    (mrb_sdl2_channel_data_t*)DATA_PTR(self);
+  mrb_sdl2_channel_t *channel;
+  Uint32 type;
+  int i;
+
+  if (NULL == data) {
+    data = (mrb_sdl2_channel_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_channel_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+    data->channel = NULL;
+    DATA_PTR(self) = data;
+    DATA_TYPE(self) = &mrb_sdl2_channel_data_type;
+  }
+  if (NULL != data->channel) {
+    mrb_sdl2_channel_release(mrb, data->channel);
+    data->channel = NULL;
+  }
+
+  type = SDL_RegisterEvents(1);
+  if ((Uint32)-1 == type) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "no user event types left.");
+  }
+  channel = (mrb_sdl2_channel_t*)SDL_malloc(sizeof(mrb_sdl2_channel_t));
+  if (NULL == channel) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  SDL_memset(channel, 0, sizeof(mrb_sdl2_channel_t));
+  channel->type = type;
+  channel->refs = 1;
+
+  SDL_AtomicLock(&mrb_sdl2_channel_registry_lock);
+  for (i = 0; i < MRB_SDL2_CHANNEL_MAX; ++i) {
+    if (NULL == mrb_sdl2_channel_registry[i]) {
+      mrb_sdl2_channel_registry[i] = channel;
+      break;
+    }
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_channel_registry_lock);
+  if (MRB_SDL2_CHANNEL_MAX == i) {
+    SDL_free(channel);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "too many channels.");
+  }
+
+  data->channel = channel;
+  return self;
+}
+
+/*
+ * SDL2::Input::Channel.open(id)
+ *
+ * Returns a new handle on an existing channel, typically from the VM of
+ * an SDL2::Thread.
+ */
+static mrb_value
+mrb_sdl2_channel_open(mrb_state *mrb, mrb_value klass)
+{
+  mrb_sdl2_channel_data_t *data;
+  mrb_sdl2_channel_t *channel = NULL;
+  mrb_int id;
+  int i;
+  mrb_get_args(mrb, "i", &id);
+
+  data = (mrb_sdl2_channel_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_channel_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+
+  SDL_AtomicLock(&mrb_sdl2_channel_registry_lock);
+  for (i = 0; i < MRB_SDL2_CHANNEL_MAX; ++i) {
+    if ((NULL != mrb_sdl2_channel_registry[i]) && ((Uint32)id == mrb_sdl2_channel_registry[i]->type)) {
+      channel = mrb_sdl2_channel_registry[i];
+      ++channel->refs;
+      break;
+    }
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_channel_registry_lock);
+  if (NULL == channel) {
+    mrb_free(mrb, data);
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "no such channel.");
+  }
+
+  data->channel = channel;
+  return mrb_obj_value(Data_Wrap_Struct(mrb, mrb_class_ptr(klass), &mrb_sdl2_channel_data_type, data));
+}
+
+static mrb_value
+mrb_sdl2_channel_get_id(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_channel_get_ptr(mrb, self)->type);
+}
+
+/*
+ * SDL2::Input::Channel#post(code, payload = nil)
+ *
+ * Queues a message from any VM. The payload may be nil, true, false,
+ * Integer, Float, String, Symbol, Array and Hash nested up to 32 levels,
+ * and SDL2::Buffer. Everything but buffers is copied; a buffer's storage
+ * is moved into the message and the buffer is left empty.
+ */
+static mrb_value
+mrb_sdl2_channel_post(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_channel_t *channel = mrb_sdl2_channel_get_ptr(mrb, self);
+  mrb_sdl2_channel_message_t *message;
+  mrb_int code;
+  mrb_value payload = mrb_nil_value();
+  mrb_bool notify;
+  Uint8 *cursor;
+  size_t size;
+  int arena_size;
+  mrb_get_args(mrb, "i|o", &code, &payload);
+
+  arena_size = mrb_gc_arena_save(mrb);
+  size = mrb_sdl2_channel_measure(mrb, payload, mrb_ary_new(mrb), 0);
+  message = mrb_sdl2_channel_message_acquire(channel, size);
+  if (NULL == message) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  cursor = MRB_SDL2_CHANNEL_PAYLOAD(message);
+  mrb_sdl2_channel_write(mrb, &cursor, payload);
+  mrb_gc_arena_restore(mrb, arena_size);
+  message->next = NULL;
+  message->code = code;
+  message->size = size;
+
+  SDL_AtomicLock(&channel->lock);
+  if (NULL == channel->tail) {
+    channel->head = message;
+  } else {
+    channel->tail->next = message;
+  }
+  channel->tail = message;
+  ++channel->pending;
+  ++channel->posted;
+  notify = !channel->notified;
+  channel->notified = true;
+  SDL_AtomicUnlock(&channel->lock);
+
+  if (notify) {
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = channel->type;
+    SDL_PushEvent(&event);
+  }
+  return self;
+}
+
+/*
+ * SDL2::Input::Channel#receive
+ *
+ * Returns the oldest message as [code, payload], or nil if none is queued.
+ */
+static mrb_value
+mrb_sdl2_channel_receive(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_channel_t *channel = mrb_sdl2_channel_get_ptr(mrb, self);
+  mrb_sdl2_channel_message_t *message = mrb_sdl2_channel_message_pop(channel);
+  Uint8 const *cursor;
+  mrb_value pair[2];
+  if (NULL == message) {
+    return mrb_nil_value();
+  }
+  cursor = MRB_SDL2_CHANNEL_PAYLOAD(message);
+  pair[0] = mrb_fixnum_value(message->code);
+  pair[1] = mrb_sdl2_channel_read(mrb, &cursor, false);
+  mrb_sdl2_channel_message_recycle(channel, message);
+  return mrb_ary_new_from_values(mrb, 2, pair);
+}
+
+/*
+ * SDL2::Input::Channel#each { |code, payload| ... }
+ *
+ * Receives every queued message, including ones posted while the block
+ * runs. Returns the number of messages received.
+ */
+static mrb_value
+mrb_sdl2_channel_each(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_channel_t *channel = mrb_sdl2_channel_get_ptr(mrb, self);
+  mrb_value block;
+  mrb_int count = 0;
+  mrb_get_args(mrb, "&", &block);
+  if (mrb_nil_p(block)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "no block given.");
+  }
+  for (;;) {
+    int const arena_size = mrb_gc_arena_save(mrb);
+    mrb_sdl2_channel_message_t *message = mrb_sdl2_channel_message_pop(channel);
+    Uint8 const *cursor;
+    mrb_value args[2];
+    if (NULL == message) {
+      break;
+    }
+    cursor = MRB_SDL2_CHANNEL_PAYLOAD(message);
+    args[0] = mrb_fixnum_value(message->code);
+    args[1] = mrb_sdl2_channel_read(mrb, &cursor, false);
+    mrb_sdl2_channel_message_recycle(channel, message);
+    mrb_yield_argv(mrb, block, 2, args);
+    mrb_gc_arena_restore(mrb, arena_size);
+    ++count;
+  }
+  return mrb_fixnum_value(count);
+}
+
+static mrb_value
+mrb_sdl2_channel_get_pending(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_channel_t *channel = mrb_sdl2_channel_get_ptr(mrb, self);
+  int pending;
+  SDL_AtomicLock(&channel->lock);
+  pending = channel->pending;
+  SDL_AtomicUnlock(&channel->lock);
+  return mrb_fixnum_value(pending);
+}
+
+static mrb_value
+mrb_sdl2_channel_get_posted(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_channel_t *channel = mrb_sdl2_channel_get_ptr(mrb, self);
+  mrb_int posted;
+  SDL_AtomicLock(&channel->lock);
+  posted = channel->posted;
+  SDL_AtomicUnlock(&channel->lock);
+  return mrb_fixnum_value(posted);
+}
+
+static mrb_value
+mrb_sdl2_channel_get_received(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_channel_t *channel = mrb_sdl2_channel_get_ptr(mrb, self);
+  mrb_int received;
+  SDL_AtomicLock(&channel->lock);
+  received = channel->received;
+  SDL_AtomicUnlock(&channel->lock);
+  return mrb_fixnum_value(received);
+}
+
+void
+mruby_sdl2_events_channel_init(mrb_state *mrb, struct RClass *mod_Input)
+{
+  struct RClass *class_Channel = mrb_define_class_under(mrb, mod_Input, "Channel", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_Channel, MRB_TT_DATA);
+
+  mrb_define_class_method(mrb, class_Channel, "open", mrb_sdl2_channel_open, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, class_Channel, "initialize", mrb_sdl2_channel_initialize,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Channel, "id",         mrb_sdl2_channel_get_id,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Channel, "post",       mrb_sdl2_channel_post,         MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Channel, "receive",    mrb_sdl2_channel_receive,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Channel, "each",       mrb_sdl2_channel_each,         MRB_ARGS_BLOCK());
+  mrb_define_method(mrb, class_Channel, "pending",    mrb_sdl2_channel_get_pending,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Channel, "posted",     mrb_sdl2_channel_get_posted,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Channel, "received",   mrb_sdl2_channel_get_received, MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_events_channel_final(mrb_state *mrb, struct RClass *mod_Input)
+{
+}
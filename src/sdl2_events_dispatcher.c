@@ -0,0 +1,542 @@
+#include "sdl2_events_dispatcher.h"
+#include "sdl2_events.h"
+#include "sdl2_events_filter.h"
+#include "sdl2_events_latency.h"
+#include "mruby/array.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/error.h"
+#include "mruby/variable.h"
+
+#define MRB_SDL2_DISPATCHER_PAGES      256
+#define MRB_SDL2_DISPATCHER_PAGE_SIZE  256
+#define MRB_SDL2_DISPATCHER_BATCH      64
+#define MRB_SDL2_DISPATCHER_ANY        (-1)
+
+static struct RClass *class_Dispatcher = NULL;
+
+/*
+ * One registered handler. Handlers for the same event type form a singly
+ * linked list through 'next' (-1 terminates), in registration order. The
+ * proc itself lives at the same index in the __handlers__ array so the GC
+ * can see it.
+ */
+typedef struct mrb_sdl2_input_dispatcher_handler_t {
+  Uint32  type;
+  mrb_int match;      /* key sym or button, MRB_SDL2_DISPATCHER_ANY for all */
+  Uint32  window_id;  /* 0 for all windows */
+  int     next;
+} mrb_sdl2_input_dispatcher_handler_t;
+
+/*
+ * The dispatch table is indexed by event type. SDL event types are sparse
+ * but clustered by their high byte, so the table is split into pages of
+ * 256 entries allocated on first use; each entry holds the index + 1 of the
+ * first handler for that type, 0 meaning no handler. A lookup is two array
+ * reads and never touches Ruby.
+ */
+typedef struct mrb_sdl2_input_dispatcher_data_t {
+  Uint16 *pages[MRB_SDL2_DISPATCHER_PAGES];
+  mrb_sdl2_input_dispatcher_handler_t *handlers;
+  int     count;
+  int     capacity;
+  Uint32  generation;
+  mrb_int dispatched;
+  mrb_int skipped;
+} mrb_sdl2_input_dispatcher_data_t;
+
+static void
+mrb_sdl2_input_dispatcher_data_reset(mrb_state *mrb, mrb_sdl2_input_dispatcher_data_t *data)
+{
+  int i;
+  for (i = 0; i < MRB_SDL2_DISPATCHER_PAGES; ++i) {
+    mrb_free(mrb, data->pages[i]);
+    data->pages[i] = NULL;
+  }
+  data->count = 0;
+  ++data->generation;
+}
+
+static void
+mrb_sdl2_input_dispatcher_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_input_dispatcher_data_t *data =
+    (mrb_sdl2_input_dispatcher_data_t*)p;
+  if (NULL != data) {
+    mrb_sdl2_input_dispatcher_data_reset(mrb, data);
+    mrb_free(mrb, data->handlers);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_input_dispatcher_data_type = {
+  "Dispatcher", mrb_sdl2_input_dispatcher_data_free
+};
+
+static mrb_sdl2_input_dispatcher_data_t *
+mrb_sdl2_input_dispatcher_get_ptr(mrb_state *mrb, mrb_value dispatcher)
+{
+  mrb_sdl2_input_dispatcher_data_t *data =
+    (mrb_sdl2_input_dispatcher_data_t*)mrb_data_get_ptr(mrb, dispatcher, &mrb_sdl2_input_dispatcher_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized dispatcher.");
+  }
+  return data;
+}
+
+static Uint32
+mrb_sdl2_input_dispatcher_check_type(mrb_state *mrb, mrb_int type)
+{
+  if ((SDL_FIRSTEVENT >= type) || (SDL_LASTEVENT < type)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "event type out of range.");
+  }
+  return (Uint32)type;
+}
+
+static int
+mrb_sdl2_input_dispatcher_head(mrb_sdl2_input_dispatcher_data_t const *data, Uint32 type)
+{
+  Uint16 const *page = data->pages[(type >> 8) & 0xff];
+  if (NULL == page) {
+    return -1;
+  }
+  return (int)page[type & 0xff] - 1;
+}
+
+/*
+ * Returns the key sym or button an event carries, for event types that
+ * handlers can be narrowed by.
+ */
+static mrb_bool
+mrb_sdl2_input_dispatcher_match_of(SDL_Event const *event, mrb_int *match)
+{
+  switch (event->type) {
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+    *match = event->key.keysym.sym;
+    return true;
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    *match = event->button.button;
+    return true;
+  case SDL_JOYBUTTONDOWN:
+  case SDL_JOYBUTTONUP:
+    *match = event->jbutton.button;
+    return true;
+  case SDL_CONTROLLERBUTTONDOWN:
+  case SDL_CONTROLLERBUTTONUP:
+    *match = event->cbutton.button;
+    return true;
+  default:
+    break;
+  }
+  return false;
+}
+
+/*
+ * Runs every handler registered for the event's type that accepts it.
+ * 'value' is the Ruby event if the caller already has one; otherwise it is
+ * nil and the event object is only created once the first handler matches.
+ * Returns true when at least one handler ran.
+ */
+static mrb_bool
+mrb_sdl2_input_dispatcher_run(mrb_state *mrb, mrb_value self,
+                              mrb_sdl2_input_dispatcher_data_t *data,
+                              SDL_Event const *event, mrb_value value)
+{
+  mrb_value procs;
+  mrb_int match = MRB_SDL2_DISPATCHER_ANY;
+  mrb_bool has_match;
+  Uint32 window_id;
+  Uint32 generation;
+  int index = mrb_sdl2_input_dispatcher_head(data, event->type);
+  mrb_bool ran = false;
+
+  if (0 > index) {
+    ++data->skipped;
+    return false;
+  }
+
+  procs      = mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__handlers__"));
+  has_match  = mrb_sdl2_input_dispatcher_match_of(event, &match);
+  window_id  = mrb_sdl2_input_event_window_id(event);
+  generation = data->generation;
+
+  while (0 <= index) {
+    /* copied: a handler may register more handlers and move the array. */
+    mrb_sdl2_input_dispatcher_handler_t const handler = data->handlers[index];
+    if ((MRB_SDL2_DISPATCHER_ANY != handler.match) && (!has_match || (handler.match != match))) {
+      index = handler.next;
+      continue;
+    }
+    if ((0 != handler.window_id) && (handler.window_id != window_id)) {
+      index = handler.next;
+      continue;
+    }
+    if (mrb_nil_p(value)) {
+      value = mrb_sdl2_input_event(mrb, event);
+    }
+    mrb_yield(mrb, mrb_ary_ref(mrb, procs, index), value);
+    ran = true;
+    if (generation != data->generation) {
+      /* handlers were removed from inside a handler. */
+      break;
+    }
+    index = handler.next;
+  }
+
+  if (ran) {
+    ++data->dispatched;
+  } else {
+    ++data->skipped;
+  }
+  return ran;
+}
+
+/***************************************************************************
+*
+* class SDL2::Input::Dispatcher
+*
+***************************************************************************/
+
+static mrb_value
+mrb_sdl2_input_dispatcher_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_t *data =
+    (mrb_sdl2_input_dispatcher_data_t*)DATA_PTR(self);
+  int i;
+  if (NULL != data) {
+    mrb_sdl2_input_dispatcher_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+
+  data = (mrb_sdl2_input_dispatcher_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_input_dispatcher_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  for (i = 0; i < MRB_SDL2_DISPATCHER_PAGES; ++i) {
+    data->pages[i] = NULL;
+  }
+  data->handlers   = NULL;
+  data->count      = 0;
+  data->capacity   = 0;
+  data->generation = 0;
+  data->dispatched = 0;
+  data->skipped    = 0;
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_input_dispatcher_data_type;
+
+  mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "__handlers__"), mrb_ary_new(mrb));
+  return self;
+}
+
+/*
+ * SDL2::Input::Dispatcher#on(type, match = nil, window_id = nil) { |event| ... }
+ *
+ * Registers a handler for events of the given type. 'match' narrows key
+ * events to a key sym and button events to a button; 'window_id' narrows
+ * window bound events to one window. Handlers run in registration order.
+ */
+static mrb_value
+mrb_sdl2_input_dispatcher_on(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_t *data = mrb_sdl2_input_dispatcher_get_ptr(mrb, self);
+  mrb_sdl2_input_dispatcher_handler_t *handler;
+  mrb_int type;
+  mrb_value match = mrb_nil_value();
+  mrb_value window_id = mrb_nil_value();
+  mrb_value block;
+  Uint16 *page;
+  int head;
+  mrb_get_args(mrb, "i|oo&", &type, &match, &window_id, &block);
+  if (mrb_nil_p(block)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "no block given.");
+  }
+  if (!mrb_sdl2_input_event_type_p(mrb_sdl2_input_dispatcher_check_type(mrb, type))) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported event type.");
+  }
+  if (!mrb_nil_p(match)) {
+    SDL_Event probe;
+    mrb_int unused;
+    probe.type = (Uint32)type;
+    if (!mrb_sdl2_input_dispatcher_match_of(&probe, &unused)) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "event type has no key or button.");
+    }
+    match = mrb_Integer(mrb, match);
+    if (0 > mrb_fixnum(match)) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "key or button out of range.");
+    }
+  }
+  if (!mrb_nil_p(window_id)) {
+    window_id = mrb_Integer(mrb, window_id);
+  }
+
+  if (data->count == data->capacity) {
+    int const capacity = (0 == data->capacity) ? 8 : data->capacity * 2;
+    if (0xffff < capacity) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "too many handlers.");
+    }
+    data->handlers = (mrb_sdl2_input_dispatcher_handler_t*)mrb_realloc(
+      mrb, data->handlers, sizeof(mrb_sdl2_input_dispatcher_handler_t) * capacity);
+    data->capacity = capacity;
+  }
+
+  page = data->pages[(type >> 8) & 0xff];
+  if (NULL == page) {
+    page = (Uint16*)mrb_malloc(mrb, sizeof(Uint16) * MRB_SDL2_DISPATCHER_PAGE_SIZE);
+    SDL_memset(page, 0, sizeof(Uint16) * MRB_SDL2_DISPATCHER_PAGE_SIZE);
+    data->pages[(type >> 8) & 0xff] = page;
+  }
+
+  handler = &data->handlers[data->count];
+  handler->type      = (Uint32)type;
+  handler->match     = mrb_nil_p(match) ? MRB_SDL2_DISPATCHER_ANY : mrb_fixnum(match);
+  handler->window_id = mrb_nil_p(window_id) ? 0 : (Uint32)mrb_fixnum(window_id);
+  handler->next      = -1;
+
+  head = (int)page[type & 0xff] - 1;
+  if (0 > head) {
+    page[type & 0xff] = (Uint16)(data->count + 1);
+  } else {
+    while (0 <= data->handlers[head].next) {
+      head = data->handlers[head].next;
+    }
+    data->handlers[head].next = data->count;
+  }
+  mrb_ary_push(mrb, mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__handlers__")), block);
+  ++data->count;
+  return self;
+}
+
+/*
+ * Rebuilds every per-type chain from the handler array. Walking it
+ * backwards and prepending keeps each chain in registration order.
+ */
+static void
+mrb_sdl2_input_dispatcher_relink(mrb_sdl2_input_dispatcher_data_t *data)
+{
+  int i;
+  for (i = 0; i < MRB_SDL2_DISPATCHER_PAGES; ++i) {
+    if (NULL != data->pages[i]) {
+      SDL_memset(data->pages[i], 0, sizeof(Uint16) * MRB_SDL2_DISPATCHER_PAGE_SIZE);
+    }
+  }
+  for (i = data->count - 1; 0 <= i; --i) {
+    Uint32 const type = data->handlers[i].type;
+    Uint16 * const page = data->pages[(type >> 8) & 0xff];
+    data->handlers[i].next = (int)page[type & 0xff] - 1;
+    page[type & 0xff] = (Uint16)(i + 1);
+  }
+}
+
+/*
+ * SDL2::Input::Dispatcher#off(type)
+ *
+ * Removes every handler registered for the type.
+ */
+static mrb_value
+mrb_sdl2_input_dispatcher_off(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_t *data = mrb_sdl2_input_dispatcher_get_ptr(mrb, self);
+  mrb_value procs = mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__handlers__"));
+  mrb_value kept;
+  mrb_int type;
+  int i, count = 0;
+  mrb_get_args(mrb, "i", &type);
+  if (0 > mrb_sdl2_input_dispatcher_head(data, mrb_sdl2_input_dispatcher_check_type(mrb, type))) {
+    return self;
+  }
+  /* compact the handlers and their procs so the slots can be reused. */
+  kept = mrb_ary_new_capa(mrb, data->count);
+  for (i = 0; i < data->count; ++i) {
+    if ((Uint32)type == data->handlers[i].type) {
+      continue;
+    }
+    data->handlers[count++] = data->handlers[i];
+    mrb_ary_push(mrb, kept, mrb_ary_ref(mrb, procs, i));
+  }
+  data->count = count;
+  mrb_sdl2_input_dispatcher_relink(data);
+  mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "__handlers__"), kept);
+  ++data->generation;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_dispatcher_clear(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_reset(mrb, mrb_sdl2_input_dispatcher_get_ptr(mrb, self));
+  mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "__handlers__"), mrb_ary_new(mrb));
+  return self;
+}
+
+/*
+ * SDL2::Input::Dispatcher#handles?(type)
+ */
+static mrb_value
+mrb_sdl2_input_dispatcher_handles(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_t *data = mrb_sdl2_input_dispatcher_get_ptr(mrb, self);
+  mrb_int type;
+  mrb_get_args(mrb, "i", &type);
+  if ((SDL_FIRSTEVENT >= type) || (SDL_LASTEVENT < type)) {
+    return mrb_false_value();
+  }
+  return mrb_bool_value(0 <= mrb_sdl2_input_dispatcher_head(data, (Uint32)type));
+}
+
+/*
+ * State of one batch taken off the queue by #pump, shared between the
+ * dispatch loop and the ensure clause that requeues what it did not reach.
+ */
+typedef struct mrb_sdl2_input_dispatcher_batch_t {
+  mrb_value self;
+  mrb_sdl2_input_dispatcher_data_t *data;
+  SDL_Event events[MRB_SDL2_DISPATCHER_BATCH];
+  int     count;
+  int     next;
+  mrb_int handled;
+} mrb_sdl2_input_dispatcher_batch_t;
+
+static mrb_value
+mrb_sdl2_input_dispatcher_run_batch(mrb_state *mrb, mrb_value arg)
+{
+  mrb_sdl2_input_dispatcher_batch_t *batch =
+    (mrb_sdl2_input_dispatcher_batch_t*)mrb_cptr(arg);
+  while (batch->next < batch->count) {
+    SDL_Event * const event = &batch->events[batch->next++];
+    int const arena_size = mrb_gc_arena_save(mrb);
+    if (mrb_sdl2_input_dispatcher_run(mrb, batch->self, batch->data, event, mrb_nil_value())) {
+      ++batch->handled;
+    } else {
+      /* never became a Ruby object, so nothing else will free its payload. */
+      mrb_sdl2_input_event_discard(mrb, event);
+    }
+    mrb_gc_arena_restore(mrb, arena_size);
+  }
+  return mrb_nil_value();
+}
+
+static mrb_value
+mrb_sdl2_input_dispatcher_requeue_batch(mrb_state *mrb, mrb_value arg)
+{
+  mrb_sdl2_input_dispatcher_batch_t *batch =
+    (mrb_sdl2_input_dispatcher_batch_t*)mrb_cptr(arg);
+  if (batch->next < batch->count) {
+    SDL_PeepEvents(&batch->events[batch->next], batch->count - batch->next,
+                   SDL_ADDEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+    batch->next = batch->count;
+  }
+  return mrb_nil_value();
+}
+
+/*
+ * SDL2::Input::Dispatcher#pump
+ *
+ * Pumps the event loop, releases events held by SDL2::Input::Filter and
+ * drains the events queued at that moment, calling the matching handlers
+ * for each. Events pushed by handlers are left for the next pump. Events
+ * whose type has no handler are discarded without creating a Ruby object.
+ * Returns the number of events that reached a handler.
+ *
+ * If a handler raises, the events of its batch that were not dispatched
+ * yet are put back at the end of the queue before the exception leaves.
+ */
+static mrb_value
+mrb_sdl2_input_dispatcher_pump(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_t *data = mrb_sdl2_input_dispatcher_get_ptr(mrb, self);
+  mrb_sdl2_input_dispatcher_batch_t batch;
+  mrb_value const arg = mrb_cptr_value(mrb, &batch);
+  int pending;
+
+  SDL_PumpEvents();
+  mrb_sdl2_input_filter_release();
+  pending = SDL_PeepEvents(NULL, 0, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+  if (0 > pending) {
+    mruby_sdl2_raise_error(mrb);
+  }
+
+  batch.self    = self;
+  batch.data    = data;
+  batch.handled = 0;
+  while (0 < pending) {
+    int const want = (MRB_SDL2_DISPATCHER_BATCH < pending) ? MRB_SDL2_DISPATCHER_BATCH : pending;
+    batch.count = SDL_PeepEvents(batch.events, want, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+    batch.next  = 0;
+    if (0 > batch.count) {
+      mruby_sdl2_raise_error(mrb);
+    }
+    if (0 == batch.count) {
+      break;
+    }
+    mrb_sdl2_input_latency_polled(batch.events, batch.count);
+    mrb_ensure(mrb, mrb_sdl2_input_dispatcher_run_batch, arg,
+               mrb_sdl2_input_dispatcher_requeue_batch, arg);
+    pending -= batch.count;
+  }
+  return mrb_fixnum_value(batch.handled);
+}
+
+/*
+ * SDL2::Input::Dispatcher#dispatch(event)
+ *
+ * Runs an event obtained elsewhere through the table. Returns true when a
+ * handler ran.
+ */
+static mrb_value
+mrb_sdl2_input_dispatcher_dispatch(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_t *data = mrb_sdl2_input_dispatcher_get_ptr(mrb, self);
+  mrb_value event;
+  SDL_Event copy;
+  mrb_get_args(mrb, "o", &event);
+  /* copied: a handler may overwrite the event with poll_into. */
+  copy = *mrb_sdl2_input_event_get_ptr(mrb, event);
+  return mrb_bool_value(mrb_sdl2_input_dispatcher_run(mrb, self, data, &copy, event));
+}
+
+static mrb_value
+mrb_sdl2_input_dispatcher_get_dispatched(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_dispatcher_get_ptr(mrb, self)->dispatched);
+}
+
+static mrb_value
+mrb_sdl2_input_dispatcher_get_skipped(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_dispatcher_get_ptr(mrb, self)->skipped);
+}
+
+static mrb_value
+mrb_sdl2_input_dispatcher_reset_stats(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_dispatcher_data_t *data = mrb_sdl2_input_dispatcher_get_ptr(mrb, self);
+  data->dispatched = 0;
+  data->skipped    = 0;
+  return self;
+}
+
+void
+mruby_sdl2_events_dispatcher_init(mrb_state *mrb, struct RClass *mod_Input)
+{
+  class_Dispatcher = mrb_define_class_under(mrb, mod_Input, "Dispatcher", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_Dispatcher, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_Dispatcher, "initialize",  mrb_sdl2_input_dispatcher_initialize,     MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Dispatcher, "on",          mrb_sdl2_input_dispatcher_on,             MRB_ARGS_REQ(1) | MRB_ARGS_OPT(2) | MRB_ARGS_BLOCK());
+  mrb_define_method(mrb, class_Dispatcher, "off",         mrb_sdl2_input_dispatcher_off,            MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Dispatcher, "clear",       mrb_sdl2_input_dispatcher_clear,          MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Dispatcher, "handles?",    mrb_sdl2_input_dispatcher_handles,        MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Dispatcher, "pump",        mrb_sdl2_input_dispatcher_pump,           MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Dispatcher, "dispatch",    mrb_sdl2_input_dispatcher_dispatch,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Dispatcher, "dispatched",  mrb_sdl2_input_dispatcher_get_dispatched, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Dispatcher, "skipped",     mrb_sdl2_input_dispatcher_get_skipped,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Dispatcher, "reset_stats", mrb_sdl2_input_dispatcher_reset_stats,    MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_events_dispatcher_final(mrb_state *mrb, struct RClass *mod_Input)
+{
+}
@@ -0,0 +1,637 @@
+#include "sdl2_events_filter.h"
+#include "sdl2_events.h"
+#include "mruby/hash.h"
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_timer.h>
+
+#define MRB_SDL2_INPUT_FILTER_TYPE_WORDS ((SDL_LASTEVENT + 1) / 32)
+#define MRB_SDL2_INPUT_FILTER_HELD_MAX   64
+#define MRB_SDL2_INPUT_FILTER_WATCH_MAX  16
+#define MRB_SDL2_INPUT_FILTER_WAIT_SLICE 5
+
+/*
+ * State of the native event filter. SDL calls the filter from whichever
+ * thread pushes an event, so the held (coalesced) events are guarded by
+ * 'lock'. The type bitmap and settings are single words written from the
+ * mruby thread and only read by the filter.
+ *
+ * Coalesced events are held here instead of being queued; the latest one
+ * per device replaces older ones (relative motion and wheel deltas are
+ * summed). Held events are put back into the queue before any other event
+ * that passes the filter, so ordering relative to buttons, keys, etc. is
+ * preserved, when the mruby side finds the queue empty, and periodically
+ * while it waits for events.
+ *
+ * 'owner' is the mrb_state that installed the filter; only that VM tears
+ * it down when it closes.
+ */
+typedef struct mrb_sdl2_input_filter_t {
+  SDL_SpinLock lock;
+  bool         installed;
+  mrb_state   *owner;
+  bool         coalesce_motion;
+  bool         coalesce_wheel;
+  bool         coalesce_axis;
+  Uint32       window_id;
+  Uint32       blocked[MRB_SDL2_INPUT_FILTER_TYPE_WORDS];
+  SDL_Event    held[MRB_SDL2_INPUT_FILTER_HELD_MAX];
+  int          held_count;
+  SDL_atomic_t passed;
+  SDL_atomic_t dropped;
+  SDL_atomic_t coalesced;
+} mrb_sdl2_input_filter_t;
+
+static mrb_sdl2_input_filter_t mrb_sdl2_input_filter;
+static struct RClass *mod_Filter = NULL;
+
+/*
+ * Event watches registered through mrb_sdl2_input_filter_add_watch. SDL
+ * runs watches only for events that pass the filter when pushed, so held
+ * events are handed to these as they are released.
+ *
+ * A release copies the watch list under the lock and runs the callbacks
+ * after dropping it, counted in the running slot of the current
+ * generation. del_watch removes the watch, moves to the next generation
+ * and waits for the previous one to drain, so the callback is not running
+ * anymore once it returns. It first waits for the slot it is about to
+ * reuse to be empty, so new releases never extend the wait. del_watch
+ * must not be called from inside a watch.
+ */
+typedef struct mrb_sdl2_input_filter_watch_t {
+  SDL_EventFilter callback;
+  void           *userdata;
+} mrb_sdl2_input_filter_watch_t;
+
+static mrb_sdl2_input_filter_watch_t mrb_sdl2_input_filter_watches[MRB_SDL2_INPUT_FILTER_WATCH_MAX];
+static int                           mrb_sdl2_input_filter_watch_count = 0;
+static SDL_SpinLock                  mrb_sdl2_input_filter_watch_lock  = 0;
+static Uint32                        mrb_sdl2_input_filter_watch_generation = 0;
+static SDL_atomic_t                  mrb_sdl2_input_filter_watch_running[2];
+
+/*
+ * SDL_AddEventWatch that also sees events held by SDL2::Input::Filter.
+ * Returns false when too many watches are registered.
+ */
+bool
+mrb_sdl2_input_filter_add_watch(SDL_EventFilter callback, void *userdata)
+{
+  bool added = false;
+  SDL_AtomicLock(&mrb_sdl2_input_filter_watch_lock);
+  if (MRB_SDL2_INPUT_FILTER_WATCH_MAX > mrb_sdl2_input_filter_watch_count) {
+    mrb_sdl2_input_filter_watches[mrb_sdl2_input_filter_watch_count].callback = callback;
+    mrb_sdl2_input_filter_watches[mrb_sdl2_input_filter_watch_count].userdata = userdata;
+    ++mrb_sdl2_input_filter_watch_count;
+    added = true;
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_input_filter_watch_lock);
+  if (added) {
+    SDL_AddEventWatch(callback, userdata);
+  }
+  return added;
+}
+
+void
+mrb_sdl2_input_filter_del_watch(SDL_EventFilter callback, void *userdata)
+{
+  SDL_atomic_t *previous;
+  int i;
+  SDL_DelEventWatch(callback, userdata);
+  for (;;) {
+    SDL_AtomicLock(&mrb_sdl2_input_filter_watch_lock);
+    if (0 == SDL_AtomicGet(&mrb_sdl2_input_filter_watch_running[(mrb_sdl2_input_filter_watch_generation + 1) & 1])) {
+      break;
+    }
+    SDL_AtomicUnlock(&mrb_sdl2_input_filter_watch_lock);
+    SDL_Delay(1);
+  }
+  for (i = 0; i < mrb_sdl2_input_filter_watch_count; ++i) {
+    if ((mrb_sdl2_input_filter_watches[i].callback == callback) &&
+        (mrb_sdl2_input_filter_watches[i].userdata == userdata)) {
+      mrb_sdl2_input_filter_watches[i] = mrb_sdl2_input_filter_watches[--mrb_sdl2_input_filter_watch_count];
+      break;
+    }
+  }
+  previous = &mrb_sdl2_input_filter_watch_running[mrb_sdl2_input_filter_watch_generation & 1];
+  ++mrb_sdl2_input_filter_watch_generation;
+  SDL_AtomicUnlock(&mrb_sdl2_input_filter_watch_lock);
+  while (0 != SDL_AtomicGet(previous)) {
+    SDL_Delay(1);
+  }
+}
+
+static void
+mrb_sdl2_input_filter_run_watches(SDL_Event *events, int count)
+{
+  mrb_sdl2_input_filter_watch_t watches[MRB_SDL2_INPUT_FILTER_WATCH_MAX];
+  SDL_atomic_t *running;
+  int n, i, j;
+  SDL_AtomicLock(&mrb_sdl2_input_filter_watch_lock);
+  n = mrb_sdl2_input_filter_watch_count;
+  if (0 == n) {
+    SDL_AtomicUnlock(&mrb_sdl2_input_filter_watch_lock);
+    return;
+  }
+  SDL_memcpy(watches, mrb_sdl2_input_filter_watches, sizeof(mrb_sdl2_input_filter_watch_t) * n);
+  running = &mrb_sdl2_input_filter_watch_running[mrb_sdl2_input_filter_watch_generation & 1];
+  SDL_AtomicAdd(running, 1);
+  SDL_AtomicUnlock(&mrb_sdl2_input_filter_watch_lock);
+
+  for (i = 0; i < n; ++i) {
+    for (j = 0; j < count; ++j) {
+      watches[i].callback(watches[i].userdata, &events[j]);
+    }
+  }
+  SDL_AtomicAdd(running, -1);
+}
+
+static bool
+mrb_sdl2_input_filter_is_blocked(Uint32 type)
+{
+  if (SDL_LASTEVENT < type) {
+    return false;
+  }
+  return 0 != (mrb_sdl2_input_filter.blocked[type >> 5] & (1u << (type & 31)));
+}
+
+static bool
+mrb_sdl2_input_filter_is_coalesced(Uint32 type)
+{
+  switch (type) {
+  case SDL_MOUSEMOTION:
+    return mrb_sdl2_input_filter.coalesce_motion;
+  case SDL_MOUSEWHEEL:
+    return mrb_sdl2_input_filter.coalesce_wheel;
+  case SDL_JOYAXISMOTION:
+  case SDL_CONTROLLERAXISMOTION:
+    return mrb_sdl2_input_filter.coalesce_axis;
+  default:
+    break;
+  }
+  return false;
+}
+
+/*
+ * Finds the held event 'event' should be merged into. Called with the lock
+ * held.
+ */
+static SDL_Event *
+mrb_sdl2_input_filter_find_held(SDL_Event const *event)
+{
+  int i;
+  for (i = 0; i < mrb_sdl2_input_filter.held_count; ++i) {
+    SDL_Event *held = &mrb_sdl2_input_filter.held[i];
+    if (held->type != event->type) {
+      continue;
+    }
+    switch (event->type) {
+    case SDL_MOUSEMOTION:
+      if ((held->motion.which == event->motion.which) &&
+          (held->motion.windowID == event->motion.windowID)) {
+        return held;
+      }
+      break;
+    case SDL_MOUSEWHEEL:
+      if ((held->wheel.which == event->wheel.which) &&
+          (held->wheel.windowID == event->wheel.windowID) &&
+          (held->wheel.direction == event->wheel.direction)) {
+        return held;
+      }
+      break;
+    case SDL_JOYAXISMOTION:
+      if ((held->jaxis.which == event->jaxis.which) &&
+          (held->jaxis.axis == event->jaxis.axis)) {
+        return held;
+      }
+      break;
+    case SDL_CONTROLLERAXISMOTION:
+      if ((held->caxis.which == event->caxis.which) &&
+          (held->caxis.axis == event->caxis.axis)) {
+        return held;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return NULL;
+}
+
+static void
+mrb_sdl2_input_filter_merge(SDL_Event *held, SDL_Event const *event)
+{
+  switch (event->type) {
+  case SDL_MOUSEMOTION: {
+    Sint32 const xrel = held->motion.xrel + event->motion.xrel;
+    Sint32 const yrel = held->motion.yrel + event->motion.yrel;
+    *held = *event;
+    held->motion.xrel = xrel;
+    held->motion.yrel = yrel;
+    break;
+  }
+  case SDL_MOUSEWHEEL: {
+    Sint32 const x = held->wheel.x + event->wheel.x;
+    Sint32 const y = held->wheel.y + event->wheel.y;
+    *held = *event;
+    held->wheel.x = x;
+    held->wheel.y = y;
+    break;
+  }
+  default:
+    *held = *event;
+    break;
+  }
+}
+
+/*
+ * Moves all held events into the SDL queue and returns how many there were.
+ * SDL_PeepEvents(SDL_ADDEVENT) runs neither the filter nor event watches,
+ * so the watches registered with mrb_sdl2_input_filter_add_watch are run
+ * here.
+ */
+int
+mrb_sdl2_input_filter_release(void)
+{
+  SDL_Event events[MRB_SDL2_INPUT_FILTER_HELD_MAX];
+  int count;
+
+  SDL_AtomicLock(&mrb_sdl2_input_filter.lock);
+  count = mrb_sdl2_input_filter.held_count;
+  if (0 < count) {
+    SDL_memcpy(events, mrb_sdl2_input_filter.held, sizeof(SDL_Event) * count);
+    mrb_sdl2_input_filter.held_count = 0;
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_input_filter.lock);
+
+  if (0 < count) {
+    SDL_PeepEvents(events, count, SDL_ADDEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+    SDL_AtomicAdd(&mrb_sdl2_input_filter.passed, count);
+    mrb_sdl2_input_filter_run_watches(events, count);
+  }
+  return count;
+}
+
+static bool
+mrb_sdl2_input_filter_is_coalescing(void)
+{
+  return mrb_sdl2_input_filter.installed &&
+         (mrb_sdl2_input_filter.coalesce_motion || mrb_sdl2_input_filter.coalesce_wheel ||
+          mrb_sdl2_input_filter.coalesce_axis);
+}
+
+/*
+ * SDL_WaitEventTimeout (SDL_WaitEvent when 'timeout' is negative) that also
+ * returns held events. Coalesced events never enter the queue on their
+ * own, so while coalescing the wait is cut into short slices with a
+ * release between them. Returns 1 with 'event' filled, 0 on timeout or
+ * error.
+ */
+int
+mrb_sdl2_input_filter_wait(SDL_Event *event, int timeout)
+{
+  Uint32 const start = SDL_GetTicks();
+  mrb_sdl2_input_filter_release();
+  if (!mrb_sdl2_input_filter_is_coalescing()) {
+    return (0 > timeout) ? SDL_WaitEvent(event) : SDL_WaitEventTimeout(event, timeout);
+  }
+  for (;;) {
+    int slice = MRB_SDL2_INPUT_FILTER_WAIT_SLICE;
+    if (0 <= timeout) {
+      Uint32 const elapsed = SDL_GetTicks() - start;
+      slice = (elapsed >= (Uint32)timeout) ? 0 : SDL_min(slice, timeout - (int)elapsed);
+    }
+    if (0 != SDL_WaitEventTimeout(event, slice)) {
+      return 1;
+    }
+    if ((0 < mrb_sdl2_input_filter_release()) && (0 != SDL_PollEvent(event))) {
+      return 1;
+    }
+    if ((0 <= timeout) && (SDL_GetTicks() - start >= (Uint32)timeout)) {
+      return 0;
+    }
+  }
+}
+
+static int SDLCALL
+mrb_sdl2_input_filter_callback(void *userdata, SDL_Event *event)
+{
+  Uint32 window_id;
+
+  if (mrb_sdl2_input_filter_is_blocked(event->type)) {
+    SDL_AtomicAdd(&mrb_sdl2_input_filter.dropped, 1);
+    return 0;
+  }
+
+  window_id = mrb_sdl2_input_filter.window_id;
+  if (0 != window_id) {
+    Uint32 const event_window_id = mrb_sdl2_input_event_window_id(event);
+    if ((0 != event_window_id) && (window_id != event_window_id)) {
+      SDL_AtomicAdd(&mrb_sdl2_input_filter.dropped, 1);
+      return 0;
+    }
+  }
+
+  if (mrb_sdl2_input_filter_is_coalesced(event->type)) {
+    SDL_Event *held;
+    SDL_AtomicLock(&mrb_sdl2_input_filter.lock);
+    held = mrb_sdl2_input_filter_find_held(event);
+    if (NULL != held) {
+      mrb_sdl2_input_filter_merge(held, event);
+      SDL_AtomicUnlock(&mrb_sdl2_input_filter.lock);
+      SDL_AtomicAdd(&mrb_sdl2_input_filter.coalesced, 1);
+      return 0;
+    }
+    if (MRB_SDL2_INPUT_FILTER_HELD_MAX > mrb_sdl2_input_filter.held_count) {
+      mrb_sdl2_input_filter.held[mrb_sdl2_input_filter.held_count++] = *event;
+      SDL_AtomicUnlock(&mrb_sdl2_input_filter.lock);
+      return 0;
+    }
+    SDL_AtomicUnlock(&mrb_sdl2_input_filter.lock);
+  } else {
+    mrb_sdl2_input_filter_release();
+  }
+
+  SDL_AtomicAdd(&mrb_sdl2_input_filter.passed, 1);
+  return 1;
+}
+
+static Uint32
+mrb_sdl2_input_filter_type_arg(mrb_state *mrb, mrb_value value)
+{
+  mrb_int const type = mrb_fixnum(mrb_Integer(mrb, value));
+  if ((0 > type) || (SDL_LASTEVENT < type)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "event type out of range.");
+  }
+  return (Uint32)type;
+}
+
+/***************************************************************************
+*
+* module SDL2::Input::Filter
+*
+***************************************************************************/
+
+/*
+ * SDL2::Input::Filter.install
+ *
+ * Installs the filter with SDL_SetEventFilter, replacing any other filter.
+ * Events already in the queue are not filtered.
+ */
+static mrb_value
+mrb_sdl2_input_filter_install(mrb_state *mrb, mrb_value self)
+{
+  SDL_SetEventFilter(mrb_sdl2_input_filter_callback, NULL);
+  mrb_sdl2_input_filter.installed = true;
+  mrb_sdl2_input_filter.owner = mrb;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_uninstall(mrb_state *mrb, mrb_value self)
+{
+  if (mrb_sdl2_input_filter.installed) {
+    SDL_SetEventFilter(NULL, NULL);
+    mrb_sdl2_input_filter.installed = false;
+    mrb_sdl2_input_filter.owner = NULL;
+    mrb_sdl2_input_filter_release();
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_is_installed(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_input_filter.installed);
+}
+
+/*
+ * SDL2::Input::Filter.allow(*types)
+ */
+static mrb_value
+mrb_sdl2_input_filter_allow(mrb_state *mrb, mrb_value self)
+{
+  mrb_value *argv;
+  mrb_int argc, i;
+  mrb_get_args(mrb, "*", &argv, &argc);
+  for (i = 0; i < argc; ++i) {
+    Uint32 const type = mrb_sdl2_input_filter_type_arg(mrb, argv[i]);
+    mrb_sdl2_input_filter.blocked[type >> 5] &= ~(1u << (type & 31));
+  }
+  return self;
+}
+
+/*
+ * SDL2::Input::Filter.block(*types)
+ */
+static mrb_value
+mrb_sdl2_input_filter_block(mrb_state *mrb, mrb_value self)
+{
+  mrb_value *argv;
+  mrb_int argc, i;
+  mrb_get_args(mrb, "*", &argv, &argc);
+  for (i = 0; i < argc; ++i) {
+    Uint32 const type = mrb_sdl2_input_filter_type_arg(mrb, argv[i]);
+    mrb_sdl2_input_filter.blocked[type >> 5] |= (1u << (type & 31));
+  }
+  return self;
+}
+
+/*
+ * SDL2::Input::Filter.only(*types)
+ *
+ * Blocks every event type except the given ones. Note that this includes
+ * SDL_QUIT unless it is listed.
+ */
+static mrb_value
+mrb_sdl2_input_filter_only(mrb_state *mrb, mrb_value self)
+{
+  Uint32 blocked[MRB_SDL2_INPUT_FILTER_TYPE_WORDS];
+  mrb_value *argv;
+  mrb_int argc, i;
+  mrb_get_args(mrb, "*", &argv, &argc);
+  SDL_memset(blocked, 0xff, sizeof(blocked));
+  for (i = 0; i < argc; ++i) {
+    Uint32 const type = mrb_sdl2_input_filter_type_arg(mrb, argv[i]);
+    blocked[type >> 5] &= ~(1u << (type & 31));
+  }
+  SDL_memcpy(mrb_sdl2_input_filter.blocked, blocked, sizeof(blocked));
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_allow_all(mrb_state *mrb, mrb_value self)
+{
+  SDL_memset(mrb_sdl2_input_filter.blocked, 0, sizeof(mrb_sdl2_input_filter.blocked));
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_is_allowed(mrb_state *mrb, mrb_value self)
+{
+  mrb_value type;
+  mrb_get_args(mrb, "o", &type);
+  return mrb_bool_value(!mrb_sdl2_input_filter_is_blocked(mrb_sdl2_input_filter_type_arg(mrb, type)));
+}
+
+static mrb_value
+mrb_sdl2_input_filter_get_window_id(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_filter.window_id);
+}
+
+/*
+ * SDL2::Input::Filter.window_id=(id)
+ *
+ * Drops window-bound events (keyboard, text, mouse, window, user) of other
+ * windows. 0 accepts all windows.
+ */
+static mrb_value
+mrb_sdl2_input_filter_set_window_id(mrb_state *mrb, mrb_value self)
+{
+  mrb_int window_id;
+  mrb_get_args(mrb, "i", &window_id);
+  mrb_sdl2_input_filter.window_id = (Uint32)window_id;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_get_coalesce_motion(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_input_filter.coalesce_motion);
+}
+
+/*
+ * SDL2::Input::Filter.coalesce_motion=(bool)
+ *
+ * Keeps only the latest SDL_MOUSEMOTION per mouse and window; xrel/yrel
+ * hold the summed motion.
+ */
+static mrb_value
+mrb_sdl2_input_filter_set_coalesce_motion(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool enabled;
+  mrb_get_args(mrb, "b", &enabled);
+  mrb_sdl2_input_filter.coalesce_motion = enabled;
+  if (!enabled) {
+    mrb_sdl2_input_filter_release();
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_get_coalesce_wheel(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_input_filter.coalesce_wheel);
+}
+
+/*
+ * SDL2::Input::Filter.coalesce_wheel=(bool)
+ *
+ * Merges SDL_MOUSEWHEEL events per mouse and window by summing x/y.
+ */
+static mrb_value
+mrb_sdl2_input_filter_set_coalesce_wheel(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool enabled;
+  mrb_get_args(mrb, "b", &enabled);
+  mrb_sdl2_input_filter.coalesce_wheel = enabled;
+  if (!enabled) {
+    mrb_sdl2_input_filter_release();
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_get_coalesce_axis(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_input_filter.coalesce_axis);
+}
+
+/*
+ * SDL2::Input::Filter.coalesce_axis=(bool)
+ *
+ * Keeps only the latest joystick/controller axis value per device and axis.
+ */
+static mrb_value
+mrb_sdl2_input_filter_set_coalesce_axis(mrb_state *mrb, mrb_value self)
+{
+  mrb_bool enabled;
+  mrb_get_args(mrb, "b", &enabled);
+  mrb_sdl2_input_filter.coalesce_axis = enabled;
+  if (!enabled) {
+    mrb_sdl2_input_filter_release();
+  }
+  return self;
+}
+
+/*
+ * SDL2::Input::Filter.release
+ *
+ * Queues the held coalesced events now. SDL2::Input.poll, poll_into and
+ * poll_all do this when they find the queue empty, and the wait functions
+ * before and while blocking, so calling it by hand is rarely needed.
+ */
+static mrb_value
+mrb_sdl2_input_filter_release_held(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_filter_release());
+}
+
+static mrb_value
+mrb_sdl2_input_filter_stats(mrb_state *mrb, mrb_value self)
+{
+  mrb_value stats = mrb_hash_new(mrb);
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "passed")),    mrb_fixnum_value(SDL_AtomicGet(&mrb_sdl2_input_filter.passed)));
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "dropped")),   mrb_fixnum_value(SDL_AtomicGet(&mrb_sdl2_input_filter.dropped)));
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "coalesced")), mrb_fixnum_value(SDL_AtomicGet(&mrb_sdl2_input_filter.coalesced)));
+  return stats;
+}
+
+static mrb_value
+mrb_sdl2_input_filter_reset_stats(mrb_state *mrb, mrb_value self)
+{
+  SDL_AtomicSet(&mrb_sdl2_input_filter.passed,    0);
+  SDL_AtomicSet(&mrb_sdl2_input_filter.dropped,   0);
+  SDL_AtomicSet(&mrb_sdl2_input_filter.coalesced, 0);
+  return self;
+}
+
+void
+mruby_sdl2_events_filter_init(mrb_state *mrb, struct RClass *mod_Input)
+{
+  mod_Filter = mrb_define_module_under(mrb, mod_Input, "Filter");
+
+  mrb_define_module_function(mrb, mod_Filter, "install",          mrb_sdl2_input_filter_install,             MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "uninstall",        mrb_sdl2_input_filter_uninstall,           MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "installed?",       mrb_sdl2_input_filter_is_installed,        MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "allow",            mrb_sdl2_input_filter_allow,               MRB_ARGS_ANY());
+  mrb_define_module_function(mrb, mod_Filter, "block",            mrb_sdl2_input_filter_block,               MRB_ARGS_ANY());
+  mrb_define_module_function(mrb, mod_Filter, "only",             mrb_sdl2_input_filter_only,                MRB_ARGS_ANY());
+  mrb_define_module_function(mrb, mod_Filter, "allow_all",        mrb_sdl2_input_filter_allow_all,           MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "allowed?",         mrb_sdl2_input_filter_is_allowed,          MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Filter, "window_id",        mrb_sdl2_input_filter_get_window_id,       MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "window_id=",       mrb_sdl2_input_filter_set_window_id,       MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Filter, "coalesce_motion",  mrb_sdl2_input_filter_get_coalesce_motion, MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "coalesce_motion=", mrb_sdl2_input_filter_set_coalesce_motion, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Filter, "coalesce_wheel",   mrb_sdl2_input_filter_get_coalesce_wheel,  MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "coalesce_wheel=",  mrb_sdl2_input_filter_set_coalesce_wheel,  MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Filter, "coalesce_axis",    mrb_sdl2_input_filter_get_coalesce_axis,   MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "coalesce_axis=",   mrb_sdl2_input_filter_set_coalesce_axis,   MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Filter, "release",          mrb_sdl2_input_filter_release_held,        MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "stats",            mrb_sdl2_input_filter_stats,               MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Filter, "reset_stats",      mrb_sdl2_input_filter_reset_stats,         MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_events_filter_final(mrb_state *mrb, struct RClass *mod_Input)
+{
+  /* the filter is process-wide; a closing SDL2::Thread VM must not remove
+   * the one its parent installed. */
+  if (mrb_sdl2_input_filter.installed && (mrb_sdl2_input_filter.owner == mrb)) {
+    SDL_SetEventFilter(NULL, NULL);
+    mrb_sdl2_input_filter.installed = false;
+    mrb_sdl2_input_filter.owner = NULL;
+    SDL_AtomicLock(&mrb_sdl2_input_filter.lock);
+    mrb_sdl2_input_filter.held_count = 0;
+    SDL_AtomicUnlock(&mrb_sdl2_input_filter.lock);
+  }
+}
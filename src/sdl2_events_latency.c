@@ -0,0 +1,281 @@
+#include "sdl2_events_latency.h"
+#include "mruby/hash.h"
+#include <SDL2/SDL_timer.h>
+
+#define MRB_SDL2_INPUT_LATENCY_BUCKETS      500
+#define MRB_SDL2_INPUT_LATENCY_PENDING_MAX  256
+
+/*
+ * Latency histogram with one bucket per millisecond; the last bucket
+ * collects everything at or above MRB_SDL2_INPUT_LATENCY_BUCKETS ms.
+ * Event timestamps come from SDL_GetTicks, so millisecond resolution is
+ * all that can be measured.
+ */
+typedef struct mrb_sdl2_input_latency_histogram_t {
+  Uint32 buckets[MRB_SDL2_INPUT_LATENCY_BUCKETS + 1];
+  Uint32 count;
+  Uint32 max;
+  Uint64 sum;
+} mrb_sdl2_input_latency_histogram_t;
+
+/*
+ * 'poll' receives now - timestamp for every input event handed out by the
+ * poll and wait functions, SDL2::Input.poll_all and Dispatcher#pump.
+ * Their timestamps are also kept in 'pending' until the next
+ * Renderer#present or Window#swap, which records now - timestamp for each
+ * of them into 'present'. Only the mruby thread touches this state; it
+ * belongs to the VM that last enabled it, so closing a worker VM that never
+ * used it leaves the measurements alone.
+ */
+static struct {
+  mrb_state *owner;
+  mrb_bool enabled;
+  mrb_sdl2_input_latency_histogram_t poll;
+  mrb_sdl2_input_latency_histogram_t present;
+  Uint32 pending[MRB_SDL2_INPUT_LATENCY_PENDING_MAX];
+  int    pending_count;
+} mrb_sdl2_input_latency;
+
+static void
+mrb_sdl2_input_latency_histogram_add(mrb_sdl2_input_latency_histogram_t *histogram, Uint32 delta)
+{
+  Uint32 const bucket = (MRB_SDL2_INPUT_LATENCY_BUCKETS < delta) ? MRB_SDL2_INPUT_LATENCY_BUCKETS : delta;
+  ++histogram->buckets[bucket];
+  ++histogram->count;
+  histogram->sum += delta;
+  if (histogram->max < delta) {
+    histogram->max = delta;
+  }
+}
+
+/*
+ * Returns the smallest latency in ms that at least 'percent' of the
+ * samples do not exceed. Samples in the overflow bucket report the largest
+ * latency seen.
+ */
+static Uint32
+mrb_sdl2_input_latency_histogram_percentile(mrb_sdl2_input_latency_histogram_t const *histogram, double percent)
+{
+  Uint64 rank = (Uint64)SDL_ceil(percent * histogram->count / 100.0);
+  Uint64 seen = 0;
+  int i;
+  if (0 == rank) {
+    rank = 1;
+  }
+  for (i = 0; i < MRB_SDL2_INPUT_LATENCY_BUCKETS; ++i) {
+    seen += histogram->buckets[i];
+    if (seen >= rank) {
+      return (Uint32)i;
+    }
+  }
+  return histogram->max;
+}
+
+/*
+ * Keyboard, mouse, joystick, controller, touch and gesture events; window,
+ * device and user events are not input latency.
+ */
+static mrb_bool
+mrb_sdl2_input_latency_is_input(Uint32 type)
+{
+  if ((SDL_KEYDOWN > type) || (SDL_CLIPBOARDUPDATE <= type)) {
+    return false;
+  }
+  switch (type) {
+  case SDL_KEYMAPCHANGED:
+  case SDL_JOYDEVICEADDED:
+  case SDL_JOYDEVICEREMOVED:
+  case SDL_CONTROLLERDEVICEADDED:
+  case SDL_CONTROLLERDEVICEREMOVED:
+  case SDL_CONTROLLERDEVICEREMAPPED:
+    return false;
+  default:
+    break;
+  }
+  return true;
+}
+
+void
+mrb_sdl2_input_latency_polled(SDL_Event const *events, int count)
+{
+  Uint32 now;
+  int i;
+  if (!mrb_sdl2_input_latency.enabled) {
+    return;
+  }
+  now = SDL_GetTicks();
+  for (i = 0; i < count; ++i) {
+    Uint32 const timestamp = events[i].common.timestamp;
+    if ((0 == timestamp) || !mrb_sdl2_input_latency_is_input(events[i].type)) {
+      continue;
+    }
+    mrb_sdl2_input_latency_histogram_add(&mrb_sdl2_input_latency.poll, now - timestamp);
+    if (MRB_SDL2_INPUT_LATENCY_PENDING_MAX > mrb_sdl2_input_latency.pending_count) {
+      mrb_sdl2_input_latency.pending[mrb_sdl2_input_latency.pending_count++] = timestamp;
+    }
+  }
+}
+
+void
+mrb_sdl2_input_latency_presented(void)
+{
+  Uint32 now;
+  int i;
+  if (!mrb_sdl2_input_latency.enabled || (0 == mrb_sdl2_input_latency.pending_count)) {
+    return;
+  }
+  now = SDL_GetTicks();
+  for (i = 0; i < mrb_sdl2_input_latency.pending_count; ++i) {
+    mrb_sdl2_input_latency_histogram_add(&mrb_sdl2_input_latency.present, now - mrb_sdl2_input_latency.pending[i]);
+  }
+  mrb_sdl2_input_latency.pending_count = 0;
+}
+
+/***************************************************************************
+*
+* module SDL2::Input::Latency
+*
+***************************************************************************/
+
+static mrb_value
+mrb_sdl2_input_latency_enable(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_latency.owner   = mrb;
+  mrb_sdl2_input_latency.enabled = true;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_latency_disable(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_latency.enabled = false;
+  mrb_sdl2_input_latency.pending_count = 0;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_latency_is_enabled(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_input_latency.enabled);
+}
+
+static mrb_value
+mrb_sdl2_input_latency_reset(mrb_state *mrb, mrb_value self)
+{
+  mrb_state * const owner = mrb_sdl2_input_latency.owner;
+  mrb_bool const enabled = mrb_sdl2_input_latency.enabled;
+  SDL_memset(&mrb_sdl2_input_latency, 0, sizeof(mrb_sdl2_input_latency));
+  mrb_sdl2_input_latency.owner   = owner;
+  mrb_sdl2_input_latency.enabled = enabled;
+  return self;
+}
+
+/*
+ * SDL2::Input::Latency.mark_present
+ *
+ * Records event-to-present latency for the events polled since the last
+ * present. Renderer#present and Window#swap call this already; use it for
+ * frames shown by other means.
+ */
+static mrb_value
+mrb_sdl2_input_latency_mark_present(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_latency_presented();
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_latency_percentile(mrb_state *mrb, mrb_sdl2_input_latency_histogram_t const *histogram)
+{
+  mrb_float percent;
+  mrb_get_args(mrb, "f", &percent);
+  if ((0.0 > percent) || (100.0 < percent)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "percentile out of range.");
+  }
+  if (0 == histogram->count) {
+    return mrb_nil_value();
+  }
+  return mrb_fixnum_value(mrb_sdl2_input_latency_histogram_percentile(histogram, percent));
+}
+
+/*
+ * SDL2::Input::Latency.poll_percentile(percent)
+ *
+ * Returns the event-to-poll latency in ms at the given percentile, or nil
+ * if nothing was recorded.
+ */
+static mrb_value
+mrb_sdl2_input_latency_poll_percentile(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_input_latency_percentile(mrb, &mrb_sdl2_input_latency.poll);
+}
+
+/*
+ * SDL2::Input::Latency.present_percentile(percent)
+ */
+static mrb_value
+mrb_sdl2_input_latency_present_percentile(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_input_latency_percentile(mrb, &mrb_sdl2_input_latency.present);
+}
+
+static void
+mrb_sdl2_input_latency_stats_set(mrb_state *mrb, mrb_value stats, char const *name, mrb_value value)
+{
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_cstr(mrb, name)), value);
+}
+
+static void
+mrb_sdl2_input_latency_stats_add(mrb_state *mrb, mrb_value stats, mrb_value key,
+                                 mrb_sdl2_input_latency_histogram_t const *histogram)
+{
+  mrb_value entry = mrb_hash_new(mrb);
+  mrb_sdl2_input_latency_stats_set(mrb, entry, "count", mrb_fixnum_value(histogram->count));
+  if (0 < histogram->count) {
+    mrb_sdl2_input_latency_stats_set(mrb, entry, "mean", mrb_float_value(mrb, (mrb_float)histogram->sum / histogram->count));
+    mrb_sdl2_input_latency_stats_set(mrb, entry, "p50",  mrb_fixnum_value(mrb_sdl2_input_latency_histogram_percentile(histogram, 50.0)));
+    mrb_sdl2_input_latency_stats_set(mrb, entry, "p90",  mrb_fixnum_value(mrb_sdl2_input_latency_histogram_percentile(histogram, 90.0)));
+    mrb_sdl2_input_latency_stats_set(mrb, entry, "p99",  mrb_fixnum_value(mrb_sdl2_input_latency_histogram_percentile(histogram, 99.0)));
+    mrb_sdl2_input_latency_stats_set(mrb, entry, "max",  mrb_fixnum_value(histogram->max));
+  }
+  mrb_hash_set(mrb, stats, key, entry);
+}
+
+/*
+ * SDL2::Input::Latency.stats
+ *
+ * Returns { poll: {...}, present: {...} }, each with :count and, once
+ * samples exist, :mean, :p50, :p90, :p99 and :max in milliseconds.
+ */
+static mrb_value
+mrb_sdl2_input_latency_stats(mrb_state *mrb, mrb_value self)
+{
+  mrb_value stats = mrb_hash_new(mrb);
+  mrb_sdl2_input_latency_stats_add(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "poll")),    &mrb_sdl2_input_latency.poll);
+  mrb_sdl2_input_latency_stats_add(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "present")), &mrb_sdl2_input_latency.present);
+  return stats;
+}
+
+void
+mruby_sdl2_events_latency_init(mrb_state *mrb, struct RClass *mod_Input)
+{
+  struct RClass *mod_Latency = mrb_define_module_under(mrb, mod_Input, "Latency");
+
+  mrb_define_module_function(mrb, mod_Latency, "enable",             mrb_sdl2_input_latency_enable,             MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Latency, "disable",            mrb_sdl2_input_latency_disable,            MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Latency, "enabled?",           mrb_sdl2_input_latency_is_enabled,         MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Latency, "reset",              mrb_sdl2_input_latency_reset,              MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Latency, "mark_present",       mrb_sdl2_input_latency_mark_present,       MRB_ARGS_NONE());
+  mrb_define_module_function(mrb, mod_Latency, "poll_percentile",    mrb_sdl2_input_latency_poll_percentile,    MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Latency, "present_percentile", mrb_sdl2_input_latency_present_percentile, MRB_ARGS_REQ(1));
+  mrb_define_module_function(mrb, mod_Latency, "stats",              mrb_sdl2_input_latency_stats,              MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_events_latency_final(mrb_state *mrb, struct RClass *mod_Input)
+{
+  if (mrb != mrb_sdl2_input_latency.owner) {
+    return;
+  }
+  SDL_memset(&mrb_sdl2_input_latency, 0, sizeof(mrb_sdl2_input_latency));
+}
@@ -0,0 +1,750 @@
+#include "sdl2_events_recorder.h"
+#include "sdl2_events_filter.h"
+#include "sdl2_rwops.h"
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_timer.h>
+#include <SDL2/SDL_version.h>
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/string.h"
+#include "mruby/variable.h"
+
+/*
+ * Event log layout, all integers little endian:
+ *
+ *   header: "SDLE", Uint32 version, Uint32 sizeof(SDL_Event), Uint32 0
+ *   record: Uint32 milliseconds since recording started, raw SDL_Event
+ *
+ * SDL_Event is stored as is, so a log only replays on builds with the same
+ * SDL_Event size and byte order. Pointers inside events are meaningless in
+ * another process, so events carrying them (drops, syswm, long text edits
+ * and user events with data attached) are neither recorded nor replayed.
+ */
+#define MRB_SDL2_EVENT_LOG_MAGIC        "SDLE"
+#define MRB_SDL2_EVENT_LOG_VERSION      1
+#define MRB_SDL2_EVENT_LOG_RECORD_SIZE  (4 + sizeof(SDL_Event))
+#define MRB_SDL2_EVENT_LOG_WAKE_BYTES   (16 * 1024)
+#define MRB_SDL2_EVENT_LOG_FLUSH_MS     250
+
+static struct RClass *class_Recorder = NULL;
+static struct RClass *class_Player   = NULL;
+
+static void
+mrb_sdl2_event_log_put32(Uint8 *p, Uint32 value)
+{
+  p[0] = (Uint8)(value);
+  p[1] = (Uint8)(value >> 8);
+  p[2] = (Uint8)(value >> 16);
+  p[3] = (Uint8)(value >> 24);
+}
+
+static Uint32
+mrb_sdl2_event_log_get32(Uint8 const *p)
+{
+  return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+/* false for events holding pointers, which must not cross a log. */
+static bool
+mrb_sdl2_event_log_is_portable(SDL_Event const *event)
+{
+  switch (event->type) {
+  case SDL_DROPFILE:
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+  case SDL_DROPTEXT:
+#endif
+#if SDL_VERSION_ATLEAST(2, 0, 22)
+  case SDL_TEXTEDITING_EXT:
+#endif
+  case SDL_SYSWMEVENT:
+    return false;
+  default:
+    break;
+  }
+  /* user event data is mrb_malloc'd and freed by whoever reads it. */
+  return (event->type < SDL_USEREVENT) ||
+         ((NULL == event->user.data1) && (NULL == event->user.data2));
+}
+
+/*
+ * Opens 'source' (a file name or an SDL2::RWops) for a recorder or player.
+ * A borrowed RWops is kept alive through an instance variable.
+ */
+static SDL_RWops *
+mrb_sdl2_event_log_open(mrb_state *mrb, mrb_value self, mrb_value source, char const *mode, bool *owns_rwops)
+{
+  SDL_RWops *rwops;
+  if (mrb_string_p(source)) {
+    rwops = SDL_RWFromFile(RSTRING_PTR(source), mode);
+    if (NULL == rwops) {
+      mruby_sdl2_raise_error(mrb);
+    }
+    *owns_rwops = true;
+  } else {
+    rwops = mrb_sdl2_rwops_get_ptr(mrb, source);
+    if (NULL == rwops) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "expected file name or SDL2::RWops.");
+    }
+    mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "__rwops__"), source);
+    *owns_rwops = false;
+  }
+  return rwops;
+}
+
+/***************************************************************************
+*
+* Recorder
+*
+***************************************************************************/
+
+/*
+ * Events are captured on whatever thread pushes them (an event watch that
+ * SDL2::Input::Filter also runs for the events it holds back) and
+ * appended as log records to 'pending'. A writer thread swaps 'pending'
+ * for its own buffer and writes it out, so the RWops is never touched by
+ * the thread running mruby while recording.
+ */
+typedef struct mrb_sdl2_input_recorder_data_t {
+  SDL_RWops  *rwops;
+  bool        owns_rwops;
+  bool        recording;
+  bool        started;
+  bool        quit;
+  bool        write_failed;
+  Uint32      start_ticks;
+  Uint32      last_offset;
+  Uint8      *pending;
+  size_t      pending_size;
+  size_t      pending_capacity;
+  mrb_int     count;
+  mrb_int     dropped;
+  SDL_mutex  *lock;
+  SDL_cond   *cond;
+  SDL_Thread *thread;
+} mrb_sdl2_input_recorder_data_t;
+
+/* only one recorder captures at a time; guarded by the spin lock. */
+static mrb_sdl2_input_recorder_data_t *mrb_sdl2_input_recorder_active = NULL;
+static SDL_SpinLock                     mrb_sdl2_input_recorder_lock   = 0;
+
+/* appends one record; called with data->lock held. */
+static void
+mrb_sdl2_input_recorder_append(mrb_sdl2_input_recorder_data_t *data, SDL_Event const *event)
+{
+  Uint8 *record;
+  Uint32 offset;
+
+  if (!mrb_sdl2_event_log_is_portable(event)) {
+    return;
+  }
+
+  if (data->pending_size + MRB_SDL2_EVENT_LOG_RECORD_SIZE > data->pending_capacity) {
+    size_t const capacity = SDL_max(data->pending_capacity * 2, 64 * MRB_SDL2_EVENT_LOG_RECORD_SIZE);
+    Uint8 *pending = (Uint8*)SDL_realloc(data->pending, capacity);
+    if (NULL == pending) {
+      ++data->dropped;
+      return;
+    }
+    data->pending = pending;
+    data->pending_capacity = capacity;
+  }
+
+  offset = (event->common.timestamp > data->start_ticks) ? (event->common.timestamp - data->start_ticks) : 0;
+  if (offset < data->last_offset) {
+    offset = data->last_offset;
+  }
+  data->last_offset = offset;
+
+  record = data->pending + data->pending_size;
+  mrb_sdl2_event_log_put32(record, offset);
+  SDL_memcpy(record + 4, event, sizeof(SDL_Event));
+  data->pending_size += MRB_SDL2_EVENT_LOG_RECORD_SIZE;
+  ++data->count;
+
+  if (MRB_SDL2_EVENT_LOG_WAKE_BYTES <= data->pending_size) {
+    SDL_CondSignal(data->cond);
+  }
+}
+
+static void
+mrb_sdl2_input_recorder_capture(SDL_Event const *events, int count)
+{
+  mrb_sdl2_input_recorder_data_t *data;
+  int i;
+  SDL_AtomicLock(&mrb_sdl2_input_recorder_lock);
+  data = mrb_sdl2_input_recorder_active;
+  if (NULL != data) {
+    SDL_LockMutex(data->lock);
+    for (i = 0; i < count; ++i) {
+      mrb_sdl2_input_recorder_append(data, &events[i]);
+    }
+    SDL_UnlockMutex(data->lock);
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_input_recorder_lock);
+}
+
+static int SDLCALL
+mrb_sdl2_input_recorder_watch(void *userdata, SDL_Event *event)
+{
+  mrb_sdl2_input_recorder_capture(event, 1);
+  return 0;
+}
+
+static int SDLCALL
+mrb_sdl2_input_recorder_writer(void *p)
+{
+  mrb_sdl2_input_recorder_data_t *data = (mrb_sdl2_input_recorder_data_t*)p;
+  Uint8 *buffer = NULL;
+  size_t capacity = 0;
+
+  SDL_LockMutex(data->lock);
+  for (;;) {
+    Uint8 *full;
+    size_t full_capacity, size;
+    if ((0 == data->pending_size) && !data->quit) {
+      SDL_CondWaitTimeout(data->cond, data->lock, MRB_SDL2_EVENT_LOG_FLUSH_MS);
+      continue;
+    }
+    if (0 == data->pending_size) {
+      break;
+    }
+    full          = data->pending;
+    full_capacity = data->pending_capacity;
+    size          = data->pending_size;
+    data->pending          = buffer;
+    data->pending_capacity = capacity;
+    data->pending_size     = 0;
+    buffer   = full;
+    capacity = full_capacity;
+
+    SDL_UnlockMutex(data->lock);
+    if (1 != SDL_RWwrite(data->rwops, buffer, size, 1)) {
+      SDL_LockMutex(data->lock);
+      data->write_failed = true;
+      continue;
+    }
+    SDL_LockMutex(data->lock);
+  }
+  SDL_UnlockMutex(data->lock);
+  SDL_free(buffer);
+  return 0;
+}
+
+static void
+mrb_sdl2_input_recorder_stop(mrb_sdl2_input_recorder_data_t *data)
+{
+  if (!data->recording) {
+    return;
+  }
+  mrb_sdl2_input_filter_del_watch(mrb_sdl2_input_recorder_watch, data);
+  SDL_AtomicLock(&mrb_sdl2_input_recorder_lock);
+  if (mrb_sdl2_input_recorder_active == data) {
+    mrb_sdl2_input_recorder_active = NULL;
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_input_recorder_lock);
+
+  SDL_LockMutex(data->lock);
+  data->quit = true;
+  SDL_CondSignal(data->cond);
+  SDL_UnlockMutex(data->lock);
+  SDL_WaitThread(data->thread, NULL);
+  data->thread    = NULL;
+  data->quit      = false;
+  data->recording = false;
+}
+
+static void
+mrb_sdl2_input_recorder_close(mrb_sdl2_input_recorder_data_t *data)
+{
+  mrb_sdl2_input_recorder_stop(data);
+  if (NULL != data->cond) {
+    SDL_DestroyCond(data->cond);
+    data->cond = NULL;
+  }
+  if (NULL != data->lock) {
+    SDL_DestroyMutex(data->lock);
+    data->lock = NULL;
+  }
+  if (NULL != data->pending) {
+    SDL_free(data->pending);
+    data->pending = NULL;
+  }
+  data->pending_size     = 0;
+  data->pending_capacity = 0;
+  if ((NULL != data->rwops) && data->owns_rwops) {
+    SDL_RWclose(data->rwops);
+  }
+  data->rwops = NULL;
+}
+
+static void
+mrb_sdl2_input_recorder_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_input_recorder_data_t *data =
+    (mrb_sdl2_input_recorder_data_t*)p;
+  if (NULL != data) {
+    mrb_sdl2_input_recorder_close(data);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_input_recorder_data_type = {
+  "Recorder", mrb_sdl2_input_recorder_data_free
+};
+
+static mrb_sdl2_input_recorder_data_t *
+mrb_sdl2_input_recorder_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_recorder_data_t *data =
+    (mrb_sdl2_input_recorder_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_input_recorder_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized recorder.");
+  }
+  return data;
+}
+
+/*
+ * SDL2::Input::Recorder#initialize(destination)
+ *
+ * 'destination' is a file name (truncated) or a writable SDL2::RWops,
+ * which must not be used elsewhere while the recorder is open. The log
+ * header is written immediately.
+ */
+static mrb_value
+mrb_sdl2_input_recorder_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_recorder_data_t *data;
+  mrb_value destination;
+  Uint8 header[16];
+  mrb_get_args(mrb, "o", &destination);
+
+  data = (mrb_sdl2_input_recorder_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_input_recorder_close(data);
+  } else {
+    data = (mrb_sdl2_input_recorder_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_input_recorder_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_input_recorder_data_type;
+
+  data->rwops = mrb_sdl2_event_log_open(mrb, self, destination, "wb", &data->owns_rwops);
+  data->lock  = SDL_CreateMutex();
+  data->cond  = SDL_CreateCond();
+  if ((NULL == data->lock) || (NULL == data->cond)) {
+    mrb_sdl2_input_recorder_close(data);
+    mruby_sdl2_raise_error(mrb);
+  }
+
+  SDL_memcpy(header, MRB_SDL2_EVENT_LOG_MAGIC, 4);
+  mrb_sdl2_event_log_put32(header + 4,  MRB_SDL2_EVENT_LOG_VERSION);
+  mrb_sdl2_event_log_put32(header + 8,  (Uint32)sizeof(SDL_Event));
+  mrb_sdl2_event_log_put32(header + 12, 0);
+  if (1 != SDL_RWwrite(data->rwops, header, sizeof(header), 1)) {
+    mrb_sdl2_input_recorder_close(data);
+    mruby_sdl2_raise_error(mrb);
+  }
+  return self;
+}
+
+/*
+ * SDL2::Input::Recorder#start
+ *
+ * Starts capturing every event that enters the SDL queue. Timestamps are
+ * relative to the first start; stopping and starting again continues the
+ * same timeline. Only one recorder can capture at a time.
+ */
+static mrb_value
+mrb_sdl2_input_recorder_start(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_recorder_data_t *data = mrb_sdl2_input_recorder_get_ptr(mrb, self);
+  bool busy;
+  if (data->recording) {
+    return self;
+  }
+  if (NULL == data->rwops) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "recorder is closed.");
+  }
+
+  SDL_AtomicLock(&mrb_sdl2_input_recorder_lock);
+  busy = (NULL != mrb_sdl2_input_recorder_active);
+  SDL_AtomicUnlock(&mrb_sdl2_input_recorder_lock);
+  if (busy) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "another recorder is active.");
+  }
+
+  if (!data->started) {
+    data->start_ticks = SDL_GetTicks();
+    data->started = true;
+  }
+  data->thread = SDL_CreateThread(mrb_sdl2_input_recorder_writer, "mruby-sdl2-recorder", data);
+  if (NULL == data->thread) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  data->recording = true;
+
+  SDL_AtomicLock(&mrb_sdl2_input_recorder_lock);
+  mrb_sdl2_input_recorder_active = data;
+  SDL_AtomicUnlock(&mrb_sdl2_input_recorder_lock);
+  if (!mrb_sdl2_input_filter_add_watch(mrb_sdl2_input_recorder_watch, data)) {
+    mrb_sdl2_input_recorder_stop(data);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "too many event watches.");
+  }
+  return self;
+}
+
+/*
+ * SDL2::Input::Recorder#stop
+ *
+ * Stops capturing and waits until everything captured so far is written.
+ */
+static mrb_value
+mrb_sdl2_input_recorder_stop_recording(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_recorder_data_t *data = mrb_sdl2_input_recorder_get_ptr(mrb, self);
+  mrb_sdl2_input_recorder_stop(data);
+  if (data->write_failed) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "failed to write event log.");
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_recorder_close_log(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_recorder_data_t *data = mrb_sdl2_input_recorder_get_ptr(mrb, self);
+  bool const failed = data->write_failed;
+  mrb_sdl2_input_recorder_close(data);
+  if (failed) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "failed to write event log.");
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_recorder_is_recording(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_input_recorder_get_ptr(mrb, self)->recording);
+}
+
+static mrb_value
+mrb_sdl2_input_recorder_get_count(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_recorder_data_t *data = mrb_sdl2_input_recorder_get_ptr(mrb, self);
+  mrb_int count;
+  if (NULL == data->lock) {
+    return mrb_fixnum_value(data->count);
+  }
+  SDL_LockMutex(data->lock);
+  count = data->count;
+  SDL_UnlockMutex(data->lock);
+  return mrb_fixnum_value(count);
+}
+
+static mrb_value
+mrb_sdl2_input_recorder_get_dropped(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_recorder_data_t *data = mrb_sdl2_input_recorder_get_ptr(mrb, self);
+  mrb_int dropped;
+  if (NULL == data->lock) {
+    return mrb_fixnum_value(data->dropped);
+  }
+  SDL_LockMutex(data->lock);
+  dropped = data->dropped;
+  SDL_UnlockMutex(data->lock);
+  return mrb_fixnum_value(dropped);
+}
+
+/***************************************************************************
+*
+* Player
+*
+***************************************************************************/
+
+/*
+ * Records are read one ahead into 'next'. The playback clock starts at the
+ * first update: in real-time mode it follows SDL_GetTicks, otherwise it
+ * advances by 'frame_ms' per update (or straight to the next record when
+ * frame_ms is 0), which replays as fast as the caller runs frames and
+ * gives the same event-to-frame assignment on every run.
+ */
+typedef struct mrb_sdl2_input_player_data_t {
+  SDL_RWops *rwops;
+  bool       owns_rwops;
+  bool       has_next;
+  bool       started;
+  bool       realtime;
+  Uint32     frame_ms;
+  Uint32     start_ticks;
+  Uint32     clock;
+  Uint32     next_offset;
+  SDL_Event  next;
+  Sint64     data_start;
+  mrb_int    pushed;
+} mrb_sdl2_input_player_data_t;
+
+static void
+mrb_sdl2_input_player_close(mrb_sdl2_input_player_data_t *data)
+{
+  if ((NULL != data->rwops) && data->owns_rwops) {
+    SDL_RWclose(data->rwops);
+  }
+  data->rwops    = NULL;
+  data->has_next = false;
+}
+
+static void
+mrb_sdl2_input_player_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_input_player_data_t *data =
+    (mrb_sdl2_input_player_data_t*)p;
+  if (NULL != data) {
+    mrb_sdl2_input_player_close(data);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_input_player_data_type = {
+  "Player", mrb_sdl2_input_player_data_free
+};
+
+static mrb_sdl2_input_player_data_t *
+mrb_sdl2_input_player_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_player_data_t *data =
+    (mrb_sdl2_input_player_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_input_player_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized player.");
+  }
+  return data;
+}
+
+/* skips records with pointers, which a foreign or damaged log may hold. */
+static void
+mrb_sdl2_input_player_read_next(mrb_sdl2_input_player_data_t *data)
+{
+  Uint8 offset[4];
+  do {
+    data->has_next =
+      (NULL != data->rwops) &&
+      (1 == SDL_RWread(data->rwops, offset, sizeof(offset), 1)) &&
+      (1 == SDL_RWread(data->rwops, &data->next, sizeof(SDL_Event), 1));
+  } while (data->has_next && !mrb_sdl2_event_log_is_portable(&data->next));
+  if (data->has_next) {
+    data->next_offset = mrb_sdl2_event_log_get32(offset);
+  }
+}
+
+/*
+ * SDL2::Input::Player#initialize(source)
+ *
+ * 'source' is a file name or a readable SDL2::RWops holding a log written
+ * by SDL2::Input::Recorder. Playback is real-time by default.
+ */
+static mrb_value
+mrb_sdl2_input_player_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_player_data_t *data;
+  mrb_value source;
+  Uint8 header[16];
+  mrb_get_args(mrb, "o", &source);
+
+  data = (mrb_sdl2_input_player_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_input_player_close(data);
+  } else {
+    data = (mrb_sdl2_input_player_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_input_player_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_input_player_data_type;
+
+  data->rwops    = mrb_sdl2_event_log_open(mrb, self, source, "rb", &data->owns_rwops);
+  data->realtime = true;
+  data->frame_ms = 16;
+
+  if ((1 != SDL_RWread(data->rwops, header, sizeof(header), 1)) ||
+      (0 != SDL_memcmp(header, MRB_SDL2_EVENT_LOG_MAGIC, 4)) ||
+      (MRB_SDL2_EVENT_LOG_VERSION != mrb_sdl2_event_log_get32(header + 4))) {
+    mrb_sdl2_input_player_close(data);
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "not an event log.");
+  }
+  if (sizeof(SDL_Event) != mrb_sdl2_event_log_get32(header + 8)) {
+    mrb_sdl2_input_player_close(data);
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "event log was recorded with a different SDL_Event size.");
+  }
+  data->data_start = SDL_RWtell(data->rwops);
+  mrb_sdl2_input_player_read_next(data);
+  return self;
+}
+
+/*
+ * SDL2::Input::Player#update
+ *
+ * Advances the playback clock and pushes every event that is due with
+ * SDL_PushEvent. Returns the number of events pushed. Events are retried
+ * on the next update if the queue is full.
+ */
+static mrb_value
+mrb_sdl2_input_player_update(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_player_data_t *data = mrb_sdl2_input_player_get_ptr(mrb, self);
+  mrb_int pushed = 0;
+  if (!data->has_next) {
+    return mrb_fixnum_value(0);
+  }
+
+  if (!data->started) {
+    data->started     = true;
+    data->start_ticks = SDL_GetTicks();
+    data->clock       = 0;
+  } else if (data->realtime) {
+    data->clock = SDL_GetTicks() - data->start_ticks;
+  } else if (0 == data->frame_ms) {
+    data->clock = SDL_max(data->clock, data->next_offset);
+  } else {
+    data->clock += data->frame_ms;
+  }
+
+  while (data->has_next && (data->next_offset <= data->clock)) {
+    int const ret = SDL_PushEvent(&data->next);
+    if (0 > ret) {
+      break;
+    }
+    pushed += ret;
+    mrb_sdl2_input_player_read_next(data);
+  }
+  data->pushed += pushed;
+  return mrb_fixnum_value(pushed);
+}
+
+/*
+ * SDL2::Input::Player#rewind
+ */
+static mrb_value
+mrb_sdl2_input_player_rewind(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_player_data_t *data = mrb_sdl2_input_player_get_ptr(mrb, self);
+  if (NULL == data->rwops) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "player is closed.");
+  }
+  if (0 > SDL_RWseek(data->rwops, data->data_start, RW_SEEK_SET)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  data->started = false;
+  data->clock   = 0;
+  data->pushed  = 0;
+  mrb_sdl2_input_player_read_next(data);
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_player_close_log(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_player_close(mrb_sdl2_input_player_get_ptr(mrb, self));
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_player_is_finished(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(!mrb_sdl2_input_player_get_ptr(mrb, self)->has_next);
+}
+
+static mrb_value
+mrb_sdl2_input_player_get_clock(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_player_get_ptr(mrb, self)->clock);
+}
+
+static mrb_value
+mrb_sdl2_input_player_get_pushed(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_player_get_ptr(mrb, self)->pushed);
+}
+
+static mrb_value
+mrb_sdl2_input_player_get_realtime(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_input_player_get_ptr(mrb, self)->realtime);
+}
+
+/*
+ * SDL2::Input::Player#realtime=(bool)
+ *
+ * Switching modes during playback keeps the current clock.
+ */
+static mrb_value
+mrb_sdl2_input_player_set_realtime(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_player_data_t *data = mrb_sdl2_input_player_get_ptr(mrb, self);
+  mrb_bool realtime;
+  mrb_get_args(mrb, "b", &realtime);
+  if (realtime && !data->realtime) {
+    data->start_ticks = SDL_GetTicks() - data->clock;
+  }
+  data->realtime = realtime;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_input_player_get_frame_ms(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_input_player_get_ptr(mrb, self)->frame_ms);
+}
+
+static mrb_value
+mrb_sdl2_input_player_set_frame_ms(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_input_player_data_t *data = mrb_sdl2_input_player_get_ptr(mrb, self);
+  mrb_int frame_ms;
+  mrb_get_args(mrb, "i", &frame_ms);
+  if (0 > frame_ms) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "negative frame time.");
+  }
+  data->frame_ms = (Uint32)frame_ms;
+  return self;
+}
+
+void
+mruby_sdl2_events_recorder_init(mrb_state *mrb, struct RClass *mod_Input)
+{
+  class_Recorder = mrb_define_class_under(mrb, mod_Input, "Recorder", mrb->object_class);
+  class_Player   = mrb_define_class_under(mrb, mod_Input, "Player",   mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_Recorder, MRB_TT_DATA);
+  MRB_SET_INSTANCE_TT(class_Player,   MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_Recorder, "initialize", mrb_sdl2_input_recorder_initialize,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Recorder, "start",      mrb_sdl2_input_recorder_start,          MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Recorder, "stop",       mrb_sdl2_input_recorder_stop_recording, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Recorder, "close",      mrb_sdl2_input_recorder_close_log,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Recorder, "recording?", mrb_sdl2_input_recorder_is_recording,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Recorder, "count",      mrb_sdl2_input_recorder_get_count,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Recorder, "dropped",    mrb_sdl2_input_recorder_get_dropped,    MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, class_Player, "initialize", mrb_sdl2_input_player_initialize,   MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Player, "update",     mrb_sdl2_input_player_update,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "rewind",     mrb_sdl2_input_player_rewind,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "close",      mrb_sdl2_input_player_close_log,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "finished?",  mrb_sdl2_input_player_is_finished,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "clock",      mrb_sdl2_input_player_get_clock,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "pushed",     mrb_sdl2_input_player_get_pushed,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "realtime",   mrb_sdl2_input_player_get_realtime, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "realtime=",  mrb_sdl2_input_player_set_realtime, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Player, "frame_ms",   mrb_sdl2_input_player_get_frame_ms, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Player, "frame_ms=",  mrb_sdl2_input_player_set_frame_ms, MRB_ARGS_REQ(1));
+}
+
+void
+mruby_sdl2_events_recorder_final(mrb_state *mrb, struct RClass *mod_Input)
+{
+}
@@ -1,4 +1,5 @@
 #include "sdl2_keyboard.h"
+#include "sdl2_keyboard_state.h"
 #include "sdl2_video.h"
 #include "sdl2_rect.h"
 #include "mruby/value.h"
@@ -681,10 +682,13 @@ mruby_sdl2_keyboard_init(mrb_state *mrb)
   mrb_define_const(mrb, mod_Keyboard, "SDL_SCANCODE_APP2", mrb_fixnum_value(SDL_SCANCODE_APP2));
   mrb_define_const(mrb, mod_Keyboard, "SDL_NUM_SCANCODES", mrb_fixnum_value(SDL_NUM_SCANCODES));
   mrb_gc_arena_restore(mrb, arena_size);
+
+  mruby_sdl2_keyboard_state_init(mrb, mod_Keyboard);
 }
 
 void
 mruby_sdl2_keyboard_final(mrb_state *mrb)
 {
+  mruby_sdl2_keyboard_state_final(mrb, mod_Keyboard);
 }
 
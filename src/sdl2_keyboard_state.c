@@ -0,0 +1,389 @@
+#include "sdl2_keyboard_state.h"
+#include "mruby/data.h"
+#include "mruby/class.h"
+#include "mruby/array.h"
+#include "mruby/variable.h"
+
+/* bit count that fits a positive Fixnum under every value boxing. */
+#define MRB_SDL2_KEYBOARD_MASK_BITS ((int)(sizeof(mrb_int) * 8) - 2)
+
+static struct RClass *class_State    = NULL;
+static struct RClass *class_Snapshot = NULL;
+
+static int
+mrb_sdl2_keyboard_scancode_arg(mrb_state *mrb, mrb_value value)
+{
+  mrb_int const scancode = mrb_fixnum(mrb_Integer(mrb, value));
+  if ((0 > scancode) || (SDL_NUM_SCANCODES <= scancode)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "scancode out of range.");
+  }
+  return (int)scancode;
+}
+
+/***************************************************************************
+*
+* class SDL2::Input::Keyboard::State
+*
+***************************************************************************/
+
+/*
+ * Read-only view of the array returned by SDL_GetKeyboardState. SDL owns
+ * the array and keeps it for the lifetime of the application; it changes
+ * whenever events are pumped.
+ */
+typedef struct mrb_sdl2_keyboard_state_data_t {
+  Uint8 const *keys;
+  int          numkeys;
+} mrb_sdl2_keyboard_state_data_t;
+
+static void
+mrb_sdl2_keyboard_state_data_free(mrb_state *mrb, void *p)
+{
+  mrb_free(mrb, p);
+}
+
+static struct mrb_data_type const mrb_sdl2_keyboard_state_data_type = {
+  "State", mrb_sdl2_keyboard_state_data_free
+};
+
+static mrb_sdl2_keyboard_state_data_t *
+mrb_sdl2_keyboard_state_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_state_data_t *data =
+    (mrb_sdl2_keyboard_state_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_keyboard_state_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized keyboard state.");
+  }
+  return data;
+}
+
+/*
+ * SDL2::Input::Keyboard.state
+ *
+ * Returns the SDL2::Input::Keyboard::State view; the same object is
+ * returned on every call.
+ */
+static mrb_value
+mrb_sdl2_keyboard_get_state(mrb_state *mrb, mrb_value mod)
+{
+  mrb_sdl2_keyboard_state_data_t *data;
+  mrb_sym const name = mrb_intern_lit(mrb, "__state__");
+  mrb_value state = mrb_iv_get(mrb, mod, name);
+  if (!mrb_nil_p(state)) {
+    return state;
+  }
+
+  data = (mrb_sdl2_keyboard_state_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_keyboard_state_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  data->keys = SDL_GetKeyboardState(&data->numkeys);
+  state = mrb_obj_value(Data_Wrap_Struct(mrb, class_State, &mrb_sdl2_keyboard_state_data_type, data));
+  mrb_iv_set(mrb, mod, name, state);
+  return state;
+}
+
+static mrb_value
+mrb_sdl2_keyboard_state_get_size(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_keyboard_state_get_ptr(mrb, self)->numkeys);
+}
+
+static mrb_value
+mrb_sdl2_keyboard_state_get_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_state_data_t *data = mrb_sdl2_keyboard_state_get_ptr(mrb, self);
+  mrb_value scancode;
+  int index;
+  mrb_get_args(mrb, "o", &scancode);
+  index = mrb_sdl2_keyboard_scancode_arg(mrb, scancode);
+  return mrb_fixnum_value((index < data->numkeys) ? data->keys[index] : 0);
+}
+
+static mrb_value
+mrb_sdl2_keyboard_state_is_pressed(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_state_data_t *data = mrb_sdl2_keyboard_state_get_ptr(mrb, self);
+  mrb_value scancode;
+  int index;
+  mrb_get_args(mrb, "o", &scancode);
+  index = mrb_sdl2_keyboard_scancode_arg(mrb, scancode);
+  return mrb_bool_value((index < data->numkeys) && (0 != data->keys[index]));
+}
+
+static mrb_value
+mrb_sdl2_keyboard_state_get_cptr(mrb_state *mrb, mrb_value self)
+{
+  return mrb_cptr_value(mrb, (void*)mrb_sdl2_keyboard_state_get_ptr(mrb, self)->keys);
+}
+
+/***************************************************************************
+*
+* class SDL2::Input::Keyboard::Snapshot
+*
+***************************************************************************/
+
+/*
+ * Two copies of the keyboard state; 'keys[current]' is the state at the
+ * last update and the other one the state at the update before it.
+ * 'bindings' are the scancodes used by the *_mask queries when they are
+ * called without arguments.
+ */
+typedef struct mrb_sdl2_keyboard_snapshot_data_t {
+  Uint8 keys[2][SDL_NUM_SCANCODES];
+  int   current;
+  int   bindings[MRB_SDL2_KEYBOARD_MASK_BITS];
+  int   nbindings;
+} mrb_sdl2_keyboard_snapshot_data_t;
+
+static void
+mrb_sdl2_keyboard_snapshot_data_free(mrb_state *mrb, void *p)
+{
+  mrb_free(mrb, p);
+}
+
+static struct mrb_data_type const mrb_sdl2_keyboard_snapshot_data_type = {
+  "Snapshot", mrb_sdl2_keyboard_snapshot_data_free
+};
+
+static mrb_sdl2_keyboard_snapshot_data_t *
+mrb_sdl2_keyboard_snapshot_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data =
+    (mrb_sdl2_keyboard_snapshot_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_keyboard_snapshot_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized keyboard snapshot.");
+  }
+  return data;
+}
+
+/* reads a scancode list (an Array) into 'codes'; returns its length. */
+static int
+mrb_sdl2_keyboard_snapshot_scancodes(mrb_state *mrb, mrb_value list, int *codes)
+{
+  mrb_int i, n;
+  if (!mrb_array_p(list)) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected Array of scancodes.");
+  }
+  n = mrb_ary_len(mrb, list);
+  if (MRB_SDL2_KEYBOARD_MASK_BITS < n) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "too many scancodes.");
+  }
+  for (i = 0; i < n; ++i) {
+    codes[i] = mrb_sdl2_keyboard_scancode_arg(mrb, mrb_ary_ref(mrb, list, i));
+  }
+  return (int)n;
+}
+
+enum {
+  MRB_SDL2_KEYBOARD_HELD,
+  MRB_SDL2_KEYBOARD_PRESSED,
+  MRB_SDL2_KEYBOARD_RELEASED
+};
+
+static bool
+mrb_sdl2_keyboard_snapshot_test(mrb_sdl2_keyboard_snapshot_data_t const *data, int scancode, int kind)
+{
+  bool const now    = 0 != data->keys[data->current][scancode];
+  bool const before = 0 != data->keys[data->current ^ 1][scancode];
+  switch (kind) {
+  case MRB_SDL2_KEYBOARD_PRESSED:
+    return now && !before;
+  case MRB_SDL2_KEYBOARD_RELEASED:
+    return !now && before;
+  default:
+    return now;
+  }
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_query(mrb_state *mrb, mrb_value self, int kind)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data = mrb_sdl2_keyboard_snapshot_get_ptr(mrb, self);
+  mrb_value scancode;
+  mrb_get_args(mrb, "o", &scancode);
+  return mrb_bool_value(mrb_sdl2_keyboard_snapshot_test(data, mrb_sdl2_keyboard_scancode_arg(mrb, scancode), kind));
+}
+
+/*
+ * Bit i of the result is set when the i-th scancode of the list (or of the
+ * bindings when no list is given) matches.
+ */
+static mrb_value
+mrb_sdl2_keyboard_snapshot_mask(mrb_state *mrb, mrb_value self, int kind)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data = mrb_sdl2_keyboard_snapshot_get_ptr(mrb, self);
+  int codes[MRB_SDL2_KEYBOARD_MASK_BITS];
+  int const *list = data->bindings;
+  int n = data->nbindings;
+  mrb_int mask = 0;
+  mrb_value scancodes;
+  int i;
+  if (1 == mrb_get_args(mrb, "|o", &scancodes)) {
+    n = mrb_sdl2_keyboard_snapshot_scancodes(mrb, scancodes, codes);
+    list = codes;
+  }
+  for (i = 0; i < n; ++i) {
+    mask |= (mrb_int)mrb_sdl2_keyboard_snapshot_test(data, list[i], kind) << i;
+  }
+  return mrb_fixnum_value(mask);
+}
+
+/*
+ * SDL2::Input::Keyboard::Snapshot#initialize
+ *
+ * Both copies start out as the current keyboard state, so nothing reads
+ * as pressed or released until the first change.
+ */
+static mrb_value
+mrb_sdl2_keyboard_snapshot_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data =
+    (mrb_sdl2_keyboard_snapshot_data_t*)DATA_PTR(self);
+  Uint8 const *keys;
+  int numkeys;
+  if (NULL == data) {
+    data = (mrb_sdl2_keyboard_snapshot_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_keyboard_snapshot_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  keys = SDL_GetKeyboardState(&numkeys);
+  SDL_memcpy(data->keys[0], keys, SDL_min(numkeys, SDL_NUM_SCANCODES));
+  SDL_memcpy(data->keys[1], data->keys[0], SDL_NUM_SCANCODES);
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_keyboard_snapshot_data_type;
+  return self;
+}
+
+/*
+ * SDL2::Input::Keyboard::Snapshot#update
+ *
+ * Takes a new snapshot; call once per frame after draining events. The
+ * previous snapshot becomes the reference for the edge queries.
+ */
+static mrb_value
+mrb_sdl2_keyboard_snapshot_update(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data = mrb_sdl2_keyboard_snapshot_get_ptr(mrb, self);
+  int numkeys;
+  Uint8 const *keys = SDL_GetKeyboardState(&numkeys);
+  data->current ^= 1;
+  SDL_memcpy(data->keys[data->current], keys, SDL_min(numkeys, SDL_NUM_SCANCODES));
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_is_held(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_keyboard_snapshot_query(mrb, self, MRB_SDL2_KEYBOARD_HELD);
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_is_pressed(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_keyboard_snapshot_query(mrb, self, MRB_SDL2_KEYBOARD_PRESSED);
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_is_released(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_keyboard_snapshot_query(mrb, self, MRB_SDL2_KEYBOARD_RELEASED);
+}
+
+/*
+ * SDL2::Input::Keyboard::Snapshot#changed?
+ *
+ * True if any key went down or up between the last two updates.
+ */
+static mrb_value
+mrb_sdl2_keyboard_snapshot_is_changed(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data = mrb_sdl2_keyboard_snapshot_get_ptr(mrb, self);
+  return mrb_bool_value(0 != SDL_memcmp(data->keys[0], data->keys[1], SDL_NUM_SCANCODES));
+}
+
+/*
+ * SDL2::Input::Keyboard::Snapshot#bind(scancodes)
+ *
+ * Stores the scancode list used by held_mask, pressed_mask and
+ * released_mask when they are called without arguments.
+ */
+static mrb_value
+mrb_sdl2_keyboard_snapshot_bind(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data = mrb_sdl2_keyboard_snapshot_get_ptr(mrb, self);
+  int codes[MRB_SDL2_KEYBOARD_MASK_BITS];
+  mrb_value scancodes;
+  int n;
+  mrb_get_args(mrb, "o", &scancodes);
+  n = mrb_sdl2_keyboard_snapshot_scancodes(mrb, scancodes, codes);
+  SDL_memcpy(data->bindings, codes, sizeof(int) * n);
+  data->nbindings = n;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_get_bindings(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_keyboard_snapshot_data_t *data = mrb_sdl2_keyboard_snapshot_get_ptr(mrb, self);
+  mrb_value array = mrb_ary_new_capa(mrb, data->nbindings);
+  int i;
+  for (i = 0; i < data->nbindings; ++i) {
+    mrb_ary_push(mrb, array, mrb_fixnum_value(data->bindings[i]));
+  }
+  return array;
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_held_mask(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_keyboard_snapshot_mask(mrb, self, MRB_SDL2_KEYBOARD_HELD);
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_pressed_mask(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_keyboard_snapshot_mask(mrb, self, MRB_SDL2_KEYBOARD_PRESSED);
+}
+
+static mrb_value
+mrb_sdl2_keyboard_snapshot_released_mask(mrb_state *mrb, mrb_value self)
+{
+  return mrb_sdl2_keyboard_snapshot_mask(mrb, self, MRB_SDL2_KEYBOARD_RELEASED);
+}
+
+void
+mruby_sdl2_keyboard_state_init(mrb_state *mrb, struct RClass *mod_Keyboard)
+{
+  class_State    = mrb_define_class_under(mrb, mod_Keyboard, "State",    mrb->object_class);
+  class_Snapshot = mrb_define_class_under(mrb, mod_Keyboard, "Snapshot", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_State,    MRB_TT_DATA);
+  MRB_SET_INSTANCE_TT(class_Snapshot, MRB_TT_DATA);
+
+  mrb_define_module_function(mrb, mod_Keyboard, "state", mrb_sdl2_keyboard_get_state, MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, class_State, "size",     mrb_sdl2_keyboard_state_get_size,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_State, "[]",       mrb_sdl2_keyboard_state_get_at,     MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_State, "pressed?", mrb_sdl2_keyboard_state_is_pressed, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_State, "cptr",     mrb_sdl2_keyboard_state_get_cptr,   MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, class_Snapshot, "initialize",           mrb_sdl2_keyboard_snapshot_initialize,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Snapshot, "update",               mrb_sdl2_keyboard_snapshot_update,        MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Snapshot, "held?",                mrb_sdl2_keyboard_snapshot_is_held,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Snapshot, "pressed_this_frame?",  mrb_sdl2_keyboard_snapshot_is_pressed,    MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Snapshot, "released_this_frame?", mrb_sdl2_keyboard_snapshot_is_released,   MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Snapshot, "changed?",             mrb_sdl2_keyboard_snapshot_is_changed,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Snapshot, "bind",                 mrb_sdl2_keyboard_snapshot_bind,          MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Snapshot, "bindings",             mrb_sdl2_keyboard_snapshot_get_bindings,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Snapshot, "held_mask",            mrb_sdl2_keyboard_snapshot_held_mask,     MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Snapshot, "pressed_mask",         mrb_sdl2_keyboard_snapshot_pressed_mask,  MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Snapshot, "released_mask",        mrb_sdl2_keyboard_snapshot_released_mask, MRB_ARGS_OPT(1));
+}
+
+void
+mruby_sdl2_keyboard_state_final(mrb_state *mrb, struct RClass *mod_Keyboard)
+{
+}
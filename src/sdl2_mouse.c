@@ -1,4 +1,5 @@
 #include "sdl2_mouse.h"
+#include "sdl2_mouse_samples.h"
 #include "sdl2_video.h"
 #include "sdl2_surface.h"
 #include "sdl2_rect.h"
@@ -302,9 +303,12 @@ mruby_sdl2_mouse_init(mrb_state *mrb)
   mrb_define_method(mrb, class_Cursor, "initialize", mrb_sdl2_input_mouse_cursor_initialize, MRB_ARGS_REQ(3));
   mrb_define_method(mrb, class_Cursor, "free",       mrb_sdl2_input_mouse_cursor_free,       MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Cursor, "destroy",    mrb_sdl2_input_mouse_cursor_free,       MRB_ARGS_NONE());
+
+  mruby_sdl2_mouse_samples_init(mrb, mod_Mouse);
 }
 
 void
 mruby_sdl2_mouse_final(mrb_state *mrb)
 {
+  mruby_sdl2_mouse_samples_final(mrb, mod_Mouse);
 }
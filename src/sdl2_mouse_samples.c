@@ -0,0 +1,403 @@
+#include "sdl2_mouse_samples.h"
+#include "sdl2_events.h"
+#include "sdl2_events_filter.h"
+#include "misc.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_events.h>
+
+#define MRB_SDL2_MOUSE_SAMPLES_FIELDS        6
+#define MRB_SDL2_MOUSE_SAMPLES_MAX_CAPACITY  65536
+
+/*
+ * One SDL_MOUSEMOTION; six int32 fields without padding, so an array of
+ * samples is handed to SDL2::IntBuffer as it is.
+ */
+typedef struct mrb_sdl2_mouse_sample_t {
+  int32_t x;
+  int32_t y;
+  int32_t xrel;
+  int32_t yrel;
+  int32_t state;
+  int32_t timestamp;
+} mrb_sdl2_mouse_sample_t;
+
+/*
+ * 'ring' is written by the event watch, possibly from another thread, and
+ * guarded by 'lock'; when it is full the oldest sample is overwritten and
+ * counted in 'dropped'. SampleRecorder#take moves the samples to 'out'
+ * and simplifies them there, using 'keep' and 'stack' as scratch. All
+ * buffers are allocated up front, so nothing is allocated under the lock.
+ */
+typedef struct mrb_sdl2_mouse_samples_data_t {
+  SDL_SpinLock             lock;
+  mrb_bool                 attached;
+  int                      capacity;
+  int                      head;
+  int                      count;
+  mrb_int                  dropped;
+  mrb_sdl2_mouse_sample_t *ring;
+  mrb_sdl2_mouse_sample_t *out;
+  Uint8                   *keep;
+  int                     *stack;
+} mrb_sdl2_mouse_samples_data_t;
+
+static int SDLCALL mrb_sdl2_mouse_samples_watch(void *userdata, SDL_Event *event);
+
+static void
+mrb_sdl2_mouse_samples_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_mouse_samples_data_t *data =
+    (mrb_sdl2_mouse_samples_data_t*)p;
+  if (NULL != data) {
+    if (data->attached) {
+      mrb_sdl2_input_filter_del_watch(mrb_sdl2_mouse_samples_watch, data);
+    }
+    mrb_free(mrb, data->ring);
+    mrb_free(mrb, data->out);
+    mrb_free(mrb, data->keep);
+    mrb_free(mrb, data->stack);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_mouse_samples_data_type = {
+  "SampleRecorder", mrb_sdl2_mouse_samples_data_free
+};
+
+static mrb_sdl2_mouse_samples_data_t *
+mrb_sdl2_mouse_samples_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data =
+    (mrb_sdl2_mouse_samples_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_mouse_samples_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized sample recorder.");
+  }
+  return data;
+}
+
+static int SDLCALL
+mrb_sdl2_mouse_samples_watch(void *userdata, SDL_Event *event)
+{
+  mrb_sdl2_mouse_samples_data_t *data = (mrb_sdl2_mouse_samples_data_t*)userdata;
+  mrb_sdl2_mouse_sample_t *sample;
+  if (SDL_MOUSEMOTION != event->type) {
+    return 1;
+  }
+  SDL_AtomicLock(&data->lock);
+  if (data->capacity == data->count) {
+    data->head = (data->head + 1) % data->capacity;
+    --data->count;
+    ++data->dropped;
+  }
+  sample = &data->ring[(data->head + data->count) % data->capacity];
+  sample->x         = event->motion.x;
+  sample->y         = event->motion.y;
+  sample->xrel      = event->motion.xrel;
+  sample->yrel      = event->motion.yrel;
+  sample->state     = (int32_t)event->motion.state;
+  sample->timestamp = (int32_t)event->motion.timestamp;
+  ++data->count;
+  SDL_AtomicUnlock(&data->lock);
+  return 1;
+}
+
+/*
+ * Squared distance of p from the line through a and b, or from a when
+ * the two coincide.
+ */
+static double
+mrb_sdl2_mouse_samples_distance2(mrb_sdl2_mouse_sample_t const *p,
+                                 mrb_sdl2_mouse_sample_t const *a,
+                                 mrb_sdl2_mouse_sample_t const *b)
+{
+  double const dx = (double)b->x - a->x;
+  double const dy = (double)b->y - a->y;
+  double const px = (double)p->x - a->x;
+  double const py = (double)p->y - a->y;
+  double const length2 = dx * dx + dy * dy;
+  double cross;
+  if (0.0 == length2) {
+    return px * px + py * py;
+  }
+  cross = dx * py - dy * px;
+  return cross * cross / length2;
+}
+
+/*
+ * Ramer-Douglas-Peucker over out[first..last]: marks in 'keep' the
+ * samples needed to stay within sqrt(epsilon2) of the path. Iterative,
+ * with at most one pending range per sample on the stack.
+ */
+static void
+mrb_sdl2_mouse_samples_rdp(mrb_sdl2_mouse_samples_data_t *data, int first, int last, double epsilon2)
+{
+  int top = 0;
+  data->keep[first] = 1;
+  data->keep[last]  = 1;
+  data->stack[top++] = first;
+  data->stack[top++] = last;
+  while (0 < top) {
+    int const b = data->stack[--top];
+    int const a = data->stack[--top];
+    double max = 0.0;
+    int index = -1;
+    int i;
+    for (i = a + 1; i < b; ++i) {
+      double const d = mrb_sdl2_mouse_samples_distance2(&data->out[i], &data->out[a], &data->out[b]);
+      if (d > max) {
+        max = d;
+        index = i;
+      }
+    }
+    if ((0 <= index) && (max > epsilon2)) {
+      data->keep[index] = 1;
+      data->stack[top++] = a;
+      data->stack[top++] = index;
+      data->stack[top++] = index;
+      data->stack[top++] = b;
+    }
+  }
+}
+
+/*
+ * Simplifies out[0...count] in place and returns the new count. Every run
+ * of samples with the same button state is simplified on its own, so a
+ * press or release is never moved; the relative motion of dropped samples
+ * is added to the next sample kept.
+ */
+static int
+mrb_sdl2_mouse_samples_simplify(mrb_sdl2_mouse_samples_data_t *data, int count, double epsilon2)
+{
+  int32_t xrel = 0, yrel = 0;
+  int first, n, i;
+  SDL_memset(data->keep, 0, (size_t)count);
+  for (first = 0; first < count; first = i) {
+    for (i = first + 1; (i < count) && (data->out[i].state == data->out[first].state); ++i) {
+    }
+    mrb_sdl2_mouse_samples_rdp(data, first, i - 1, epsilon2);
+  }
+  for (i = 0, n = 0; i < count; ++i) {
+    xrel += data->out[i].xrel;
+    yrel += data->out[i].yrel;
+    if (data->keep[i]) {
+      data->out[n] = data->out[i];
+      data->out[n].xrel = xrel;
+      data->out[n].yrel = yrel;
+      xrel = yrel = 0;
+      ++n;
+    }
+  }
+  return n;
+}
+
+/***************************************************************************
+*
+* class SDL2::Input::Mouse::SampleRecorder
+*
+***************************************************************************/
+
+/*
+ * SDL2::Input::Mouse::SampleRecorder#initialize(capacity = 1024)
+ *
+ * Creates a recorder holding up to 'capacity' mouse motions between two
+ * calls to #take. It records nothing until #attach or #feed.
+ */
+static mrb_value
+mrb_sdl2_mouse_samples_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data;
+  mrb_int capacity = 1024;
+  mrb_get_args(mrb, "|i", &capacity);
+  if ((2 > capacity) || (MRB_SDL2_MOUSE_SAMPLES_MAX_CAPACITY < capacity)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "capacity out of range.");
+  }
+
+  data = (mrb_sdl2_mouse_samples_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_mouse_samples_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+
+  data = (mrb_sdl2_mouse_samples_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_mouse_samples_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  SDL_memset(data, 0, sizeof(mrb_sdl2_mouse_samples_data_t));
+  data->capacity = (int)capacity;
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_mouse_samples_data_type;
+
+  data->ring  = (mrb_sdl2_mouse_sample_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_mouse_sample_t) * capacity);
+  data->out   = (mrb_sdl2_mouse_sample_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_mouse_sample_t) * capacity);
+  data->keep  = (Uint8*)mrb_malloc(mrb, capacity);
+  data->stack = (int*)mrb_malloc(mrb, sizeof(int) * 2 * capacity);
+  if ((NULL == data->ring) || (NULL == data->out) || (NULL == data->keep) || (NULL == data->stack)) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_mouse_samples_get_capacity(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_mouse_samples_get_ptr(mrb, self)->capacity);
+}
+
+/*
+ * SDL2::Input::Mouse::SampleRecorder#attach
+ *
+ * Records every SDL_MOUSEMOTION as SDL queues it, from an event watch;
+ * no Ruby event object is created for the samples. While
+ * SDL2::Input::Filter coalesces motion, the recorder gets the merged
+ * motions as the filter releases them, with xrel/yrel summed.
+ */
+static mrb_value
+mrb_sdl2_mouse_samples_attach(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data = mrb_sdl2_mouse_samples_get_ptr(mrb, self);
+  if (!data->attached) {
+    if (!mrb_sdl2_input_filter_add_watch(mrb_sdl2_mouse_samples_watch, data)) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "too many event watches.");
+    }
+    data->attached = true;
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_mouse_samples_detach(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data = mrb_sdl2_mouse_samples_get_ptr(mrb, self);
+  if (data->attached) {
+    mrb_sdl2_input_filter_del_watch(mrb_sdl2_mouse_samples_watch, data);
+    data->attached = false;
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_mouse_samples_is_attached(mrb_state *mrb, mrb_value self)
+{
+  return mrb_bool_value(mrb_sdl2_mouse_samples_get_ptr(mrb, self)->attached);
+}
+
+/*
+ * SDL2::Input::Mouse::SampleRecorder#feed(event)
+ *
+ * Records one SDL2::Input::MouseMotionEvent; other events are ignored.
+ */
+static mrb_value
+mrb_sdl2_mouse_samples_feed(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data = mrb_sdl2_mouse_samples_get_ptr(mrb, self);
+  mrb_value event;
+  mrb_get_args(mrb, "o", &event);
+  mrb_sdl2_mouse_samples_watch(data, mrb_sdl2_input_event_get_ptr(mrb, event));
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_mouse_samples_get_pending(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data = mrb_sdl2_mouse_samples_get_ptr(mrb, self);
+  int count;
+  SDL_AtomicLock(&data->lock);
+  count = data->count;
+  SDL_AtomicUnlock(&data->lock);
+  return mrb_fixnum_value(count);
+}
+
+/*
+ * SDL2::Input::Mouse::SampleRecorder#dropped
+ *
+ * Returns how many samples were overwritten because #take was not called
+ * before the recorder filled up.
+ */
+static mrb_value
+mrb_sdl2_mouse_samples_get_dropped(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data = mrb_sdl2_mouse_samples_get_ptr(mrb, self);
+  mrb_int dropped;
+  SDL_AtomicLock(&data->lock);
+  dropped = data->dropped;
+  SDL_AtomicUnlock(&data->lock);
+  return mrb_fixnum_value(dropped);
+}
+
+static mrb_value
+mrb_sdl2_mouse_samples_clear(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data = mrb_sdl2_mouse_samples_get_ptr(mrb, self);
+  SDL_AtomicLock(&data->lock);
+  data->head    = 0;
+  data->count   = 0;
+  data->dropped = 0;
+  SDL_AtomicUnlock(&data->lock);
+  return self;
+}
+
+/*
+ * SDL2::Input::Mouse::SampleRecorder#take(epsilon = nil)
+ *
+ * Removes the recorded samples and returns them as an SDL2::IntBuffer of
+ * FIELDS values per sample: x, y, xrel, yrel, button state, timestamp.
+ * With an epsilon the path is first simplified, dropping samples that lie
+ * within epsilon pixels of the simplified path.
+ */
+static mrb_value
+mrb_sdl2_mouse_samples_take(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_mouse_samples_data_t *data = mrb_sdl2_mouse_samples_get_ptr(mrb, self);
+  mrb_value arg = mrb_nil_value();
+  mrb_float epsilon = 0.0;
+  int count, first;
+  mrb_get_args(mrb, "|o", &arg);
+  if (!mrb_nil_p(arg)) {
+    epsilon = mrb_float(mrb_Float(mrb, arg));
+    if (0.0 > epsilon) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "negative epsilon.");
+    }
+  }
+
+  SDL_AtomicLock(&data->lock);
+  count = data->count;
+  first = SDL_min(count, data->capacity - data->head);
+  SDL_memcpy(data->out, &data->ring[data->head], sizeof(mrb_sdl2_mouse_sample_t) * first);
+  SDL_memcpy(&data->out[first], data->ring, sizeof(mrb_sdl2_mouse_sample_t) * (count - first));
+  data->head  = 0;
+  data->count = 0;
+  SDL_AtomicUnlock(&data->lock);
+
+  if ((0.0 < epsilon) && (2 < count)) {
+    count = mrb_sdl2_mouse_samples_simplify(data, count, epsilon * epsilon);
+  }
+  return mrb_sdl2_misc_intbuffer(mrb, (int32_t const*)data->out, (size_t)count * MRB_SDL2_MOUSE_SAMPLES_FIELDS);
+}
+
+void
+mruby_sdl2_mouse_samples_init(mrb_state *mrb, struct RClass *mod_Mouse)
+{
+  struct RClass *class_SampleRecorder = mrb_define_class_under(mrb, mod_Mouse, "SampleRecorder", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_SampleRecorder, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_SampleRecorder, "initialize", mrb_sdl2_mouse_samples_initialize,   MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_SampleRecorder, "capacity",   mrb_sdl2_mouse_samples_get_capacity, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SampleRecorder, "attach",     mrb_sdl2_mouse_samples_attach,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SampleRecorder, "detach",     mrb_sdl2_mouse_samples_detach,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SampleRecorder, "attached?",  mrb_sdl2_mouse_samples_is_attached,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SampleRecorder, "feed",       mrb_sdl2_mouse_samples_feed,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SampleRecorder, "pending",    mrb_sdl2_mouse_samples_get_pending,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SampleRecorder, "dropped",    mrb_sdl2_mouse_samples_get_dropped,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SampleRecorder, "clear",      mrb_sdl2_mouse_samples_clear,        MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SampleRecorder, "take",       mrb_sdl2_mouse_samples_take,         MRB_ARGS_OPT(1));
+
+  mrb_define_const(mrb, class_SampleRecorder, "FIELDS", mrb_fixnum_value(MRB_SDL2_MOUSE_SAMPLES_FIELDS));
+}
+
+void
+mruby_sdl2_mouse_samples_final(mrb_state *mrb, struct RClass *mod_Mouse)
+{
+}
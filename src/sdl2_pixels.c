@@ -1,7 +1,9 @@
 #include "sdl2_pixels.h"
+#include "misc.h"
 #include "mruby/array.h"
 #include "mruby/class.h"
 #include "mruby/data.h"
+#include "mruby/string.h"
 
 
 
@@ -231,13 +233,148 @@ mrb_sdl2_pixels_palette_set_color(mrb_state *mrb, mrb_value self)
   color.a = (Uint8) a;
   palette_p = mrb_sdl2_pixels_palette_get_ptr(mrb, self);
   result = SDL_SetPaletteColors(palette_p, &color, (int) firstcolor, (int) ncolors);
-  if (result == 1) {
+  if (0 != result) {
     // error occurred
     mruby_sdl2_raise_error(mrb);
   }
   return self;
 }
 
+static SDL_Palette *
+mrb_sdl2_pixels_palette_get_live_ptr(mrb_state *mrb, mrb_value palette)
+{
+  SDL_Palette *palette_p = mrb_sdl2_pixels_palette_get_ptr(mrb, palette);
+  if (NULL == palette_p) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "palette has been freed.");
+  }
+  return palette_p;
+}
+
+static mrb_value
+mrb_sdl2_pixels_palette_get_ncolors(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_pixels_palette_get_live_ptr(mrb, self)->ncolors);
+}
+
+/*
+ * SDL2::Pixels::Palette#rotate(range, steps = 1)
+ *
+ * Cycles the colors within 'range' (a Range of indices) by 'steps';
+ * positive steps move each color to a higher index.
+ */
+static mrb_value
+mrb_sdl2_pixels_palette_rotate(mrb_state *mrb, mrb_value self)
+{
+  SDL_Palette *palette_p = mrb_sdl2_pixels_palette_get_live_ptr(mrb, self);
+  SDL_Color *colors;
+  mrb_value range;
+  mrb_int steps = 1, first, last, count, shift, i;
+  int result;
+  mrb_get_args(mrb, "o|i", &range, &steps);
+  first = mrb_fixnum(mrb_Integer(mrb, mrb_funcall(mrb, range, "first", 0)));
+  last  = mrb_fixnum(mrb_Integer(mrb, mrb_funcall(mrb, range, "last", 0)));
+  if (mrb_test(mrb_funcall(mrb, range, "exclude_end?", 0))) {
+    --last;
+  }
+  if ((0 > first) || (first > last) || (last >= palette_p->ncolors)) {
+    mrb_raise(mrb, E_INDEX_ERROR, "palette index out of range.");
+  }
+  count = last - first + 1;
+  shift = ((steps % count) + count) % count;
+  if (0 == shift) {
+    return self;
+  }
+  colors = (SDL_Color*)SDL_malloc(sizeof(SDL_Color) * count);
+  if (NULL == colors) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  for (i = 0; i < count; ++i) {
+    colors[(i + shift) % count] = palette_p->colors[first + i];
+  }
+  result = SDL_SetPaletteColors(palette_p, colors, (int) first, (int) count);
+  SDL_free(colors);
+  if (0 != result) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  return self;
+}
+
+/*
+ * SDL2::Pixels::Palette#blend_to(other, t, base = self)
+ *
+ * Sets the colors to the mix of 'base' and 'other' at 't' (0.0 gives
+ * base, 1.0 gives other). Keeping an untouched base palette makes fades
+ * independent of the number of steps.
+ */
+static mrb_value
+mrb_sdl2_pixels_palette_blend_to(mrb_state *mrb, mrb_value self)
+{
+  SDL_Palette *palette_p = mrb_sdl2_pixels_palette_get_live_ptr(mrb, self);
+  SDL_Palette const *other_p, *base_p;
+  SDL_Color *colors;
+  mrb_value other, base = self;
+  mrb_float t;
+  int w, n, i, result;
+  mrb_get_args(mrb, "of|o", &other, &t, &base);
+  other_p = mrb_sdl2_pixels_palette_get_live_ptr(mrb, other);
+  base_p  = mrb_sdl2_pixels_palette_get_live_ptr(mrb, base);
+  w = (t <= 0.0) ? 0 : ((t >= 1.0) ? 256 : (int)(t * 256.0 + 0.5));
+  n = SDL_min(palette_p->ncolors, SDL_min(other_p->ncolors, base_p->ncolors));
+  if (0 >= n) {
+    return self;
+  }
+  colors = (SDL_Color*)SDL_malloc(sizeof(SDL_Color) * n);
+  if (NULL == colors) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  for (i = 0; i < n; ++i) {
+    SDL_Color const a = base_p->colors[i];
+    SDL_Color const b = other_p->colors[i];
+    colors[i].r = (Uint8)((a.r * (256 - w) + b.r * w + 128) >> 8);
+    colors[i].g = (Uint8)((a.g * (256 - w) + b.g * w + 128) >> 8);
+    colors[i].b = (Uint8)((a.b * (256 - w) + b.b * w + 128) >> 8);
+    colors[i].a = (Uint8)((a.a * (256 - w) + b.a * w + 128) >> 8);
+  }
+  result = SDL_SetPaletteColors(palette_p, colors, 0, n);
+  SDL_free(colors);
+  if (0 != result) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  return self;
+}
+
+/*
+ * SDL2::Pixels::Palette#set_colors(buffer, offset = 0)
+ *
+ * Sets consecutive colors from RGBA bytes in a String or SDL2::Buffer,
+ * starting at 'offset'. Returns the number of colors set.
+ */
+static mrb_value
+mrb_sdl2_pixels_palette_set_colors(mrb_state *mrb, mrb_value self)
+{
+  SDL_Palette *palette_p = mrb_sdl2_pixels_palette_get_live_ptr(mrb, self);
+  mrb_value buffer;
+  mrb_int offset = 0;
+  void const *p;
+  size_t size;
+  int count;
+  mrb_get_args(mrb, "o|i", &buffer, &offset);
+  if ((0 > offset) || (offset > palette_p->ncolors)) {
+    mrb_raise(mrb, E_INDEX_ERROR, "palette index out of range.");
+  }
+  if (mrb_string_p(buffer)) {
+    p = RSTRING_PTR(buffer);
+    size = (size_t)RSTRING_LEN(buffer);
+  } else {
+    p = mrb_sdl2_misc_buffer_get_ptr(mrb, buffer, &size);
+  }
+  count = (int)SDL_min(size / sizeof(SDL_Color), (size_t)(palette_p->ncolors - offset));
+  if ((0 < count) && (0 != SDL_SetPaletteColors(palette_p, (SDL_Color const*)p, (int) offset, count))) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  return mrb_fixnum_value(count);
+}
+
 static mrb_value
 mrb_sdl2_pixels_pixelformat_map_rgb(mrb_state *mrb, mrb_value self)
 {
@@ -313,15 +450,260 @@ mrb_sdl2_pixels_pixelformat_get_rgba(mrb_state *mrb, mrb_value self)
 }
 
 
+/*
+ * Batch conversion between packed RGBA bytes (R, G, B, A in memory order)
+ * and native pixels. 32-bit formats with 8-bit channels use a word
+ * shuffle with loop invariant shifts, which the compiler vectorizes; other
+ * packed formats use per-channel lookup tables built from the shift/loss
+ * values; indexed formats fall back to SDL_MapRGBA and palette lookups.
+ */
+static bool
+mrb_sdl2_pixels_is_8888(SDL_PixelFormat const *format)
+{
+  return (4 == format->BytesPerPixel) &&
+         (0 == format->Rloss) && (0 == format->Gloss) && (0 == format->Bloss) &&
+         ((0 == format->Amask) || (0 == format->Aloss)) &&
+         (0 == (format->Rshift & 7)) && (0 == (format->Gshift & 7)) &&
+         (0 == (format->Bshift & 7)) && (0 == (format->Ashift & 7));
+}
+
+static inline void
+mrb_sdl2_pixels_store(Uint8 *d, int bpp, Uint32 pixel)
+{
+  switch (bpp) {
+  case 1:
+    *d = (Uint8)pixel;
+    break;
+  case 2:
+    *(Uint16*)d = (Uint16)pixel;
+    break;
+  case 3:
+    if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+      d[0] = (Uint8)(pixel >> 16); d[1] = (Uint8)(pixel >> 8); d[2] = (Uint8)pixel;
+    } else {
+      d[0] = (Uint8)pixel; d[1] = (Uint8)(pixel >> 8); d[2] = (Uint8)(pixel >> 16);
+    }
+    break;
+  default:
+    *(Uint32*)d = pixel;
+    break;
+  }
+}
+
+static inline Uint32
+mrb_sdl2_pixels_load(Uint8 const *s, int bpp)
+{
+  switch (bpp) {
+  case 1:
+    return *s;
+  case 2:
+    return *(Uint16 const*)s;
+  case 3:
+    if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+      return ((Uint32)s[0] << 16) | ((Uint32)s[1] << 8) | s[2];
+    }
+    return s[0] | ((Uint32)s[1] << 8) | ((Uint32)s[2] << 16);
+  default:
+    return *(Uint32 const*)s;
+  }
+}
+
+void
+mrb_sdl2_pixels_map_rgba_buffer(SDL_PixelFormat const *format, Uint8 const *src, void *dst, size_t count)
+{
+  int const bpp = format->BytesPerPixel;
+  Uint8 *d = (Uint8*)dst;
+  size_t i;
+  if (mrb_sdl2_pixels_is_8888(format)) {
+    Uint32 const rs = format->Rshift, gs = format->Gshift, bs = format->Bshift, as = format->Ashift;
+    Uint32 const amask = format->Amask;
+    Uint32 *out = (Uint32*)dst;
+    for (i = 0; i < count; ++i) {
+      Uint8 const *p = src + i * 4;
+      out[i] = ((Uint32)p[0] << rs) | ((Uint32)p[1] << gs) | ((Uint32)p[2] << bs) | (((Uint32)p[3] << as) & amask);
+    }
+  } else if (NULL == format->palette) {
+    Uint32 table[4][256];
+    int v;
+    for (v = 0; v < 256; ++v) {
+      table[0][v] = ((Uint32)(v >> format->Rloss) << format->Rshift) & format->Rmask;
+      table[1][v] = ((Uint32)(v >> format->Gloss) << format->Gshift) & format->Gmask;
+      table[2][v] = ((Uint32)(v >> format->Bloss) << format->Bshift) & format->Bmask;
+      table[3][v] = ((Uint32)(v >> format->Aloss) << format->Ashift) & format->Amask;
+    }
+    for (i = 0; i < count; ++i) {
+      Uint8 const *p = src + i * 4;
+      mrb_sdl2_pixels_store(d + i * bpp, bpp, table[0][p[0]] | table[1][p[1]] | table[2][p[2]] | table[3][p[3]]);
+    }
+  } else {
+    for (i = 0; i < count; ++i) {
+      Uint8 const *p = src + i * 4;
+      mrb_sdl2_pixels_store(d + i * bpp, bpp, SDL_MapRGBA(format, p[0], p[1], p[2], p[3]));
+    }
+  }
+}
+
+static void
+mrb_sdl2_pixels_expand_table(Uint8 *table, Uint32 mask, Uint8 loss, Uint8 fill)
+{
+  int const bits = 8 - loss;
+  int const max = (1 << bits) - 1;
+  int v;
+  if ((0 == mask) || (0 >= bits)) {
+    SDL_memset(table, fill, 256);
+    return;
+  }
+  for (v = 0; v <= max; ++v) {
+    table[v] = (Uint8)((v * 255 + max / 2) / max);
+  }
+}
+
+void
+mrb_sdl2_pixels_unpack_rgba_buffer(SDL_PixelFormat const *format, void const *src, Uint8 *dst, size_t count)
+{
+  int const bpp = format->BytesPerPixel;
+  Uint8 const *s = (Uint8 const*)src;
+  size_t i;
+  if (mrb_sdl2_pixels_is_8888(format)) {
+    Uint32 const rs = format->Rshift, gs = format->Gshift, bs = format->Bshift, as = format->Ashift;
+    Uint32 const fill = (0 == format->Amask) ? 0xff : 0x00;
+    Uint32 const *in = (Uint32 const*)src;
+    for (i = 0; i < count; ++i) {
+      Uint32 const w = in[i];
+      Uint8 *p = dst + i * 4;
+      p[0] = (Uint8)(w >> rs);
+      p[1] = (Uint8)(w >> gs);
+      p[2] = (Uint8)(w >> bs);
+      p[3] = (Uint8)((w >> as) | fill);
+    }
+  } else if (NULL == format->palette) {
+    Uint8 table[4][256];
+    mrb_sdl2_pixels_expand_table(table[0], format->Rmask, format->Rloss, 0);
+    mrb_sdl2_pixels_expand_table(table[1], format->Gmask, format->Gloss, 0);
+    mrb_sdl2_pixels_expand_table(table[2], format->Bmask, format->Bloss, 0);
+    mrb_sdl2_pixels_expand_table(table[3], format->Amask, format->Aloss, 0xff);
+    for (i = 0; i < count; ++i) {
+      Uint32 const pixel = mrb_sdl2_pixels_load(s + i * bpp, bpp);
+      Uint8 *p = dst + i * 4;
+      p[0] = table[0][(pixel & format->Rmask) >> format->Rshift];
+      p[1] = table[1][(pixel & format->Gmask) >> format->Gshift];
+      p[2] = table[2][(pixel & format->Bmask) >> format->Bshift];
+      p[3] = table[3][(pixel & format->Amask) >> format->Ashift];
+    }
+  } else {
+    SDL_Palette const *palette = format->palette;
+    for (i = 0; i < count; ++i) {
+      Uint32 const index = mrb_sdl2_pixels_load(s + i * bpp, bpp);
+      Uint8 *p = dst + i * 4;
+      if ((int)index < palette->ncolors) {
+        p[0] = palette->colors[index].r;
+        p[1] = palette->colors[index].g;
+        p[2] = palette->colors[index].b;
+        p[3] = palette->colors[index].a;
+      } else {
+        p[0] = p[1] = p[2] = 0;
+        p[3] = 0xff;
+      }
+    }
+  }
+}
+
+/*
+ * The buffer conversions work on whole bytes per pixel and channels of at
+ * most 8 bits. Packed sub-byte (INDEX1, INDEX4) and FOURCC formats have
+ * BytesPerPixel 0 or none at all; wider channels (ARGB2101010) have no
+ * 8-bit loss to shift by.
+ */
+mrb_bool
+mrb_sdl2_pixels_buffer_format_p(SDL_PixelFormat const *format)
+{
+  if ((8 > format->BitsPerPixel) || (0 == format->BytesPerPixel) || SDL_ISPIXELFORMAT_FOURCC(format->format)) {
+    return 0;
+  }
+  return (0xff >= (format->Rmask >> format->Rshift)) && (0xff >= (format->Gmask >> format->Gshift)) &&
+         (0xff >= (format->Bmask >> format->Bshift)) && (0xff >= (format->Amask >> format->Ashift));
+}
+
+static void
+mrb_sdl2_pixels_check_buffer_format(mrb_state *mrb, SDL_PixelFormat const *format)
+{
+  if (NULL == format) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "pixel format has been freed.");
+  }
+  if (!mrb_sdl2_pixels_buffer_format_p(format)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported pixel format.");
+  }
+}
+
+/*
+ * SDL2::Pixels::PixelFormat#map_rgba_buffer(src, dst)
+ *
+ * Converts packed RGBA bytes in 'src' into native pixels in 'dst' (both
+ * SDL2::Buffer). Returns the number of pixels converted.
+ */
+static mrb_value
+mrb_sdl2_pixels_pixelformat_map_rgba_buffer(mrb_state *mrb, mrb_value self)
+{
+  mrb_value src, dst;
+  size_t src_size, dst_size, count;
+  void *src_p, *dst_p;
+  SDL_PixelFormat *format;
+  mrb_get_args(mrb, "oo", &src, &dst);
+  format = mrb_sdl2_pixels_pixelformat_get_ptr(mrb, self);
+  mrb_sdl2_pixels_check_buffer_format(mrb, format);
+  src_p = mrb_sdl2_misc_buffer_get_ptr(mrb, src, &src_size);
+  dst_p = mrb_sdl2_misc_buffer_get_ptr(mrb, dst, &dst_size);
+  count = SDL_min(src_size / 4, dst_size / format->BytesPerPixel);
+  mrb_sdl2_pixels_map_rgba_buffer(format, (Uint8 const*)src_p, dst_p, count);
+  return mrb_fixnum_value((mrb_int)count);
+}
+
+/*
+ * SDL2::Pixels::PixelFormat#unpack_rgba_buffer(src, dst)
+ *
+ * Converts native pixels in 'src' into packed RGBA bytes in 'dst'. Returns
+ * the number of pixels converted.
+ */
+static mrb_value
+mrb_sdl2_pixels_pixelformat_unpack_rgba_buffer(mrb_state *mrb, mrb_value self)
+{
+  mrb_value src, dst;
+  size_t src_size, dst_size, count;
+  void *src_p, *dst_p;
+  SDL_PixelFormat *format;
+  mrb_get_args(mrb, "oo", &src, &dst);
+  format = mrb_sdl2_pixels_pixelformat_get_ptr(mrb, self);
+  mrb_sdl2_pixels_check_buffer_format(mrb, format);
+  src_p = mrb_sdl2_misc_buffer_get_ptr(mrb, src, &src_size);
+  dst_p = mrb_sdl2_misc_buffer_get_ptr(mrb, dst, &dst_size);
+  count = SDL_min(src_size / format->BytesPerPixel, dst_size / 4);
+  mrb_sdl2_pixels_unpack_rgba_buffer(format, src_p, (Uint8*)dst_p, count);
+  return mrb_fixnum_value((mrb_int)count);
+}
+
+/*
+ * SDL2::Pixels.calculate_gamma_ramp(gamma)
+ *
+ * Returns the 256 entry ramp for 'gamma' as an Array of Integers.
+ */
 static mrb_value
 mrb_sdl2_pixels_calculate_gamma_ramp(mrb_state *mrb, mrb_value self)
 {
   mrb_float gamma;
-  Uint16 ramp;
+  Uint16 ramp[256];
+  mrb_value ary;
+  int i;
   mrb_get_args(mrb, "f", &gamma);
-  SDL_CalculateGammaRamp((float) gamma, &ramp);
+  if (0.0 > gamma) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "gamma must not be negative.");
+  }
+  SDL_CalculateGammaRamp((float) gamma, ramp);
 
-  return mrb_fixnum_value(ramp);
+  ary = mrb_ary_new_capa(mrb, 256);
+  for (i = 0; i < 256; ++i) {
+    mrb_ary_push(mrb, ary, mrb_fixnum_value(ramp[i]));
+  }
+  return ary;
 }
 /***************************************************************************
 *
@@ -329,17 +711,22 @@ mrb_sdl2_pixels_calculate_gamma_ramp(mrb_state *mrb, mrb_value self)
 *
 ***************************************************************************/
 
+/*
+ * Wraps an existing format. The wrapper takes its own reference, released
+ * by SDL_FreeFormat, so it stays valid after the owning surface is freed.
+ */
 mrb_value
 mrb_sdl2_pixels_pixelformat_new(mrb_state *mrb, SDL_PixelFormat *format)
 {
-  //@todo how do better?
-  mrb_sdl2_pixels_pixelformat_data_t *data;
-  mrb_value args[] = {mrb_fixnum_value(format->format)};
-  mrb_value oformat = mrb_obj_new(mrb, class_PixelFormat, 1, args);
-  data = (mrb_sdl2_pixels_pixelformat_data_t*)DATA_PTR(oformat);
+  mrb_sdl2_pixels_pixelformat_data_t *data =
+    (mrb_sdl2_pixels_pixelformat_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_pixels_pixelformat_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  ++format->refcount;
+  data->is_associated = false;
   data->pixelformat = format;
-  DATA_PTR(oformat) = data;
-  return oformat;
+  return mrb_obj_value(Data_Wrap_Struct(mrb, class_PixelFormat, &mrb_sdl2_pixels_pixelformat_data_type, data));
 }
 
 static mrb_value
@@ -448,7 +835,12 @@ mrb_sdl2_pixels_pixelformat_get_format(mrb_state *mrb, mrb_value self) {
 
 static mrb_value 
 mrb_sdl2_pixels_pixelformat_get_palette(mrb_state *mrb, mrb_value self) { 
-  return mrb_sdl2_pixels_palette(mrb, (mrb_sdl2_pixels_pixelformat_get_ptr(mrb, self)->palette)); 
+  SDL_Palette *palette = mrb_sdl2_pixels_pixelformat_get_ptr(mrb, self)->palette;
+  /* the wrapper releases the palette with SDL_FreePalette, so it takes a reference. */
+  if (NULL != palette) {
+    ++palette->refcount;
+  }
+  return mrb_sdl2_pixels_palette(mrb, palette); 
 }
 
 static mrb_value 
@@ -587,10 +979,16 @@ mruby_sdl2_pixels_init(mrb_state *mrb)
   mrb_define_method(mrb, class_PixelFormat, "mapRGBA",        mrb_sdl2_pixels_pixelformat_map_rgba,           MRB_ARGS_REQ(4));
   mrb_define_method(mrb, class_PixelFormat, "get_rgb",        mrb_sdl2_pixels_pixelformat_get_rgb,            MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_PixelFormat, "get_rgba",       mrb_sdl2_pixels_pixelformat_get_rgba,           MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_PixelFormat, "map_rgba_buffer",    mrb_sdl2_pixels_pixelformat_map_rgba_buffer,    MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_PixelFormat, "unpack_rgba_buffer", mrb_sdl2_pixels_pixelformat_unpack_rgba_buffer, MRB_ARGS_REQ(2));
   // SDL_MapRGB
 
   mrb_define_method(mrb, class_Palette, "initialize", mrb_sdl2_pixels_palette_initialize, MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Palette, "set_color",  mrb_sdl2_pixels_palette_set_color,  MRB_ARGS_REQ(6) /*| MRB_ARGS_REQ(3)*/);
+  mrb_define_method(mrb, class_Palette, "set_colors", mrb_sdl2_pixels_palette_set_colors, MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Palette, "rotate",     mrb_sdl2_pixels_palette_rotate,     MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Palette, "blend_to",   mrb_sdl2_pixels_palette_blend_to,   MRB_ARGS_REQ(2) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Palette, "ncolors",    mrb_sdl2_pixels_palette_get_ncolors, MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Palette, "destroy",    mrb_sdl2_pixels_palette_free,       MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Palette, "free",       mrb_sdl2_pixels_palette_free,       MRB_ARGS_NONE());
 
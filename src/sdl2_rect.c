@@ -1,8 +1,13 @@
 #include "sdl2_rect.h"
+#include "sdl2_rect_array.h"
+#include "sdl2_spatial_hash.h"
+#include "sdl2_dirty_region.h"
 #include "mruby/data.h"
 #include "mruby/class.h"
 #include "mruby/variable.h"
 #include "mruby/array.h"
+#include "mruby/hash.h"
+#include <SDL2/SDL_atomic.h>
 
 static struct RClass *class_Rect = NULL;
 static struct RClass *class_Point = NULL;
@@ -20,13 +25,77 @@ typedef struct mrb_sdl2_rect_size_data_t {
   size_data_t size;
 } mrb_sdl2_rect_size_data_t;
 
+/*
+ * Rect, Point and Size data are fixed size blocks taken from a free list
+ * over SDL_malloc'd slabs, so creating one of these small objects does not
+ * reach the system allocator. The pool is shared by every mrb_state,
+ * guarded by a spinlock, and slabs are kept for the life of the process
+ * because objects may outlive the gem finalizer.
+ */
+typedef union mrb_sdl2_rect_block_t {
+  mrb_sdl2_rect_rect_data_t     rect;
+  mrb_sdl2_rect_point_data_t    point;
+  mrb_sdl2_rect_size_data_t     size;
+  union mrb_sdl2_rect_block_t  *next;
+} mrb_sdl2_rect_block_t;
+
+#define MRB_SDL2_RECT_SLAB_BLOCKS 256
+
+static SDL_SpinLock           mrb_sdl2_rect_pool_lock      = 0;
+static mrb_sdl2_rect_block_t *mrb_sdl2_rect_pool_free_list = NULL;
+static size_t                 mrb_sdl2_rect_pool_slabs     = 0;
+static size_t                 mrb_sdl2_rect_pool_live      = 0;
+static size_t                 mrb_sdl2_rect_pool_allocated = 0;
+
+static void *
+mrb_sdl2_rect_pool_alloc(mrb_state *mrb)
+{
+  mrb_sdl2_rect_block_t *block;
+  SDL_AtomicLock(&mrb_sdl2_rect_pool_lock);
+  if (NULL == mrb_sdl2_rect_pool_free_list) {
+    mrb_sdl2_rect_block_t *slab =
+      (mrb_sdl2_rect_block_t*)SDL_malloc(sizeof(mrb_sdl2_rect_block_t) * MRB_SDL2_RECT_SLAB_BLOCKS);
+    if (NULL != slab) {
+      int i;
+      for (i = 0; i < MRB_SDL2_RECT_SLAB_BLOCKS - 1; ++i) {
+        slab[i].next = &slab[i + 1];
+      }
+      slab[MRB_SDL2_RECT_SLAB_BLOCKS - 1].next = NULL;
+      mrb_sdl2_rect_pool_free_list = slab;
+      ++mrb_sdl2_rect_pool_slabs;
+    }
+  }
+  block = mrb_sdl2_rect_pool_free_list;
+  if (NULL != block) {
+    mrb_sdl2_rect_pool_free_list = block->next;
+    ++mrb_sdl2_rect_pool_live;
+    ++mrb_sdl2_rect_pool_allocated;
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_rect_pool_lock);
+  if (NULL == block) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  return block;
+}
+
+static void
+mrb_sdl2_rect_pool_free(void *p)
+{
+  mrb_sdl2_rect_block_t *block = (mrb_sdl2_rect_block_t*)p;
+  SDL_AtomicLock(&mrb_sdl2_rect_pool_lock);
+  block->next = mrb_sdl2_rect_pool_free_list;
+  mrb_sdl2_rect_pool_free_list = block;
+  --mrb_sdl2_rect_pool_live;
+  SDL_AtomicUnlock(&mrb_sdl2_rect_pool_lock);
+}
+
 static void
 mrb_sdl2_rect_rect_data_free(mrb_state *mrb, void *p)
 {
   mrb_sdl2_rect_rect_data_t *data =
     (mrb_sdl2_rect_rect_data_t*)p;
   if (NULL != data) {
-    mrb_free(mrb, data);
+    mrb_sdl2_rect_pool_free(data);
   }
 }
 
@@ -36,7 +105,7 @@ mrb_sdl2_rect_point_data_free(mrb_state *mrb, void *p)
   mrb_sdl2_rect_point_data_t *data =
     (mrb_sdl2_rect_point_data_t*)p;
   if (NULL != data) {
-    mrb_free(mrb, data);
+    mrb_sdl2_rect_pool_free(data);
   }
 }
 
@@ -46,7 +115,7 @@ mrb_sdl2_rect_size_data_free(mrb_state *mrb, void *p)
   mrb_sdl2_rect_size_data_t *data =
     (mrb_sdl2_rect_size_data_t*)p;
   if (NULL != data) {
-    mrb_free(mrb, data);
+    mrb_sdl2_rect_pool_free(data);
   }
 }
 
@@ -66,10 +135,7 @@ mrb_value
 mrb_sdl2_rect(mrb_state *mrb, int x, int y, int w, int h)
 {
   mrb_sdl2_rect_rect_data_t *data =
-    (mrb_sdl2_rect_rect_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_rect_data_t));
-  if (NULL == data) {
-    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-  }
+    (mrb_sdl2_rect_rect_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   data->rect.x = x;
   data->rect.y = y;
   data->rect.w = w;
@@ -81,10 +147,7 @@ mrb_value
 mrb_sdl2_rect_direct(mrb_state *mrb, SDL_Rect const *rect)
 {
   mrb_sdl2_rect_rect_data_t *data =
-    (mrb_sdl2_rect_rect_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_rect_data_t));
-  if (NULL == data) {
-    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-  }
+    (mrb_sdl2_rect_rect_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   if (NULL == rect) {
     data->rect.x = 0;
     data->rect.y = 0;
@@ -103,10 +166,7 @@ mrb_value
 mrb_sdl2_point(mrb_state *mrb, int x, int y)
 {
   mrb_sdl2_rect_point_data_t *data =
-    (mrb_sdl2_rect_point_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_point_data_t));
-  if (NULL == data) {
-    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-  }
+    (mrb_sdl2_rect_point_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   data->point.x = x;
   data->point.y = y;
   return mrb_obj_value(Data_Wrap_Struct(mrb, class_Point, &mrb_sdl2_rect_point_data_type, data));
@@ -116,10 +176,7 @@ mrb_value
 mrb_sdl2_size(mrb_state *mrb, int w, int h)
 {
   mrb_sdl2_rect_size_data_t *data =
-    (mrb_sdl2_rect_size_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_size_data_t));
-  if (NULL == data) {
-    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-  }
+    (mrb_sdl2_rect_size_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   data->size.w = w;
   data->size.h = h;
   return mrb_obj_value(Data_Wrap_Struct(mrb, class_Size, &mrb_sdl2_rect_size_data_type, data));
@@ -175,10 +232,7 @@ mrb_sdl2_rect_rect_initialize(mrb_state *mrb, mrb_value self)
   mrb_sdl2_rect_rect_data_t *data =
     (mrb_sdl2_rect_rect_data_t*)DATA_PTR(self);
   if (data == NULL) {
-    data = (mrb_sdl2_rect_rect_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_rect_data_t));
-    if (NULL == data) {
-      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-    }
+    data = (mrb_sdl2_rect_rect_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   }
 
   switch (argc) {
@@ -280,15 +334,30 @@ mrb_sdl2_rect_rect_set_h(mrb_state *mrb, mrb_value self)
   return self;
 }
 
+/*
+ * SDL2::Rect#set(x, y, w, h)
+ *
+ * Updates the rect in place so per-frame code can reuse one object.
+ */
+static mrb_value
+mrb_sdl2_rect_rect_set(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x, y, w, h;
+  SDL_Rect * const rect = mrb_sdl2_rect_get_ptr(mrb, self);
+  mrb_get_args(mrb, "iiii", &x, &y, &w, &h);
+  rect->x = x;
+  rect->y = y;
+  rect->w = w;
+  rect->h = h;
+  return self;
+}
+
 static mrb_value
 mrb_sdl2_rect_rect_get_position(mrb_state *mrb, mrb_value self)
 {
   SDL_Rect const * const rect = mrb_sdl2_rect_get_ptr(mrb, self);
   mrb_sdl2_rect_point_data_t *data =
-    (mrb_sdl2_rect_point_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_point_data_t));
-  if (NULL == data) {
-    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-  }
+    (mrb_sdl2_rect_point_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   data->point.x = rect->x;
   data->point.y = rect->y;
   return mrb_obj_value(Data_Wrap_Struct(mrb, class_Point, &mrb_sdl2_rect_point_data_type, data));
@@ -307,7 +376,7 @@ mrb_sdl2_rect_rect_set_position(mrb_state *mrb, mrb_value self)
     SDL_Point const * const rhs = mrb_sdl2_point_get_ptr(mrb, arg);
     lhs->x = rhs->x;
     lhs->y = rhs->y;
-  } else if (DATA_TYPE(arg) == &mrb_sdl2_rect_point_data_type) {
+  } else if (DATA_TYPE(arg) == &mrb_sdl2_rect_rect_data_type) {
     SDL_Rect const * const rhs = mrb_sdl2_rect_get_ptr(mrb, arg);
     lhs->x = rhs->x;
     lhs->y = rhs->y;
@@ -322,10 +391,7 @@ mrb_sdl2_rect_rect_get_size(mrb_state *mrb, mrb_value self)
 {
   SDL_Rect const * const rect = mrb_sdl2_rect_get_ptr(mrb, self);
   mrb_sdl2_rect_size_data_t *data =
-    (mrb_sdl2_rect_size_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_size_data_t));
-  if (NULL == data) {
-    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-  }
+    (mrb_sdl2_rect_size_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   data->size.w = rect->w;
   data->size.h = rect->h;
   return mrb_obj_value(Data_Wrap_Struct(mrb, class_Size, &mrb_sdl2_rect_size_data_type, data));
@@ -344,7 +410,7 @@ mrb_sdl2_rect_rect_set_size(mrb_state *mrb, mrb_value self)
     size_data_t const * const rhs = mrb_sdl2_size_get_ptr(mrb, arg);
     lhs->w = rhs->w;
     lhs->h = rhs->h;
-  } else if (DATA_TYPE(arg) == &mrb_sdl2_rect_point_data_type) {
+  } else if (DATA_TYPE(arg) == &mrb_sdl2_rect_rect_data_type) {
     SDL_Rect const * const rhs = mrb_sdl2_rect_get_ptr(mrb, arg);
     lhs->w = rhs->w;
     lhs->h = rhs->h;
@@ -470,8 +536,12 @@ mrb_sdl2_rect_rect_enclose_points(mrb_state *mrb, mrb_value self)
     SDL_Point const * const p = mrb_sdl2_point_get_ptr(mrb, argv[i]);
     points[i] = *p;
   }
-  return (SDL_FALSE == SDL_EnclosePoints(points, argc, c, &result)) ?
-    mrb_nil_value() : mrb_sdl2_rect_direct(mrb, &result);
+  if (SDL_FALSE == SDL_EnclosePoints(points, argc, c, &result)) {
+    SDL_free(points);
+    return mrb_nil_value();
+  }
+  SDL_free(points);
+  return mrb_sdl2_rect_direct(mrb, &result);
 }
 
 /***************************************************************************
@@ -490,10 +560,7 @@ mrb_sdl2_rect_point_initialize(mrb_state *mrb, mrb_value self)
     (mrb_sdl2_rect_point_data_t*)DATA_PTR(self);
 
   if (data == NULL) {
-    data = (mrb_sdl2_rect_point_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_point_data_t));
-    if (NULL == data) {
-      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-    }
+    data = (mrb_sdl2_rect_point_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   }
 
   switch (argc) {
@@ -527,7 +594,7 @@ mrb_sdl2_rect_point_set_x(mrb_state *mrb, mrb_value self)
 {
   mrb_int x;
   mrb_get_args(mrb, "i", &x);
-  mrb_sdl2_rect_get_ptr(mrb, self)->x = x;
+  mrb_sdl2_point_get_ptr(mrb, self)->x = x;
   return self;
 }
 
@@ -542,7 +609,18 @@ mrb_sdl2_rect_point_set_y(mrb_state *mrb, mrb_value self)
 {
   mrb_int y;
   mrb_get_args(mrb, "i", &y);
-  mrb_sdl2_rect_get_ptr(mrb, self)->y = y;
+  mrb_sdl2_point_get_ptr(mrb, self)->y = y;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_rect_point_set(mrb_state *mrb, mrb_value self)
+{
+  mrb_int x, y;
+  SDL_Point * const point = mrb_sdl2_point_get_ptr(mrb, self);
+  mrb_get_args(mrb, "ii", &x, &y);
+  point->x = x;
+  point->y = y;
   return self;
 }
 
@@ -561,10 +639,7 @@ mrb_sdl2_rect_size_initialize(mrb_state *mrb, mrb_value self)
     (mrb_sdl2_rect_size_data_t*)DATA_PTR(self);
 
   if (data == NULL) {
-    data = (mrb_sdl2_rect_size_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_size_data_t));
-    if (NULL == data) {
-      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
-    }
+    data = (mrb_sdl2_rect_size_data_t*)mrb_sdl2_rect_pool_alloc(mrb);
   }
 
   switch (argc) {
@@ -617,6 +692,41 @@ mrb_sdl2_rect_size_set_h(mrb_state *mrb, mrb_value self)
   return self;
 }
 
+static mrb_value
+mrb_sdl2_rect_size_set(mrb_state *mrb, mrb_value self)
+{
+  mrb_int w, h;
+  size_data_t * const size = mrb_sdl2_size_get_ptr(mrb, self);
+  mrb_get_args(mrb, "ii", &w, &h);
+  size->w = w;
+  size->h = h;
+  return self;
+}
+
+/*
+ * SDL2::Rect.pool_stats
+ *
+ * Returns counters of the block pool shared by Rect, Point and Size:
+ * :slabs is the number of system allocations made, :live the blocks in
+ * use and :allocated the blocks handed out so far.
+ */
+static mrb_value
+mrb_sdl2_rect_pool_stats(mrb_state *mrb, mrb_value self)
+{
+  mrb_value stats = mrb_hash_new(mrb);
+  size_t slabs, live, allocated;
+  SDL_AtomicLock(&mrb_sdl2_rect_pool_lock);
+  slabs     = mrb_sdl2_rect_pool_slabs;
+  live      = mrb_sdl2_rect_pool_live;
+  allocated = mrb_sdl2_rect_pool_allocated;
+  SDL_AtomicUnlock(&mrb_sdl2_rect_pool_lock);
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "slabs")),     mrb_fixnum_value((mrb_int)slabs));
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "capacity")),  mrb_fixnum_value((mrb_int)(slabs * MRB_SDL2_RECT_SLAB_BLOCKS)));
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "live")),      mrb_fixnum_value((mrb_int)live));
+  mrb_hash_set(mrb, stats, mrb_symbol_value(mrb_intern_lit(mrb, "allocated")), mrb_fixnum_value((mrb_int)allocated));
+  return stats;
+}
+
 void
 mruby_sdl2_rect_init(mrb_state *mrb)
 {
@@ -648,22 +758,33 @@ mruby_sdl2_rect_init(mrb_state *mrb)
   mrb_define_method(mrb, class_Rect, "==",                 mrb_sdl2_rect_rect_equals,            MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Rect, "!=",                 mrb_sdl2_rect_rect_not_equals,        MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Rect, "union",              mrb_sdl2_rect_rect_union,             MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Rect, "set",                mrb_sdl2_rect_rect_set,               MRB_ARGS_REQ(4));
   mrb_define_class_method(mrb, class_Rect, "enclose_points", mrb_sdl2_rect_rect_enclose_points, MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_class_method(mrb, class_Rect, "pool_stats",     mrb_sdl2_rect_pool_stats,          MRB_ARGS_NONE());
 
   mrb_define_method(mrb, class_Point, "initialize", mrb_sdl2_rect_point_initialize, MRB_ARGS_OPT(2));
   mrb_define_method(mrb, class_Point, "x",          mrb_sdl2_rect_point_get_x,      MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Point, "x=",         mrb_sdl2_rect_point_set_x,      MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Point, "y",          mrb_sdl2_rect_point_get_y,      MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Point, "y=",         mrb_sdl2_rect_point_set_y,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Point, "set",        mrb_sdl2_rect_point_set,        MRB_ARGS_REQ(2));
 
   mrb_define_method(mrb, class_Size, "initialize", mrb_sdl2_rect_size_initialize, MRB_ARGS_OPT(2));
   mrb_define_method(mrb, class_Size, "w",          mrb_sdl2_rect_size_get_w,      MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Size, "w=",         mrb_sdl2_rect_size_set_w,      MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Size, "h",          mrb_sdl2_rect_size_get_h,      MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Size, "h=",         mrb_sdl2_rect_size_set_h,      MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Size, "set",        mrb_sdl2_rect_size_set,        MRB_ARGS_REQ(2));
+
+  mruby_sdl2_rect_array_init(mrb);
+  mruby_sdl2_spatial_hash_init(mrb);
+  mruby_sdl2_dirty_region_init(mrb);
 }
 
 void
 mruby_sdl2_rect_final(mrb_state *mrb)
 {
+  mruby_sdl2_dirty_region_final(mrb);
+  mruby_sdl2_spatial_hash_final(mrb);
+  mruby_sdl2_rect_array_final(mrb);
 }
@@ -0,0 +1,568 @@
+#include "sdl2_rect_array.h"
+#include "sdl2_rect.h"
+#include "misc.h"
+#include "mruby/data.h"
+#include "mruby/class.h"
+#include "mruby/array.h"
+
+static struct RClass *class_RectArray = NULL;
+
+/*
+ * Rects are stored as one int32 column per field, so the queries below
+ * run as flat loops the compiler can vectorize. 'packed' is an SDL_Rect
+ * copy built on demand for the SDL draw/fill calls, and 'hits' is scratch
+ * space for index queries; both have 'capacity' entries.
+ */
+typedef struct mrb_sdl2_rect_array_data_t {
+  int32_t  *x;
+  int32_t  *y;
+  int32_t  *w;
+  int32_t  *h;
+  int32_t  *hits;
+  SDL_Rect *packed;
+  bool      packed_valid;
+  int       size;
+  int       capacity;
+} mrb_sdl2_rect_array_data_t;
+
+static void
+mrb_sdl2_rect_array_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_rect_array_data_t *data =
+    (mrb_sdl2_rect_array_data_t*)p;
+  if (NULL != data) {
+    mrb_free(mrb, data->x);
+    mrb_free(mrb, data->y);
+    mrb_free(mrb, data->w);
+    mrb_free(mrb, data->h);
+    mrb_free(mrb, data->hits);
+    mrb_free(mrb, data->packed);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_rect_array_data_type = {
+  "RectArray", mrb_sdl2_rect_array_data_free
+};
+
+static mrb_sdl2_rect_array_data_t *
+mrb_sdl2_rect_array_get_ptr(mrb_state *mrb, mrb_value rects)
+{
+  mrb_sdl2_rect_array_data_t *data =
+    (mrb_sdl2_rect_array_data_t*)mrb_data_get_ptr(mrb, rects, &mrb_sdl2_rect_array_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized rect array.");
+  }
+  return data;
+}
+
+static mrb_sdl2_rect_array_data_t *
+mrb_sdl2_rect_array_data_new(mrb_state *mrb)
+{
+  mrb_sdl2_rect_array_data_t *data =
+    (mrb_sdl2_rect_array_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_rect_array_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  return data;
+}
+
+static void
+mrb_sdl2_rect_array_reserve(mrb_state *mrb, mrb_sdl2_rect_array_data_t *data, mrb_int count)
+{
+  mrb_int capacity = (0 < data->capacity) ? data->capacity : 16;
+  if (count <= data->capacity) {
+    return;
+  }
+  if (count > (mrb_int)(SDL_MAX_SINT32 / sizeof(SDL_Rect))) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "too many rects.");
+  }
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  /* each column stays valid if a later reallocation raises. */
+  data->x      = (int32_t*)mrb_realloc(mrb, data->x,      sizeof(int32_t) * capacity);
+  data->y      = (int32_t*)mrb_realloc(mrb, data->y,      sizeof(int32_t) * capacity);
+  data->w      = (int32_t*)mrb_realloc(mrb, data->w,      sizeof(int32_t) * capacity);
+  data->h      = (int32_t*)mrb_realloc(mrb, data->h,      sizeof(int32_t) * capacity);
+  data->hits   = (int32_t*)mrb_realloc(mrb, data->hits,   sizeof(int32_t) * capacity);
+  data->packed = (SDL_Rect*)mrb_realloc(mrb, data->packed, sizeof(SDL_Rect) * capacity);
+  data->capacity = (int)capacity;
+}
+
+static void
+mrb_sdl2_rect_array_append(mrb_state *mrb, mrb_sdl2_rect_array_data_t *data, int x, int y, int w, int h)
+{
+  mrb_sdl2_rect_array_reserve(mrb, data, (mrb_int)data->size + 1);
+  data->x[data->size] = x;
+  data->y[data->size] = y;
+  data->w[data->size] = w;
+  data->h[data->size] = h;
+  ++data->size;
+  data->packed_valid = false;
+}
+
+static SDL_Rect const *
+mrb_sdl2_rect_array_query_rect(mrb_state *mrb, mrb_value rect)
+{
+  SDL_Rect const *r = mrb_sdl2_rect_get_ptr(mrb, rect);
+  if (NULL == r) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Rect.");
+  }
+  return r;
+}
+
+static mrb_int
+mrb_sdl2_rect_array_index(mrb_state *mrb, mrb_sdl2_rect_array_data_t const *data, mrb_int index)
+{
+  if (0 > index) {
+    index += data->size;
+  }
+  if ((0 > index) || (index >= data->size)) {
+    mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
+  }
+  return index;
+}
+
+bool
+mrb_sdl2_rect_array_p(mrb_state *mrb, mrb_value obj)
+{
+  return (MRB_TT_DATA == mrb_type(obj)) && (&mrb_sdl2_rect_array_data_type == DATA_TYPE(obj));
+}
+
+/*
+ * Returns the rects packed as SDL_Rect, valid until the array is modified.
+ */
+SDL_Rect const *
+mrb_sdl2_rect_array_get_rects(mrb_state *mrb, mrb_value rects, int *count)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, rects);
+  if (!data->packed_valid) {
+    int i;
+    for (i = 0; i < data->size; ++i) {
+      data->packed[i].x = data->x[i];
+      data->packed[i].y = data->y[i];
+      data->packed[i].w = data->w[i];
+      data->packed[i].h = data->h[i];
+    }
+    data->packed_valid = true;
+  }
+  *count = data->size;
+  return data->packed;
+}
+
+/*
+ * Creates an SDL2::RectArray holding a copy of 'count' rects.
+ */
+mrb_value
+mrb_sdl2_rect_array(mrb_state *mrb, SDL_Rect const *rects, int count)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_data_new(mrb);
+  mrb_value result = mrb_obj_value(Data_Wrap_Struct(mrb, class_RectArray, &mrb_sdl2_rect_array_data_type, data));
+  int i;
+  mrb_sdl2_rect_array_reserve(mrb, data, count);
+  for (i = 0; i < count; ++i) {
+    data->x[i] = rects[i].x;
+    data->y[i] = rects[i].y;
+    data->w[i] = rects[i].w;
+    data->h[i] = rects[i].h;
+  }
+  data->size = count;
+  return result;
+}
+
+/***************************************************************************
+*
+* class SDL2::RectArray
+*
+***************************************************************************/
+
+/*
+ * SDL2::RectArray#initialize(capacity = 0)
+ */
+static mrb_value
+mrb_sdl2_rect_array_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data;
+  mrb_int capacity = 0;
+  mrb_get_args(mrb, "|i", &capacity);
+  if (0 > capacity) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "negative capacity.");
+  }
+
+  data = (mrb_sdl2_rect_array_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_rect_array_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+  data = mrb_sdl2_rect_array_data_new(mrb);
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_rect_array_data_type;
+  mrb_sdl2_rect_array_reserve(mrb, data, capacity);
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_rect_array_get_size(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_rect_array_get_ptr(mrb, self)->size);
+}
+
+static mrb_value
+mrb_sdl2_rect_array_clear(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  data->size = 0;
+  data->packed_valid = false;
+  return self;
+}
+
+/*
+ * SDL2::RectArray#push(rect)
+ * SDL2::RectArray#push(x, y, w, h)
+ */
+static mrb_value
+mrb_sdl2_rect_array_push(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_value *argv;
+  mrb_int argc;
+  mrb_get_args(mrb, "*", &argv, &argc);
+  if (1 == argc) {
+    SDL_Rect const *r = mrb_sdl2_rect_array_query_rect(mrb, argv[0]);
+    mrb_sdl2_rect_array_append(mrb, data, r->x, r->y, r->w, r->h);
+  } else if (4 == argc) {
+    mrb_sdl2_rect_array_append(mrb, data,
+                               (int)mrb_fixnum(mrb_Integer(mrb, argv[0])),
+                               (int)mrb_fixnum(mrb_Integer(mrb, argv[1])),
+                               (int)mrb_fixnum(mrb_Integer(mrb, argv[2])),
+                               (int)mrb_fixnum(mrb_Integer(mrb, argv[3])));
+  } else {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "wrong number of arguments.");
+  }
+  return self;
+}
+
+/*
+ * SDL2::RectArray#concat(rects)
+ *
+ * Appends another RectArray, or an Array whose items are SDL2::Rect or
+ * [x, y, w, h].
+ */
+static mrb_value
+mrb_sdl2_rect_array_concat(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_value arg;
+  mrb_get_args(mrb, "o", &arg);
+
+  if (mrb_sdl2_rect_array_p(mrb, arg)) {
+    mrb_sdl2_rect_array_data_t const *other = mrb_sdl2_rect_array_get_ptr(mrb, arg);
+    int const n = other->size;
+    mrb_sdl2_rect_array_reserve(mrb, data, (mrb_int)data->size + n);
+    SDL_memmove(data->x + data->size, other->x, sizeof(int32_t) * n);
+    SDL_memmove(data->y + data->size, other->y, sizeof(int32_t) * n);
+    SDL_memmove(data->w + data->size, other->w, sizeof(int32_t) * n);
+    SDL_memmove(data->h + data->size, other->h, sizeof(int32_t) * n);
+    data->size += n;
+    data->packed_valid = false;
+  } else if (mrb_array_p(arg)) {
+    mrb_int const n = mrb_ary_len(mrb, arg);
+    mrb_int i;
+    mrb_sdl2_rect_array_reserve(mrb, data, (mrb_int)data->size + n);
+    for (i = 0; i < n; ++i) {
+      mrb_value const item = mrb_ary_ref(mrb, arg, i);
+      if (mrb_array_p(item)) {
+        if (4 != mrb_ary_len(mrb, item)) {
+          mrb_raise(mrb, E_ARGUMENT_ERROR, "expected [x, y, w, h].");
+        }
+        mrb_sdl2_rect_array_append(mrb, data,
+                                   (int)mrb_fixnum(mrb_Integer(mrb, mrb_ary_ref(mrb, item, 0))),
+                                   (int)mrb_fixnum(mrb_Integer(mrb, mrb_ary_ref(mrb, item, 1))),
+                                   (int)mrb_fixnum(mrb_Integer(mrb, mrb_ary_ref(mrb, item, 2))),
+                                   (int)mrb_fixnum(mrb_Integer(mrb, mrb_ary_ref(mrb, item, 3))));
+      } else {
+        SDL_Rect const *r = mrb_sdl2_rect_array_query_rect(mrb, item);
+        mrb_sdl2_rect_array_append(mrb, data, r->x, r->y, r->w, r->h);
+      }
+    }
+  } else {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::RectArray or Array.");
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_rect_array_get_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_int index;
+  mrb_get_args(mrb, "i", &index);
+  index = mrb_sdl2_rect_array_index(mrb, data, index);
+  return mrb_sdl2_rect(mrb, data->x[index], data->y[index], data->w[index], data->h[index]);
+}
+
+static mrb_value
+mrb_sdl2_rect_array_set_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_int index;
+  mrb_value rect;
+  SDL_Rect const *r;
+  mrb_get_args(mrb, "io", &index, &rect);
+  index = mrb_sdl2_rect_array_index(mrb, data, index);
+  r = mrb_sdl2_rect_array_query_rect(mrb, rect);
+  data->x[index] = r->x;
+  data->y[index] = r->y;
+  data->w[index] = r->w;
+  data->h[index] = r->h;
+  data->packed_valid = false;
+  return rect;
+}
+
+/*
+ * SDL2::RectArray#slice(start, length)
+ *
+ * Returns a new RectArray with up to 'length' rects from 'start'.
+ */
+static mrb_value
+mrb_sdl2_rect_array_slice(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_sdl2_rect_array_data_t *slice;
+  mrb_value result;
+  mrb_int start, length;
+  mrb_get_args(mrb, "ii", &start, &length);
+  if (0 > start) {
+    start += data->size;
+  }
+  if ((0 > start) || (start > data->size) || (0 > length)) {
+    mrb_raise(mrb, E_INDEX_ERROR, "index out of bounds.");
+  }
+  if (length > data->size - start) {
+    length = data->size - start;
+  }
+
+  slice = mrb_sdl2_rect_array_data_new(mrb);
+  result = mrb_obj_value(Data_Wrap_Struct(mrb, class_RectArray, &mrb_sdl2_rect_array_data_type, slice));
+  if (0 < length) {
+    mrb_sdl2_rect_array_reserve(mrb, slice, length);
+    SDL_memcpy(slice->x, data->x + start, sizeof(int32_t) * length);
+    SDL_memcpy(slice->y, data->y + start, sizeof(int32_t) * length);
+    SDL_memcpy(slice->w, data->w + start, sizeof(int32_t) * length);
+    SDL_memcpy(slice->h, data->h + start, sizeof(int32_t) * length);
+    slice->size = (int)length;
+  }
+  return result;
+}
+
+static mrb_value
+mrb_sdl2_rect_array_to_a(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_value ary = mrb_ary_new_capa(mrb, data->size);
+  int i;
+  for (i = 0; i < data->size; ++i) {
+    mrb_ary_push(mrb, ary, mrb_sdl2_rect(mrb, data->x[i], data->y[i], data->w[i], data->h[i]));
+  }
+  return ary;
+}
+
+/*
+ * The kernels below write every index to 'out' and advance by the test
+ * result, so the loops carry no data dependent branches.
+ */
+static int
+mrb_sdl2_rect_array_select_intersecting(mrb_sdl2_rect_array_data_t const *data, SDL_Rect const *q, int32_t *out)
+{
+  int32_t const *x = data->x, *y = data->y, *w = data->w, *h = data->h;
+  int32_t const qx0 = q->x, qx1 = q->x + q->w;
+  int32_t const qy0 = q->y, qy1 = q->y + q->h;
+  int i, n = 0;
+  if ((0 >= q->w) || (0 >= q->h)) {
+    return 0;
+  }
+  for (i = 0; i < data->size; ++i) {
+    int const hit = (x[i] < qx1) & (x[i] + w[i] > qx0) &
+                    (y[i] < qy1) & (y[i] + h[i] > qy0) &
+                    (w[i] > 0) & (h[i] > 0);
+    out[n] = i;
+    n += hit;
+  }
+  return n;
+}
+
+static int
+mrb_sdl2_rect_array_select_containing(mrb_sdl2_rect_array_data_t const *data, int32_t px, int32_t py, int32_t *out)
+{
+  int32_t const *x = data->x, *y = data->y, *w = data->w, *h = data->h;
+  int i, n = 0;
+  for (i = 0; i < data->size; ++i) {
+    int const hit = (px >= x[i]) & (px < x[i] + w[i]) &
+                    (py >= y[i]) & (py < y[i] + h[i]);
+    out[n] = i;
+    n += hit;
+  }
+  return n;
+}
+
+static int
+mrb_sdl2_rect_array_select_within(mrb_sdl2_rect_array_data_t const *data, SDL_Rect const *q, int32_t *out)
+{
+  int32_t const *x = data->x, *y = data->y, *w = data->w, *h = data->h;
+  int32_t const qx0 = q->x, qx1 = q->x + q->w;
+  int32_t const qy0 = q->y, qy1 = q->y + q->h;
+  int i, n = 0;
+  for (i = 0; i < data->size; ++i) {
+    int const hit = (x[i] >= qx0) & (x[i] + w[i] <= qx1) &
+                    (y[i] >= qy0) & (y[i] + h[i] <= qy1) &
+                    (w[i] > 0) & (h[i] > 0);
+    out[n] = i;
+    n += hit;
+  }
+  return n;
+}
+
+/*
+ * SDL2::RectArray#intersects_any?(rect)
+ */
+static mrb_value
+mrb_sdl2_rect_array_intersects_any(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  int32_t const *x = data->x, *y = data->y, *w = data->w, *h = data->h;
+  SDL_Rect const *q;
+  int32_t qx0, qx1, qy0, qy1;
+  mrb_value rect;
+  int begin, i;
+  mrb_get_args(mrb, "o", &rect);
+  q = mrb_sdl2_rect_array_query_rect(mrb, rect);
+  if ((0 >= q->w) || (0 >= q->h)) {
+    return mrb_false_value();
+  }
+  qx0 = q->x; qx1 = q->x + q->w;
+  qy0 = q->y; qy1 = q->y + q->h;
+  /* tests a block at a time and only checks for a hit between blocks. */
+  for (begin = 0; begin < data->size; begin += 64) {
+    int const end = SDL_min(begin + 64, data->size);
+    int any = 0;
+    for (i = begin; i < end; ++i) {
+      any |= (x[i] < qx1) & (x[i] + w[i] > qx0) &
+             (y[i] < qy1) & (y[i] + h[i] > qy0) &
+             (w[i] > 0) & (h[i] > 0);
+    }
+    if (any) {
+      return mrb_true_value();
+    }
+  }
+  return mrb_false_value();
+}
+
+/*
+ * SDL2::RectArray#intersecting(rect)
+ *
+ * Returns an SDL2::IntBuffer with the indices of the rects overlapping
+ * 'rect'.
+ */
+static mrb_value
+mrb_sdl2_rect_array_intersecting(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_value rect;
+  int n;
+  mrb_get_args(mrb, "o", &rect);
+  n = mrb_sdl2_rect_array_select_intersecting(data, mrb_sdl2_rect_array_query_rect(mrb, rect), data->hits);
+  return mrb_sdl2_misc_intbuffer(mrb, data->hits, (size_t)n);
+}
+
+/*
+ * SDL2::RectArray#containing(x, y)
+ *
+ * Returns an SDL2::IntBuffer with the indices of the rects containing the
+ * point.
+ */
+static mrb_value
+mrb_sdl2_rect_array_containing(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_int x, y;
+  int n;
+  mrb_get_args(mrb, "ii", &x, &y);
+  n = mrb_sdl2_rect_array_select_containing(data, (int32_t)x, (int32_t)y, data->hits);
+  return mrb_sdl2_misc_intbuffer(mrb, data->hits, (size_t)n);
+}
+
+/*
+ * SDL2::RectArray#within(rect)
+ *
+ * Returns an SDL2::IntBuffer with the indices of the non-empty rects lying
+ * entirely inside 'rect'.
+ */
+static mrb_value
+mrb_sdl2_rect_array_within(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  mrb_value rect;
+  int n;
+  mrb_get_args(mrb, "o", &rect);
+  n = mrb_sdl2_rect_array_select_within(data, mrb_sdl2_rect_array_query_rect(mrb, rect), data->hits);
+  return mrb_sdl2_misc_intbuffer(mrb, data->hits, (size_t)n);
+}
+
+/*
+ * SDL2::RectArray#bounds
+ *
+ * Returns the union of all non-empty rects, or nil if there is none.
+ */
+static mrb_value
+mrb_sdl2_rect_array_bounds(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_rect_array_data_t *data = mrb_sdl2_rect_array_get_ptr(mrb, self);
+  int32_t const *x = data->x, *y = data->y, *w = data->w, *h = data->h;
+  int32_t x0 = SDL_MAX_SINT32, y0 = SDL_MAX_SINT32;
+  int32_t x1 = SDL_MIN_SINT32, y1 = SDL_MIN_SINT32;
+  int i;
+  for (i = 0; i < data->size; ++i) {
+    if ((0 < w[i]) && (0 < h[i])) {
+      x0 = SDL_min(x0, x[i]);
+      y0 = SDL_min(y0, y[i]);
+      x1 = SDL_max(x1, x[i] + w[i]);
+      y1 = SDL_max(y1, y[i] + h[i]);
+    }
+  }
+  if (x0 > x1) {
+    return mrb_nil_value();
+  }
+  return mrb_sdl2_rect(mrb, x0, y0, x1 - x0, y1 - y0);
+}
+
+void
+mruby_sdl2_rect_array_init(mrb_state *mrb)
+{
+  class_RectArray = mrb_define_class_under(mrb, mod_SDL2, "RectArray", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_RectArray, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_RectArray, "initialize",      mrb_sdl2_rect_array_initialize,     MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_RectArray, "size",            mrb_sdl2_rect_array_get_size,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_RectArray, "length",          mrb_sdl2_rect_array_get_size,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_RectArray, "clear",           mrb_sdl2_rect_array_clear,          MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_RectArray, "push",            mrb_sdl2_rect_array_push,           MRB_ARGS_ANY());
+  mrb_define_method(mrb, class_RectArray, "<<",              mrb_sdl2_rect_array_push,           MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_RectArray, "concat",          mrb_sdl2_rect_array_concat,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_RectArray, "[]",              mrb_sdl2_rect_array_get_at,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_RectArray, "[]=",             mrb_sdl2_rect_array_set_at,         MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_RectArray, "slice",           mrb_sdl2_rect_array_slice,          MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_RectArray, "to_a",            mrb_sdl2_rect_array_to_a,           MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_RectArray, "intersects_any?", mrb_sdl2_rect_array_intersects_any, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_RectArray, "intersecting",    mrb_sdl2_rect_array_intersecting,   MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_RectArray, "containing",      mrb_sdl2_rect_array_containing,     MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_RectArray, "within",          mrb_sdl2_rect_array_within,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_RectArray, "bounds",          mrb_sdl2_rect_array_bounds,         MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_rect_array_final(mrb_state *mrb)
+{
+}
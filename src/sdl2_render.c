@@ -1,7 +1,9 @@
 #include "sdl2_render.h"
 #include "sdl2_video.h"
 #include "sdl2_rect.h"
+#include "sdl2_rect_array.h"
 #include "sdl2_surface.h"
+#include "sdl2_events_latency.h"
 #include "mruby/data.h"
 #include "mruby/class.h"
 #include "mruby/array.h"
@@ -490,7 +492,18 @@ mrb_sdl2_video_renderer_draw_rects(mrb_state *mrb, mrb_value self)
   mrb_int i;
   SDL_Renderer *renderer = mrb_sdl2_video_renderer_get_ptr(mrb, self);
   mrb_get_args(mrb, "*", &argv, &argc);
+  if ((1 == argc) && mrb_sdl2_rect_array_p(mrb, argv[0])) {
+    int count;
+    SDL_Rect const *packed = mrb_sdl2_rect_array_get_rects(mrb, argv[0], &count);
+    if ((0 < count) && (0 != SDL_RenderDrawRects(renderer, packed, count))) {
+      mruby_sdl2_raise_error(mrb);
+    }
+    return self;
+  }
   rects = (SDL_Rect *) SDL_malloc(sizeof(SDL_Rect) * argc);
+  if (NULL == rects) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
   for (i = 0; i < argc; ++i) {
     SDL_Rect * r;
     r = mrb_sdl2_rect_get_ptr(mrb, argv[i]);
@@ -501,8 +514,10 @@ mrb_sdl2_video_renderer_draw_rects(mrb_state *mrb, mrb_value self)
     }
   }
   if (0 != SDL_RenderDrawRects(renderer, rects, argc)) {
+    SDL_free(rects);
     mruby_sdl2_raise_error(mrb);
   }
+  SDL_free(rects);
   return self;
 }
 
@@ -529,7 +544,18 @@ mrb_sdl2_video_renderer_fill_rects(mrb_state *mrb, mrb_value self)
   mrb_int i;
   SDL_Renderer *renderer = mrb_sdl2_video_renderer_get_ptr(mrb, self);
   mrb_get_args(mrb, "*", &argv, &argc);
+  if ((1 == argc) && mrb_sdl2_rect_array_p(mrb, argv[0])) {
+    int count;
+    SDL_Rect const *packed = mrb_sdl2_rect_array_get_rects(mrb, argv[0], &count);
+    if ((0 < count) && (0 != SDL_RenderFillRects(renderer, packed, count))) {
+      mruby_sdl2_raise_error(mrb);
+    }
+    return self;
+  }
   rects = (SDL_Rect *) SDL_malloc(sizeof(SDL_Rect) * argc);
+  if (NULL == rects) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
   for (i = 0; i < argc; ++i) {
     SDL_Rect * r;
     r = mrb_sdl2_rect_get_ptr(mrb, argv[i]);
@@ -540,8 +566,10 @@ mrb_sdl2_video_renderer_fill_rects(mrb_state *mrb, mrb_value self)
     }
   }
   if (0 != SDL_RenderFillRects(renderer, rects, argc)) {
+    SDL_free(rects);
     mruby_sdl2_raise_error(mrb);
   }
+  SDL_free(rects);
   return self;
 }
 
@@ -554,6 +582,26 @@ mrb_sdl2_video_renderer_get_clip_rect(mrb_state *mrb, mrb_value self)
   return mrb_sdl2_rect_direct(mrb, &rect);
 }
 
+/*
+ * SDL2::Video::Renderer#clip_rect_into(rect)
+ *
+ * Stores the clip rect into 'rect' instead of allocating a new Rect.
+ */
+static mrb_value
+mrb_sdl2_video_renderer_clip_rect_into(mrb_state *mrb, mrb_value self)
+{
+  mrb_value arg;
+  SDL_Rect * rect;
+  SDL_Renderer *renderer = mrb_sdl2_video_renderer_get_ptr(mrb, self);
+  mrb_get_args(mrb, "o", &arg);
+  rect = mrb_sdl2_rect_get_ptr(mrb, arg);
+  if (NULL == rect) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Rect.");
+  }
+  SDL_RenderGetClipRect(renderer, rect);
+  return arg;
+}
+
 static mrb_value
 mrb_sdl2_video_renderer_set_clip_rect(mrb_state *mrb, mrb_value self)
 {
@@ -577,6 +625,21 @@ mrb_sdl2_video_renderer_get_view_port(mrb_state *mrb, mrb_value self)
   return mrb_sdl2_rect_direct(mrb, &rect);
 }
 
+static mrb_value
+mrb_sdl2_video_renderer_view_port_into(mrb_state *mrb, mrb_value self)
+{
+  mrb_value arg;
+  SDL_Rect * rect;
+  SDL_Renderer *renderer = mrb_sdl2_video_renderer_get_ptr(mrb, self);
+  mrb_get_args(mrb, "o", &arg);
+  rect = mrb_sdl2_rect_get_ptr(mrb, arg);
+  if (NULL == rect) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Rect.");
+  }
+  SDL_RenderGetViewport(renderer, rect);
+  return arg;
+}
+
 static mrb_value
 mrb_sdl2_video_renderer_set_view_port(mrb_state *mrb, mrb_value self)
 {
@@ -596,6 +659,7 @@ mrb_sdl2_video_renderer_present(mrb_state *mrb, mrb_value self)
 {
   SDL_Renderer *renderer = mrb_sdl2_video_renderer_get_ptr(mrb, self);
   SDL_RenderPresent(renderer);
+  mrb_sdl2_input_latency_presented();
   return self;
 }
 
@@ -1081,8 +1145,10 @@ mruby_sdl2_video_renderer_init(mrb_state *mrb, struct RClass *mod_Video)
   mrb_define_method(mrb, class_Renderer, "fill_rects",       mrb_sdl2_video_renderer_fill_rects,          MRB_ARGS_ANY());
   mrb_define_method(mrb, class_Renderer, "clip_rect",        mrb_sdl2_video_renderer_get_clip_rect,       MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Renderer, "clip_rect=",       mrb_sdl2_video_renderer_set_clip_rect,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Renderer, "clip_rect_into",   mrb_sdl2_video_renderer_clip_rect_into,      MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Renderer, "view_port",        mrb_sdl2_video_renderer_get_view_port,       MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Renderer, "view_port=",       mrb_sdl2_video_renderer_set_view_port,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Renderer, "view_port_into",   mrb_sdl2_video_renderer_view_port_into,      MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Renderer, "present",          mrb_sdl2_video_renderer_present,             MRB_ARGS_NONE());
   mrb_define_method(mrb, class_Renderer, "read_pixels",      mrb_sdl2_video_renderer_read_pixels,         MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
 
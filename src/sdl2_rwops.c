@@ -206,9 +206,15 @@ mrb_sdl2_rwops_write(mrb_state *mrb, mrb_value self)
 static mrb_value
 mrb_sdl2_rwops_close(mrb_state *mrb, mrb_value self)
 {
-
-  SDL_RWops * rwops = mrb_sdl2_rwops_get_ptr(mrb, self);
-  int result = SDL_RWclose(rwops);
+  mrb_sdl2_rwops_data_t *data =
+    (mrb_sdl2_rwops_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_rwops_data_type);
+  int result;
+  if ((NULL == data) || (NULL == data->rwops)) {
+    return mrb_true_value();
+  }
+  /* SDL_RWclose frees the RWops; do not free it again later. */
+  result = SDL_RWclose(data->rwops);
+  data->rwops = NULL;
   if (result == -1) {
     mruby_sdl2_raise_error(mrb);
   }
@@ -236,7 +242,7 @@ void
 mruby_sdl2_rwops_init(mrb_state *mrb)
 {
   int arena_size;
-  struct RClass *class_RWops = mrb_define_class_under(mrb, mod_SDL2, "RWops", mrb->object_class);
+  class_RWops = mrb_define_class_under(mrb, mod_SDL2, "RWops", mrb->object_class);
 
   MRB_SET_INSTANCE_TT(class_RWops, MRB_TT_DATA);
 
@@ -0,0 +1,683 @@
+#include "sdl2_spatial_hash.h"
+#include "sdl2_rect.h"
+#include "sdl2_rect_array.h"
+#include "misc.h"
+#include "mruby/data.h"
+#include "mruby/class.h"
+
+static struct RClass *class_SpatialHash = NULL;
+
+#define MRB_SDL2_SPATIAL_HASH_MAX_ID    (1 << 24)
+#define MRB_SDL2_SPATIAL_HASH_MAX_CELLS (1 << 16)
+
+typedef struct mrb_sdl2_spatial_hash_entity_t {
+  SDL_Rect rect;
+  int      cx0, cy0, cx1, cy1;
+  Uint32   stamp;
+  bool     active;
+} mrb_sdl2_spatial_hash_entity_t;
+
+typedef struct mrb_sdl2_spatial_hash_node_t {
+  int32_t id;
+  int32_t next;
+} mrb_sdl2_spatial_hash_node_t;
+
+typedef struct mrb_sdl2_spatial_hash_slot_t {
+  int32_t cx;
+  int32_t cy;
+  int32_t head;
+  bool    used;
+} mrb_sdl2_spatial_hash_slot_t;
+
+/*
+ * Entities are indexed by id. Every grid cell an entity covers holds one
+ * node of a singly linked list; nodes come from one pool with a free list
+ * and cells live in an open addressing table keyed by cell coordinates.
+ * A cell whose list became empty keeps its slot until the next rehash.
+ */
+typedef struct mrb_sdl2_spatial_hash_data_t {
+  int                             cell_size;
+  mrb_sdl2_spatial_hash_entity_t *entities;
+  int                             entity_capacity;
+  int                             count;
+  mrb_sdl2_spatial_hash_node_t   *nodes;
+  int                             node_capacity;
+  int                             node_top;
+  int32_t                         free_node;
+  mrb_sdl2_spatial_hash_slot_t   *slots;
+  int                             slot_capacity;
+  int                             slot_used;
+  Uint32                          stamp;
+  int32_t                        *out;
+  int                             out_capacity;
+} mrb_sdl2_spatial_hash_data_t;
+
+static void
+mrb_sdl2_spatial_hash_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_spatial_hash_data_t *data =
+    (mrb_sdl2_spatial_hash_data_t*)p;
+  if (NULL != data) {
+    mrb_free(mrb, data->entities);
+    mrb_free(mrb, data->nodes);
+    mrb_free(mrb, data->slots);
+    mrb_free(mrb, data->out);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_spatial_hash_data_type = {
+  "SpatialHash", mrb_sdl2_spatial_hash_data_free
+};
+
+static mrb_sdl2_spatial_hash_data_t *
+mrb_sdl2_spatial_hash_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data =
+    (mrb_sdl2_spatial_hash_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_spatial_hash_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized spatial hash.");
+  }
+  return data;
+}
+
+static int
+mrb_sdl2_spatial_hash_floor_div(Sint64 a, int b)
+{
+  Sint64 q = a / b;
+  if ((0 != (a % b)) && (0 > a)) {
+    --q;
+  }
+  return (int)SDL_max(SDL_min(q, (Sint64)SDL_MAX_SINT32), (Sint64)SDL_MIN_SINT32);
+}
+
+static bool
+mrb_sdl2_spatial_hash_intersects(SDL_Rect const *a, SDL_Rect const *b)
+{
+  return (0 < a->w) && (0 < a->h) && (0 < b->w) && (0 < b->h) &&
+         (a->x < (Sint64)b->x + b->w) && (b->x < (Sint64)a->x + a->w) &&
+         (a->y < (Sint64)b->y + b->h) && (b->y < (Sint64)a->y + a->h);
+}
+
+/*
+ * computes the cell range of 'rect'; empty rects still occupy one cell.
+ * Returns the number of cells, or -1 when it exceeds MAX_CELLS.
+ */
+static int
+mrb_sdl2_spatial_hash_cells(mrb_sdl2_spatial_hash_data_t const *data, SDL_Rect const *rect, int *cx0, int *cy0, int *cx1, int *cy1)
+{
+  int const cs = data->cell_size;
+  Sint64 cells;
+  *cx0 = mrb_sdl2_spatial_hash_floor_div(rect->x, cs);
+  *cy0 = mrb_sdl2_spatial_hash_floor_div(rect->y, cs);
+  *cx1 = mrb_sdl2_spatial_hash_floor_div((Sint64)rect->x + SDL_max(rect->w, 1) - 1, cs);
+  *cy1 = mrb_sdl2_spatial_hash_floor_div((Sint64)rect->y + SDL_max(rect->h, 1) - 1, cs);
+  cells = ((Sint64)*cx1 - *cx0 + 1) * ((Sint64)*cy1 - *cy0 + 1);
+  return (MRB_SDL2_SPATIAL_HASH_MAX_CELLS < cells) ? -1 : (int)cells;
+}
+
+static Uint32
+mrb_sdl2_spatial_hash_slot_hash(int32_t cx, int32_t cy)
+{
+  return ((Uint32)cx * 73856093u) ^ ((Uint32)cy * 19349663u);
+}
+
+static int
+mrb_sdl2_spatial_hash_find_slot(mrb_sdl2_spatial_hash_data_t const *data, int32_t cx, int32_t cy)
+{
+  Uint32 const mask = (Uint32)data->slot_capacity - 1;
+  Uint32 i;
+  if (0 == data->slot_capacity) {
+    return -1;
+  }
+  for (i = mrb_sdl2_spatial_hash_slot_hash(cx, cy) & mask; data->slots[i].used; i = (i + 1) & mask) {
+    if ((data->slots[i].cx == cx) && (data->slots[i].cy == cy)) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/* the caller reserves room for the slot beforehand. */
+static int
+mrb_sdl2_spatial_hash_add_slot(mrb_sdl2_spatial_hash_data_t *data, int32_t cx, int32_t cy)
+{
+  Uint32 const mask = (Uint32)data->slot_capacity - 1;
+  Uint32 i;
+  for (i = mrb_sdl2_spatial_hash_slot_hash(cx, cy) & mask; data->slots[i].used; i = (i + 1) & mask) {
+    if ((data->slots[i].cx == cx) && (data->slots[i].cy == cy)) {
+      return (int)i;
+    }
+  }
+  data->slots[i].cx   = cx;
+  data->slots[i].cy   = cy;
+  data->slots[i].head = -1;
+  data->slots[i].used = true;
+  ++data->slot_used;
+  return (int)i;
+}
+
+static void
+mrb_sdl2_spatial_hash_reserve_slots(mrb_state *mrb, mrb_sdl2_spatial_hash_data_t *data, int extra)
+{
+  mrb_sdl2_spatial_hash_slot_t *old = data->slots;
+  int const old_capacity = data->slot_capacity;
+  int capacity = (0 < old_capacity) ? old_capacity : 64;
+  int live = 0;
+  int i;
+  if ((data->slot_used + extra) * 2 < old_capacity) {
+    return;
+  }
+  /*
+   * empty cells are dropped by the rehash, so entities wandering over a
+   * large world do not grow the table; sizing for a quarter load keeps
+   * rehashes rare.
+   */
+  for (i = 0; i < old_capacity; ++i) {
+    live += (old[i].used && (0 <= old[i].head)) ? 1 : 0;
+  }
+  while ((live + extra) * 4 >= capacity) {
+    capacity *= 2;
+  }
+  data->slots = (mrb_sdl2_spatial_hash_slot_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_spatial_hash_slot_t) * capacity);
+  SDL_memset(data->slots, 0, sizeof(mrb_sdl2_spatial_hash_slot_t) * capacity);
+  data->slot_capacity = capacity;
+  data->slot_used     = 0;
+  for (i = 0; i < old_capacity; ++i) {
+    if (old[i].used && (0 <= old[i].head)) {
+      int const s = mrb_sdl2_spatial_hash_add_slot(data, old[i].cx, old[i].cy);
+      data->slots[s].head = old[i].head;
+    }
+  }
+  mrb_free(mrb, old);
+}
+
+static void
+mrb_sdl2_spatial_hash_reserve_nodes(mrb_state *mrb, mrb_sdl2_spatial_hash_data_t *data, int extra)
+{
+  int capacity = (0 < data->node_capacity) ? data->node_capacity : 256;
+  if (data->node_top + extra <= data->node_capacity) {
+    return;
+  }
+  if (data->node_top + extra > SDL_MAX_SINT32 / (int)sizeof(mrb_sdl2_spatial_hash_node_t) / 2) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  while (capacity < data->node_top + extra) {
+    capacity *= 2;
+  }
+  data->nodes = (mrb_sdl2_spatial_hash_node_t*)mrb_realloc(mrb, data->nodes, sizeof(mrb_sdl2_spatial_hash_node_t) * capacity);
+  data->node_capacity = capacity;
+}
+
+static void
+mrb_sdl2_spatial_hash_reserve_entities(mrb_state *mrb, mrb_sdl2_spatial_hash_data_t *data, int id)
+{
+  int capacity = (0 < data->entity_capacity) ? data->entity_capacity : 64;
+  if (id < data->entity_capacity) {
+    return;
+  }
+  while (capacity <= id) {
+    capacity *= 2;
+  }
+  data->entities = (mrb_sdl2_spatial_hash_entity_t*)mrb_realloc(mrb, data->entities, sizeof(mrb_sdl2_spatial_hash_entity_t) * capacity);
+  SDL_memset(data->entities + data->entity_capacity, 0,
+             sizeof(mrb_sdl2_spatial_hash_entity_t) * (capacity - data->entity_capacity));
+  data->entity_capacity = capacity;
+}
+
+static void
+mrb_sdl2_spatial_hash_emit(mrb_state *mrb, mrb_sdl2_spatial_hash_data_t *data, int *n, int32_t value)
+{
+  if (*n == data->out_capacity) {
+    int const capacity = (0 < data->out_capacity) ? data->out_capacity * 2 : 256;
+    data->out = (int32_t*)mrb_realloc(mrb, data->out, sizeof(int32_t) * capacity);
+    data->out_capacity = capacity;
+  }
+  data->out[(*n)++] = value;
+}
+
+static void
+mrb_sdl2_spatial_hash_link(mrb_sdl2_spatial_hash_data_t *data, int32_t id, mrb_sdl2_spatial_hash_entity_t const *e)
+{
+  int cx, cy;
+  for (cy = e->cy0; cy <= e->cy1; ++cy) {
+    for (cx = e->cx0; cx <= e->cx1; ++cx) {
+      int const s = mrb_sdl2_spatial_hash_add_slot(data, cx, cy);
+      int32_t node = data->free_node;
+      if (0 <= node) {
+        data->free_node = data->nodes[node].next;
+      } else {
+        node = data->node_top++;
+      }
+      data->nodes[node].id   = id;
+      data->nodes[node].next = data->slots[s].head;
+      data->slots[s].head    = node;
+    }
+  }
+}
+
+static void
+mrb_sdl2_spatial_hash_unlink(mrb_sdl2_spatial_hash_data_t *data, int32_t id, mrb_sdl2_spatial_hash_entity_t const *e)
+{
+  int cx, cy;
+  for (cy = e->cy0; cy <= e->cy1; ++cy) {
+    for (cx = e->cx0; cx <= e->cx1; ++cx) {
+      int const s = mrb_sdl2_spatial_hash_find_slot(data, cx, cy);
+      int32_t *link;
+      if (0 > s) {
+        continue;
+      }
+      for (link = &data->slots[s].head; 0 <= *link; link = &data->nodes[*link].next) {
+        int32_t const node = *link;
+        if (id == data->nodes[node].id) {
+          *link = data->nodes[node].next;
+          data->nodes[node].next = data->free_node;
+          data->free_node = node;
+          break;
+        }
+      }
+    }
+  }
+}
+
+static void
+mrb_sdl2_spatial_hash_place(mrb_state *mrb, mrb_sdl2_spatial_hash_data_t *data, mrb_int id, SDL_Rect const *rect)
+{
+  mrb_sdl2_spatial_hash_entity_t *e;
+  int cx0, cy0, cx1, cy1, cells;
+  if ((0 > id) || (MRB_SDL2_SPATIAL_HASH_MAX_ID <= id)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "id out of range.");
+  }
+  cells = mrb_sdl2_spatial_hash_cells(data, rect, &cx0, &cy0, &cx1, &cy1);
+  if ((0 > cells) || (MRB_SDL2_SPATIAL_HASH_MAX_CELLS < cells)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "rect covers too many cells.");
+  }
+  mrb_sdl2_spatial_hash_reserve_entities(mrb, data, (int)id);
+  e = &data->entities[id];
+  if (e->active && (e->cx0 == cx0) && (e->cy0 == cy0) && (e->cx1 == cx1) && (e->cy1 == cy1)) {
+    e->rect = *rect;
+    return;
+  }
+  mrb_sdl2_spatial_hash_reserve_nodes(mrb, data, cells);
+  mrb_sdl2_spatial_hash_reserve_slots(mrb, data, cells);
+  if (e->active) {
+    mrb_sdl2_spatial_hash_unlink(data, (int32_t)id, e);
+  } else {
+    e->active = true;
+    ++data->count;
+  }
+  e->rect = *rect;
+  e->cx0  = cx0;
+  e->cy0  = cy0;
+  e->cx1  = cx1;
+  e->cy1  = cy1;
+  mrb_sdl2_spatial_hash_link(data, (int32_t)id, e);
+}
+
+static bool
+mrb_sdl2_spatial_hash_delete(mrb_sdl2_spatial_hash_data_t *data, mrb_int id)
+{
+  mrb_sdl2_spatial_hash_entity_t *e;
+  if ((0 > id) || (data->entity_capacity <= id) || !data->entities[id].active) {
+    return false;
+  }
+  e = &data->entities[id];
+  mrb_sdl2_spatial_hash_unlink(data, (int32_t)id, e);
+  e->active = false;
+  --data->count;
+  return true;
+}
+
+static Uint32
+mrb_sdl2_spatial_hash_next_stamp(mrb_sdl2_spatial_hash_data_t *data)
+{
+  if (0 == ++data->stamp) {
+    int i;
+    for (i = 0; i < data->entity_capacity; ++i) {
+      data->entities[i].stamp = 0;
+    }
+    data->stamp = 1;
+  }
+  return data->stamp;
+}
+
+static mrb_sdl2_spatial_hash_entity_t *
+mrb_sdl2_spatial_hash_entity(mrb_state *mrb, mrb_sdl2_spatial_hash_data_t *data, mrb_int id)
+{
+  if ((0 > id) || (data->entity_capacity <= id) || !data->entities[id].active) {
+    mrb_raise(mrb, E_INDEX_ERROR, "unknown id.");
+  }
+  return &data->entities[id];
+}
+
+static SDL_Rect const *
+mrb_sdl2_spatial_hash_rect_arg(mrb_state *mrb, mrb_value rect)
+{
+  SDL_Rect const *r = mrb_sdl2_rect_get_ptr(mrb, rect);
+  if (NULL == r) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Rect.");
+  }
+  return r;
+}
+
+/***************************************************************************
+*
+* class SDL2::SpatialHash
+*
+***************************************************************************/
+
+/*
+ * SDL2::SpatialHash#initialize(cell_size = 64)
+ *
+ * A uniform grid for broad-phase collision. Pick a cell size around the
+ * size of a typical entity.
+ */
+static mrb_value
+mrb_sdl2_spatial_hash_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data;
+  mrb_int cell_size = 64;
+  mrb_get_args(mrb, "|i", &cell_size);
+  if ((0 >= cell_size) || (SDL_MAX_SINT32 < cell_size)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "cell size must be positive.");
+  }
+
+  data = (mrb_sdl2_spatial_hash_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_spatial_hash_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+  data = (mrb_sdl2_spatial_hash_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_spatial_hash_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  data->cell_size = (int)cell_size;
+  data->free_node = -1;
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_spatial_hash_data_type;
+  return self;
+}
+
+/*
+ * SDL2::SpatialHash#insert(id, rect)
+ * SDL2::SpatialHash#insert(id, x, y, w, h)
+ *
+ * Adds 'id' or moves it to new bounds. A move that stays within the same
+ * cells only updates the stored bounds.
+ */
+static mrb_value
+mrb_sdl2_spatial_hash_insert(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  mrb_int id, x, y, w, h;
+  mrb_value rect;
+  SDL_Rect r;
+  int const argc = mrb_get_args(mrb, "io|iii", &id, &rect, &y, &w, &h);
+  if (2 == argc) {
+    r = *mrb_sdl2_spatial_hash_rect_arg(mrb, rect);
+  } else if (5 == argc) {
+    x = mrb_fixnum(mrb_Integer(mrb, rect));
+    r.x = (int)x;
+    r.y = (int)y;
+    r.w = (int)w;
+    r.h = (int)h;
+  } else {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "wrong number of arguments.");
+  }
+  mrb_sdl2_spatial_hash_place(mrb, data, id, &r);
+  return self;
+}
+
+/*
+ * SDL2::SpatialHash#move(id, x, y)
+ */
+static mrb_value
+mrb_sdl2_spatial_hash_move(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  mrb_int id, x, y;
+  SDL_Rect r;
+  mrb_get_args(mrb, "iii", &id, &x, &y);
+  r = mrb_sdl2_spatial_hash_entity(mrb, data, id)->rect;
+  r.x = (int)x;
+  r.y = (int)y;
+  mrb_sdl2_spatial_hash_place(mrb, data, id, &r);
+  return self;
+}
+
+/*
+ * SDL2::SpatialHash#update_all(rect_array)
+ *
+ * Places rect i of an SDL2::RectArray under id i and removes any id past
+ * the end of the array.
+ */
+static mrb_value
+mrb_sdl2_spatial_hash_update_all(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  SDL_Rect const *rects;
+  mrb_value arg;
+  int count, i;
+  mrb_get_args(mrb, "o", &arg);
+  if (!mrb_sdl2_rect_array_p(mrb, arg)) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::RectArray.");
+  }
+  rects = mrb_sdl2_rect_array_get_rects(mrb, arg, &count);
+  for (i = 0; i < count; ++i) {
+    mrb_sdl2_spatial_hash_place(mrb, data, i, &rects[i]);
+  }
+  for (i = count; i < data->entity_capacity; ++i) {
+    mrb_sdl2_spatial_hash_delete(data, i);
+  }
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_spatial_hash_remove(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  mrb_int id;
+  mrb_get_args(mrb, "i", &id);
+  return mrb_bool_value(mrb_sdl2_spatial_hash_delete(data, id));
+}
+
+static mrb_value
+mrb_sdl2_spatial_hash_clear(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  if (NULL != data->slots) {
+    SDL_memset(data->slots, 0, sizeof(mrb_sdl2_spatial_hash_slot_t) * data->slot_capacity);
+  }
+  if (NULL != data->entities) {
+    SDL_memset(data->entities, 0, sizeof(mrb_sdl2_spatial_hash_entity_t) * data->entity_capacity);
+  }
+  data->slot_used = 0;
+  data->node_top  = 0;
+  data->free_node = -1;
+  data->count     = 0;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_spatial_hash_include(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  mrb_int id;
+  mrb_get_args(mrb, "i", &id);
+  return mrb_bool_value((0 <= id) && (id < data->entity_capacity) && data->entities[id].active);
+}
+
+static mrb_value
+mrb_sdl2_spatial_hash_get_at(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  mrb_int id;
+  mrb_get_args(mrb, "i", &id);
+  if ((0 > id) || (data->entity_capacity <= id) || !data->entities[id].active) {
+    return mrb_nil_value();
+  }
+  return mrb_sdl2_rect_direct(mrb, &data->entities[id].rect);
+}
+
+static mrb_value
+mrb_sdl2_spatial_hash_get_size(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_spatial_hash_get_ptr(mrb, self)->count);
+}
+
+static mrb_value
+mrb_sdl2_spatial_hash_get_cell_size(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_spatial_hash_get_ptr(mrb, self)->cell_size);
+}
+
+static void
+mrb_sdl2_spatial_hash_query_cell(mrb_state *mrb, mrb_sdl2_spatial_hash_data_t *data, int s, SDL_Rect const *q, Uint32 stamp, int *n)
+{
+  int32_t node;
+  for (node = data->slots[s].head; 0 <= node; node = data->nodes[node].next) {
+    int32_t const id = data->nodes[node].id;
+    mrb_sdl2_spatial_hash_entity_t *e = &data->entities[id];
+    if (stamp != e->stamp) {
+      e->stamp = stamp;
+      if (mrb_sdl2_spatial_hash_intersects(&e->rect, q)) {
+        mrb_sdl2_spatial_hash_emit(mrb, data, n, id);
+      }
+    }
+  }
+}
+
+/*
+ * SDL2::SpatialHash#query(rect)
+ *
+ * Returns an SDL2::IntBuffer with the ids whose bounds overlap 'rect'.
+ */
+static mrb_value
+mrb_sdl2_spatial_hash_query(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  SDL_Rect const *q;
+  mrb_value rect;
+  Uint32 stamp;
+  int cx0, cy0, cx1, cy1, cells, cx, cy, s;
+  int n = 0;
+  mrb_get_args(mrb, "o", &rect);
+  q = mrb_sdl2_spatial_hash_rect_arg(mrb, rect);
+  if ((0 >= q->w) || (0 >= q->h) || (0 == data->count)) {
+    return mrb_sdl2_misc_intbuffer(mrb, NULL, 0);
+  }
+  stamp = mrb_sdl2_spatial_hash_next_stamp(data);
+  cells = mrb_sdl2_spatial_hash_cells(data, q, &cx0, &cy0, &cx1, &cy1);
+  if ((0 > cells) || (data->slot_capacity < cells)) {
+    /* a region larger than the table is cheaper to answer by a scan. */
+    for (s = 0; s < data->slot_capacity; ++s) {
+      mrb_sdl2_spatial_hash_slot_t const *slot = &data->slots[s];
+      if (slot->used && (cx0 <= slot->cx) && (slot->cx <= cx1) && (cy0 <= slot->cy) && (slot->cy <= cy1)) {
+        mrb_sdl2_spatial_hash_query_cell(mrb, data, s, q, stamp, &n);
+      }
+    }
+  } else {
+    for (cy = cy0; cy <= cy1; ++cy) {
+      for (cx = cx0; cx <= cx1; ++cx) {
+        s = mrb_sdl2_spatial_hash_find_slot(data, cx, cy);
+        if (0 <= s) {
+          mrb_sdl2_spatial_hash_query_cell(mrb, data, s, q, stamp, &n);
+        }
+      }
+    }
+  }
+  return mrb_sdl2_misc_intbuffer(mrb, data->out, (size_t)n);
+}
+
+/*
+ * SDL2::SpatialHash#query_point(x, y)
+ *
+ * Returns an SDL2::IntBuffer with the ids whose bounds contain the point.
+ */
+static mrb_value
+mrb_sdl2_spatial_hash_query_point(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  mrb_int x, y;
+  int32_t node;
+  int s, n = 0;
+  mrb_get_args(mrb, "ii", &x, &y);
+  s = mrb_sdl2_spatial_hash_find_slot(data,
+                                      mrb_sdl2_spatial_hash_floor_div((int)x, data->cell_size),
+                                      mrb_sdl2_spatial_hash_floor_div((int)y, data->cell_size));
+  if (0 <= s) {
+    for (node = data->slots[s].head; 0 <= node; node = data->nodes[node].next) {
+      SDL_Rect const *r = &data->entities[data->nodes[node].id].rect;
+      if ((r->x <= x) && (x < r->x + r->w) && (r->y <= y) && (y < r->y + r->h)) {
+        mrb_sdl2_spatial_hash_emit(mrb, data, &n, data->nodes[node].id);
+      }
+    }
+  }
+  return mrb_sdl2_misc_intbuffer(mrb, data->out, (size_t)n);
+}
+
+/*
+ * SDL2::SpatialHash#pairs
+ *
+ * Returns an SDL2::IntBuffer of overlapping id pairs laid out as
+ * [a0, b0, a1, b1, ...] with a < b. A pair sharing several cells is
+ * reported only from the first cell of their overlap.
+ */
+static mrb_value
+mrb_sdl2_spatial_hash_pairs(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_spatial_hash_data_t *data = mrb_sdl2_spatial_hash_get_ptr(mrb, self);
+  int s, n = 0;
+  for (s = 0; s < data->slot_capacity; ++s) {
+    mrb_sdl2_spatial_hash_slot_t const *slot = &data->slots[s];
+    int32_t a, b;
+    if (!slot->used) {
+      continue;
+    }
+    for (a = slot->head; 0 <= a; a = data->nodes[a].next) {
+      int32_t const ia = data->nodes[a].id;
+      mrb_sdl2_spatial_hash_entity_t const *ea = &data->entities[ia];
+      for (b = data->nodes[a].next; 0 <= b; b = data->nodes[b].next) {
+        int32_t const ib = data->nodes[b].id;
+        mrb_sdl2_spatial_hash_entity_t const *eb = &data->entities[ib];
+        if ((SDL_max(ea->cx0, eb->cx0) != slot->cx) || (SDL_max(ea->cy0, eb->cy0) != slot->cy)) {
+          continue;
+        }
+        if (mrb_sdl2_spatial_hash_intersects(&ea->rect, &eb->rect)) {
+          mrb_sdl2_spatial_hash_emit(mrb, data, &n, SDL_min(ia, ib));
+          mrb_sdl2_spatial_hash_emit(mrb, data, &n, SDL_max(ia, ib));
+        }
+      }
+    }
+  }
+  return mrb_sdl2_misc_intbuffer(mrb, data->out, (size_t)n);
+}
+
+void
+mruby_sdl2_spatial_hash_init(mrb_state *mrb)
+{
+  class_SpatialHash = mrb_define_class_under(mrb, mod_SDL2, "SpatialHash", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_SpatialHash, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_SpatialHash, "initialize",  mrb_sdl2_spatial_hash_initialize,    MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_SpatialHash, "insert",      mrb_sdl2_spatial_hash_insert,        MRB_ARGS_REQ(2) | MRB_ARGS_OPT(3));
+  mrb_define_method(mrb, class_SpatialHash, "update",      mrb_sdl2_spatial_hash_insert,        MRB_ARGS_REQ(2) | MRB_ARGS_OPT(3));
+  mrb_define_method(mrb, class_SpatialHash, "move",        mrb_sdl2_spatial_hash_move,          MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, class_SpatialHash, "update_all",  mrb_sdl2_spatial_hash_update_all,    MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SpatialHash, "remove",      mrb_sdl2_spatial_hash_remove,        MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SpatialHash, "clear",       mrb_sdl2_spatial_hash_clear,         MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SpatialHash, "include?",    mrb_sdl2_spatial_hash_include,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SpatialHash, "[]",          mrb_sdl2_spatial_hash_get_at,        MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SpatialHash, "size",        mrb_sdl2_spatial_hash_get_size,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SpatialHash, "cell_size",   mrb_sdl2_spatial_hash_get_cell_size, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SpatialHash, "query",       mrb_sdl2_spatial_hash_query,         MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SpatialHash, "query_point", mrb_sdl2_spatial_hash_query_point,   MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_SpatialHash, "pairs",       mrb_sdl2_spatial_hash_pairs,         MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_spatial_hash_final(mrb_state *mrb)
+{
+}
@@ -1,5 +1,10 @@
 #include "sdl2_surface.h"
+#include "sdl2_surface_filter.h"
+#include "sdl2_surface_compare.h"
+#include "sdl2_surface_convert.h"
+#include "sdl2_surface_quantize.h"
 #include "sdl2_rect.h"
+#include "sdl2_rect_array.h"
 #include "sdl2_pixels.h"
 #include <SDL2/SDL_endian.h>
 #include "mruby/data.h"
@@ -150,14 +155,20 @@ mrb_sdl2_video_surface_convert_format(mrb_state *mrb, mrb_value self)
 {
   SDL_Surface *s, *new_s;
   mrb_int pixel_format;
+  SDL_PixelFormat *format;
   mrb_get_args(mrb, "i", &pixel_format);
   s = mrb_sdl2_video_surface_get_ptr(mrb, self);
 
-  new_s = SDL_ConvertSurfaceFormat(s, (Uint32) pixel_format, 0);
+  format = SDL_AllocFormat((Uint32) pixel_format);
+  if (NULL == format) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  new_s = mrb_sdl2_video_surface_convert_surface(s, format);
+  SDL_FreeFormat(format);
   if (NULL == new_s) {
     mruby_sdl2_raise_error(mrb);
   }
-  return mrb_sdl2_video_surface(mrb, new_s, true);
+  return mrb_sdl2_video_surface(mrb, new_s, false);
 }
 
 static mrb_value
@@ -196,19 +207,33 @@ mrb_sdl2_video_surface_fill_rect(mrb_state *mrb, mrb_value self)
 static mrb_value
 mrb_sdl2_video_surface_fill_rects(mrb_state *mrb, mrb_value self)
 {
-  uint32_t color;
+  mrb_int color;
   mrb_value rects;
   mrb_int n;
   SDL_Surface *s;
   SDL_Rect * r;
   mrb_int i;
   mrb_get_args(mrb, "io", &color, &rects);
+  s = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  if (mrb_sdl2_rect_array_p(mrb, rects)) {
+    int count;
+    SDL_Rect const *packed = mrb_sdl2_rect_array_get_rects(mrb, rects, &count);
+    if ((0 < count) && (0 != SDL_FillRects(s, packed, count, (Uint32)color))) {
+      mruby_sdl2_raise_error(mrb);
+    }
+    return self;
+  }
   if (!mrb_array_p(rects)) {
-    mrb_raise(mrb, E_TYPE_ERROR, "given 2nd argument is unexpected type (expected Array).");
+    mrb_raise(mrb, E_TYPE_ERROR, "given 2nd argument is unexpected type (expected Array or RectArray).");
   }
   n = mrb_ary_len(mrb, rects);
-  s = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  if (0 == n) {
+    return self;
+  }
   r = (SDL_Rect *) SDL_malloc(sizeof(SDL_Rect) * n);
+  if (NULL == r) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
   for (i = 0; i < n; ++i) {
     SDL_Rect const * const ptr = mrb_sdl2_rect_get_ptr(mrb, mrb_ary_ref(mrb, rects, i));
     if (NULL != ptr) {
@@ -217,9 +242,11 @@ mrb_sdl2_video_surface_fill_rects(mrb_state *mrb, mrb_value self)
       r[i] = (SDL_Rect){ 0, 0, 0, 0 };
     }
   }
-  if (0 != SDL_FillRects(s, r, n, color)) {
+  if (0 != SDL_FillRects(s, r, n, (Uint32)color)) {
+    SDL_free(r);
     mruby_sdl2_raise_error(mrb);
   }
+  SDL_free(r);
   return self;
 }
 
@@ -390,6 +417,80 @@ mrb_sdl2_video_surface_unlock(mrb_state *mrb, mrb_value self)
 }
 
 
+/*
+ * SDL2::Video::Surface#view(rect)
+ *
+ * Returns a surface aliasing the pixels of 'rect' in this surface, with no
+ * copy. The view keeps its parent alive; freeing the parent explicitly
+ * leaves the view dangling.
+ */
+static mrb_value
+mrb_sdl2_video_surface_view(mrb_state *mrb, mrb_value self)
+{
+  SDL_Surface *parent, *view;
+  SDL_Rect bounds, area;
+  SDL_Rect *rect;
+  SDL_BlendMode mode;
+  Uint32 key;
+  Uint8 alpha, r, g, b;
+  mrb_value arg, result;
+  mrb_get_args(mrb, "o", &arg);
+  parent = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  rect = mrb_sdl2_rect_get_ptr(mrb, arg);
+  if ((NULL == parent) || (NULL == rect)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface and rect must not be nil.");
+  }
+  if (SDL_MUSTLOCK(parent)) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "cannot create a view of a RLE surface.");
+  }
+  /* a view starts on a byte; INDEX1/INDEX4 pixels do not. */
+  if (8 > parent->format->BitsPerPixel) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "cannot create a view of a sub-byte surface.");
+  }
+  bounds.x = 0;
+  bounds.y = 0;
+  bounds.w = parent->w;
+  bounds.h = parent->h;
+  if (!SDL_IntersectRect(&bounds, rect, &area)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "rect is outside of the surface.");
+  }
+  view = SDL_CreateRGBSurfaceFrom((Uint8*)parent->pixels + area.y * parent->pitch + area.x * parent->format->BytesPerPixel,
+                                  area.w, area.h, parent->format->BitsPerPixel, parent->pitch,
+                                  parent->format->Rmask, parent->format->Gmask,
+                                  parent->format->Bmask, parent->format->Amask);
+  if (NULL == view) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  /* a view blits like the parent would. */
+  if (NULL != parent->format->palette) {
+    SDL_SetSurfacePalette(view, parent->format->palette);
+  }
+  if (0 == SDL_GetColorKey(parent, &key)) {
+    SDL_SetColorKey(view, SDL_TRUE, key);
+  }
+  if (0 == SDL_GetSurfaceBlendMode(parent, &mode)) {
+    SDL_SetSurfaceBlendMode(view, mode);
+  }
+  if (0 == SDL_GetSurfaceAlphaMod(parent, &alpha)) {
+    SDL_SetSurfaceAlphaMod(view, alpha);
+  }
+  if (0 == SDL_GetSurfaceColorMod(parent, &r, &g, &b)) {
+    SDL_SetSurfaceColorMod(view, r, g, b);
+  }
+  result = mrb_sdl2_video_surface(mrb, view, false);
+  mrb_iv_set(mrb, result, mrb_intern_lit(mrb, "__parent__"), self);
+  return result;
+}
+
+/*
+ * SDL2::Video::Surface#parent
+ */
+static mrb_value
+mrb_sdl2_video_surface_parent(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__parent__"));
+}
+
 /*
  * SDL2::Video::Surface::load_bmp
  */
@@ -476,11 +577,11 @@ mrb_sdl2_video_surface_convert(mrb_state *mrb, mrb_value self)
   p = mrb_sdl2_pixels_pixelformat_get_ptr(mrb, pixel_format);
   s = mrb_sdl2_video_surface_get_ptr(mrb, self);
   
-  new_s = SDL_ConvertSurface(s, p, 0);
+  new_s = mrb_sdl2_video_surface_convert_surface(s, p);
   if (NULL == new_s) {
     mruby_sdl2_raise_error(mrb);
   }
-  return mrb_sdl2_video_surface(mrb, new_s, true);
+  return mrb_sdl2_video_surface(mrb, new_s, false);
 }
 
 static mrb_value
@@ -699,6 +800,8 @@ mruby_sdl2_video_surface_init(mrb_state *mrb, struct RClass *mod_Video)
   mrb_define_method(mrb, class_Surface, "convert",            mrb_sdl2_video_surface_convert,            MRB_ARGS_REQ(1));
   mrb_define_method(mrb, class_Surface, "get_pixel",          mrb_sdl2_video_surface_get_pixel,          MRB_ARGS_REQ(2));
   mrb_define_method(mrb, class_Surface, "set_pixel",          mrb_sdl2_video_surface_set_pixel,          MRB_ARGS_REQ(3));
+  mrb_define_method(mrb, class_Surface, "view",               mrb_sdl2_video_surface_view,               MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Surface, "parent",             mrb_sdl2_video_surface_parent,             MRB_ARGS_NONE());
 
   arena_size = mrb_gc_arena_save(mrb);
   mrb_define_const(mrb, class_Surface, "SDL_BLENDMODE_NONE",  mrb_fixnum_value(SDL_BLENDMODE_NONE));
@@ -711,9 +814,18 @@ mruby_sdl2_video_surface_init(mrb_state *mrb, struct RClass *mod_Video)
   mrb_define_class_method(mrb, class_Surface, "save_bmp", mrb_sdl2_video_surface_save_bmp, MRB_ARGS_REQ(2));
   mrb_define_class_method(mrb, class_Surface, "map_rgba", mrb_sdl2_video_surface_map_rgba, MRB_ARGS_REQ(5));
   mrb_define_class_method(mrb, class_Surface, "map_rgb",  mrb_sdl2_video_surface_map_rgb,  MRB_ARGS_REQ(4));
+
+  mruby_sdl2_video_surface_filter_init(mrb, class_Surface);
+  mruby_sdl2_video_surface_compare_init(mrb, class_Surface);
+  mruby_sdl2_video_surface_convert_init(mrb, class_Surface);
+  mruby_sdl2_video_surface_quantize_init(mrb, class_Surface);
 }
 
 void
 mruby_sdl2_video_surface_final(mrb_state *mrb, struct RClass *mod_Video)
 {
+  mruby_sdl2_video_surface_quantize_final(mrb, class_Surface);
+  mruby_sdl2_video_surface_convert_final(mrb, class_Surface);
+  mruby_sdl2_video_surface_compare_final(mrb, class_Surface);
+  mruby_sdl2_video_surface_filter_final(mrb, class_Surface);
 }
@@ -0,0 +1,584 @@
+#include "sdl2_surface_cache.h"
+#include "sdl2_surface.h"
+#include <SDL2/SDL_rwops.h>
+#include <SDL2/SDL_pixels.h>
+#include "mruby/data.h"
+#include "mruby/class.h"
+#include "mruby/string.h"
+#include "mruby/variable.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MRB_SDL2_SURFACE_CACHE_USE_MMAP
+#endif
+
+/*
+ * Layout of a cache entry:
+ *   [header, zero padded to MRB_SDL2_SURFACE_CACHE_ALIGN bytes][pixels]
+ * The pixel block starts on a page boundary so that it can be mapped and
+ * handed to SDL_CreateRGBSurfaceFrom without being copied.
+ */
+#define MRB_SDL2_SURFACE_CACHE_MAGIC   "MSDL2SC\0"
+#define MRB_SDL2_SURFACE_CACHE_VERSION 1
+#define MRB_SDL2_SURFACE_CACHE_ALIGN   4096
+#define MRB_SDL2_SURFACE_CACHE_CHUNK   65536
+
+static struct RClass *class_SurfaceCache = NULL;
+static struct RClass *class_Mapping      = NULL;
+
+typedef struct mrb_sdl2_video_surface_cache_header_t {
+  char   magic[8];
+  Uint32 version;
+  Uint32 format;
+  Sint32 width;
+  Sint32 height;
+  Sint32 pitch;
+  Uint32 reserved;
+  Uint64 source_size;
+  Sint64 source_mtime;
+  Uint64 source_hash;
+  Uint64 data_offset;
+  Uint64 data_size;
+} mrb_sdl2_video_surface_cache_header_t;
+
+typedef struct mrb_sdl2_video_surface_cache_data_t {
+  char  *dir;
+  Uint32 format;
+} mrb_sdl2_video_surface_cache_data_t;
+
+typedef struct mrb_sdl2_video_surface_cache_mapping_data_t {
+  void  *address;
+  size_t size;
+  bool   is_mapped;
+} mrb_sdl2_video_surface_cache_mapping_data_t;
+
+static void
+mrb_sdl2_video_surface_cache_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_video_surface_cache_data_t *data =
+    (mrb_sdl2_video_surface_cache_data_t*)p;
+  if (NULL != data) {
+    if (NULL != data->dir) {
+      mrb_free(mrb, data->dir);
+    }
+    mrb_free(mrb, data);
+  }
+}
+
+static void
+mrb_sdl2_video_surface_cache_mapping_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_video_surface_cache_mapping_data_t *data =
+    (mrb_sdl2_video_surface_cache_mapping_data_t*)p;
+  if (NULL != data) {
+    if (NULL != data->address) {
+#ifdef MRB_SDL2_SURFACE_CACHE_USE_MMAP
+      if (data->is_mapped) {
+        munmap(data->address, data->size);
+      } else {
+        SDL_free(data->address);
+      }
+#else
+      SDL_free(data->address);
+#endif
+    }
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_video_surface_cache_data_type = {
+  "SurfaceCache", mrb_sdl2_video_surface_cache_data_free
+};
+
+static struct mrb_data_type const mrb_sdl2_video_surface_cache_mapping_data_type = {
+  "Mapping", mrb_sdl2_video_surface_cache_mapping_data_free
+};
+
+static mrb_sdl2_video_surface_cache_data_t *
+mrb_sdl2_video_surface_cache_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_cache_data_t *data =
+    (mrb_sdl2_video_surface_cache_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_video_surface_cache_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized surface cache.");
+  }
+  return data;
+}
+
+/* 64-bit FNV-1a over a byte range, continuing from 'hash'. */
+static Uint64
+mrb_sdl2_video_surface_cache_fnv1a(Uint64 hash, Uint8 const *p, size_t size)
+{
+  size_t i;
+  for (i = 0; i < size; ++i) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static bool
+mrb_sdl2_video_surface_cache_hash_file(char const *path, Uint64 *hash)
+{
+  Uint8 *chunk;
+  size_t n;
+  SDL_RWops *rw = SDL_RWFromFile(path, "rb");
+  if (NULL == rw) {
+    return false;
+  }
+  chunk = (Uint8*)SDL_malloc(MRB_SDL2_SURFACE_CACHE_CHUNK);
+  if (NULL == chunk) {
+    SDL_RWclose(rw);
+    return false;
+  }
+  *hash = 0xcbf29ce484222325ULL;
+  while (0 < (n = SDL_RWread(rw, chunk, 1, MRB_SDL2_SURFACE_CACHE_CHUNK))) {
+    *hash = mrb_sdl2_video_surface_cache_fnv1a(*hash, chunk, n);
+  }
+  SDL_free(chunk);
+  SDL_RWclose(rw);
+  return true;
+}
+
+/*
+ * Entries are named after a hash of the source path, the cache format and
+ * the entry layout version, so that assets with the same basename in
+ * different directories, caches of other formats sharing the directory
+ * and entries written by an older layout do not collide.
+ */
+static mrb_value
+mrb_sdl2_video_surface_cache_entry_path_of(mrb_state *mrb, mrb_sdl2_video_surface_cache_data_t *data, mrb_value path)
+{
+  char name[32];
+  size_t const len = strlen(data->dir);
+  Uint32 const key[2] = { data->format, MRB_SDL2_SURFACE_CACHE_VERSION };
+  Uint64 hash =
+    mrb_sdl2_video_surface_cache_fnv1a(0xcbf29ce484222325ULL, (Uint8 const*)RSTRING_PTR(path), RSTRING_LEN(path));
+  mrb_value entry = mrb_str_new(mrb, data->dir, len);
+  if ((0 < len) && ('/' != data->dir[len - 1]) && ('\\' != data->dir[len - 1])) {
+    mrb_str_cat(mrb, entry, "/", 1);
+  }
+  hash = mrb_sdl2_video_surface_cache_fnv1a(hash, (Uint8 const*)key, sizeof(key));
+  SDL_snprintf(name, sizeof(name), "%08x%08x.surf", (unsigned int)(hash >> 32), (unsigned int)(hash & 0xffffffffu));
+  mrb_str_cat(mrb, entry, name, strlen(name));
+  return entry;
+}
+
+static bool
+mrb_sdl2_video_surface_cache_stat(char const *path, Uint64 *size, Sint64 *mtime)
+{
+  struct stat st;
+  if (0 != stat(path, &st)) {
+    return false;
+  }
+  *size  = (Uint64)st.st_size;
+  *mtime = (Sint64)st.st_mtime;
+  return true;
+}
+
+static bool
+mrb_sdl2_video_surface_cache_read_header(char const *entry, mrb_sdl2_video_surface_cache_header_t *header)
+{
+  Sint64 size;
+  SDL_RWops *rw = SDL_RWFromFile(entry, "rb");
+  if (NULL == rw) {
+    return false;
+  }
+  size = SDL_RWsize(rw);
+  if (1 != SDL_RWread(rw, header, sizeof(*header), 1)) {
+    SDL_RWclose(rw);
+    return false;
+  }
+  SDL_RWclose(rw);
+  if (0 != memcmp(header->magic, MRB_SDL2_SURFACE_CACHE_MAGIC, sizeof(header->magic))) {
+    return false;
+  }
+  if (MRB_SDL2_SURFACE_CACHE_VERSION != header->version) {
+    return false;
+  }
+  if ((0 > size) || ((Uint64)size < header->data_offset + header->data_size)) {
+    return false;
+  }
+  if ((Uint64)header->pitch * (Uint64)header->height > header->data_size) {
+    return false;
+  }
+  return true;
+}
+
+static bool
+mrb_sdl2_video_surface_cache_write_header(char const *entry, mrb_sdl2_video_surface_cache_header_t const *header)
+{
+  size_t n;
+  SDL_RWops *rw = SDL_RWFromFile(entry, "r+b");
+  if (NULL == rw) {
+    return false;
+  }
+  n = SDL_RWwrite(rw, header, sizeof(*header), 1);
+  SDL_RWclose(rw);
+  return 1 == n;
+}
+
+/*
+ * Checks an entry against the current state of its source file. Size must
+ * match exactly; if only the modification time differs (e.g. the asset was
+ * touched or re-checked out) the content hash decides, and on a match the
+ * stored mtime is refreshed so the next startup takes the cheap path again.
+ */
+static bool
+mrb_sdl2_video_surface_cache_validate(mrb_sdl2_video_surface_cache_data_t *data, char const *source, char const *entry, bool verify, mrb_sdl2_video_surface_cache_header_t *header)
+{
+  Uint64 size, hash;
+  Sint64 mtime;
+  if (!mrb_sdl2_video_surface_cache_stat(source, &size, &mtime)) {
+    return false;
+  }
+  if (!mrb_sdl2_video_surface_cache_read_header(entry, header)) {
+    return false;
+  }
+  if ((header->format != data->format) || (header->source_size != size)) {
+    return false;
+  }
+  if ((header->source_mtime == mtime) && !verify) {
+    return true;
+  }
+  if (!mrb_sdl2_video_surface_cache_hash_file(source, &hash) || (header->source_hash != hash)) {
+    return false;
+  }
+  if (header->source_mtime != mtime) {
+    header->source_mtime = mtime;
+    mrb_sdl2_video_surface_cache_write_header(entry, header);
+  }
+  return true;
+}
+
+static bool
+mrb_sdl2_video_surface_cache_write_entry(char const *source, char const *entry, SDL_Surface *surface)
+{
+  mrb_sdl2_video_surface_cache_header_t header;
+  Uint8 zero[256];
+  char tmp[4096];
+  size_t remain;
+  bool ok = true;
+  SDL_RWops *rw;
+
+  SDL_memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MRB_SDL2_SURFACE_CACHE_MAGIC, sizeof(header.magic));
+  header.version     = MRB_SDL2_SURFACE_CACHE_VERSION;
+  header.format      = surface->format->format;
+  header.width       = surface->w;
+  header.height      = surface->h;
+  header.pitch       = surface->pitch;
+  header.data_offset = MRB_SDL2_SURFACE_CACHE_ALIGN;
+  header.data_size   = (Uint64)surface->pitch * (Uint64)surface->h;
+  if (!mrb_sdl2_video_surface_cache_stat(source, &header.source_size, &header.source_mtime)) {
+    return false;
+  }
+  if (!mrb_sdl2_video_surface_cache_hash_file(source, &header.source_hash)) {
+    return false;
+  }
+
+  /* write to a temporary file first so a crash never leaves a torn entry. */
+  SDL_snprintf(tmp, sizeof(tmp), "%s.tmp", entry);
+  rw = SDL_RWFromFile(tmp, "wb");
+  if (NULL == rw) {
+    return false;
+  }
+  SDL_memset(zero, 0, sizeof(zero));
+  if (1 != SDL_RWwrite(rw, &header, sizeof(header), 1)) {
+    ok = false;
+  }
+  remain = MRB_SDL2_SURFACE_CACHE_ALIGN - sizeof(header);
+  while (ok && (0 < remain)) {
+    size_t const n = SDL_min(remain, sizeof(zero));
+    if (1 != SDL_RWwrite(rw, zero, n, 1)) {
+      ok = false;
+    }
+    remain -= n;
+  }
+  if (ok && (0 < header.data_size)) {
+    if (SDL_MUSTLOCK(surface)) {
+      SDL_LockSurface(surface);
+    }
+    if (1 != SDL_RWwrite(rw, surface->pixels, (size_t)header.data_size, 1)) {
+      ok = false;
+    }
+    if (SDL_MUSTLOCK(surface)) {
+      SDL_UnlockSurface(surface);
+    }
+  }
+  if (0 != SDL_RWclose(rw)) {
+    ok = false;
+  }
+  if (ok) {
+    remove(entry);
+    ok = (0 == rename(tmp, entry));
+  }
+  if (!ok) {
+    remove(tmp);
+  }
+  return ok;
+}
+
+/*
+ * Maps the whole entry. Pages are mapped private and writable, so pixels
+ * can be modified through the surface without touching the file on disk.
+ * Platforms without mmap fall back to reading the entry into memory.
+ */
+static bool
+mrb_sdl2_video_surface_cache_map(char const *entry, mrb_sdl2_video_surface_cache_header_t const *header, mrb_sdl2_video_surface_cache_mapping_data_t *mapping)
+{
+  size_t const size = (size_t)(header->data_offset + header->data_size);
+  SDL_RWops *rw;
+#ifdef MRB_SDL2_SURFACE_CACHE_USE_MMAP
+  int const fd = open(entry, O_RDONLY);
+  if (0 <= fd) {
+    void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED != address) {
+      mapping->address   = address;
+      mapping->size      = size;
+      mapping->is_mapped = true;
+      return true;
+    }
+  }
+#endif
+  rw = SDL_RWFromFile(entry, "rb");
+  if (NULL == rw) {
+    return false;
+  }
+  mapping->address = SDL_malloc(size);
+  if (NULL == mapping->address) {
+    SDL_RWclose(rw);
+    return false;
+  }
+  if (1 != SDL_RWread(rw, mapping->address, size, 1)) {
+    SDL_free(mapping->address);
+    mapping->address = NULL;
+    SDL_RWclose(rw);
+    return false;
+  }
+  SDL_RWclose(rw);
+  mapping->size      = size;
+  mapping->is_mapped = false;
+  return true;
+}
+
+static mrb_value
+mrb_sdl2_video_surface_cache_open(mrb_state *mrb, char const *entry, mrb_sdl2_video_surface_cache_header_t const *header)
+{
+  mrb_sdl2_video_surface_cache_mapping_data_t *mapping;
+  mrb_value mapping_value, surface_value;
+  SDL_Surface *surface;
+  Uint32 rmask, gmask, bmask, amask;
+  int bpp;
+
+  if (!SDL_PixelFormatEnumToMasks(header->format, &bpp, &rmask, &gmask, &bmask, &amask)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  mapping =
+    (mrb_sdl2_video_surface_cache_mapping_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_video_surface_cache_mapping_data_t));
+  if (NULL == mapping) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  mapping->address   = NULL;
+  mapping->size      = 0;
+  mapping->is_mapped = false;
+  /* wrap first so the mapping is released even if a raise follows. */
+  mapping_value = mrb_obj_value(Data_Wrap_Struct(mrb, class_Mapping, &mrb_sdl2_video_surface_cache_mapping_data_type, mapping));
+  if (!mrb_sdl2_video_surface_cache_map(entry, header, mapping)) {
+    return mrb_nil_value();
+  }
+  surface = SDL_CreateRGBSurfaceFrom((Uint8*)mapping->address + header->data_offset,
+                                     header->width, header->height, bpp, header->pitch,
+                                     rmask, gmask, bmask, amask);
+  if (NULL == surface) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  surface_value = mrb_sdl2_video_surface(mrb, surface, false);
+  /* the surface borrows the mapped pixels; keep the mapping alive with it. */
+  mrb_iv_set(mrb, surface_value, mrb_intern_lit(mrb, "__mapping__"), mapping_value);
+  return surface_value;
+}
+
+/*
+ * SDL2::Video::SurfaceCache#initialize(dir, format)
+ */
+static mrb_value
+mrb_sdl2_video_surface_cache_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_value dir;
+  mrb_int format;
+  mrb_sdl2_video_surface_cache_data_t *data =
+    (mrb_sdl2_video_surface_cache_data_t*)DATA_PTR(self);
+  mrb_get_args(mrb, "Si", &dir, &format);
+  if (SDL_ISPIXELFORMAT_FOURCC((Uint32)format) || SDL_ISPIXELFORMAT_INDEXED((Uint32)format)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported pixel format.");
+  }
+  if (NULL == data) {
+    data = (mrb_sdl2_video_surface_cache_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_video_surface_cache_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+    data->dir = NULL;
+  } else if (NULL != data->dir) {
+    mrb_free(mrb, data->dir);
+    data->dir = NULL;
+  }
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_video_surface_cache_data_type;
+  data->format = (Uint32)format;
+  data->dir = (char*)mrb_malloc(mrb, RSTRING_LEN(dir) + 1);
+  memcpy(data->dir, RSTRING_PTR(dir), RSTRING_LEN(dir));
+  data->dir[RSTRING_LEN(dir)] = '\0';
+  return self;
+}
+
+/*
+ * SDL2::Video::SurfaceCache#load(path, verify = false) { |path| surface }
+ *
+ * Returns a surface in the cache format whose pixels live in the mapped
+ * entry. On a miss the block (or Surface.load_bmp when no block is given)
+ * decodes the source, the result is converted and stored, then mapped.
+ */
+static mrb_value
+mrb_sdl2_video_surface_cache_load(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_cache_data_t *data = mrb_sdl2_video_surface_cache_get_ptr(mrb, self);
+  mrb_sdl2_video_surface_cache_header_t header;
+  mrb_value path, entry, block, result, converted_value;
+  mrb_bool verify = false;
+  SDL_Surface *source = NULL;
+  SDL_Surface *converted;
+  bool written;
+
+  mrb_get_args(mrb, "S|b&", &path, &verify, &block);
+  entry = mrb_sdl2_video_surface_cache_entry_path_of(mrb, data, path);
+
+  if (mrb_sdl2_video_surface_cache_validate(data, RSTRING_PTR(path), RSTRING_PTR(entry), verify, &header)) {
+    result = mrb_sdl2_video_surface_cache_open(mrb, RSTRING_PTR(entry), &header);
+    if (!mrb_nil_p(result)) {
+      return result;
+    }
+  }
+
+  if (mrb_nil_p(block)) {
+    source = SDL_LoadBMP(RSTRING_PTR(path));
+    if (NULL == source) {
+      mruby_sdl2_raise_error(mrb);
+    }
+  } else {
+    source = mrb_sdl2_video_surface_get_ptr(mrb, mrb_yield(mrb, block, path));
+    if (NULL == source) {
+      mrb_raise(mrb, E_TYPE_ERROR, "block must return a surface.");
+    }
+  }
+  converted = SDL_ConvertSurfaceFormat(source, data->format, 0);
+  if (mrb_nil_p(block)) {
+    SDL_FreeSurface(source);
+  }
+  if (NULL == converted) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  /* wrap first so the converted surface is released even if a raise follows. */
+  converted_value = mrb_sdl2_video_surface(mrb, converted, false);
+  written = mrb_sdl2_video_surface_cache_write_entry(RSTRING_PTR(path), RSTRING_PTR(entry), converted);
+  if (written && mrb_sdl2_video_surface_cache_read_header(RSTRING_PTR(entry), &header)) {
+    result = mrb_sdl2_video_surface_cache_open(mrb, RSTRING_PTR(entry), &header);
+    if (!mrb_nil_p(result)) {
+      mrb_funcall(mrb, converted_value, "destroy", 0);
+      return result;
+    }
+  }
+  /* the cache directory is not writable; hand out the converted surface. */
+  return converted_value;
+}
+
+/*
+ * SDL2::Video::SurfaceCache#valid?(path, verify = false)
+ */
+static mrb_value
+mrb_sdl2_video_surface_cache_valid(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_cache_data_t *data = mrb_sdl2_video_surface_cache_get_ptr(mrb, self);
+  mrb_sdl2_video_surface_cache_header_t header;
+  mrb_value path, entry;
+  mrb_bool verify = false;
+  mrb_get_args(mrb, "S|b", &path, &verify);
+  entry = mrb_sdl2_video_surface_cache_entry_path_of(mrb, data, path);
+  return mrb_bool_value(mrb_sdl2_video_surface_cache_validate(data, RSTRING_PTR(path), RSTRING_PTR(entry), verify, &header));
+}
+
+/*
+ * SDL2::Video::SurfaceCache#invalidate(path)
+ */
+static mrb_value
+mrb_sdl2_video_surface_cache_invalidate(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_cache_data_t *data = mrb_sdl2_video_surface_cache_get_ptr(mrb, self);
+  mrb_value path, entry;
+  mrb_get_args(mrb, "S", &path);
+  entry = mrb_sdl2_video_surface_cache_entry_path_of(mrb, data, path);
+  return mrb_bool_value(0 == remove(RSTRING_PTR(entry)));
+}
+
+/*
+ * SDL2::Video::SurfaceCache#entry_path(path)
+ */
+static mrb_value
+mrb_sdl2_video_surface_cache_entry_path(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_cache_data_t *data = mrb_sdl2_video_surface_cache_get_ptr(mrb, self);
+  mrb_value path;
+  mrb_get_args(mrb, "S", &path);
+  return mrb_sdl2_video_surface_cache_entry_path_of(mrb, data, path);
+}
+
+static mrb_value
+mrb_sdl2_video_surface_cache_get_format(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_video_surface_cache_get_ptr(mrb, self)->format);
+}
+
+static mrb_value
+mrb_sdl2_video_surface_cache_get_dir(mrb_state *mrb, mrb_value self)
+{
+  return mrb_str_new_cstr(mrb, mrb_sdl2_video_surface_cache_get_ptr(mrb, self)->dir);
+}
+
+static mrb_value
+mrb_sdl2_video_surface_cache_mapping_mapped(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_cache_mapping_data_t *data =
+    (mrb_sdl2_video_surface_cache_mapping_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_video_surface_cache_mapping_data_type);
+  return mrb_bool_value((NULL != data) && data->is_mapped);
+}
+
+void
+mruby_sdl2_video_surface_cache_init(mrb_state *mrb, struct RClass *mod_Video)
+{
+  class_SurfaceCache = mrb_define_class_under(mrb, mod_Video, "SurfaceCache", mrb->object_class);
+  class_Mapping      = mrb_define_class_under(mrb, class_SurfaceCache, "Mapping", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_SurfaceCache, MRB_TT_DATA);
+  MRB_SET_INSTANCE_TT(class_Mapping,      MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_SurfaceCache, "initialize", mrb_sdl2_video_surface_cache_initialize, MRB_ARGS_REQ(2));
+  mrb_define_method(mrb, class_SurfaceCache, "load",       mrb_sdl2_video_surface_cache_load,       MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1) | MRB_ARGS_BLOCK());
+  mrb_define_method(mrb, class_SurfaceCache, "valid?",     mrb_sdl2_video_surface_cache_valid,      MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_SurfaceCache, "invalidate", mrb_sdl2_video_surface_cache_invalidate, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SurfaceCache, "entry_path", mrb_sdl2_video_surface_cache_entry_path, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_SurfaceCache, "format",     mrb_sdl2_video_surface_cache_get_format, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_SurfaceCache, "dir",        mrb_sdl2_video_surface_cache_get_dir,    MRB_ARGS_NONE());
+
+  mrb_define_method(mrb, class_Mapping, "mapped?", mrb_sdl2_video_surface_cache_mapping_mapped, MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_video_surface_cache_final(mrb_state *mrb, struct RClass *mod_Video)
+{
+}
@@ -0,0 +1,319 @@
+#include "sdl2_surface_compare.h"
+#include "sdl2_surface.h"
+#include "sdl2_surface_filter.h"
+#include "sdl2_rect.h"
+#include "mruby/array.h"
+#include "mruby/string.h"
+
+#define MRB_SDL2_DIFF_DEFAULT_TILE 32
+
+/*
+ * Comparing is memory bound and cheap per pixel, so a band has to cover
+ * this many pixels before a thread pays for its creation. Frames up to
+ * 2560x1440 are compared on the calling thread; 4K splits in two.
+ */
+#define MRB_SDL2_DIFF_MIN_BAND_PIXELS (1 << 22)
+
+/***************************************************************************
+*
+* hashing
+*
+***************************************************************************/
+
+#define MRB_SDL2_HASH_K1 0x9e3779b185ebca87ULL
+#define MRB_SDL2_HASH_K2 0xc2b2ae3d27d4eb4fULL
+
+static inline Uint64
+mrb_sdl2_video_surface_hash_mix(Uint64 h, Uint64 v)
+{
+  v *= MRB_SDL2_HASH_K2;
+  v  = (v << 31) | (v >> 33);
+  v *= MRB_SDL2_HASH_K1;
+  h ^= v;
+  h  = (h << 27) | (h >> 37);
+  return h * 5 + 0x52dce729;
+}
+
+/*
+ * Hashes the visible bytes of every row (pitch padding is skipped) eight
+ * bytes at a time, together with the size and pixel format.
+ */
+Uint64
+mrb_sdl2_video_surface_hash64(SDL_Surface *surface, Uint64 seed)
+{
+  size_t const row_size = (size_t)surface->w * surface->format->BytesPerPixel;
+  Uint64 h = seed ^ MRB_SDL2_HASH_K1;
+  int y;
+  h = mrb_sdl2_video_surface_hash_mix(h, ((Uint64)surface->w << 32) | (Uint32)surface->h);
+  h = mrb_sdl2_video_surface_hash_mix(h, surface->format->format);
+  if (SDL_MUSTLOCK(surface)) {
+    SDL_LockSurface(surface);
+  }
+  for (y = 0; y < surface->h; ++y) {
+    Uint8 const *p = (Uint8 const*)surface->pixels + y * surface->pitch;
+    Uint64 tail = 0;
+    size_t i;
+    for (i = 0; i + 8 <= row_size; i += 8) {
+      Uint64 v;
+      SDL_memcpy(&v, p + i, 8);
+      h = mrb_sdl2_video_surface_hash_mix(h, v);
+    }
+    if (i < row_size) {
+      SDL_memcpy(&tail, p + i, row_size - i);
+      h = mrb_sdl2_video_surface_hash_mix(h, tail ^ (Uint64)(row_size - i));
+    }
+  }
+  if (SDL_MUSTLOCK(surface)) {
+    SDL_UnlockSurface(surface);
+  }
+  h ^= h >> 33;
+  h *= MRB_SDL2_HASH_K2;
+  h ^= h >> 29;
+  return h;
+}
+
+/***************************************************************************
+*
+* diff
+*
+***************************************************************************/
+
+typedef struct mrb_sdl2_video_surface_diff_t {
+  SDL_Surface const *a;
+  SDL_Surface const *b;
+  int     tolerance;
+  int     tile;
+  int     tiles_x;
+  Uint8  *dirty;      /* tiles_x * tiles_y flags */
+  Uint32 *counts;     /* per tile row */
+  Uint8  *max_delta;  /* per tile row */
+} mrb_sdl2_video_surface_diff_t;
+
+/*
+ * Compares one segment of a row. The per-byte delta loop has no branches
+ * so it vectorizes; pixels only need a second look when the segment is
+ * over tolerance.
+ */
+static Uint32
+mrb_sdl2_video_surface_diff_segment(Uint8 const *pa, Uint8 const *pb, int pixels, int bpp, int tolerance, Uint8 *max_delta)
+{
+  int const n = pixels * bpp;
+  Uint8 m = 0;
+  Uint32 count = 0;
+  int i, c;
+  if (0 == SDL_memcmp(pa, pb, n)) {
+    return 0;
+  }
+  for (i = 0; i < n; ++i) {
+    int const d = (pa[i] > pb[i]) ? (pa[i] - pb[i]) : (pb[i] - pa[i]);
+    m = (Uint8)((d > m) ? d : m);
+  }
+  if (m > *max_delta) {
+    *max_delta = m;
+  }
+  if (m <= tolerance) {
+    return 0;
+  }
+  for (i = 0; i < pixels; ++i) {
+    for (c = 0; c < bpp; ++c) {
+      int const d = pa[i * bpp + c] - pb[i * bpp + c];
+      if ((d > tolerance) || (-d > tolerance)) {
+        ++count;
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+static void
+mrb_sdl2_video_surface_diff_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_surface_diff_t *df = (mrb_sdl2_video_surface_diff_t*)p;
+  int const bpp = df->a->format->BytesPerPixel;
+  int ty, tx, y;
+  for (ty = begin; ty < end; ++ty) {
+    int const y0 = ty * df->tile;
+    int const y1 = SDL_min(y0 + df->tile, df->a->h);
+    for (y = y0; y < y1; ++y) {
+      Uint8 const *ra = (Uint8 const*)df->a->pixels + y * df->a->pitch;
+      Uint8 const *rb = (Uint8 const*)df->b->pixels + y * df->b->pitch;
+      for (tx = 0; tx < df->tiles_x; ++tx) {
+        int const x0 = tx * df->tile;
+        int const w  = SDL_min(df->tile, df->a->w - x0);
+        Uint32 const n =
+          mrb_sdl2_video_surface_diff_segment(ra + x0 * bpp, rb + x0 * bpp, w, bpp, df->tolerance, &df->max_delta[ty]);
+        if (0 < n) {
+          df->counts[ty] += n;
+          df->dirty[ty * df->tiles_x + tx] = 1;
+        }
+      }
+    }
+  }
+}
+
+/*
+ * Merges dirty tiles into rects: runs of dirty tiles in a tile row become
+ * one rect, and a run is extended downwards while the row below has the
+ * exact same run.
+ */
+static mrb_value
+mrb_sdl2_video_surface_diff_rects(mrb_state *mrb, mrb_sdl2_video_surface_diff_t *df, int tiles_y)
+{
+  mrb_value rects = mrb_ary_new(mrb);
+  int ty, tx, k;
+  for (ty = 0; ty < tiles_y; ++ty) {
+    for (tx = 0; tx < df->tiles_x; ) {
+      int run, rows;
+      if (1 != df->dirty[ty * df->tiles_x + tx]) {
+        ++tx;
+        continue;
+      }
+      for (run = 1; (tx + run < df->tiles_x) && (1 == df->dirty[ty * df->tiles_x + tx + run]); ++run)
+        ;
+      for (rows = 1; ty + rows < tiles_y; ++rows) {
+        Uint8 const *below = df->dirty + (ty + rows) * df->tiles_x;
+        bool same = ((0 == tx) || (1 != below[tx - 1])) &&
+                    ((tx + run == df->tiles_x) || (1 != below[tx + run]));
+        for (k = 0; same && (k < run); ++k) {
+          same = (1 == below[tx + k]);
+        }
+        if (!same) {
+          break;
+        }
+        for (k = 0; k < run; ++k) {
+          df->dirty[(ty + rows) * df->tiles_x + tx + k] = 2;
+        }
+      }
+      {
+        int const x = tx * df->tile;
+        int const y = ty * df->tile;
+        int const w = SDL_min(run * df->tile, df->a->w - x);
+        int const h = SDL_min(rows * df->tile, df->a->h - y);
+        int const arena = mrb_gc_arena_save(mrb);
+        mrb_ary_push(mrb, rects, mrb_sdl2_rect(mrb, x, y, w, h));
+        mrb_gc_arena_restore(mrb, arena);
+      }
+      tx += run;
+    }
+  }
+  return rects;
+}
+
+/***************************************************************************
+*
+* class SDL2::Video::Surface (compare)
+*
+***************************************************************************/
+
+/*
+ * SDL2::Video::Surface#diff(other, tolerance = 0, tile = 32)
+ *
+ * Returns [count, max_delta, rects]: the number of pixels where any byte
+ * differs by more than 'tolerance', the largest byte delta seen, and an
+ * Array of Rects covering the changed tiles. The rects can be passed
+ * straight to Window#update_surface_rects.
+ */
+static mrb_value
+mrb_sdl2_video_surface_diff(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_diff_t df;
+  mrb_value other, result[3];
+  mrb_int tolerance = 0, tile = MRB_SDL2_DIFF_DEFAULT_TILE;
+  SDL_Surface *a, *b;
+  Uint32 count = 0;
+  Uint8 max_delta = 0;
+  int tiles_y, grain, i;
+
+  mrb_get_args(mrb, "o|ii", &other, &tolerance, &tile);
+  a = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  b = mrb_sdl2_video_surface_get_ptr(mrb, other);
+  if ((NULL == a) || (NULL == b)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  if ((a->w != b->w) || (a->h != b->h) || (a->format->format != b->format->format)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surfaces differ in size or pixel format.");
+  }
+  if (0 >= tile) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "tile size must be positive.");
+  }
+  if (0 > tolerance) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "tolerance must not be negative.");
+  }
+
+  df.a         = a;
+  df.b         = b;
+  df.tolerance = (int)SDL_min(tolerance, 255);
+  df.tile      = (int)SDL_min(tile, SDL_max(SDL_max(a->w, a->h), 1));
+  df.tiles_x   = (a->w + df.tile - 1) / df.tile;
+  tiles_y      = (a->h + df.tile - 1) / df.tile;
+  df.dirty     = (Uint8*)mrb_malloc(mrb, (size_t)df.tiles_x * tiles_y + 1);
+  df.counts    = (Uint32*)mrb_malloc(mrb, sizeof(Uint32) * tiles_y + 1);
+  df.max_delta = (Uint8*)mrb_malloc(mrb, (size_t)tiles_y + 1);
+  SDL_memset(df.dirty, 0, (size_t)df.tiles_x * tiles_y);
+  SDL_memset(df.counts, 0, sizeof(Uint32) * tiles_y);
+  SDL_memset(df.max_delta, 0, (size_t)tiles_y);
+
+  if (SDL_MUSTLOCK(a)) {
+    SDL_LockSurface(a);
+  }
+  if ((a != b) && SDL_MUSTLOCK(b)) {
+    SDL_LockSurface(b);
+  }
+  grain = (int)SDL_min((Sint64)tiles_y, (MRB_SDL2_DIFF_MIN_BAND_PIXELS + (Sint64)df.tile * SDL_max(a->w, 1) - 1) / ((Sint64)df.tile * SDL_max(a->w, 1)));
+  mrb_sdl2_video_surface_parallel_for(tiles_y, grain, mrb_sdl2_video_surface_diff_band, &df);
+  if ((a != b) && SDL_MUSTLOCK(b)) {
+    SDL_UnlockSurface(b);
+  }
+  if (SDL_MUSTLOCK(a)) {
+    SDL_UnlockSurface(a);
+  }
+
+  for (i = 0; i < tiles_y; ++i) {
+    count += df.counts[i];
+    max_delta = SDL_max(max_delta, df.max_delta[i]);
+  }
+  result[0] = mrb_fixnum_value(count);
+  result[1] = mrb_fixnum_value(max_delta);
+  result[2] = mrb_sdl2_video_surface_diff_rects(mrb, &df, tiles_y);
+
+  mrb_free(mrb, df.max_delta);
+  mrb_free(mrb, df.counts);
+  mrb_free(mrb, df.dirty);
+  return mrb_ary_new_from_values(mrb, 3, result);
+}
+
+/*
+ * SDL2::Video::Surface#hash64(seed = 0)
+ *
+ * Returns the 64-bit content hash as a 16 digit hex String, which is safe
+ * regardless of the width of mrb_int.
+ */
+static mrb_value
+mrb_sdl2_video_surface_hash64_method(mrb_state *mrb, mrb_value self)
+{
+  char buf[17];
+  mrb_int seed = 0;
+  Uint64 h;
+  SDL_Surface *s;
+  mrb_get_args(mrb, "|i", &seed);
+  s = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  if (NULL == s) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  h = mrb_sdl2_video_surface_hash64(s, (Uint64)seed);
+  SDL_snprintf(buf, sizeof(buf), "%08x%08x", (unsigned int)(h >> 32), (unsigned int)(h & 0xffffffffu));
+  return mrb_str_new(mrb, buf, 16);
+}
+
+void
+mruby_sdl2_video_surface_compare_init(mrb_state *mrb, struct RClass *class_Surface)
+{
+  mrb_define_method(mrb, class_Surface, "diff",   mrb_sdl2_video_surface_diff,          MRB_ARGS_REQ(1) | MRB_ARGS_OPT(2));
+  mrb_define_method(mrb, class_Surface, "hash64", mrb_sdl2_video_surface_hash64_method, MRB_ARGS_OPT(1));
+}
+
+void
+mruby_sdl2_video_surface_compare_final(mrb_state *mrb, struct RClass *class_Surface)
+{
+}
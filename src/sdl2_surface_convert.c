@@ -0,0 +1,444 @@
+#include "sdl2_surface_convert.h"
+#include "sdl2_surface.h"
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_endian.h>
+
+#define MRB_SDL2_CONVERT_CACHE_SIZE 16
+
+/***************************************************************************
+*
+* conversion plans
+*
+***************************************************************************/
+
+struct mrb_sdl2_video_convert_plan_t;
+
+typedef void (*mrb_sdl2_video_convert_row_t)(struct mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut);
+
+/*
+ * What SDL keeps in a blit map, for one (source, destination) format
+ * pair: the row kernel and, for the generic kernel, the channel layout of
+ * both formats plus tables expanding source channels to 8 bits. A NULL
+ * 'row' records a pair that is left to SDL_ConvertSurface.
+ */
+typedef struct mrb_sdl2_video_convert_plan_t {
+  Uint32 src_format;
+  Uint32 dst_format;
+  mrb_sdl2_video_convert_row_t row;
+  int    src_bpp;
+  int    dst_bpp;
+  Uint32 src_mask[4];
+  Uint8  src_shift[4];
+  Uint8  dst_loss[4];
+  Uint8  dst_shift[4];
+  Uint8  expand[4][256];
+} mrb_sdl2_video_convert_plan_t;
+
+static mrb_sdl2_video_convert_plan_t mrb_sdl2_video_convert_cache[MRB_SDL2_CONVERT_CACHE_SIZE];
+static int mrb_sdl2_video_convert_cache_count = 0;
+static int mrb_sdl2_video_convert_cache_next = 0;
+static SDL_SpinLock mrb_sdl2_video_convert_cache_lock = 0;
+
+static inline Uint32
+mrb_sdl2_video_convert_read(Uint8 const *p, int bpp)
+{
+  switch (bpp) {
+  case 1:
+    return *p;
+  case 2:
+    return *(Uint16 const*)p;
+  case 3:
+    if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+      return ((Uint32)p[0] << 16) | ((Uint32)p[1] << 8) | p[2];
+    }
+    return p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16);
+  default:
+    return *(Uint32 const*)p;
+  }
+}
+
+static inline void
+mrb_sdl2_video_convert_write(Uint8 *p, int bpp, Uint32 v)
+{
+  switch (bpp) {
+  case 1:
+    *p = (Uint8)v;
+    break;
+  case 2:
+    *(Uint16*)p = (Uint16)v;
+    break;
+  case 3:
+    if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+      p[0] = (Uint8)(v >> 16);
+      p[1] = (Uint8)(v >> 8);
+      p[2] = (Uint8)v;
+    } else {
+      p[0] = (Uint8)v;
+      p[1] = (Uint8)(v >> 8);
+      p[2] = (Uint8)(v >> 16);
+    }
+    break;
+  default:
+    *(Uint32*)p = v;
+    break;
+  }
+}
+
+static void
+mrb_sdl2_video_convert_copy(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  SDL_memcpy(dst, src, (size_t)width * plan->src_bpp);
+}
+
+static void
+mrb_sdl2_video_convert_rgb24_to_argb8888(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  Uint32 *d = (Uint32*)dst;
+  int x;
+  for (x = 0; x < width; ++x, src += 3) {
+    d[x] = 0xff000000u | ((Uint32)src[0] << 16) | ((Uint32)src[1] << 8) | src[2];
+  }
+}
+
+static void
+mrb_sdl2_video_convert_bgr24_to_argb8888(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  Uint32 *d = (Uint32*)dst;
+  int x;
+  for (x = 0; x < width; ++x, src += 3) {
+    d[x] = 0xff000000u | ((Uint32)src[2] << 16) | ((Uint32)src[1] << 8) | src[0];
+  }
+}
+
+static void
+mrb_sdl2_video_convert_rgb888_to_argb8888(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  Uint32 const *s = (Uint32 const*)src;
+  Uint32 *d = (Uint32*)dst;
+  int x;
+  for (x = 0; x < width; ++x) {
+    d[x] = s[x] | 0xff000000u;
+  }
+}
+
+/* ABGR8888 <-> ARGB8888: swaps the first and third channels. */
+static void
+mrb_sdl2_video_convert_swap_rb(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  Uint32 const *s = (Uint32 const*)src;
+  Uint32 *d = (Uint32*)dst;
+  int x;
+  for (x = 0; x < width; ++x) {
+    Uint32 const p = s[x];
+    d[x] = (p & 0xff00ff00u) | ((p & 0xffu) << 16) | ((p >> 16) & 0xffu);
+  }
+}
+
+static void
+mrb_sdl2_video_convert_index8_to_32(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  Uint32 *d = (Uint32*)dst;
+  int x;
+  for (x = 0; x < width; ++x) {
+    d[x] = lut[src[x]];
+  }
+}
+
+static void
+mrb_sdl2_video_convert_index8(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  int x;
+  for (x = 0; x < width; ++x, dst += plan->dst_bpp) {
+    mrb_sdl2_video_convert_write(dst, plan->dst_bpp, lut[src[x]]);
+  }
+}
+
+/*
+ * Any packed format to any packed format. Missing source channels expand
+ * to 0 (alpha to 255) and missing destination channels have a loss of 8,
+ * so no channel needs a branch.
+ */
+static void
+mrb_sdl2_video_convert_generic(mrb_sdl2_video_convert_plan_t const *plan, Uint8 const *src, Uint8 *dst, int width, Uint32 const *lut)
+{
+  int x, c;
+  for (x = 0; x < width; ++x, src += plan->src_bpp, dst += plan->dst_bpp) {
+    Uint32 const p = mrb_sdl2_video_convert_read(src, plan->src_bpp);
+    Uint32 out = 0;
+    for (c = 0; c < 4; ++c) {
+      Uint32 const v = plan->expand[c][(p & plan->src_mask[c]) >> plan->src_shift[c]];
+      out |= (v >> plan->dst_loss[c]) << plan->dst_shift[c];
+    }
+    mrb_sdl2_video_convert_write(dst, plan->dst_bpp, out);
+  }
+}
+
+static void
+mrb_sdl2_video_convert_expand_table(Uint8 *table, Uint32 mask, Uint8 loss, Uint8 fill)
+{
+  int const bits = 8 - loss;
+  int v, max;
+  if ((0 == mask) || (0 >= bits)) {
+    SDL_memset(table, fill, 256);
+    return;
+  }
+  max = (1 << bits) - 1;
+  for (v = 0; v <= max; ++v) {
+    table[v] = (Uint8)((v * 255 + max / 2) / max);
+  }
+}
+
+static void
+mrb_sdl2_video_convert_plan_build(mrb_sdl2_video_convert_plan_t *plan, SDL_PixelFormat const *sf, SDL_PixelFormat const *df)
+{
+  Uint32 const s = sf->format;
+  Uint32 const d = df->format;
+  SDL_memset(plan, 0, sizeof(*plan));
+  plan->src_format = s;
+  plan->dst_format = d;
+  plan->src_bpp    = sf->BytesPerPixel;
+  plan->dst_bpp    = df->BytesPerPixel;
+
+  if (SDL_ISPIXELFORMAT_FOURCC(s) || SDL_ISPIXELFORMAT_FOURCC(d) || (NULL != df->palette)) {
+    return;
+  }
+  if (NULL != sf->palette) {
+    if (SDL_PIXELFORMAT_INDEX8 == s) {
+      plan->row = (4 == plan->dst_bpp) ? mrb_sdl2_video_convert_index8_to_32 : mrb_sdl2_video_convert_index8;
+    }
+    return;
+  }
+  if (s == d) {
+    plan->row = mrb_sdl2_video_convert_copy;
+  } else if ((SDL_PIXELFORMAT_RGB24 == s) && (SDL_PIXELFORMAT_ARGB8888 == d)) {
+    plan->row = mrb_sdl2_video_convert_rgb24_to_argb8888;
+  } else if ((SDL_PIXELFORMAT_BGR24 == s) && (SDL_PIXELFORMAT_ARGB8888 == d)) {
+    plan->row = mrb_sdl2_video_convert_bgr24_to_argb8888;
+  } else if ((SDL_PIXELFORMAT_RGB888 == s) && (SDL_PIXELFORMAT_ARGB8888 == d)) {
+    plan->row = mrb_sdl2_video_convert_rgb888_to_argb8888;
+  } else if (((SDL_PIXELFORMAT_ABGR8888 == s) && (SDL_PIXELFORMAT_ARGB8888 == d)) ||
+             ((SDL_PIXELFORMAT_ARGB8888 == s) && (SDL_PIXELFORMAT_ABGR8888 == d))) {
+    plan->row = mrb_sdl2_video_convert_swap_rb;
+  } else if ((8 <= sf->BitsPerPixel) && (8 <= df->BitsPerPixel) &&
+             (SDL_PIXELFORMAT_ARGB2101010 != s) && (SDL_PIXELFORMAT_ARGB2101010 != d)) {
+    /* channels wider than 8 bits (ARGB2101010) are left to SDL */
+    Uint32 const src_mask[4]  = {sf->Rmask,  sf->Gmask,  sf->Bmask,  sf->Amask};
+    Uint8 const  src_shift[4] = {sf->Rshift, sf->Gshift, sf->Bshift, sf->Ashift};
+    Uint8 const  src_loss[4]  = {sf->Rloss,  sf->Gloss,  sf->Bloss,  sf->Aloss};
+    Uint8 const  dst_shift[4] = {df->Rshift, df->Gshift, df->Bshift, df->Ashift};
+    Uint8 const  dst_loss[4]  = {df->Rloss,  df->Gloss,  df->Bloss,  df->Aloss};
+    int c;
+    for (c = 0; c < 4; ++c) {
+      plan->src_mask[c]  = src_mask[c];
+      plan->src_shift[c] = src_shift[c];
+      plan->dst_shift[c] = dst_shift[c];
+      plan->dst_loss[c]  = dst_loss[c];
+      mrb_sdl2_video_convert_expand_table(plan->expand[c], src_mask[c], src_loss[c], (3 == c) ? 0xff : 0);
+    }
+    plan->row = mrb_sdl2_video_convert_generic;
+  }
+}
+
+/*
+ * Copies the cached plan for the pair into 'plan', building and caching it
+ * on a miss. Returns false when the pair is left to SDL.
+ */
+static bool
+mrb_sdl2_video_convert_plan_get(SDL_PixelFormat const *sf, SDL_PixelFormat const *df, mrb_sdl2_video_convert_plan_t *plan)
+{
+  int i;
+  SDL_AtomicLock(&mrb_sdl2_video_convert_cache_lock);
+  for (i = 0; i < mrb_sdl2_video_convert_cache_count; ++i) {
+    if ((mrb_sdl2_video_convert_cache[i].src_format == sf->format) &&
+        (mrb_sdl2_video_convert_cache[i].dst_format == df->format)) {
+      *plan = mrb_sdl2_video_convert_cache[i];
+      SDL_AtomicUnlock(&mrb_sdl2_video_convert_cache_lock);
+      return NULL != plan->row;
+    }
+  }
+  SDL_AtomicUnlock(&mrb_sdl2_video_convert_cache_lock);
+
+  mrb_sdl2_video_convert_plan_build(plan, sf, df);
+
+  SDL_AtomicLock(&mrb_sdl2_video_convert_cache_lock);
+  mrb_sdl2_video_convert_cache[mrb_sdl2_video_convert_cache_next] = *plan;
+  mrb_sdl2_video_convert_cache_next = (mrb_sdl2_video_convert_cache_next + 1) % MRB_SDL2_CONVERT_CACHE_SIZE;
+  mrb_sdl2_video_convert_cache_count = SDL_min(mrb_sdl2_video_convert_cache_count + 1, MRB_SDL2_CONVERT_CACHE_SIZE);
+  SDL_AtomicUnlock(&mrb_sdl2_video_convert_cache_lock);
+  return NULL != plan->row;
+}
+
+/***************************************************************************
+*
+* conversion
+*
+***************************************************************************/
+
+/* pairs without a plan go through a temporary SDL_ConvertSurface result. */
+static int
+mrb_sdl2_video_convert_fallback(SDL_Surface *src, SDL_Surface *dst)
+{
+  SDL_Surface *tmp = SDL_ConvertSurface(src, dst->format, 0);
+  size_t const row = (size_t)dst->w * dst->format->BytesPerPixel;
+  int y;
+  if (NULL == tmp) {
+    return -1;
+  }
+  if (SDL_MUSTLOCK(tmp)) {
+    SDL_LockSurface(tmp);
+  }
+  if (SDL_MUSTLOCK(dst)) {
+    SDL_LockSurface(dst);
+  }
+  for (y = 0; y < dst->h; ++y) {
+    SDL_memcpy((Uint8*)dst->pixels + y * dst->pitch, (Uint8 const*)tmp->pixels + y * tmp->pitch, row);
+  }
+  if (SDL_MUSTLOCK(dst)) {
+    SDL_UnlockSurface(dst);
+  }
+  if (SDL_MUSTLOCK(tmp)) {
+    SDL_UnlockSurface(tmp);
+  }
+  SDL_FreeSurface(tmp);
+  return 0;
+}
+
+/*
+ * Converts every pixel of 'src' into the same sized 'dst' on the calling
+ * thread, ignoring blending, color keys and clip rects. Returns 0, or -1
+ * with the SDL error set.
+ */
+int
+mrb_sdl2_video_surface_convert_pixels(SDL_Surface *src, SDL_Surface *dst)
+{
+  mrb_sdl2_video_convert_plan_t plan;
+  Uint32 lut[256];
+  int y;
+  if ((src->w != dst->w) || (src->h != dst->h)) {
+    return SDL_SetError("surface size mismatch");
+  }
+  if (src == dst) {
+    return 0;
+  }
+  if (!mrb_sdl2_video_convert_plan_get(src->format, dst->format, &plan)) {
+    return mrb_sdl2_video_convert_fallback(src, dst);
+  }
+  if (NULL != src->format->palette) {
+    SDL_Palette const *palette = src->format->palette;
+    int i;
+    for (i = 0; i < 256; ++i) {
+      lut[i] = (i < palette->ncolors) ?
+        SDL_MapRGBA(dst->format, palette->colors[i].r, palette->colors[i].g, palette->colors[i].b, palette->colors[i].a) :
+        SDL_MapRGBA(dst->format, 0, 0, 0, 0xff);
+    }
+  }
+  if (SDL_MUSTLOCK(src)) {
+    SDL_LockSurface(src);
+  }
+  if (SDL_MUSTLOCK(dst)) {
+    SDL_LockSurface(dst);
+  }
+  for (y = 0; y < src->h; ++y) {
+    plan.row(&plan, (Uint8 const*)src->pixels + y * src->pitch, (Uint8*)dst->pixels + y * dst->pitch, src->w, lut);
+  }
+  if (SDL_MUSTLOCK(dst)) {
+    SDL_UnlockSurface(dst);
+  }
+  if (SDL_MUSTLOCK(src)) {
+    SDL_UnlockSurface(src);
+  }
+  return 0;
+}
+
+/*
+ * SDL_ConvertSurface through the cached plans. Like SDL, the result keeps
+ * the source color mod, alpha mod and blend mode, and blends when both
+ * formats have alpha or the alpha mod is set. Surfaces with a color key
+ * or RLE, indexed targets and pairs without a plan are left to SDL, which
+ * knows how to carry those over.
+ */
+SDL_Surface *
+mrb_sdl2_video_surface_convert_surface(SDL_Surface *src, SDL_PixelFormat const *format)
+{
+  mrb_sdl2_video_convert_plan_t plan;
+  SDL_Surface *dst;
+  Uint32 key;
+  Uint8 r, g, b, alpha = 0xff;
+  SDL_BlendMode mode;
+  if ((NULL != format->palette) || (0 != (src->flags & SDL_RLEACCEL)) ||
+      (0 == SDL_GetColorKey(src, &key)) ||
+      !mrb_sdl2_video_convert_plan_get(src->format, format, &plan)) {
+    return SDL_ConvertSurface(src, format, 0);
+  }
+  dst = SDL_CreateRGBSurface(0, src->w, src->h, format->BytesPerPixel * 8,
+                             format->Rmask, format->Gmask, format->Bmask, format->Amask);
+  if ((NULL != dst) && (dst->format->format != format->format)) {
+    SDL_FreeSurface(dst);
+    return SDL_ConvertSurface(src, format, 0);
+  }
+  if (NULL == dst) {
+    return NULL;
+  }
+  if (0 != mrb_sdl2_video_surface_convert_pixels(src, dst)) {
+    SDL_FreeSurface(dst);
+    return NULL;
+  }
+  SDL_SetClipRect(dst, &src->clip_rect);
+  if (0 == SDL_GetSurfaceColorMod(src, &r, &g, &b)) {
+    SDL_SetSurfaceColorMod(dst, r, g, b);
+  }
+  if (0 == SDL_GetSurfaceAlphaMod(src, &alpha)) {
+    SDL_SetSurfaceAlphaMod(dst, alpha);
+  }
+  if (0 == SDL_GetSurfaceBlendMode(src, &mode)) {
+    SDL_SetSurfaceBlendMode(dst, mode);
+  }
+  if (((0 != src->format->Amask) && (0 != format->Amask)) || (0xff != alpha)) {
+    SDL_SetSurfaceBlendMode(dst, SDL_BLENDMODE_BLEND);
+  }
+  return dst;
+}
+
+/***************************************************************************
+*
+* class SDL2::Video::Surface (convert)
+*
+***************************************************************************/
+
+/*
+ * SDL2::Video::Surface#convert_into(dst)
+ *
+ * Converts the pixels into 'dst', a surface of the same size in any
+ * format, replacing its contents. Meant for converting streaming frames
+ * into a surface allocated once.
+ */
+static mrb_value
+mrb_sdl2_video_surface_convert_into(mrb_state *mrb, mrb_value self)
+{
+  mrb_value dst;
+  SDL_Surface *s, *d;
+  mrb_get_args(mrb, "o", &dst);
+  s = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  d = mrb_sdl2_video_surface_get_ptr(mrb, dst);
+  if ((NULL == s) || (NULL == d)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  if ((s->w != d->w) || (s->h != d->h)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "destination surface size mismatch.");
+  }
+  if (0 != mrb_sdl2_video_surface_convert_pixels(s, d)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  return dst;
+}
+
+void
+mruby_sdl2_video_surface_convert_init(mrb_state *mrb, struct RClass *class_Surface)
+{
+  mrb_define_method(mrb, class_Surface, "convert_into", mrb_sdl2_video_surface_convert_into, MRB_ARGS_REQ(1));
+}
+
+void
+mruby_sdl2_video_surface_convert_final(mrb_state *mrb, struct RClass *class_Surface)
+{
+}
@@ -0,0 +1,846 @@
+#include "sdl2_surface_filter.h"
+#include "sdl2_surface.h"
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_cpuinfo.h>
+#include "mruby/array.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * All filters work on 32 bits per pixel surfaces and treat the four bytes
+ * of a pixel as independent channels, so the channel order does not matter.
+ * Inner loops run over contiguous byte rows (width * 4 values) with no
+ * branches, which lets the compiler vectorize them.
+ */
+#define MRB_SDL2_FILTER_SHIFT      12
+#define MRB_SDL2_FILTER_ONE        (1 << MRB_SDL2_FILTER_SHIFT)
+#define MRB_SDL2_FILTER_MAX_THREADS 16
+#define MRB_SDL2_FILTER_MAX_KERNEL 255
+#define MRB_SDL2_FILTER_MAX_TAPS   1024
+
+typedef struct mrb_sdl2_video_surface_band_t {
+  mrb_sdl2_video_surface_band_func_t func;
+  void *context;
+  int   begin;
+  int   end;
+} mrb_sdl2_video_surface_band_t;
+
+static int
+mrb_sdl2_video_surface_band_thread(void *p)
+{
+  mrb_sdl2_video_surface_band_t *band = (mrb_sdl2_video_surface_band_t*)p;
+  band->func(band->context, band->begin, band->end);
+  return 0;
+}
+
+/*
+ * Splits [0, count) into bands of at least 'grain' items and runs them on
+ * up to SDL_GetCPUCount() threads. The calling thread takes the last band.
+ * If a thread cannot be created its band runs on the calling thread.
+ */
+void
+mrb_sdl2_video_surface_parallel_for(int count, int grain, mrb_sdl2_video_surface_band_func_t func, void *context)
+{
+  mrb_sdl2_video_surface_band_t bands[MRB_SDL2_FILTER_MAX_THREADS];
+  SDL_Thread *threads[MRB_SDL2_FILTER_MAX_THREADS];
+  int n, i, step;
+
+  if (0 >= count) {
+    return;
+  }
+  if (0 >= grain) {
+    grain = 1;
+  }
+  n = SDL_min(SDL_GetCPUCount(), MRB_SDL2_FILTER_MAX_THREADS);
+  n = SDL_min(n, count / grain);
+  if (1 >= n) {
+    func(context, 0, count);
+    return;
+  }
+  step = (count + n - 1) / n;
+  for (i = 0; i < n; ++i) {
+    bands[i].func    = func;
+    bands[i].context = context;
+    bands[i].begin   = SDL_min(i * step, count);
+    bands[i].end     = SDL_min((i + 1) * step, count);
+  }
+  for (i = 0; i < n - 1; ++i) {
+    threads[i] = SDL_CreateThread(mrb_sdl2_video_surface_band_thread, "mruby-sdl2-filter", &bands[i]);
+    if (NULL == threads[i]) {
+      func(context, bands[i].begin, bands[i].end);
+    }
+  }
+  func(context, bands[n - 1].begin, bands[n - 1].end);
+  for (i = 0; i < n - 1; ++i) {
+    if (NULL != threads[i]) {
+      SDL_WaitThread(threads[i], NULL);
+    }
+  }
+}
+
+/***************************************************************************
+*
+* filter passes
+*
+***************************************************************************/
+
+typedef struct mrb_sdl2_video_surface_filter_t {
+  Uint8 const  *src;
+  int           src_pitch;
+  Uint8        *dst;
+  int           dst_pitch;
+  int           w;
+  int           h;
+  Sint32 const *weights;
+  Sint32       *wide;
+  int           wide_pitch;
+  int           rx;
+  int           ry;
+  Uint32        inv;
+  SDL_atomic_t  failed;
+} mrb_sdl2_video_surface_filter_t;
+
+static inline int
+mrb_sdl2_video_surface_clamp(int v, int lo, int hi)
+{
+  return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+/* copies a row into 'line' with 'r' edge pixels replicated on each side. */
+static void
+mrb_sdl2_video_surface_pad_row(Uint8 *line, Uint8 const *row, int w, int r)
+{
+  int i;
+  SDL_memcpy(line + r * 4, row, (size_t)w * 4);
+  for (i = 0; i < r; ++i) {
+    SDL_memcpy(line + i * 4, row, 4);
+    SDL_memcpy(line + (r + w + i) * 4, row + (w - 1) * 4, 4);
+  }
+}
+
+static void
+mrb_sdl2_video_surface_store_row(Uint8 *dst, Sint32 const *acc, int n)
+{
+  int i;
+  for (i = 0; i < n; ++i) {
+    Sint32 const v = (acc[i] + (MRB_SDL2_FILTER_ONE / 2)) >> MRB_SDL2_FILTER_SHIFT;
+    dst[i] = (Uint8)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+  }
+}
+
+/*
+ * Stores the horizontal pass unclamped, so that kernels with negative
+ * weights (sharpen, edge detection) see the true intermediate values.
+ */
+static void
+mrb_sdl2_video_surface_store_wide_row(Sint32 *dst, Sint32 const *acc, int n)
+{
+  int i;
+  for (i = 0; i < n; ++i) {
+    dst[i] = (acc[i] + (MRB_SDL2_FILTER_ONE / 2)) >> MRB_SDL2_FILTER_SHIFT;
+  }
+}
+
+static void
+mrb_sdl2_video_surface_conv_h_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_surface_filter_t *f = (mrb_sdl2_video_surface_filter_t*)p;
+  int const n = f->w * 4;
+  int const taps = f->rx * 2 + 1;
+  Uint8 *line = (Uint8*)SDL_malloc((size_t)(f->w + f->rx * 2) * 4);
+  Sint32 *acc = (Sint32*)SDL_malloc(sizeof(Sint32) * n);
+  int y, k, i;
+  if ((NULL == line) || (NULL == acc)) {
+    SDL_AtomicSet(&f->failed, 1);
+  } else {
+    for (y = begin; y < end; ++y) {
+      mrb_sdl2_video_surface_pad_row(line, f->src + y * f->src_pitch, f->w, f->rx);
+      SDL_memset(acc, 0, sizeof(Sint32) * n);
+      for (k = 0; k < taps; ++k) {
+        Sint32 const wk = f->weights[k];
+        Uint8 const *s = line + k * 4;
+        for (i = 0; i < n; ++i) {
+          acc[i] += wk * s[i];
+        }
+      }
+      mrb_sdl2_video_surface_store_wide_row(f->wide + y * f->wide_pitch, acc, n);
+    }
+  }
+  SDL_free(acc);
+  SDL_free(line);
+}
+
+static void
+mrb_sdl2_video_surface_conv_v_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_surface_filter_t *f = (mrb_sdl2_video_surface_filter_t*)p;
+  int const n = f->w * 4;
+  int const taps = f->ry * 2 + 1;
+  Sint32 *acc = (Sint32*)SDL_malloc(sizeof(Sint32) * n);
+  int y, k, i;
+  if (NULL == acc) {
+    SDL_AtomicSet(&f->failed, 1);
+    return;
+  }
+  for (y = begin; y < end; ++y) {
+    SDL_memset(acc, 0, sizeof(Sint32) * n);
+    for (k = 0; k < taps; ++k) {
+      Sint32 const wk = f->weights[k];
+      Sint32 const *s = f->wide + mrb_sdl2_video_surface_clamp(y + k - f->ry, 0, f->h - 1) * f->wide_pitch;
+      for (i = 0; i < n; ++i) {
+        acc[i] += wk * s[i];
+      }
+    }
+    mrb_sdl2_video_surface_store_row(f->dst + y * f->dst_pitch, acc, n);
+  }
+  SDL_free(acc);
+}
+
+static void
+mrb_sdl2_video_surface_conv_2d_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_surface_filter_t *f = (mrb_sdl2_video_surface_filter_t*)p;
+  int const n = f->w * 4;
+  int const kw = f->rx * 2 + 1;
+  int const kh = f->ry * 2 + 1;
+  Uint8 *line = (Uint8*)SDL_malloc((size_t)(f->w + f->rx * 2) * 4);
+  Sint32 *acc = (Sint32*)SDL_malloc(sizeof(Sint32) * n);
+  int y, kx, ky, i;
+  if ((NULL == line) || (NULL == acc)) {
+    SDL_AtomicSet(&f->failed, 1);
+  } else {
+    for (y = begin; y < end; ++y) {
+      SDL_memset(acc, 0, sizeof(Sint32) * n);
+      for (ky = 0; ky < kh; ++ky) {
+        int const sy = mrb_sdl2_video_surface_clamp(y + ky - f->ry, 0, f->h - 1);
+        mrb_sdl2_video_surface_pad_row(line, f->src + sy * f->src_pitch, f->w, f->rx);
+        for (kx = 0; kx < kw; ++kx) {
+          Sint32 const wk = f->weights[ky * kw + kx];
+          Uint8 const *s = line + kx * 4;
+          if (0 == wk) {
+            continue;
+          }
+          for (i = 0; i < n; ++i) {
+            acc[i] += wk * s[i];
+          }
+        }
+      }
+      mrb_sdl2_video_surface_store_row(f->dst + y * f->dst_pitch, acc, n);
+    }
+  }
+  SDL_free(acc);
+  SDL_free(line);
+}
+
+/* box blur, horizontal: one running sum per channel along the row. */
+static void
+mrb_sdl2_video_surface_box_h_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_surface_filter_t *f = (mrb_sdl2_video_surface_filter_t*)p;
+  int const r = f->rx;
+  Uint8 *line = (Uint8*)SDL_malloc((size_t)(f->w + r * 2) * 4);
+  int y, x, c;
+  if (NULL == line) {
+    SDL_AtomicSet(&f->failed, 1);
+    return;
+  }
+  for (y = begin; y < end; ++y) {
+    Uint8 *d = f->dst + y * f->dst_pitch;
+    Uint32 sum[4] = { 0, 0, 0, 0 };
+    mrb_sdl2_video_surface_pad_row(line, f->src + y * f->src_pitch, f->w, r);
+    for (x = 0; x < r * 2 + 1; ++x) {
+      for (c = 0; c < 4; ++c) {
+        sum[c] += line[x * 4 + c];
+      }
+    }
+    for (x = 0; x < f->w; ++x) {
+      for (c = 0; c < 4; ++c) {
+        d[x * 4 + c] = (Uint8)SDL_min((sum[c] * f->inv + 32768) >> 16, 255);
+      }
+      if (x + 1 < f->w) {
+        for (c = 0; c < 4; ++c) {
+          sum[c] += line[(x + r * 2 + 1) * 4 + c];
+          sum[c] -= line[x * 4 + c];
+        }
+      }
+    }
+  }
+  SDL_free(line);
+}
+
+/*
+ * box blur, vertical: keeps a running sum per column and slides it down the
+ * band, so every row is read in order and the per-row work is a contiguous
+ * add/subtract over width * 4 values.
+ */
+static void
+mrb_sdl2_video_surface_box_v_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_surface_filter_t *f = (mrb_sdl2_video_surface_filter_t*)p;
+  int const n = f->w * 4;
+  int const r = f->ry;
+  Uint32 *sum = (Uint32*)SDL_malloc(sizeof(Uint32) * n);
+  int y, k, i;
+  if (NULL == sum) {
+    SDL_AtomicSet(&f->failed, 1);
+    return;
+  }
+  SDL_memset(sum, 0, sizeof(Uint32) * n);
+  for (k = -r; k <= r; ++k) {
+    Uint8 const *s = f->src + mrb_sdl2_video_surface_clamp(begin + k, 0, f->h - 1) * f->src_pitch;
+    for (i = 0; i < n; ++i) {
+      sum[i] += s[i];
+    }
+  }
+  for (y = begin; y < end; ++y) {
+    Uint8 *d = f->dst + y * f->dst_pitch;
+    Uint8 const *out = f->src + mrb_sdl2_video_surface_clamp(y - r, 0, f->h - 1) * f->src_pitch;
+    Uint8 const *in  = f->src + mrb_sdl2_video_surface_clamp(y + r + 1, 0, f->h - 1) * f->src_pitch;
+    for (i = 0; i < n; ++i) {
+      Uint32 const v = (sum[i] * f->inv + 32768) >> 16;
+      d[i] = (Uint8)((v > 255) ? 255 : v);
+    }
+    for (i = 0; i < n; ++i) {
+      sum[i] += in[i];
+      sum[i] -= out[i];
+    }
+  }
+  SDL_free(sum);
+}
+
+/***************************************************************************
+*
+* class SDL2::Video::Surface (filters)
+*
+***************************************************************************/
+
+typedef struct mrb_sdl2_video_surface_filter_target_t {
+  SDL_Surface *src;
+  SDL_Surface *dst;
+  SDL_Rect     region;
+  Uint8       *tmp;
+} mrb_sdl2_video_surface_filter_target_t;
+
+/*
+ * Resolves the source and destination surfaces and the region to filter:
+ * the source clip rect, intersected with the destination clip rect when
+ * writing into another surface. The scratch buffer holds 'channel_size'
+ * bytes per channel of the region.
+ */
+static bool
+mrb_sdl2_video_surface_filter_begin(mrb_state *mrb, mrb_value self, mrb_value dst, size_t channel_size, mrb_sdl2_video_surface_filter_target_t *t)
+{
+  t->tmp = NULL;
+  t->src = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  t->dst = mrb_nil_p(dst) ? t->src : mrb_sdl2_video_surface_get_ptr(mrb, dst);
+  if ((NULL == t->src) || (NULL == t->dst)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  if ((4 != t->src->format->BytesPerPixel) || (4 != t->dst->format->BytesPerPixel)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported pixel format (expected 32 bits per pixel).");
+  }
+  if (t->src->format->format != t->dst->format->format) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "destination pixel format mismatch.");
+  }
+  if ((t->src->w != t->dst->w) || (t->src->h != t->dst->h)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "destination surface size mismatch.");
+  }
+  if (!SDL_IntersectRect(&t->src->clip_rect, &t->dst->clip_rect, &t->region)) {
+    return false;
+  }
+  t->tmp = (Uint8*)SDL_malloc((size_t)t->region.w * t->region.h * 4 * channel_size);
+  if (NULL == t->tmp) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  if (SDL_MUSTLOCK(t->src)) {
+    SDL_LockSurface(t->src);
+  }
+  if ((t->dst != t->src) && SDL_MUSTLOCK(t->dst)) {
+    SDL_LockSurface(t->dst);
+  }
+  return true;
+}
+
+static void
+mrb_sdl2_video_surface_filter_end(mrb_state *mrb, mrb_sdl2_video_surface_filter_target_t *t, mrb_sdl2_video_surface_filter_t const *f)
+{
+  if ((t->dst != t->src) && SDL_MUSTLOCK(t->dst)) {
+    SDL_UnlockSurface(t->dst);
+  }
+  if (SDL_MUSTLOCK(t->src)) {
+    SDL_UnlockSurface(t->src);
+  }
+  SDL_free(t->tmp);
+  t->tmp = NULL;
+  if ((NULL != f) && (0 != SDL_AtomicGet((SDL_atomic_t*)&f->failed))) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+}
+
+static Uint8 *
+mrb_sdl2_video_surface_region_ptr(SDL_Surface *s, SDL_Rect const *r)
+{
+  return (Uint8*)s->pixels + r->y * s->pitch + r->x * 4;
+}
+
+/*
+ * Runs one separable pass pair: 'src' -> tmp along rows, then tmp -> 'dst'
+ * along columns, using either the box running sums (tmp holds bytes) or the
+ * weight tables (tmp holds Sint32 values).
+ */
+static void
+mrb_sdl2_video_surface_filter_separable(mrb_sdl2_video_surface_filter_target_t *t, mrb_sdl2_video_surface_filter_t *f, Uint8 const *src, int src_pitch, bool box, Sint32 const *weights_x, Sint32 const *weights_y)
+{
+  int const grain = 16;
+  f->w = t->region.w;
+  f->h = t->region.h;
+
+  f->src       = src;
+  f->src_pitch = src_pitch;
+  f->dst        = t->tmp;
+  f->dst_pitch  = t->region.w * 4;
+  f->wide       = (Sint32*)t->tmp;
+  f->wide_pitch = t->region.w * 4;
+  f->weights    = weights_x;
+  mrb_sdl2_video_surface_parallel_for(f->h, grain, box ? mrb_sdl2_video_surface_box_h_band : mrb_sdl2_video_surface_conv_h_band, f);
+
+  f->src       = t->tmp;
+  f->src_pitch = t->region.w * 4;
+  f->dst       = mrb_sdl2_video_surface_region_ptr(t->dst, &t->region);
+  f->dst_pitch = t->dst->pitch;
+  f->weights   = weights_y;
+  mrb_sdl2_video_surface_parallel_for(f->h, grain, box ? mrb_sdl2_video_surface_box_v_band : mrb_sdl2_video_surface_conv_v_band, f);
+}
+
+/*
+ * SDL2::Video::Surface#box_blur(radius, passes = 1, dst = nil)
+ *
+ * Three passes approximate a gaussian blur. Cost does not depend on radius.
+ */
+static mrb_value
+mrb_sdl2_video_surface_box_blur(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_filter_target_t t;
+  mrb_sdl2_video_surface_filter_t f;
+  mrb_int radius, passes = 1, i;
+  mrb_value dst = mrb_nil_value();
+  mrb_get_args(mrb, "i|io", &radius, &passes, &dst);
+  if ((0 > radius) || (0 > passes)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "radius and passes must not be negative.");
+  }
+  if (!mrb_sdl2_video_surface_filter_begin(mrb, self, dst, 1, &t)) {
+    return mrb_nil_p(dst) ? self : dst;
+  }
+  /* a wider kernel only repeats the edge pixels; keep the sizes bounded. */
+  radius = SDL_min(radius, SDL_max(t.region.w, t.region.h));
+  SDL_AtomicSet(&f.failed, 0);
+  f.rx  = f.ry = (int)radius;
+  f.inv = (Uint32)((65536 + radius) / (radius * 2 + 1));
+  if ((0 == passes) || (0 == radius)) {
+    if (t.dst != t.src) {
+      for (i = 0; i < t.region.h; ++i) {
+        SDL_memcpy(mrb_sdl2_video_surface_region_ptr(t.dst, &t.region) + i * t.dst->pitch,
+                   mrb_sdl2_video_surface_region_ptr(t.src, &t.region) + i * t.src->pitch,
+                   (size_t)t.region.w * 4);
+      }
+    }
+  } else {
+    for (i = 0; i < passes; ++i) {
+      SDL_Surface *s = (0 == i) ? t.src : t.dst;
+      mrb_sdl2_video_surface_filter_separable(&t, &f, mrb_sdl2_video_surface_region_ptr(s, &t.region), s->pitch, true, NULL, NULL);
+    }
+  }
+  mrb_sdl2_video_surface_filter_end(mrb, &t, &f);
+  return mrb_nil_p(dst) ? self : dst;
+}
+
+/*
+ * Fixed point weights for a normalized 1D kernel. The rounding error is
+ * folded into the center tap so the weights sum to exactly one.
+ */
+static void
+mrb_sdl2_video_surface_gaussian_weights(Sint32 *weights, int r, double sigma)
+{
+  double total = 0.0;
+  double tmp[MRB_SDL2_FILTER_MAX_KERNEL];
+  Sint32 sum = 0;
+  int i;
+  for (i = -r; i <= r; ++i) {
+    tmp[i + r] = exp(-(double)(i * i) / (2.0 * sigma * sigma));
+    total += tmp[i + r];
+  }
+  for (i = 0; i < r * 2 + 1; ++i) {
+    weights[i] = (Sint32)floor(tmp[i] / total * MRB_SDL2_FILTER_ONE + 0.5);
+    sum += weights[i];
+  }
+  weights[r] += MRB_SDL2_FILTER_ONE - sum;
+}
+
+/*
+ * SDL2::Video::Surface#gaussian_blur(sigma, dst = nil)
+ */
+static mrb_value
+mrb_sdl2_video_surface_gaussian_blur(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_filter_target_t t;
+  mrb_sdl2_video_surface_filter_t f;
+  Sint32 weights[MRB_SDL2_FILTER_MAX_KERNEL];
+  mrb_float sigma;
+  mrb_value dst = mrb_nil_value();
+  int r;
+  mrb_get_args(mrb, "f|o", &sigma, &dst);
+  if (!(0.0 < sigma)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "sigma must be positive.");
+  }
+  /* the kernel spans 3 sigma on each side and at most MAX_KERNEL taps. */
+  sigma = SDL_max(sigma, 0.1);
+  sigma = SDL_min(sigma, (MRB_SDL2_FILTER_MAX_KERNEL - 1) / 6.0);
+  r = (int)ceil(sigma * 3.0);
+  mrb_sdl2_video_surface_gaussian_weights(weights, r, sigma);
+  if (!mrb_sdl2_video_surface_filter_begin(mrb, self, dst, sizeof(Sint32), &t)) {
+    return mrb_nil_p(dst) ? self : dst;
+  }
+  SDL_AtomicSet(&f.failed, 0);
+  f.rx = f.ry = r;
+  mrb_sdl2_video_surface_filter_separable(&t, &f, mrb_sdl2_video_surface_region_ptr(t.src, &t.region), t.src->pitch, false, weights, weights);
+  mrb_sdl2_video_surface_filter_end(mrb, &t, &f);
+  return mrb_nil_p(dst) ? self : dst;
+}
+
+static Sint32
+mrb_sdl2_video_surface_kernel_weight(mrb_state *mrb, mrb_value v)
+{
+  double const w = mrb_float(mrb_Float(mrb, v));
+  if (!isfinite(w)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "kernel weights must be finite.");
+  }
+  if (fabs(w) * MRB_SDL2_FILTER_ONE * 255.0 > SDL_MAX_SINT32) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "kernel weights are too large.");
+  }
+  return (Sint32)floor(w * MRB_SDL2_FILTER_ONE + 0.5);
+}
+
+/*
+ * The accumulators are Sint32. A 2D pass sums weight * 255 over all taps;
+ * the separable vertical pass sums weight * the horizontal result, which
+ * is itself up to the absolute weight sum * 255.
+ */
+static void
+mrb_sdl2_video_surface_check_kernel_range(mrb_state *mrb, Sint32 const *weights, mrb_int n, bool is_2d)
+{
+  Sint64 sum = 0, bound;
+  mrb_int i;
+  for (i = 0; i < n; ++i) {
+    sum += (0 > weights[i]) ? -(Sint64)weights[i] : weights[i];
+  }
+  bound = sum * 255 + MRB_SDL2_FILTER_ONE / 2;
+  if (!is_2d && (bound <= SDL_MAX_SINT32)) {
+    bound = sum * (bound >> MRB_SDL2_FILTER_SHIFT) + MRB_SDL2_FILTER_ONE / 2;
+  }
+  if (SDL_MAX_SINT32 < bound) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "kernel weights are too large.");
+  }
+}
+
+/*
+ * SDL2::Video::Surface#convolve(kernel, dst = nil)
+ *
+ * 'kernel' is either a flat Array of odd length, applied separably along
+ * rows and then columns, or an Array of equally sized rows (odd width and
+ * height) applied as a full 2D kernel. Weights are used as given; pass a
+ * normalized kernel to preserve brightness.
+ */
+static mrb_value
+mrb_sdl2_video_surface_convolve(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_filter_target_t t;
+  mrb_sdl2_video_surface_filter_t f;
+  mrb_value kernel, dst = mrb_nil_value();
+  Sint32 weights[MRB_SDL2_FILTER_MAX_TAPS];
+  mrb_int kw, kh, x, y;
+  bool is_2d;
+  mrb_get_args(mrb, "A|o", &kernel, &dst);
+
+  kh = mrb_ary_len(mrb, kernel);
+  if (0 == kh) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "empty kernel.");
+  }
+  is_2d = mrb_array_p(mrb_ary_ref(mrb, kernel, 0));
+  kw = is_2d ? mrb_ary_len(mrb, mrb_ary_ref(mrb, kernel, 0)) : kh;
+  if ((0 == (kw & 1)) || (0 == (kh & 1)) || (MRB_SDL2_FILTER_MAX_KERNEL < kw) || (MRB_SDL2_FILTER_MAX_KERNEL < kh)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "kernel dimensions must be odd.");
+  }
+  if (is_2d && (MRB_SDL2_FILTER_MAX_TAPS < kw * kh)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "kernel is too large.");
+  }
+  if (is_2d) {
+    for (y = 0; y < kh; ++y) {
+      mrb_value const row = mrb_ary_ref(mrb, kernel, y);
+      if (!mrb_array_p(row) || (mrb_ary_len(mrb, row) != kw)) {
+        mrb_raise(mrb, E_ARGUMENT_ERROR, "kernel rows must have the same length.");
+      }
+      for (x = 0; x < kw; ++x) {
+        weights[y * kw + x] = mrb_sdl2_video_surface_kernel_weight(mrb, mrb_ary_ref(mrb, row, x));
+      }
+    }
+  } else {
+    for (x = 0; x < kw; ++x) {
+      weights[x] = mrb_sdl2_video_surface_kernel_weight(mrb, mrb_ary_ref(mrb, kernel, x));
+    }
+  }
+  mrb_sdl2_video_surface_check_kernel_range(mrb, weights, is_2d ? kw * kh : kw, is_2d);
+  if (!mrb_sdl2_video_surface_filter_begin(mrb, self, dst, sizeof(Sint32), &t)) {
+    return mrb_nil_p(dst) ? self : dst;
+  }
+  SDL_AtomicSet(&f.failed, 0);
+  f.rx = (int)(kw / 2);
+  f.ry = (int)(kh / 2);
+  if (is_2d) {
+    /* a 2D kernel may not read pixels it already wrote; go through tmp. */
+    for (y = 0; y < t.region.h; ++y) {
+      SDL_memcpy(t.tmp + y * t.region.w * 4,
+                 mrb_sdl2_video_surface_region_ptr(t.src, &t.region) + y * t.src->pitch,
+                 (size_t)t.region.w * 4);
+    }
+    f.src       = t.tmp;
+    f.src_pitch = t.region.w * 4;
+    f.dst       = mrb_sdl2_video_surface_region_ptr(t.dst, &t.region);
+    f.dst_pitch = t.dst->pitch;
+    f.w         = t.region.w;
+    f.h         = t.region.h;
+    f.weights   = weights;
+    mrb_sdl2_video_surface_parallel_for(f.h, 16, mrb_sdl2_video_surface_conv_2d_band, &f);
+  } else {
+    mrb_sdl2_video_surface_filter_separable(&t, &f, mrb_sdl2_video_surface_region_ptr(t.src, &t.region), t.src->pitch, false, weights, weights);
+  }
+  mrb_sdl2_video_surface_filter_end(mrb, &t, &f);
+  return mrb_nil_p(dst) ? self : dst;
+}
+
+/***************************************************************************
+*
+* rotozoom
+*
+***************************************************************************/
+
+/*
+ * Inverse mapping: for every destination pixel the source position is
+ * stepped incrementally in 16.16 fixed point along the row, so the inner
+ * loop is two adds and a bounds check. Positions are kept in 64 bits: at
+ * the smallest zoom a step is 2^30, and a 16384 pixel row walks 2^44.
+ */
+#define MRB_SDL2_ROTOZOOM_MAX_SIZE 16384
+#define MRB_SDL2_ROTOZOOM_MIN_ZOOM (1.0 / 16384.0)
+
+typedef struct mrb_sdl2_video_surface_rotozoom_t {
+  SDL_Surface *src;
+  SDL_Surface *dst;
+  double       a, b, c, d;
+  double       cx_src, cy_src;
+  double       cx_dst, cy_dst;
+  bool         smooth;
+} mrb_sdl2_video_surface_rotozoom_t;
+
+static void
+mrb_sdl2_video_surface_rotozoom_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_surface_rotozoom_t const *rz = (mrb_sdl2_video_surface_rotozoom_t*)p;
+  SDL_Surface const *src = rz->src;
+  int const bpp = src->format->BytesPerPixel;
+  int const sw = src->w;
+  int const sh = src->h;
+  Sint64 const step_x = (Sint64)(rz->a * 65536.0);
+  Sint64 const step_y = (Sint64)(-rz->c * 65536.0);
+  /* bilinear samples are centered, so shift by half a pixel. */
+  double const bias = rz->smooth ? 0.5 : 0.0;
+  int x, y, c;
+  for (y = begin; y < end; ++y) {
+    double const ox = 0.5 - rz->cx_dst;
+    double const oy = (double)y + 0.5 - rz->cy_dst;
+    Sint64 fx = (Sint64)floor((ox * rz->a + oy * rz->b + rz->cx_src - bias) * 65536.0);
+    Sint64 fy = (Sint64)floor((-ox * rz->c + oy * rz->d + rz->cy_src - bias) * 65536.0);
+    Uint8 *d = (Uint8*)rz->dst->pixels + y * rz->dst->pitch;
+    if (!rz->smooth) {
+      for (x = 0; x < rz->dst->w; ++x, fx += step_x, fy += step_y, d += bpp) {
+        if ((0 <= fx) && (0 <= fy) && ((fx >> 16) < sw) && ((fy >> 16) < sh)) {
+          int const sx = (int)(fx >> 16);
+          int const sy = (int)(fy >> 16);
+          Uint8 const *s = (Uint8 const*)src->pixels + sy * src->pitch + sx * bpp;
+          switch (bpp) {
+          case 4: *(Uint32*)d = *(Uint32 const*)s; break;
+          case 2: *(Uint16*)d = *(Uint16 const*)s; break;
+          case 1: *d = *s; break;
+          default: SDL_memcpy(d, s, bpp); break;
+          }
+        }
+      }
+    } else {
+      for (x = 0; x < rz->dst->w; ++x, fx += step_x, fy += step_y, d += 4) {
+        int sx, sy, x1, y1;
+        Uint32 wx, wy;
+        Uint8 const *r0, *r1;
+        if ((-65536 / 2 > fx) || (-65536 / 2 > fy) || ((fx >> 16) >= sw) || ((fy >> 16) >= sh)) {
+          continue;
+        }
+        sx = (int)(fx >> 16);
+        sy = (int)(fy >> 16);
+        wx = (Uint32)(fx >> 8) & 0xff;
+        wy = (Uint32)(fy >> 8) & 0xff;
+        x1 = SDL_min(sx + 1, sw - 1);
+        y1 = SDL_min(sy + 1, sh - 1);
+        sx = SDL_max(sx, 0);
+        sy = SDL_max(sy, 0);
+        r0 = (Uint8 const*)src->pixels + sy * src->pitch;
+        r1 = (Uint8 const*)src->pixels + y1 * src->pitch;
+        for (c = 0; c < 4; ++c) {
+          Uint32 const top    = r0[sx * 4 + c] * (256 - wx) + r0[x1 * 4 + c] * wx;
+          Uint32 const bottom = r1[sx * 4 + c] * (256 - wx) + r1[x1 * 4 + c] * wx;
+          d[c] = (Uint8)((top * (256 - wy) + bottom * wy + 32768) >> 16);
+        }
+      }
+    }
+  }
+}
+
+/* exact quarter turns without scaling are plain row/column copies. */
+static void
+mrb_sdl2_video_surface_rotate_quarter(SDL_Surface const *src, SDL_Surface *dst, int turns)
+{
+  int const bpp = src->format->BytesPerPixel;
+  int x, y;
+  for (y = 0; y < dst->h; ++y) {
+    Uint8 *d = (Uint8*)dst->pixels + y * dst->pitch;
+    for (x = 0; x < dst->w; ++x, d += bpp) {
+      int sx, sy;
+      switch (turns) {
+      case 1:  sx = y;              sy = src->h - 1 - x; break;
+      case 2:  sx = src->w - 1 - x; sy = src->h - 1 - y; break;
+      case 3:  sx = src->w - 1 - y; sy = x;              break;
+      default: sx = x;              sy = y;              break;
+      }
+      SDL_memcpy(d, (Uint8 const*)src->pixels + sy * src->pitch + sx * bpp, bpp);
+    }
+  }
+}
+
+/*
+ * SDL2::Video::Surface#rotozoom(angle, zoom_x = 1.0, zoom_y = zoom_x, smooth = false)
+ *
+ * Returns a new surface holding this surface rotated clockwise by 'angle'
+ * degrees and scaled, sized to the rotated bounding box. Pixels outside the
+ * source are left transparent (or set to the color key). Negative zoom
+ * factors mirror the image. Smoothing requires 32 bits per pixel. The
+ * result may be at most 16384 pixels on each side.
+ */
+static mrb_value
+mrb_sdl2_video_surface_rotozoom(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_surface_rotozoom_t rz;
+  mrb_float angle, zoom_x = 1.0, zoom_y = 0.0;
+  mrb_bool smooth = false;
+  SDL_Surface *src, *dst;
+  double rad, cs, sn, turns, fw, fh;
+  int dw, dh, argc;
+  Uint32 key;
+  bool has_key;
+
+  argc = mrb_get_args(mrb, "f|ffb", &angle, &zoom_x, &zoom_y, &smooth);
+  if (3 > argc) {
+    zoom_y = zoom_x;
+  }
+  if ((0.0 == zoom_x) || (0.0 == zoom_y)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "zoom factor must not be zero.");
+  }
+  /* the inverse zoom is stepped in 16.16 fixed point; written so that NaN fails too. */
+  if (!(isfinite(zoom_x) && isfinite(zoom_y) && isfinite(angle) &&
+        (MRB_SDL2_ROTOZOOM_MIN_ZOOM <= fabs(zoom_x)) && (MRB_SDL2_ROTOZOOM_MIN_ZOOM <= fabs(zoom_y)))) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "zoom factor out of range.");
+  }
+  src = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  if (NULL == src) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  if (smooth && (4 != src->format->BytesPerPixel)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "smooth rotozoom needs 32 bits per pixel.");
+  }
+
+  turns = fmod(angle, 360.0);
+  if (0.0 > turns) {
+    turns += 360.0;
+  }
+  turns /= 90.0;
+  rad = angle * M_PI / 180.0;
+  cs  = cos(rad);
+  sn  = sin(rad);
+  if ((1.0 == zoom_x) && (1.0 == zoom_y) && (turns == floor(turns))) {
+    dw = (1 == ((int)turns & 1)) ? src->h : src->w;
+    dh = (1 == ((int)turns & 1)) ? src->w : src->h;
+  } else {
+    fw = ceil(fabs(src->w * zoom_x * cs) + fabs(src->h * zoom_y * sn) - 1e-9);
+    fh = ceil(fabs(src->w * zoom_x * sn) + fabs(src->h * zoom_y * cs) - 1e-9);
+    /* written so that NaN fails too. */
+    if (!((MRB_SDL2_ROTOZOOM_MAX_SIZE >= fw) && (MRB_SDL2_ROTOZOOM_MAX_SIZE >= fh))) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "rotozoom result is too large.");
+    }
+    dw = (int)fw;
+    dh = (int)fh;
+  }
+  dw = SDL_max(dw, 1);
+  dh = SDL_max(dh, 1);
+
+  dst = SDL_CreateRGBSurface(0, dw, dh, src->format->BitsPerPixel,
+                             src->format->Rmask, src->format->Gmask, src->format->Bmask, src->format->Amask);
+  if (NULL == dst) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  if (NULL != src->format->palette) {
+    SDL_SetSurfacePalette(dst, src->format->palette);
+  }
+  has_key = (0 == SDL_GetColorKey(src, &key));
+  if (has_key) {
+    SDL_SetColorKey(dst, SDL_TRUE, key);
+    SDL_FillRect(dst, NULL, key);
+  }
+
+  if (SDL_MUSTLOCK(src)) {
+    SDL_LockSurface(src);
+  }
+  if ((1.0 == zoom_x) && (1.0 == zoom_y) && (turns == floor(turns))) {
+    mrb_sdl2_video_surface_rotate_quarter(src, dst, (int)turns);
+  } else {
+    rz.src    = src;
+    rz.dst    = dst;
+    rz.a      = cs / zoom_x;
+    rz.b      = sn / zoom_x;
+    rz.c      = sn / zoom_y;
+    rz.d      = cs / zoom_y;
+    rz.cx_src = src->w / 2.0;
+    rz.cy_src = src->h / 2.0;
+    rz.cx_dst = dw / 2.0;
+    rz.cy_dst = dh / 2.0;
+    rz.smooth = smooth;
+    mrb_sdl2_video_surface_parallel_for(dh, 32, mrb_sdl2_video_surface_rotozoom_band, &rz);
+  }
+  if (SDL_MUSTLOCK(src)) {
+    SDL_UnlockSurface(src);
+  }
+  return mrb_sdl2_video_surface(mrb, dst, false);
+}
+
+void
+mruby_sdl2_video_surface_filter_init(mrb_state *mrb, struct RClass *class_Surface)
+{
+  mrb_define_method(mrb, class_Surface, "box_blur",      mrb_sdl2_video_surface_box_blur,      MRB_ARGS_REQ(1) | MRB_ARGS_OPT(2));
+  mrb_define_method(mrb, class_Surface, "gaussian_blur", mrb_sdl2_video_surface_gaussian_blur, MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Surface, "convolve",      mrb_sdl2_video_surface_convolve,      MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Surface, "rotozoom",      mrb_sdl2_video_surface_rotozoom,      MRB_ARGS_REQ(1) | MRB_ARGS_OPT(3));
+}
+
+void
+mruby_sdl2_video_surface_filter_final(mrb_state *mrb, struct RClass *class_Surface)
+{
+}
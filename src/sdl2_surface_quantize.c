@@ -0,0 +1,511 @@
+#include "sdl2_surface_quantize.h"
+#include "sdl2_surface.h"
+#include "sdl2_surface_filter.h"
+#include "sdl2_pixels.h"
+#include "mruby/hash.h"
+
+#define MRB_SDL2_QUANT_BITS          5
+#define MRB_SDL2_QUANT_SIDE          (1 << MRB_SDL2_QUANT_BITS)
+#define MRB_SDL2_QUANT_BINS          (MRB_SDL2_QUANT_SIDE * MRB_SDL2_QUANT_SIDE * MRB_SDL2_QUANT_SIDE)
+#define MRB_SDL2_QUANT_KMEANS_PASSES 2
+#define MRB_SDL2_QUANT_ALPHA_CUTOFF  128
+
+#define MRB_SDL2_QUANT_BIN(r, g, b) \
+  ((((r) >> 3) << (2 * MRB_SDL2_QUANT_BITS)) | (((g) >> 3) << MRB_SDL2_QUANT_BITS) | ((b) >> 3))
+
+enum {
+  MRB_SDL2_DITHER_NONE,
+  MRB_SDL2_DITHER_ORDERED,
+  MRB_SDL2_DITHER_FLOYD_STEINBERG
+};
+
+/*
+ * Colors are gathered into a 5 bits per channel histogram; median cut and
+ * k-means work on its bins, and 'cube' caches the nearest palette entry of
+ * every bin so mapping a pixel is a single load.
+ */
+typedef struct mrb_sdl2_video_quantize_t {
+  Uint8     *rgba;
+  int        width;
+  int        height;
+  bool       has_alpha;
+  Uint32    *count;
+  Uint64    *sum;
+  SDL_Color  palette[256];
+  int        first;   /* 1 when index 0 is the transparent entry */
+  int        ncolors;
+  Uint8     *cube;
+  int        dither;
+  int        spread;
+  SDL_Surface *dst;
+} mrb_sdl2_video_quantize_t;
+
+typedef struct mrb_sdl2_video_quantize_box_t {
+  int    lo[3];
+  int    hi[3];
+  Uint64 count;
+} mrb_sdl2_video_quantize_box_t;
+
+static Uint8 const mrb_sdl2_video_quantize_bayer[8][8] = {
+  {  0, 32,  8, 40,  2, 34, 10, 42 },
+  { 48, 16, 56, 24, 50, 18, 58, 26 },
+  { 12, 44,  4, 36, 14, 46,  6, 38 },
+  { 60, 28, 52, 20, 62, 30, 54, 22 },
+  {  3, 35, 11, 43,  1, 33,  9, 41 },
+  { 51, 19, 59, 27, 49, 17, 57, 25 },
+  { 15, 47,  7, 39, 13, 45,  5, 37 },
+  { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+static inline int
+mrb_sdl2_video_quantize_clamp(int v)
+{
+  return (v < 0) ? 0 : ((v > 255) ? 255 : v);
+}
+
+/* weighted squared distance; green matters most to the eye. */
+static inline int
+mrb_sdl2_video_quantize_nearest(mrb_sdl2_video_quantize_t const *q, int r, int g, int b)
+{
+  int best = q->first, best_d = 0x7fffffff, i;
+  for (i = q->first; i < q->ncolors; ++i) {
+    int const dr = r - q->palette[i].r;
+    int const dg = g - q->palette[i].g;
+    int const db = b - q->palette[i].b;
+    int const d = 2 * dr * dr + 4 * dg * dg + 3 * db * db;
+    if (d < best_d) {
+      best_d = d;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/***************************************************************************
+*
+* median cut
+*
+***************************************************************************/
+
+/* shrinks the box to its occupied bins and recounts it. */
+static void
+mrb_sdl2_video_quantize_box_shrink(mrb_sdl2_video_quantize_t const *q, mrb_sdl2_video_quantize_box_t *box)
+{
+  int lo[3] = { MRB_SDL2_QUANT_SIDE, MRB_SDL2_QUANT_SIDE, MRB_SDL2_QUANT_SIDE };
+  int hi[3] = { -1, -1, -1 };
+  int r, g, b, k;
+  box->count = 0;
+  for (r = box->lo[0]; r <= box->hi[0]; ++r) {
+    for (g = box->lo[1]; g <= box->hi[1]; ++g) {
+      for (b = box->lo[2]; b <= box->hi[2]; ++b) {
+        Uint32 const n = q->count[(r << (2 * MRB_SDL2_QUANT_BITS)) | (g << MRB_SDL2_QUANT_BITS) | b];
+        int const v[3] = { r, g, b };
+        if (0 == n) {
+          continue;
+        }
+        box->count += n;
+        for (k = 0; k < 3; ++k) {
+          lo[k] = SDL_min(lo[k], v[k]);
+          hi[k] = SDL_max(hi[k], v[k]);
+        }
+      }
+    }
+  }
+  if (0 < box->count) {
+    for (k = 0; k < 3; ++k) {
+      box->lo[k] = lo[k];
+      box->hi[k] = hi[k];
+    }
+  }
+}
+
+static Uint64
+mrb_sdl2_video_quantize_slice_count(mrb_sdl2_video_quantize_t const *q, mrb_sdl2_video_quantize_box_t const *box, int axis, int at)
+{
+  mrb_sdl2_video_quantize_box_t slice = *box;
+  Uint64 n = 0;
+  int r, g, b;
+  slice.lo[axis] = slice.hi[axis] = at;
+  for (r = slice.lo[0]; r <= slice.hi[0]; ++r) {
+    for (g = slice.lo[1]; g <= slice.hi[1]; ++g) {
+      for (b = slice.lo[2]; b <= slice.hi[2]; ++b) {
+        n += q->count[(r << (2 * MRB_SDL2_QUANT_BITS)) | (g << MRB_SDL2_QUANT_BITS) | b];
+      }
+    }
+  }
+  return n;
+}
+
+/*
+ * Repeatedly splits the most populated box at the median of its longest
+ * axis. Returns the number of boxes.
+ */
+static int
+mrb_sdl2_video_quantize_median_cut(mrb_sdl2_video_quantize_t const *q, mrb_sdl2_video_quantize_box_t *boxes, int max_boxes)
+{
+  int n = 1;
+  int i, k;
+  for (k = 0; k < 3; ++k) {
+    boxes[0].lo[k] = 0;
+    boxes[0].hi[k] = MRB_SDL2_QUANT_SIDE - 1;
+  }
+  mrb_sdl2_video_quantize_box_shrink(q, &boxes[0]);
+  if (0 == boxes[0].count) {
+    return 0;
+  }
+  while (n < max_boxes) {
+    mrb_sdl2_video_quantize_box_t *box = NULL;
+    mrb_sdl2_video_quantize_box_t upper;
+    Uint64 acc = 0;
+    int axis = 0, cut;
+    for (i = 0; i < n; ++i) {
+      bool const splittable = (boxes[i].lo[0] < boxes[i].hi[0]) ||
+                              (boxes[i].lo[1] < boxes[i].hi[1]) ||
+                              (boxes[i].lo[2] < boxes[i].hi[2]);
+      if (splittable && ((NULL == box) || (boxes[i].count > box->count))) {
+        box = &boxes[i];
+      }
+    }
+    if (NULL == box) {
+      break;
+    }
+    for (k = 1; k < 3; ++k) {
+      if ((box->hi[k] - box->lo[k]) > (box->hi[axis] - box->lo[axis])) {
+        axis = k;
+      }
+    }
+    for (cut = box->lo[axis]; cut < box->hi[axis] - 1; ++cut) {
+      acc += mrb_sdl2_video_quantize_slice_count(q, box, axis, cut);
+      if (acc >= box->count / 2) {
+        break;
+      }
+    }
+    upper = *box;
+    box->hi[axis]  = cut;
+    upper.lo[axis] = cut + 1;
+    mrb_sdl2_video_quantize_box_shrink(q, box);
+    mrb_sdl2_video_quantize_box_shrink(q, &upper);
+    boxes[n++] = upper;
+  }
+  return n;
+}
+
+static void
+mrb_sdl2_video_quantize_box_color(mrb_sdl2_video_quantize_t const *q, mrb_sdl2_video_quantize_box_t const *box, SDL_Color *color)
+{
+  Uint64 s[3] = { 0, 0, 0 };
+  Uint64 n = 0;
+  int r, g, b, k;
+  for (r = box->lo[0]; r <= box->hi[0]; ++r) {
+    for (g = box->lo[1]; g <= box->hi[1]; ++g) {
+      for (b = box->lo[2]; b <= box->hi[2]; ++b) {
+        int const bin = (r << (2 * MRB_SDL2_QUANT_BITS)) | (g << MRB_SDL2_QUANT_BITS) | b;
+        n += q->count[bin];
+        for (k = 0; k < 3; ++k) {
+          s[k] += q->sum[bin * 3 + k];
+        }
+      }
+    }
+  }
+  n = SDL_max(n, 1);
+  color->r = (Uint8)((s[0] + n / 2) / n);
+  color->g = (Uint8)((s[1] + n / 2) / n);
+  color->b = (Uint8)((s[2] + n / 2) / n);
+  color->a = 0xff;
+}
+
+/* moves every palette entry to the mean of the bins nearest to it. */
+static void
+mrb_sdl2_video_quantize_kmeans(mrb_sdl2_video_quantize_t *q)
+{
+  Uint64 acc[256][4];
+  int pass, bin, i, k;
+  for (pass = 0; pass < MRB_SDL2_QUANT_KMEANS_PASSES; ++pass) {
+    SDL_memset(acc, 0, sizeof(acc));
+    for (bin = 0; bin < MRB_SDL2_QUANT_BINS; ++bin) {
+      Uint32 const n = q->count[bin];
+      if (0 == n) {
+        continue;
+      }
+      i = mrb_sdl2_video_quantize_nearest(q,
+                                          (int)(q->sum[bin * 3 + 0] / n),
+                                          (int)(q->sum[bin * 3 + 1] / n),
+                                          (int)(q->sum[bin * 3 + 2] / n));
+      for (k = 0; k < 3; ++k) {
+        acc[i][k] += q->sum[bin * 3 + k];
+      }
+      acc[i][3] += n;
+    }
+    for (i = q->first; i < q->ncolors; ++i) {
+      Uint64 const n = acc[i][3];
+      if (0 < n) {
+        q->palette[i].r = (Uint8)((acc[i][0] + n / 2) / n);
+        q->palette[i].g = (Uint8)((acc[i][1] + n / 2) / n);
+        q->palette[i].b = (Uint8)((acc[i][2] + n / 2) / n);
+      }
+    }
+  }
+}
+
+/***************************************************************************
+*
+* mapping
+*
+***************************************************************************/
+
+/* fills the lookup cube, one red slice of bins per item. */
+static void
+mrb_sdl2_video_quantize_cube_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_quantize_t *q = (mrb_sdl2_video_quantize_t*)p;
+  int r, g, b;
+  for (r = begin; r < end; ++r) {
+    for (g = 0; g < MRB_SDL2_QUANT_SIDE; ++g) {
+      for (b = 0; b < MRB_SDL2_QUANT_SIDE; ++b) {
+        q->cube[(r << (2 * MRB_SDL2_QUANT_BITS)) | (g << MRB_SDL2_QUANT_BITS) | b] =
+          (Uint8)mrb_sdl2_video_quantize_nearest(q, (r << 3) | 4, (g << 3) | 4, (b << 3) | 4);
+      }
+    }
+  }
+}
+
+static inline bool
+mrb_sdl2_video_quantize_transparent(mrb_sdl2_video_quantize_t const *q, Uint8 const *px)
+{
+  return q->has_alpha && (MRB_SDL2_QUANT_ALPHA_CUTOFF > px[3]);
+}
+
+/* no dithering, or an 8x8 Bayer offset; rows are independent. */
+static void
+mrb_sdl2_video_quantize_map_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_quantize_t const *q = (mrb_sdl2_video_quantize_t*)p;
+  int y, x;
+  for (y = begin; y < end; ++y) {
+    Uint8 const *px = q->rgba + (size_t)y * q->width * 4;
+    Uint8 *d = (Uint8*)q->dst->pixels + y * q->dst->pitch;
+    for (x = 0; x < q->width; ++x, px += 4) {
+      int o = 0;
+      if (mrb_sdl2_video_quantize_transparent(q, px)) {
+        d[x] = 0;
+        continue;
+      }
+      if (MRB_SDL2_DITHER_ORDERED == q->dither) {
+        o = ((mrb_sdl2_video_quantize_bayer[y & 7][x & 7] - 32) * q->spread) / 64;
+      }
+      d[x] = q->cube[MRB_SDL2_QUANT_BIN(mrb_sdl2_video_quantize_clamp(px[0] + o),
+                                        mrb_sdl2_video_quantize_clamp(px[1] + o),
+                                        mrb_sdl2_video_quantize_clamp(px[2] + o))];
+    }
+  }
+}
+
+/*
+ * Serpentine Floyd-Steinberg. 'err' holds two rows of per-channel error
+ * with a one pixel border on each side.
+ */
+static void
+mrb_sdl2_video_quantize_floyd_steinberg(mrb_sdl2_video_quantize_t const *q, int *err)
+{
+  int const stride = (q->width + 2) * 3;
+  int y, i, k;
+  for (y = 0; y < q->height; ++y) {
+    int *cur = err + (y & 1) * stride;
+    int *next = err + ((y + 1) & 1) * stride;
+    int const dir = (y & 1) ? -1 : 1;
+    int x = (y & 1) ? q->width - 1 : 0;
+    Uint8 *d = (Uint8*)q->dst->pixels + y * q->dst->pitch;
+    SDL_memset(next, 0, sizeof(int) * stride);
+    for (i = 0; i < q->width; ++i, x += dir) {
+      Uint8 const *px = q->rgba + ((size_t)y * q->width + x) * 4;
+      int *e = cur + (x + 1) * 3;
+      int v[3], index;
+      if (mrb_sdl2_video_quantize_transparent(q, px)) {
+        d[x] = 0;
+        continue;
+      }
+      for (k = 0; k < 3; ++k) {
+        v[k] = mrb_sdl2_video_quantize_clamp(px[k] + (e[k] + 8) / 16);
+      }
+      index = q->cube[MRB_SDL2_QUANT_BIN(v[0], v[1], v[2])];
+      d[x] = (Uint8)index;
+      {
+        int const got[3] = { q->palette[index].r, q->palette[index].g, q->palette[index].b };
+        for (k = 0; k < 3; ++k) {
+          int const delta = v[k] - got[k];
+          e[dir * 3 + k]                        += delta * 7;
+          next[(x + 1 - dir) * 3 + k]           += delta * 3;
+          next[(x + 1) * 3 + k]                 += delta * 5;
+          next[(x + 1 + dir) * 3 + k]           += delta;
+        }
+      }
+    }
+  }
+}
+
+/***************************************************************************
+*
+* class SDL2::Video::Surface (quantize)
+*
+***************************************************************************/
+
+static void
+mrb_sdl2_video_quantize_free(mrb_sdl2_video_quantize_t *q)
+{
+  SDL_free(q->rgba);
+  SDL_free(q->count);
+  SDL_free(q->sum);
+  SDL_free(q->cube);
+}
+
+static int
+mrb_sdl2_video_quantize_dither_mode(mrb_state *mrb, mrb_value opt)
+{
+  mrb_value mode = opt;
+  if (mrb_hash_p(opt)) {
+    mode = mrb_hash_get(mrb, opt, mrb_symbol_value(mrb_intern_lit(mrb, "dither")));
+  }
+  if (mrb_nil_p(mode)) {
+    return MRB_SDL2_DITHER_FLOYD_STEINBERG;
+  }
+  if (mrb_symbol_p(mode)) {
+    mrb_sym const sym = mrb_symbol(mode);
+    if (sym == mrb_intern_lit(mrb, "floyd_steinberg")) {
+      return MRB_SDL2_DITHER_FLOYD_STEINBERG;
+    }
+    if (sym == mrb_intern_lit(mrb, "ordered")) {
+      return MRB_SDL2_DITHER_ORDERED;
+    }
+    if (sym == mrb_intern_lit(mrb, "none")) {
+      return MRB_SDL2_DITHER_NONE;
+    }
+  }
+  mrb_raise(mrb, E_ARGUMENT_ERROR, "dither must be :floyd_steinberg, :ordered or :none.");
+  return MRB_SDL2_DITHER_NONE;
+}
+
+/*
+ * SDL2::Video::Surface#quantize(colors = 256, dither: :floyd_steinberg)
+ *
+ * Returns a new INDEX8 surface whose palette (Surface#format.palette) is
+ * built by median cut and refined by k-means. 'dither' is
+ * :floyd_steinberg, :ordered or :none. Pixels with alpha below 128 map to
+ * index 0, which becomes the color key.
+ */
+static mrb_value
+mrb_sdl2_video_surface_quantize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_quantize_t q;
+  mrb_sdl2_video_quantize_box_t boxes[256];
+  mrb_value arg = mrb_nil_value(), opt = mrb_nil_value();
+  mrb_int colors = 256;
+  SDL_Surface *src;
+  int *err = NULL;
+  int nboxes, y, i, k;
+  bool transparent = false;
+
+  mrb_get_args(mrb, "|oo", &arg, &opt);
+  if (mrb_hash_p(arg) && mrb_nil_p(opt)) {
+    /* quantize(dither: ...) */
+    opt = arg;
+  } else if (!mrb_nil_p(arg)) {
+    colors = mrb_fixnum(mrb_Integer(mrb, arg));
+  }
+  src = mrb_sdl2_video_surface_get_ptr(mrb, self);
+  if (NULL == src) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  if (!mrb_sdl2_pixels_buffer_format_p(src->format)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "cannot quantize a sub-byte or packed-format surface.");
+  }
+  if ((2 > colors) || (256 < colors)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "colors must be between 2 and 256.");
+  }
+  SDL_memset(&q, 0, sizeof(q));
+  q.dither    = mrb_sdl2_video_quantize_dither_mode(mrb, opt);
+  q.width     = src->w;
+  q.height    = src->h;
+  q.has_alpha = (0 != src->format->Amask);
+  q.rgba      = (Uint8*)SDL_malloc((size_t)src->w * src->h * 4 + 4);
+  q.count     = (Uint32*)SDL_calloc(MRB_SDL2_QUANT_BINS, sizeof(Uint32));
+  q.sum       = (Uint64*)SDL_calloc(MRB_SDL2_QUANT_BINS * 3, sizeof(Uint64));
+  q.cube      = (Uint8*)SDL_malloc(MRB_SDL2_QUANT_BINS);
+  if (MRB_SDL2_DITHER_FLOYD_STEINBERG == q.dither) {
+    err = (int*)SDL_calloc((size_t)(src->w + 2) * 3 * 2, sizeof(int));
+  }
+  if ((NULL == q.rgba) || (NULL == q.count) || (NULL == q.sum) || (NULL == q.cube) ||
+      ((MRB_SDL2_DITHER_FLOYD_STEINBERG == q.dither) && (NULL == err))) {
+    mrb_sdl2_video_quantize_free(&q);
+    SDL_free(err);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+
+  if (SDL_MUSTLOCK(src)) {
+    SDL_LockSurface(src);
+  }
+  for (y = 0; y < src->h; ++y) {
+    mrb_sdl2_pixels_unpack_rgba_buffer(src->format, (Uint8 const*)src->pixels + y * src->pitch,
+                                       q.rgba + (size_t)y * src->w * 4, src->w);
+  }
+  if (SDL_MUSTLOCK(src)) {
+    SDL_UnlockSurface(src);
+  }
+
+  for (i = 0; i < src->w * src->h; ++i) {
+    Uint8 const *px = q.rgba + (size_t)i * 4;
+    int bin;
+    if (mrb_sdl2_video_quantize_transparent(&q, px)) {
+      transparent = true;
+      continue;
+    }
+    bin = MRB_SDL2_QUANT_BIN(px[0], px[1], px[2]);
+    q.count[bin] += 1;
+    for (k = 0; k < 3; ++k) {
+      q.sum[bin * 3 + k] += px[k];
+    }
+  }
+
+  q.first = transparent ? 1 : 0;
+  nboxes = mrb_sdl2_video_quantize_median_cut(&q, boxes, (int)colors - q.first);
+  q.ncolors = q.first + SDL_max(nboxes, 1);
+  SDL_memset(q.palette, 0, sizeof(q.palette));
+  for (i = 0; i < nboxes; ++i) {
+    mrb_sdl2_video_quantize_box_color(&q, &boxes[i], &q.palette[q.first + i]);
+  }
+  if (0 == nboxes) {
+    q.palette[q.first].a = 0xff;
+  }
+  mrb_sdl2_video_quantize_kmeans(&q);
+  mrb_sdl2_video_surface_parallel_for(MRB_SDL2_QUANT_SIDE, 1, mrb_sdl2_video_quantize_cube_band, &q);
+
+  q.dst = SDL_CreateRGBSurface(0, src->w, src->h, 8, 0, 0, 0, 0);
+  if ((NULL == q.dst) || (0 != SDL_SetPaletteColors(q.dst->format->palette, q.palette, 0, q.ncolors))) {
+    SDL_FreeSurface(q.dst);
+    mrb_sdl2_video_quantize_free(&q);
+    SDL_free(err);
+    mruby_sdl2_raise_error(mrb);
+  }
+  if (transparent) {
+    SDL_SetColorKey(q.dst, SDL_TRUE, 0);
+  }
+  if (MRB_SDL2_DITHER_FLOYD_STEINBERG == q.dither) {
+    mrb_sdl2_video_quantize_floyd_steinberg(&q, err);
+  } else {
+    q.spread = (int)(255.0 / SDL_pow(q.ncolors - q.first, 1.0 / 3.0));
+    mrb_sdl2_video_surface_parallel_for(src->h, 16, mrb_sdl2_video_quantize_map_band, &q);
+  }
+  SDL_free(err);
+  mrb_sdl2_video_quantize_free(&q);
+  return mrb_sdl2_video_surface(mrb, q.dst, false);
+}
+
+void
+mruby_sdl2_video_surface_quantize_init(mrb_state *mrb, struct RClass *class_Surface)
+{
+  mrb_define_method(mrb, class_Surface, "quantize", mrb_sdl2_video_surface_quantize, MRB_ARGS_OPT(2));
+}
+
+void
+mruby_sdl2_video_surface_quantize_final(mrb_state *mrb, struct RClass *class_Surface)
+{
+}
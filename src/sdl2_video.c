@@ -1,7 +1,14 @@
 #include "sdl2_video.h"
 #include "sdl2_rect.h"
+#include "sdl2_rect_array.h"
+#include "sdl2_dirty_region.h"
 #include "sdl2_render.h"
 #include "sdl2_surface.h"
+#include "sdl2_surface_cache.h"
+#include "sdl2_video_y4m.h"
+#include "sdl2_video_color_lut.h"
+#include "sdl2_video_indexed_texture.h"
+#include "sdl2_events_latency.h"
 #include "mruby/class.h"
 #include "mruby/data.h"
 #include "mruby/string.h"
@@ -686,31 +693,75 @@ mrb_sdl2_video_window_get_flags(mrb_state *mrb, mrb_value self)
           mrb_sdl2_video_window_get_ptr(mrb, self)));
 }
 
+static mrb_value
+mrb_sdl2_video_window_ramp_to_ary(mrb_state *mrb, Uint16 const *ramp)
+{
+  mrb_value ary = mrb_ary_new_capa(mrb, 256);
+  int i;
+  for (i = 0; i < 256; ++i) {
+    mrb_ary_push(mrb, ary, mrb_fixnum_value(ramp[i]));
+  }
+  return ary;
+}
+
+/* returns NULL when 'ary' is nil, which leaves that channel unchanged. */
+static Uint16 *
+mrb_sdl2_video_window_ary_to_ramp(mrb_state *mrb, mrb_value ary, Uint16 *ramp)
+{
+  int i;
+  if (mrb_nil_p(ary)) {
+    return NULL;
+  }
+  if (!mrb_array_p(ary) || (256 != mrb_ary_len(mrb, ary))) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "gamma ramp must be an Array of 256 values.");
+  }
+  for (i = 0; i < 256; ++i) {
+    mrb_int const v = mrb_fixnum(mrb_Integer(mrb, mrb_ary_ref(mrb, ary, i)));
+    ramp[i] = (Uint16)((v < 0) ? 0 : ((v > 0xffff) ? 0xffff : v));
+  }
+  return ramp;
+}
+
+/*
+ * SDL2::Video::Window#gamma_ramp
+ *
+ * Returns [red, green, blue], each an Array of 256 values.
+ */
 static mrb_value
 mrb_sdl2_video_window_get_gamma_ramp(mrb_state *mrb, mrb_value self)
 {
-  mrb_value ary;
-  Uint16 red, green, blue;
-  ary = mrb_ary_new_capa(mrb, 3);
-  SDL_GetWindowGammaRamp(mrb_sdl2_video_window_get_ptr(mrb, self),
-                         &red,
-                         &green,
-                         &blue);
-  mrb_ary_push(mrb, ary, mrb_fixnum_value(red));
-  mrb_ary_push(mrb, ary, mrb_fixnum_value(green));
-  mrb_ary_push(mrb, ary, mrb_fixnum_value(blue));
-  return self;
+  Uint16 red[256], green[256], blue[256];
+  mrb_value ramps[3];
+  if (0 != SDL_GetWindowGammaRamp(mrb_sdl2_video_window_get_ptr(mrb, self),
+                                  red,
+                                  green,
+                                  blue)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  ramps[0] = mrb_sdl2_video_window_ramp_to_ary(mrb, red);
+  ramps[1] = mrb_sdl2_video_window_ramp_to_ary(mrb, green);
+  ramps[2] = mrb_sdl2_video_window_ramp_to_ary(mrb, blue);
+  return mrb_ary_new_from_values(mrb, 3, ramps);
 }
 
+/*
+ * SDL2::Video::Window#gamma_ramp=([red, green, blue])
+ *
+ * Each channel is an Array of 256 values, or nil to leave it unchanged.
+ */
 static mrb_value
 mrb_sdl2_video_window_set_gamma_ramp(mrb_state *mrb, mrb_value self)
 {
-  mrb_int red, green, blue;
-  mrb_get_args(mrb, "iii", &red, &green, &blue);
+  Uint16 red[256], green[256], blue[256];
+  mrb_value ramps;
+  mrb_get_args(mrb, "A", &ramps);
+  if (3 != mrb_ary_len(mrb, ramps)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "expected [red, green, blue].");
+  }
   if (0 != SDL_SetWindowGammaRamp(mrb_sdl2_video_window_get_ptr(mrb, self),
-                                  &red,
-                                  &green,
-                                  &blue)) {
+                                  mrb_sdl2_video_window_ary_to_ramp(mrb, mrb_ary_ref(mrb, ramps, 0), red),
+                                  mrb_sdl2_video_window_ary_to_ramp(mrb, mrb_ary_ref(mrb, ramps, 1), green),
+                                  mrb_sdl2_video_window_ary_to_ramp(mrb, mrb_ary_ref(mrb, ramps, 2), blue))) {
     mruby_sdl2_raise_error(mrb);
   }
   return self;
@@ -814,23 +865,52 @@ mrb_sdl2_video_window_update_surface(mrb_state *mrb, mrb_value self)
   return self;
 }
 
+/*
+ * SDL2::Video::Window#update_surface_rects(rects)
+ *
+ * 'rects' is an Array of SDL2::Rect, an SDL2::RectArray or an
+ * SDL2::DirtyRegion. A region is left as is; see DirtyRegion#update_window
+ * to push and clear it in one call.
+ */
 static mrb_value
 mrb_sdl2_video_window_update_surface_rects(mrb_state *mrb, mrb_value self)
 {
   mrb_value rects_ary;
-  int size, i;
+  int size, i, result;
   SDL_Rect *rects;
-  mrb_get_args(mrb, "A", &rects_ary);
+  SDL_Window *window = mrb_sdl2_video_window_get_ptr(mrb, self);
+  mrb_get_args(mrb, "o", &rects_ary);
+  if (mrb_sdl2_rect_array_p(mrb, rects_ary) || mrb_sdl2_dirty_region_p(mrb, rects_ary)) {
+    SDL_Rect const *packed = mrb_sdl2_rect_array_p(mrb, rects_ary) ?
+      mrb_sdl2_rect_array_get_rects(mrb, rects_ary, &size) :
+      mrb_sdl2_dirty_region_get_rects(mrb, rects_ary, &size);
+    if ((0 < size) && (0 != SDL_UpdateWindowSurfaceRects(window, packed, size))) {
+      mruby_sdl2_raise_error(mrb);
+    }
+    return self;
+  }
+  if (!mrb_array_p(rects_ary)) {
+    mrb_raise(mrb, E_TYPE_ERROR, "expected Array, RectArray or DirtyRegion.");
+  }
   size = mrb_ary_len(mrb, rects_ary);
+  if (0 == size) {
+    return self;
+  }
   rects = (SDL_Rect *) SDL_malloc(size * sizeof(SDL_Rect));
+  if (NULL == rects) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
   for (i = 0; i < size; i++) {
     SDL_Rect *r = mrb_sdl2_rect_get_ptr(mrb, mrb_ary_ref(mrb, rects_ary, i));
+    if (NULL == r) {
+      SDL_free(rects);
+      mrb_raise(mrb, E_TYPE_ERROR, "expected SDL2::Rect.");
+    }
     rects[i] = (SDL_Rect) {r->x, r->y, r->w, r->h};
   }
-  if (0 != SDL_UpdateWindowSurfaceRects(
-          mrb_sdl2_video_window_get_ptr(mrb, self),
-          rects,
-          size)) {
+  result = SDL_UpdateWindowSurfaceRects(window, rects, size);
+  SDL_free(rects);
+  if (0 != result) {
     mruby_sdl2_raise_error(mrb);
   }
   return self;
@@ -861,6 +941,7 @@ mrb_sdl2_video_window_swap(mrb_state *mrb, mrb_value self)
     return mrb_nil_value();
   }
   SDL_GL_SwapWindow(data->window);
+  mrb_sdl2_input_latency_presented();
   return self;
 }
 
@@ -1094,6 +1175,10 @@ mruby_sdl2_video_init(mrb_state *mrb)
 
   mruby_sdl2_video_renderer_init(mrb, mod_Video);
   mruby_sdl2_video_surface_init(mrb, mod_Video);
+  mruby_sdl2_video_surface_cache_init(mrb, mod_Video);
+  mruby_sdl2_video_y4m_init(mrb, mod_Video);
+  mruby_sdl2_video_color_lut_init(mrb, mod_Video);
+  mruby_sdl2_video_indexed_texture_init(mrb, mod_Video);
 
   mrb_gc_arena_restore(mrb, arena_size);
 }
@@ -1101,6 +1186,10 @@ mruby_sdl2_video_init(mrb_state *mrb)
 void
 mruby_sdl2_video_final(mrb_state *mrb)
 {
+  mruby_sdl2_video_indexed_texture_final(mrb, mod_Video);
+  mruby_sdl2_video_color_lut_final(mrb, mod_Video);
+  mruby_sdl2_video_y4m_final(mrb, mod_Video);
+  mruby_sdl2_video_surface_cache_final(mrb, mod_Video);
   mruby_sdl2_video_surface_final(mrb, mod_Video);
   mruby_sdl2_video_renderer_final(mrb, mod_Video);
 }
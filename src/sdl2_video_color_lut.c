@@ -0,0 +1,761 @@
+#include "sdl2_video_color_lut.h"
+#include "sdl2_surface.h"
+#include "sdl2_surface_filter.h"
+#include "sdl2_render.h"
+#include "sdl2_rect.h"
+#include "sdl2_rwops.h"
+#include "sdl2_pixels.h"
+#include "mruby/array.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/string.h"
+#include <SDL2/SDL_render.h>
+
+#define MRB_SDL2_LUT_MAX_CUBE  128
+#define MRB_SDL2_LUT_MAX_1D    65536
+#define MRB_SDL2_LUT_MAX_FILE  (64 * 1024 * 1024)
+#define MRB_SDL2_LUT_CHUNK     256
+
+static struct RClass *class_ColorLUT = NULL;
+
+/*
+ * A grade is either three per-channel tables or, when 'cube' is set, a 3D
+ * table of 'size'^3 RGB entries in 8.8 fixed point. Cube entries are in
+ * .cube file order: red varies fastest, then green, then blue.
+ */
+typedef struct mrb_sdl2_video_color_lut_data_t {
+  Uint8   table[3][256];
+  Uint16 *cube;
+  int     size;
+} mrb_sdl2_video_color_lut_data_t;
+
+static void
+mrb_sdl2_video_color_lut_reset(mrb_sdl2_video_color_lut_data_t *data)
+{
+  int i;
+  SDL_free(data->cube);
+  data->cube = NULL;
+  data->size = 0;
+  for (i = 0; i < 256; ++i) {
+    data->table[0][i] = data->table[1][i] = data->table[2][i] = (Uint8)i;
+  }
+}
+
+static void
+mrb_sdl2_video_color_lut_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_video_color_lut_data_t *data =
+    (mrb_sdl2_video_color_lut_data_t*)p;
+  if (NULL != data) {
+    SDL_free(data->cube);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_video_color_lut_data_type = {
+  "ColorLUT", mrb_sdl2_video_color_lut_data_free
+};
+
+static mrb_sdl2_video_color_lut_data_t *
+mrb_sdl2_video_color_lut_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t *data =
+    (mrb_sdl2_video_color_lut_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_video_color_lut_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized color LUT.");
+  }
+  return data;
+}
+
+static inline Uint8
+mrb_sdl2_video_color_lut_clamp8(double v)
+{
+  return (Uint8)((v <= 0.0) ? 0 : ((v >= 255.0) ? 255 : (int)(v + 0.5)));
+}
+
+/***************************************************************************
+*
+* kernels
+*
+***************************************************************************/
+
+typedef struct mrb_sdl2_video_color_lut_job_t {
+  mrb_sdl2_video_color_lut_data_t const *lut;
+  SDL_PixelFormat const *format;
+  Uint8 *pixels;
+  int    pitch;
+  int    width;
+  int    bpp;
+  int    offset[3];  /* byte offsets of R, G and B, or -1 */
+} mrb_sdl2_video_color_lut_job_t;
+
+static inline int
+mrb_sdl2_video_color_lut_lerp(int a, int b, int f)
+{
+  return a + (((b - a) * f) >> 8);
+}
+
+/*
+ * Trilinear interpolation between the eight cube entries around (r, g, b).
+ * All arithmetic is 8.8 fixed point.
+ */
+static inline void
+mrb_sdl2_video_color_lut_cube_rgb(mrb_sdl2_video_color_lut_data_t const *lut, Uint8 *r, Uint8 *g, Uint8 *b)
+{
+  int const last = lut->size - 1;
+  int const pr = (*r * last * 256) / 255;
+  int const pg = (*g * last * 256) / 255;
+  int const pb = (*b * last * 256) / 255;
+  int const fr = pr & 0xff, fg = pg & 0xff, fb = pb & 0xff;
+  int const ir = pr >> 8, ig = pg >> 8, ib = pb >> 8;
+  int const dr = (ir < last) ? 3 : 0;
+  int const dg = (ig < last) ? 3 * lut->size : 0;
+  int const db = (ib < last) ? 3 * lut->size * lut->size : 0;
+  Uint16 const *c = lut->cube + 3 * (ir + lut->size * (ig + lut->size * ib));
+  Uint8 out[3];
+  int k;
+  for (k = 0; k < 3; ++k) {
+    int const c00 = mrb_sdl2_video_color_lut_lerp(c[k],           c[dr + k],           fr);
+    int const c10 = mrb_sdl2_video_color_lut_lerp(c[dg + k],      c[dg + dr + k],      fr);
+    int const c01 = mrb_sdl2_video_color_lut_lerp(c[db + k],      c[db + dr + k],      fr);
+    int const c11 = mrb_sdl2_video_color_lut_lerp(c[db + dg + k], c[db + dg + dr + k], fr);
+    int const c0  = mrb_sdl2_video_color_lut_lerp(c00, c10, fg);
+    int const c1  = mrb_sdl2_video_color_lut_lerp(c01, c11, fg);
+    out[k] = (Uint8)((mrb_sdl2_video_color_lut_lerp(c0, c1, fb) + 128) >> 8);
+  }
+  *r = out[0];
+  *g = out[1];
+  *b = out[2];
+}
+
+/*
+ * Grades 'count' pixels of 'bpp' bytes whose channels sit at byte offsets
+ * 'ro', 'go' and 'bo'. Other bytes (alpha, padding) are left untouched.
+ */
+static void
+mrb_sdl2_video_color_lut_bytes(mrb_sdl2_video_color_lut_data_t const *lut, Uint8 *p, int count, int bpp, int ro, int go, int bo)
+{
+  int x;
+  if (NULL == lut->cube) {
+    Uint8 const *tr = lut->table[0];
+    Uint8 const *tg = lut->table[1];
+    Uint8 const *tb = lut->table[2];
+    for (x = 0; x < count; ++x, p += bpp) {
+      p[ro] = tr[p[ro]];
+      p[go] = tg[p[go]];
+      p[bo] = tb[p[bo]];
+    }
+  } else {
+    for (x = 0; x < count; ++x, p += bpp) {
+      mrb_sdl2_video_color_lut_cube_rgb(lut, &p[ro], &p[go], &p[bo]);
+    }
+  }
+}
+
+static void
+mrb_sdl2_video_color_lut_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_color_lut_job_t const *job = (mrb_sdl2_video_color_lut_job_t*)p;
+  Uint8 rgba[MRB_SDL2_LUT_CHUNK * 4];
+  int y, x;
+  for (y = begin; y < end; ++y) {
+    Uint8 *row = job->pixels + y * job->pitch;
+    if (0 <= job->offset[0]) {
+      mrb_sdl2_video_color_lut_bytes(job->lut, row, job->width, job->bpp, job->offset[0], job->offset[1], job->offset[2]);
+      continue;
+    }
+    for (x = 0; x < job->width; x += MRB_SDL2_LUT_CHUNK) {
+      int const n = SDL_min(MRB_SDL2_LUT_CHUNK, job->width - x);
+      Uint8 *px = row + x * job->bpp;
+      mrb_sdl2_pixels_unpack_rgba_buffer(job->format, px, rgba, n);
+      mrb_sdl2_video_color_lut_bytes(job->lut, rgba, n, 4, 0, 1, 2);
+      mrb_sdl2_pixels_map_rgba_buffer(job->format, rgba, px, n);
+    }
+  }
+}
+
+/* byte offset of an 8-bit aligned channel, or -1. */
+static int
+mrb_sdl2_video_color_lut_channel_offset(SDL_PixelFormat const *format, Uint32 mask, Uint8 shift)
+{
+  if ((0 != (shift & 7)) || ((Uint32)0xff << shift != mask)) {
+    return -1;
+  }
+  if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+    return format->BytesPerPixel - 1 - shift / 8;
+  }
+  return shift / 8;
+}
+
+/*
+ * Grades a 'rect' sized block of pixels. Formats with 8-bit channels take
+ * the byte kernel; other packed formats go through RGBA in small chunks.
+ * Rows are split across threads.
+ */
+static void
+mrb_sdl2_video_color_lut_apply(mrb_sdl2_video_color_lut_data_t const *lut, SDL_PixelFormat const *format, Uint8 *pixels, int pitch, SDL_Rect const *rect)
+{
+  mrb_sdl2_video_color_lut_job_t job;
+  job.lut    = lut;
+  job.format = format;
+  job.bpp    = format->BytesPerPixel;
+  job.pixels = pixels + rect->y * pitch + rect->x * job.bpp;
+  job.pitch  = pitch;
+  job.width  = rect->w;
+  job.offset[0] = job.offset[1] = job.offset[2] = -1;
+  if ((3 <= job.bpp) &&
+      (0 <= mrb_sdl2_video_color_lut_channel_offset(format, format->Rmask, format->Rshift)) &&
+      (0 <= mrb_sdl2_video_color_lut_channel_offset(format, format->Gmask, format->Gshift)) &&
+      (0 <= mrb_sdl2_video_color_lut_channel_offset(format, format->Bmask, format->Bshift))) {
+    job.offset[0] = mrb_sdl2_video_color_lut_channel_offset(format, format->Rmask, format->Rshift);
+    job.offset[1] = mrb_sdl2_video_color_lut_channel_offset(format, format->Gmask, format->Gshift);
+    job.offset[2] = mrb_sdl2_video_color_lut_channel_offset(format, format->Bmask, format->Bshift);
+  }
+  mrb_sdl2_video_surface_parallel_for(rect->h, 16, mrb_sdl2_video_color_lut_band, &job);
+}
+
+/***************************************************************************
+*
+* .cube parsing
+*
+***************************************************************************/
+
+static bool
+mrb_sdl2_video_color_lut_keyword(char const *line, char const *keyword, char const **rest)
+{
+  size_t const n = SDL_strlen(keyword);
+  if ((0 != SDL_strncmp(line, keyword, n)) || ((' ' != line[n]) && ('\t' != line[n]))) {
+    return false;
+  }
+  *rest = line + n;
+  return true;
+}
+
+static bool
+mrb_sdl2_video_color_lut_triple(char const *s, double *v)
+{
+  char *end;
+  int i;
+  for (i = 0; i < 3; ++i) {
+    v[i] = SDL_strtod(s, &end);
+    if (end == s) {
+      return false;
+    }
+    s = end;
+  }
+  return true;
+}
+
+/*
+ * Parses a NUL terminated .cube file. Returns NULL on success or an error
+ * message; on success 'data' holds the new grade.
+ */
+static char const *
+mrb_sdl2_video_color_lut_parse_cube(char *text, mrb_sdl2_video_color_lut_data_t *data)
+{
+  int size_1d = 0, size_3d = 0, count = 0, expected = 0, i, k;
+  double *curve = NULL;
+  Uint16 *cube = NULL;
+  char *line = text;
+  while (NULL != line) {
+    char *next = SDL_strchr(line, '\n');
+    char const *rest;
+    double v[3];
+    if (NULL != next) {
+      *next++ = '\0';
+    }
+    while ((' ' == *line) || ('\t' == *line) || ('\r' == *line)) {
+      ++line;
+    }
+    if (('\0' == *line) || ('#' == *line)) {
+      /* blank or comment */
+    } else if (mrb_sdl2_video_color_lut_keyword(line, "LUT_1D_SIZE", &rest)) {
+      size_1d = SDL_atoi(rest);
+      if ((2 > size_1d) || (MRB_SDL2_LUT_MAX_1D < size_1d) || (0 != expected)) {
+        break;
+      }
+      expected = size_1d;
+      curve = (double*)SDL_malloc(sizeof(double) * 3 * size_1d);
+      if (NULL == curve) {
+        return "insufficient memory.";
+      }
+    } else if (mrb_sdl2_video_color_lut_keyword(line, "LUT_3D_SIZE", &rest)) {
+      size_3d = SDL_atoi(rest);
+      if ((2 > size_3d) || (MRB_SDL2_LUT_MAX_CUBE < size_3d) || (0 != expected)) {
+        break;
+      }
+      expected = size_3d * size_3d * size_3d;
+      cube = (Uint16*)SDL_malloc(sizeof(Uint16) * 3 * expected);
+      if (NULL == cube) {
+        return "insufficient memory.";
+      }
+    } else if (mrb_sdl2_video_color_lut_keyword(line, "DOMAIN_MIN", &rest)) {
+      if (!mrb_sdl2_video_color_lut_triple(rest, v) || (0.0 != v[0]) || (0.0 != v[1]) || (0.0 != v[2])) {
+        break;
+      }
+    } else if (mrb_sdl2_video_color_lut_keyword(line, "DOMAIN_MAX", &rest)) {
+      if (!mrb_sdl2_video_color_lut_triple(rest, v) || (1.0 != v[0]) || (1.0 != v[1]) || (1.0 != v[2])) {
+        break;
+      }
+    } else if (('A' <= *line) && ('Z' >= *line)) {
+      /* TITLE and other keywords we do not need */
+    } else {
+      if ((count >= expected) || !mrb_sdl2_video_color_lut_triple(line, v)) {
+        break;
+      }
+      for (k = 0; k < 3; ++k) {
+        v[k] = (v[k] < 0.0) ? 0.0 : ((v[k] > 1.0) ? 1.0 : v[k]);
+        if (NULL != cube) {
+          cube[count * 3 + k] = (Uint16)(v[k] * 65280.0 + 0.5);
+        } else {
+          curve[count * 3 + k] = v[k] * 255.0;
+        }
+      }
+      ++count;
+    }
+    line = next;
+  }
+
+  if ((NULL != line) || (0 == expected) || (count != expected)) {
+    SDL_free(curve);
+    SDL_free(cube);
+    return "malformed or unsupported .cube file.";
+  }
+  mrb_sdl2_video_color_lut_reset(data);
+  if (NULL != cube) {
+    data->cube = cube;
+    data->size = size_3d;
+  } else {
+    for (i = 0; i < 256; ++i) {
+      double const pos = (double)i * (size_1d - 1) / 255.0;
+      int const i0 = SDL_min((int)pos, size_1d - 2);
+      double const f = pos - i0;
+      for (k = 0; k < 3; ++k) {
+        double const a = curve[i0 * 3 + k];
+        double const b = curve[(i0 + 1) * 3 + k];
+        data->table[k][i] = mrb_sdl2_video_color_lut_clamp8(a + (b - a) * f);
+      }
+    }
+    SDL_free(curve);
+  }
+  return NULL;
+}
+
+/***************************************************************************
+*
+* class SDL2::Video::ColorLUT
+*
+***************************************************************************/
+
+/*
+ * SDL2::Video::ColorLUT#initialize
+ *
+ * Creates the identity grade.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t *data =
+    (mrb_sdl2_video_color_lut_data_t*)DATA_PTR(self);
+  if (NULL == data) {
+    data = (mrb_sdl2_video_color_lut_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_video_color_lut_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+    data->cube = NULL;
+  }
+  mrb_sdl2_video_color_lut_reset(data);
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_video_color_lut_data_type;
+  return self;
+}
+
+/*
+ * SDL2::Video::ColorLUT.gamma(red, green = red, blue = green)
+ *
+ * Uses the same convention as SDL_CalculateGammaRamp: values above 1.0
+ * brighten.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_s_gamma(mrb_state *mrb, mrb_value klass)
+{
+  mrb_sdl2_video_color_lut_data_t *data;
+  mrb_float gamma[3];
+  mrb_value lut;
+  int argc, i, k;
+  argc = mrb_get_args(mrb, "f|ff", &gamma[0], &gamma[1], &gamma[2]);
+  if (2 > argc) {
+    gamma[1] = gamma[0];
+  }
+  if (3 > argc) {
+    gamma[2] = gamma[1];
+  }
+  for (k = 0; k < 3; ++k) {
+    if (0.0 >= gamma[k]) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "gamma must be positive.");
+    }
+  }
+  lut = mrb_obj_new(mrb, class_ColorLUT, 0, NULL);
+  data = mrb_sdl2_video_color_lut_get_ptr(mrb, lut);
+  for (k = 0; k < 3; ++k) {
+    for (i = 0; i < 256; ++i) {
+      data->table[k][i] = mrb_sdl2_video_color_lut_clamp8(SDL_pow(i / 255.0, 1.0 / gamma[k]) * 255.0);
+    }
+  }
+  return lut;
+}
+
+/* fills 'table' from [[in, out], ...] control points, linearly. */
+static void
+mrb_sdl2_video_color_lut_curve(mrb_state *mrb, mrb_value points, Uint8 *table)
+{
+  mrb_float xs[256], ys[256];
+  mrb_int n, i;
+  int j = 0;
+  if (mrb_nil_p(points)) {
+    return;
+  }
+  if (!mrb_array_p(points) || (1 > (n = mrb_ary_len(mrb, points))) || (256 < n)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "curve must be an Array of 1 to 256 [in, out] points.");
+  }
+  for (i = 0; i < n; ++i) {
+    mrb_value const pt = mrb_ary_ref(mrb, points, i);
+    if (!mrb_array_p(pt) || (2 != mrb_ary_len(mrb, pt))) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "curve point must be [in, out].");
+    }
+    xs[i] = mrb_float(mrb_Float(mrb, mrb_ary_ref(mrb, pt, 0)));
+    ys[i] = mrb_float(mrb_Float(mrb, mrb_ary_ref(mrb, pt, 1)));
+    if ((0 < i) && (xs[i] <= xs[i - 1])) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "curve inputs must be increasing.");
+    }
+  }
+  for (i = 0; i < 256; ++i) {
+    if (i <= xs[0]) {
+      table[i] = mrb_sdl2_video_color_lut_clamp8(ys[0]);
+    } else if (i >= xs[n - 1]) {
+      table[i] = mrb_sdl2_video_color_lut_clamp8(ys[n - 1]);
+    } else {
+      while (i > xs[j + 1]) {
+        ++j;
+      }
+      table[i] = mrb_sdl2_video_color_lut_clamp8(ys[j] + (ys[j + 1] - ys[j]) * (i - xs[j]) / (xs[j + 1] - xs[j]));
+    }
+  }
+}
+
+/*
+ * SDL2::Video::ColorLUT.curves(red, green = red, blue = green)
+ *
+ * Each channel is an Array of [in, out] points (0..255, inputs increasing)
+ * joined by straight segments, or nil for the identity.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_s_curves(mrb_state *mrb, mrb_value klass)
+{
+  mrb_sdl2_video_color_lut_data_t *data;
+  mrb_value points[3], lut;
+  int argc, k;
+  argc = mrb_get_args(mrb, "o|oo", &points[0], &points[1], &points[2]);
+  if (2 > argc) {
+    points[1] = points[0];
+  }
+  if (3 > argc) {
+    points[2] = points[1];
+  }
+  lut = mrb_obj_new(mrb, class_ColorLUT, 0, NULL);
+  data = mrb_sdl2_video_color_lut_get_ptr(mrb, lut);
+  for (k = 0; k < 3; ++k) {
+    mrb_sdl2_video_color_lut_curve(mrb, points[k], data->table[k]);
+  }
+  return lut;
+}
+
+/*
+ * SDL2::Video::ColorLUT.load_cube(source)
+ *
+ * Loads a 1D or 3D .cube file from a file name or an SDL2::RWops. 1D
+ * curves are resampled to 256 entries; 3D tables are applied with
+ * trilinear interpolation.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_s_load_cube(mrb_state *mrb, mrb_value klass)
+{
+  mrb_sdl2_video_color_lut_data_t *data;
+  mrb_value source, lut;
+  SDL_RWops *rw;
+  Sint64 size;
+  char *text;
+  char const *error;
+  mrb_get_args(mrb, "o", &source);
+  lut = mrb_obj_new(mrb, class_ColorLUT, 0, NULL);
+  data = mrb_sdl2_video_color_lut_get_ptr(mrb, lut);
+
+  if (mrb_string_p(source)) {
+    rw = SDL_RWFromFile(RSTRING_PTR(source), "rb");
+  } else {
+    rw = mrb_sdl2_rwops_get_ptr(mrb, source);
+    if (NULL == rw) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "cannot read from nil.");
+    }
+  }
+  if (NULL == rw) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  size = SDL_RWsize(rw);
+  text = ((0 <= size) && (MRB_SDL2_LUT_MAX_FILE >= size)) ? (char*)SDL_malloc((size_t)size + 1) : NULL;
+  if ((NULL != text) && ((size_t)size != SDL_RWread(rw, text, 1, (size_t)size))) {
+    SDL_free(text);
+    text = NULL;
+  }
+  if (mrb_string_p(source)) {
+    SDL_RWclose(rw);
+  }
+  if (NULL == text) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "cannot read .cube file.");
+  }
+  text[size] = '\0';
+  error = mrb_sdl2_video_color_lut_parse_cube(text, data);
+  SDL_free(text);
+  if (NULL != error) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, error);
+  }
+  return lut;
+}
+
+/*
+ * SDL2::Video::ColorLUT#apply(surface, rect = nil)
+ *
+ * Grades the surface in place within its clip rect (and 'rect' if given).
+ * For indexed surfaces the palette is graded instead.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_apply_surface(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t const *data = mrb_sdl2_video_color_lut_get_ptr(mrb, self);
+  mrb_value surface, rect = mrb_nil_value();
+  SDL_Surface *s;
+  SDL_Rect region;
+  mrb_get_args(mrb, "o|o", &surface, &rect);
+  s = mrb_sdl2_video_surface_get_ptr(mrb, surface);
+  if (NULL == s) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+
+  if (NULL != s->format->palette) {
+    SDL_Palette *palette = s->format->palette;
+    SDL_Color colors[256];
+    int const n = SDL_min(palette->ncolors, 256);
+    int i;
+    SDL_memcpy(colors, palette->colors, sizeof(SDL_Color) * n);
+    for (i = 0; i < n; ++i) {
+      mrb_sdl2_video_color_lut_bytes(data, &colors[i].r, 1, sizeof(SDL_Color), 0, 1, 2);
+    }
+    if (1 < palette->refcount) {
+      /* The palette is shared with other surfaces; grade a private copy. */
+      SDL_Palette *private_palette = SDL_AllocPalette(palette->ncolors);
+      int result;
+      if (NULL == private_palette) {
+        mruby_sdl2_raise_error(mrb);
+      }
+      result = SDL_SetSurfacePalette(s, private_palette);
+      SDL_FreePalette(private_palette);
+      if (0 != result) {
+        mruby_sdl2_raise_error(mrb);
+      }
+      palette = s->format->palette;
+    }
+    if (0 != SDL_SetPaletteColors(palette, colors, 0, n)) {
+      mruby_sdl2_raise_error(mrb);
+    }
+    return surface;
+  }
+
+  if (!mrb_sdl2_pixels_buffer_format_p(s->format)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported pixel format.");
+  }
+  region = s->clip_rect;
+  if (!mrb_nil_p(rect) && !SDL_IntersectRect(&s->clip_rect, mrb_sdl2_rect_get_ptr(mrb, rect), &region)) {
+    return surface;
+  }
+  if ((0 >= region.w) || (0 >= region.h)) {
+    return surface;
+  }
+  if (SDL_MUSTLOCK(s)) {
+    SDL_LockSurface(s);
+  }
+  mrb_sdl2_video_color_lut_apply(data, s->format, (Uint8*)s->pixels, s->pitch, &region);
+  if (SDL_MUSTLOCK(s)) {
+    SDL_UnlockSurface(s);
+  }
+  return surface;
+}
+
+/*
+ * SDL2::Video::ColorLUT#apply_texture(texture, rect = nil)
+ *
+ * Locks a streaming texture, grades it in place and unlocks it. The
+ * locked pixels are write-only for some renderers, so grade textures
+ * only after writing them completely.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_apply_texture(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t const *data = mrb_sdl2_video_color_lut_get_ptr(mrb, self);
+  mrb_value texture, rect = mrb_nil_value();
+  SDL_Texture *t;
+  SDL_PixelFormat *format;
+  SDL_Rect full, region, local;
+  Uint32 pixel_format;
+  int access, pitch;
+  void *pixels;
+  mrb_get_args(mrb, "o|o", &texture, &rect);
+  t = mrb_sdl2_video_texture_get_ptr(mrb, texture);
+  full.x = full.y = 0;
+  if (0 != SDL_QueryTexture(t, &pixel_format, &access, &full.w, &full.h)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  if (SDL_TEXTUREACCESS_STREAMING != access) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "texture must be streaming.");
+  }
+  if (SDL_ISPIXELFORMAT_FOURCC(pixel_format) || SDL_ISPIXELFORMAT_INDEXED(pixel_format)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported pixel format.");
+  }
+  region = full;
+  if (!mrb_nil_p(rect) && !SDL_IntersectRect(&full, mrb_sdl2_rect_get_ptr(mrb, rect), &region)) {
+    return texture;
+  }
+  format = SDL_AllocFormat(pixel_format);
+  if (NULL == format) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  if (!mrb_sdl2_pixels_buffer_format_p(format)) {
+    SDL_FreeFormat(format);
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported pixel format.");
+  }
+  if (0 != SDL_LockTexture(t, &region, &pixels, &pitch)) {
+    SDL_FreeFormat(format);
+    mruby_sdl2_raise_error(mrb);
+  }
+  local.x = local.y = 0;
+  local.w = region.w;
+  local.h = region.h;
+  mrb_sdl2_video_color_lut_apply(data, format, (Uint8*)pixels, pitch, &local);
+  SDL_UnlockTexture(t);
+  SDL_FreeFormat(format);
+  return texture;
+}
+
+static mrb_sdl2_video_color_lut_data_t *
+mrb_sdl2_video_color_lut_get_tables(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t *data = mrb_sdl2_video_color_lut_get_ptr(mrb, self);
+  if (NULL != data->cube) {
+    mrb_raise(mrb, E_TYPE_ERROR, "3D LUT has no per-channel tables.");
+  }
+  return data;
+}
+
+/*
+ * SDL2::Video::ColorLUT#tables
+ *
+ * Returns [red, green, blue], each an Array of 256 values (1D LUTs only).
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_tables(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t const *data = mrb_sdl2_video_color_lut_get_tables(mrb, self);
+  mrb_value tables[3];
+  int i, k;
+  for (k = 0; k < 3; ++k) {
+    tables[k] = mrb_ary_new_capa(mrb, 256);
+    for (i = 0; i < 256; ++i) {
+      mrb_ary_push(mrb, tables[k], mrb_fixnum_value(data->table[k][i]));
+    }
+  }
+  return mrb_ary_new_from_values(mrb, 3, tables);
+}
+
+/*
+ * SDL2::Video::ColorLUT#gamma_ramp
+ *
+ * Returns the tables scaled to 16 bits, ready for Window#gamma_ramp=.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_gamma_ramp(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t const *data = mrb_sdl2_video_color_lut_get_tables(mrb, self);
+  mrb_value ramps[3];
+  int i, k;
+  for (k = 0; k < 3; ++k) {
+    ramps[k] = mrb_ary_new_capa(mrb, 256);
+    for (i = 0; i < 256; ++i) {
+      mrb_ary_push(mrb, ramps[k], mrb_fixnum_value(data->table[k][i] * 257));
+    }
+  }
+  return mrb_ary_new_from_values(mrb, 3, ramps);
+}
+
+/*
+ * SDL2::Video::ColorLUT#then(other)
+ *
+ * Returns a LUT applying self and then 'other'. Both must be 1D.
+ */
+static mrb_value
+mrb_sdl2_video_color_lut_then(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t const *a = mrb_sdl2_video_color_lut_get_tables(mrb, self);
+  mrb_sdl2_video_color_lut_data_t const *b;
+  mrb_sdl2_video_color_lut_data_t *c;
+  mrb_value other, lut;
+  int i, k;
+  mrb_get_args(mrb, "o", &other);
+  b = mrb_sdl2_video_color_lut_get_tables(mrb, other);
+  lut = mrb_obj_new(mrb, class_ColorLUT, 0, NULL);
+  c = mrb_sdl2_video_color_lut_get_ptr(mrb, lut);
+  for (k = 0; k < 3; ++k) {
+    for (i = 0; i < 256; ++i) {
+      c->table[k][i] = b->table[k][a->table[k][i]];
+    }
+  }
+  return lut;
+}
+
+static mrb_value
+mrb_sdl2_video_color_lut_get_size(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t const *data = mrb_sdl2_video_color_lut_get_ptr(mrb, self);
+  return mrb_fixnum_value((NULL != data->cube) ? data->size : 256);
+}
+
+static mrb_value
+mrb_sdl2_video_color_lut_is_3d(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_color_lut_data_t const *data = mrb_sdl2_video_color_lut_get_ptr(mrb, self);
+  return mrb_bool_value(NULL != data->cube);
+}
+
+void
+mruby_sdl2_video_color_lut_init(mrb_state *mrb, struct RClass *mod_Video)
+{
+  class_ColorLUT = mrb_define_class_under(mrb, mod_Video, "ColorLUT", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_ColorLUT, MRB_TT_DATA);
+
+  mrb_define_class_method(mrb, class_ColorLUT, "gamma",     mrb_sdl2_video_color_lut_s_gamma,     MRB_ARGS_REQ(1) | MRB_ARGS_OPT(2));
+  mrb_define_class_method(mrb, class_ColorLUT, "curves",    mrb_sdl2_video_color_lut_s_curves,    MRB_ARGS_REQ(1) | MRB_ARGS_OPT(2));
+  mrb_define_class_method(mrb, class_ColorLUT, "load_cube", mrb_sdl2_video_color_lut_s_load_cube, MRB_ARGS_REQ(1));
+
+  mrb_define_method(mrb, class_ColorLUT, "initialize",    mrb_sdl2_video_color_lut_initialize,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ColorLUT, "apply",         mrb_sdl2_video_color_lut_apply_surface, MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_ColorLUT, "apply_texture", mrb_sdl2_video_color_lut_apply_texture, MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_ColorLUT, "tables",        mrb_sdl2_video_color_lut_tables,        MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ColorLUT, "gamma_ramp",    mrb_sdl2_video_color_lut_gamma_ramp,    MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ColorLUT, "then",          mrb_sdl2_video_color_lut_then,          MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_ColorLUT, "size",          mrb_sdl2_video_color_lut_get_size,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_ColorLUT, "three_d?",      mrb_sdl2_video_color_lut_is_3d,         MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_video_color_lut_final(mrb_state *mrb, struct RClass *mod_Video)
+{
+}
@@ -0,0 +1,289 @@
+#include "sdl2_video_indexed_texture.h"
+#include "sdl2_surface.h"
+#include "sdl2_render.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/variable.h"
+
+static struct RClass *class_IndexedTexture = NULL;
+
+/*
+ * 'shadow' holds the indices as last uploaded and 'lut' the palette as
+ * last expanded into the texture format, so an update can tell which
+ * pixels actually changed. The texture itself is only held by the
+ * __texture__ object, which may be destroyed independently.
+ */
+typedef struct mrb_sdl2_video_indexed_texture_data_t {
+  SDL_PixelFormat *format;
+  int              width;
+  int              height;
+  Uint8           *shadow;
+  Uint32           lut[256];
+  bool             uploaded;
+} mrb_sdl2_video_indexed_texture_data_t;
+
+static void
+mrb_sdl2_video_indexed_texture_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_video_indexed_texture_data_t *data =
+    (mrb_sdl2_video_indexed_texture_data_t*)p;
+  if (NULL != data) {
+    if (NULL != data->format) {
+      SDL_FreeFormat(data->format);
+    }
+    SDL_free(data->shadow);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_video_indexed_texture_data_type = {
+  "IndexedTexture", mrb_sdl2_video_indexed_texture_data_free
+};
+
+static mrb_sdl2_video_indexed_texture_data_t *
+mrb_sdl2_video_indexed_texture_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_indexed_texture_data_t *data =
+    (mrb_sdl2_video_indexed_texture_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_video_indexed_texture_data_type);
+  if ((NULL == data) || (NULL == data->shadow)) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized indexed texture.");
+  }
+  return data;
+}
+
+static SDL_Surface *
+mrb_sdl2_video_indexed_texture_surface(mrb_state *mrb, mrb_value surface)
+{
+  SDL_Surface *s = mrb_sdl2_video_surface_get_ptr(mrb, surface);
+  if (NULL == s) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface has been freed.");
+  }
+  if (SDL_PIXELFORMAT_INDEX8 != s->format->format) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface must be INDEX8.");
+  }
+  return s;
+}
+
+static SDL_Texture *
+mrb_sdl2_video_indexed_texture_texture(mrb_state *mrb, mrb_value self)
+{
+  SDL_Texture *texture =
+    mrb_sdl2_video_texture_get_ptr(mrb, mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__texture__")));
+  if (NULL == texture) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "texture has been destroyed.");
+  }
+  return texture;
+}
+
+/*
+ * SDL2::Video::IndexedTexture#initialize(renderer, surface, format = ARGB8888)
+ *
+ * Creates a streaming texture of the INDEX8 surface's size in a 32 bits
+ * per pixel 'format'. Call #update after changing the surface or its
+ * palette.
+ */
+static mrb_value
+mrb_sdl2_video_indexed_texture_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_indexed_texture_data_t *data;
+  mrb_value renderer, surface;
+  mrb_int format = SDL_PIXELFORMAT_ARGB8888;
+  SDL_Surface *s;
+  SDL_Texture *texture;
+  mrb_get_args(mrb, "oo|i", &renderer, &surface, &format);
+  s = mrb_sdl2_video_indexed_texture_surface(mrb, surface);
+
+  data = (mrb_sdl2_video_indexed_texture_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_video_indexed_texture_data_free(mrb, data);
+    DATA_PTR(self) = NULL;
+  }
+  data = (mrb_sdl2_video_indexed_texture_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_video_indexed_texture_data_t));
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_video_indexed_texture_data_type;
+
+  data->format = SDL_AllocFormat((Uint32)format);
+  if (NULL == data->format) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  if (4 != data->format->BytesPerPixel) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "texture format must be 32 bits per pixel.");
+  }
+  data->width  = s->w;
+  data->height = s->h;
+  data->shadow = (Uint8*)SDL_malloc((size_t)s->w * s->h + 1);
+  if (NULL == data->shadow) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+  texture = SDL_CreateTexture(mrb_sdl2_video_renderer_get_ptr(mrb, renderer),
+                              (Uint32)format, SDL_TEXTUREACCESS_STREAMING, s->w, s->h);
+  if (NULL == texture) {
+    SDL_free(data->shadow);
+    data->shadow = NULL;
+    mruby_sdl2_raise_error(mrb);
+  }
+  mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "__texture__"), mrb_sdl2_video_texture(mrb, texture));
+  mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "__surface__"), surface);
+  return self;
+}
+
+/* expands rows [y0, y1] and columns [x0, x1] through the LUT. */
+static int
+mrb_sdl2_video_indexed_texture_upload(SDL_Texture *texture, SDL_Surface const *s, Uint32 const *lut, int x0, int x1, int y0, int y1)
+{
+  SDL_Rect rect;
+  void *pixels;
+  int pitch, y, x;
+  rect.x = x0;
+  rect.y = y0;
+  rect.w = x1 - x0 + 1;
+  rect.h = y1 - y0 + 1;
+  if (0 != SDL_LockTexture(texture, &rect, &pixels, &pitch)) {
+    return -1;
+  }
+  for (y = 0; y < rect.h; ++y) {
+    Uint8 const *src = (Uint8 const*)s->pixels + (y0 + y) * s->pitch + x0;
+    Uint32 *dst = (Uint32*)((Uint8*)pixels + y * pitch);
+    for (x = 0; x < rect.w; ++x) {
+      dst[x] = lut[src[x]];
+    }
+  }
+  SDL_UnlockTexture(texture);
+  return 0;
+}
+
+/*
+ * SDL2::Video::IndexedTexture#update
+ *
+ * Re-uploads only the pixels whose index or palette color changed since
+ * the last update. Changed spans of consecutive rows are merged into one
+ * locked rect each. Returns the number of rects uploaded.
+ */
+static mrb_value
+mrb_sdl2_video_indexed_texture_update(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_indexed_texture_data_t *data = mrb_sdl2_video_indexed_texture_get_ptr(mrb, self);
+  SDL_Texture *texture = mrb_sdl2_video_indexed_texture_texture(mrb, self);
+  SDL_Surface *s = mrb_sdl2_video_indexed_texture_surface(mrb, mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__surface__")));
+  SDL_Palette const *palette = s->format->palette;
+  Uint32 lut[256];
+  bool changed[256];
+  bool palette_changed = false;
+  int band_y = -1, band_x0 = 0, band_x1 = 0;
+  int uploads = 0, failed = 0;
+  int i, x, y;
+
+  if ((s->w != data->width) || (s->h != data->height)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "surface size changed.");
+  }
+  for (i = 0; i < 256; ++i) {
+    lut[i] = (i < palette->ncolors) ?
+      SDL_MapRGBA(data->format, palette->colors[i].r, palette->colors[i].g, palette->colors[i].b, palette->colors[i].a) :
+      SDL_MapRGBA(data->format, 0, 0, 0, 0xff);
+    changed[i] = !data->uploaded || (lut[i] != data->lut[i]);
+    palette_changed = palette_changed || changed[i];
+  }
+
+  if (SDL_MUSTLOCK(s)) {
+    SDL_LockSurface(s);
+  }
+  for (y = 0; (y <= data->height) && (0 == failed); ++y) {
+    int lo = data->width, hi = -1;
+    if (y < data->height) {
+      Uint8 const *row = (Uint8 const*)s->pixels + y * s->pitch;
+      Uint8 *shadow = data->shadow + (size_t)y * data->width;
+      if (!data->uploaded) {
+        lo = 0;
+        hi = data->width - 1;
+      } else if (palette_changed || (0 != SDL_memcmp(row, shadow, data->width))) {
+        for (x = 0; x < data->width; ++x) {
+          if ((row[x] != shadow[x]) || changed[row[x]]) {
+            lo = x;
+            break;
+          }
+        }
+        for (x = data->width - 1; x >= lo; --x) {
+          if ((row[x] != shadow[x]) || changed[row[x]]) {
+            hi = x;
+            break;
+          }
+        }
+      }
+      if (lo <= hi) {
+        SDL_memcpy(shadow, row, data->width);
+        if (0 > band_y) {
+          band_y  = y;
+          band_x0 = lo;
+          band_x1 = hi;
+        } else {
+          band_x0 = SDL_min(band_x0, lo);
+          band_x1 = SDL_max(band_x1, hi);
+        }
+        continue;
+      }
+    }
+    if (0 <= band_y) {
+      failed = mrb_sdl2_video_indexed_texture_upload(texture, s, lut, band_x0, band_x1, band_y, y - 1);
+      band_y = -1;
+      ++uploads;
+    }
+  }
+  if (SDL_MUSTLOCK(s)) {
+    SDL_UnlockSurface(s);
+  }
+
+  if (0 != failed) {
+    data->uploaded = false;
+    mruby_sdl2_raise_error(mrb);
+  }
+  SDL_memcpy(data->lut, lut, sizeof(lut));
+  data->uploaded = true;
+  return mrb_fixnum_value(uploads);
+}
+
+/*
+ * SDL2::Video::IndexedTexture#invalidate
+ *
+ * Makes the next #update upload the whole texture.
+ */
+static mrb_value
+mrb_sdl2_video_indexed_texture_invalidate(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_indexed_texture_get_ptr(mrb, self)->uploaded = false;
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_video_indexed_texture_get_texture(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__texture__"));
+}
+
+static mrb_value
+mrb_sdl2_video_indexed_texture_get_surface(mrb_state *mrb, mrb_value self)
+{
+  return mrb_iv_get(mrb, self, mrb_intern_lit(mrb, "__surface__"));
+}
+
+void
+mruby_sdl2_video_indexed_texture_init(mrb_state *mrb, struct RClass *mod_Video)
+{
+  class_IndexedTexture = mrb_define_class_under(mrb, mod_Video, "IndexedTexture", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_IndexedTexture, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_IndexedTexture, "initialize", mrb_sdl2_video_indexed_texture_initialize,  MRB_ARGS_REQ(2) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_IndexedTexture, "update",     mrb_sdl2_video_indexed_texture_update,      MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_IndexedTexture, "invalidate", mrb_sdl2_video_indexed_texture_invalidate,  MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_IndexedTexture, "texture",    mrb_sdl2_video_indexed_texture_get_texture, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_IndexedTexture, "surface",    mrb_sdl2_video_indexed_texture_get_surface, MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_video_indexed_texture_final(mrb_state *mrb, struct RClass *mod_Video)
+{
+}
@@ -0,0 +1,571 @@
+#include "sdl2_video_y4m.h"
+#include "sdl2_surface.h"
+#include "sdl2_surface_filter.h"
+#include "sdl2_render.h"
+#include "sdl2_rect.h"
+#include "sdl2_rwops.h"
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/string.h"
+#include "mruby/variable.h"
+
+#define MRB_SDL2_Y4M_MAX_LINE 1024
+#define MRB_SDL2_Y4M_MAX_SLOTS 16
+#define MRB_SDL2_Y4M_MAX_SIZE  16384
+
+static struct RClass *class_Y4MReader = NULL;
+
+/*
+ * Frames are read into a ring of 'nslots' reusable buffers, each holding
+ * the Y, U and V planes back to back (I420 layout). With read ahead
+ * enabled a worker thread fills free slots while the caller presents the
+ * slot it holds; 'filled' slots follow the held one in ring order.
+ */
+typedef struct mrb_sdl2_video_y4m_data_t {
+  SDL_RWops  *rwops;
+  bool        owns_rwops;
+  int         width;
+  int         height;
+  int         chroma_width;
+  int         chroma_height;
+  int         rate_num;
+  int         rate_den;
+  size_t      frame_size;
+  Uint8      *slots;
+  int         nslots;
+  int         read_index;
+  int         filled;
+  bool        held;
+  bool        eof;
+  bool        error;
+  bool        quit;
+  mrb_int     frame_number;
+  SDL_mutex  *lock;
+  SDL_cond   *cond;
+  SDL_Thread *thread;
+} mrb_sdl2_video_y4m_data_t;
+
+static void
+mrb_sdl2_video_y4m_close(mrb_sdl2_video_y4m_data_t *data)
+{
+  if (NULL != data->thread) {
+    SDL_LockMutex(data->lock);
+    data->quit = true;
+    SDL_CondBroadcast(data->cond);
+    SDL_UnlockMutex(data->lock);
+    SDL_WaitThread(data->thread, NULL);
+    data->thread = NULL;
+  }
+  if (NULL != data->cond) {
+    SDL_DestroyCond(data->cond);
+    data->cond = NULL;
+  }
+  if (NULL != data->lock) {
+    SDL_DestroyMutex(data->lock);
+    data->lock = NULL;
+  }
+  if (NULL != data->slots) {
+    SDL_free(data->slots);
+    data->slots = NULL;
+  }
+  if ((NULL != data->rwops) && data->owns_rwops) {
+    SDL_RWclose(data->rwops);
+  }
+  data->rwops = NULL;
+  data->held  = false;
+  data->eof   = true;
+}
+
+static void
+mrb_sdl2_video_y4m_data_free(mrb_state *mrb, void *p)
+{
+  mrb_sdl2_video_y4m_data_t *data =
+    (mrb_sdl2_video_y4m_data_t*)p;
+  if (NULL != data) {
+    mrb_sdl2_video_y4m_close(data);
+    mrb_free(mrb, data);
+  }
+}
+
+static struct mrb_data_type const mrb_sdl2_video_y4m_data_type = {
+  "Y4MReader", mrb_sdl2_video_y4m_data_free
+};
+
+static mrb_sdl2_video_y4m_data_t *
+mrb_sdl2_video_y4m_get_ptr(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_data_t *data =
+    (mrb_sdl2_video_y4m_data_t*)mrb_data_get_ptr(mrb, self, &mrb_sdl2_video_y4m_data_type);
+  if (NULL == data) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "uninitialized Y4M reader.");
+  }
+  return data;
+}
+
+/***************************************************************************
+*
+* YUV to RGB
+*
+***************************************************************************/
+
+typedef struct mrb_sdl2_video_i420_job_t {
+  Uint8 const *y;
+  Uint8 const *u;
+  Uint8 const *v;
+  int          width;
+  int          height;
+  SDL_Surface *surface;
+} mrb_sdl2_video_i420_job_t;
+
+static inline Uint32
+mrb_sdl2_video_clip8(int v)
+{
+  return (Uint32)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+}
+
+/*
+ * BT.601 limited range, 8.8 fixed point. Each band covers chroma rows and
+ * writes the two luma rows that share them.
+ */
+static void
+mrb_sdl2_video_i420_band(void *p, int begin, int end)
+{
+  mrb_sdl2_video_i420_job_t const *job = (mrb_sdl2_video_i420_job_t*)p;
+  SDL_PixelFormat const *f = job->surface->format;
+  int const cw = (job->width + 1) / 2;
+  int const w = SDL_min(job->width, job->surface->w);
+  int const h = SDL_min(job->height, job->surface->h);
+  Uint32 const rs = f->Rshift, gs = f->Gshift, bs = f->Bshift, amask = f->Amask;
+  int j, k, x;
+  for (j = begin; j < end; ++j) {
+    Uint8 const *u = job->u + j * cw;
+    Uint8 const *v = job->v + j * cw;
+    for (k = 0; k < 2; ++k) {
+      int const row = j * 2 + k;
+      Uint8 const *y;
+      Uint32 *d;
+      if (row >= h) {
+        break;
+      }
+      y = job->y + row * job->width;
+      d = (Uint32*)((Uint8*)job->surface->pixels + row * job->surface->pitch);
+      for (x = 0; x < w; ++x) {
+        int const c = 298 * (y[x] - 16) + 128;
+        int const du = u[x >> 1] - 128;
+        int const dv = v[x >> 1] - 128;
+        d[x] = (mrb_sdl2_video_clip8((c + 409 * dv) >> 8) << rs) |
+               (mrb_sdl2_video_clip8((c - 100 * du - 208 * dv) >> 8) << gs) |
+               (mrb_sdl2_video_clip8((c + 516 * du) >> 8) << bs) |
+               amask;
+      }
+    }
+  }
+}
+
+/*
+ * Converts I420 planes into a 32 bits per pixel surface with 8-bit
+ * channels. Rows are split across threads; the per-pixel loop is plain
+ * integer arithmetic the compiler can vectorize.
+ */
+void
+mrb_sdl2_video_i420_to_surface(Uint8 const *y, Uint8 const *u, Uint8 const *v, int width, int height, SDL_Surface *surface)
+{
+  mrb_sdl2_video_i420_job_t job;
+  job.y       = y;
+  job.u       = u;
+  job.v       = v;
+  job.width   = width;
+  job.height  = height;
+  job.surface = surface;
+  if (SDL_MUSTLOCK(surface)) {
+    SDL_LockSurface(surface);
+  }
+  mrb_sdl2_video_surface_parallel_for((SDL_min(height, surface->h) + 1) / 2, 16, mrb_sdl2_video_i420_band, &job);
+  if (SDL_MUSTLOCK(surface)) {
+    SDL_UnlockSurface(surface);
+  }
+}
+
+/***************************************************************************
+*
+* Y4M parsing
+*
+***************************************************************************/
+
+/* reads one '\n' terminated line; returns its length, or -1 at EOF. */
+static int
+mrb_sdl2_video_y4m_read_line(SDL_RWops *rw, char *line, int size)
+{
+  int n = 0;
+  char c;
+  while (1 == SDL_RWread(rw, &c, 1, 1)) {
+    if ('\n' == c) {
+      line[n] = '\0';
+      return n;
+    }
+    if (n + 1 < size) {
+      line[n++] = c;
+    }
+  }
+  line[n] = '\0';
+  return (0 == n) ? -1 : n;
+}
+
+static bool
+mrb_sdl2_video_y4m_parse_header(mrb_sdl2_video_y4m_data_t *data, char *line)
+{
+  char *token = line;
+  data->width    = 0;
+  data->height   = 0;
+  data->rate_num = 25;
+  data->rate_den = 1;
+  if (0 != SDL_strncmp(line, "YUV4MPEG2", 9)) {
+    return false;
+  }
+  while (NULL != token) {
+    char *next = SDL_strchr(token, ' ');
+    if (NULL != next) {
+      *next++ = '\0';
+    }
+    switch (token[0]) {
+    case 'W':
+      data->width = SDL_atoi(token + 1);
+      break;
+    case 'H':
+      data->height = SDL_atoi(token + 1);
+      break;
+    case 'F':
+      data->rate_num = SDL_atoi(token + 1);
+      data->rate_den = SDL_strchr(token, ':') ? SDL_atoi(SDL_strchr(token, ':') + 1) : 1;
+      break;
+    case 'C':
+      /* 8-bit 4:2:0 only; C420p10 and friends have 16-bit samples. */
+      if ((0 != SDL_strcmp(token, "C420")) && (0 != SDL_strcmp(token, "C420jpeg")) &&
+          (0 != SDL_strcmp(token, "C420paldv")) && (0 != SDL_strcmp(token, "C420mpeg2"))) {
+        return false;
+      }
+      break;
+    default:
+      break;
+    }
+    token = next;
+  }
+  return (0 < data->width) && (MRB_SDL2_Y4M_MAX_SIZE >= data->width) &&
+         (0 < data->height) && (MRB_SDL2_Y4M_MAX_SIZE >= data->height);
+}
+
+/* returns 1 on success, 0 at end of stream and -1 on a malformed frame. */
+static int
+mrb_sdl2_video_y4m_read_frame(mrb_sdl2_video_y4m_data_t *data, Uint8 *dst)
+{
+  char line[MRB_SDL2_Y4M_MAX_LINE];
+  if (0 > mrb_sdl2_video_y4m_read_line(data->rwops, line, sizeof(line))) {
+    return 0;
+  }
+  if (0 != SDL_strncmp(line, "FRAME", 5)) {
+    return -1;
+  }
+  if (1 != SDL_RWread(data->rwops, dst, data->frame_size, 1)) {
+    return 0;
+  }
+  return 1;
+}
+
+static int
+mrb_sdl2_video_y4m_worker(void *p)
+{
+  mrb_sdl2_video_y4m_data_t *data = (mrb_sdl2_video_y4m_data_t*)p;
+  for (;;) {
+    int index, result;
+    SDL_LockMutex(data->lock);
+    while (!data->quit && (data->filled + (data->held ? 1 : 0) >= data->nslots)) {
+      SDL_CondWait(data->cond, data->lock);
+    }
+    if (data->quit) {
+      SDL_UnlockMutex(data->lock);
+      break;
+    }
+    index = (data->read_index + (data->held ? 1 : 0) + data->filled) % data->nslots;
+    SDL_UnlockMutex(data->lock);
+
+    /* the slot is owned by this thread until 'filled' is raised. */
+    result = mrb_sdl2_video_y4m_read_frame(data, data->slots + index * data->frame_size);
+
+    SDL_LockMutex(data->lock);
+    if (0 < result) {
+      ++data->filled;
+    } else {
+      data->eof   = true;
+      data->error = (0 > result);
+    }
+    SDL_CondBroadcast(data->cond);
+    SDL_UnlockMutex(data->lock);
+    if (0 >= result) {
+      break;
+    }
+  }
+  return 0;
+}
+
+static Uint8 const *
+mrb_sdl2_video_y4m_current(mrb_state *mrb, mrb_sdl2_video_y4m_data_t *data)
+{
+  if (!data->held) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "no frame; call next_frame first.");
+  }
+  return data->slots + data->read_index * data->frame_size;
+}
+
+/***************************************************************************
+*
+* class SDL2::Video::Y4MReader
+*
+***************************************************************************/
+
+/*
+ * SDL2::Video::Y4MReader#initialize(source, read_ahead = 3)
+ *
+ * 'source' is a file name or an SDL2::RWops. With a positive 'read_ahead'
+ * a worker thread decodes up to that many frames ahead; the RWops must not
+ * be used elsewhere while the reader is open.
+ */
+static mrb_value
+mrb_sdl2_video_y4m_initialize(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_data_t *data;
+  mrb_value source;
+  mrb_int read_ahead = 3;
+  char line[MRB_SDL2_Y4M_MAX_LINE];
+  mrb_get_args(mrb, "o|i", &source, &read_ahead);
+
+  data = (mrb_sdl2_video_y4m_data_t*)DATA_PTR(self);
+  if (NULL != data) {
+    mrb_sdl2_video_y4m_close(data);
+  } else {
+    data = (mrb_sdl2_video_y4m_data_t*)mrb_malloc(mrb, sizeof(mrb_sdl2_video_y4m_data_t));
+    if (NULL == data) {
+      mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+    }
+  }
+  SDL_memset(data, 0, sizeof(*data));
+  DATA_PTR(self) = data;
+  DATA_TYPE(self) = &mrb_sdl2_video_y4m_data_type;
+
+  if (mrb_string_p(source)) {
+    data->rwops = SDL_RWFromFile(RSTRING_PTR(source), "rb");
+    data->owns_rwops = true;
+    if (NULL == data->rwops) {
+      mruby_sdl2_raise_error(mrb);
+    }
+  } else {
+    data->rwops = mrb_sdl2_rwops_get_ptr(mrb, source);
+    if (NULL == data->rwops) {
+      mrb_raise(mrb, E_ARGUMENT_ERROR, "cannot read from nil.");
+    }
+    mrb_iv_set(mrb, self, mrb_intern_lit(mrb, "__rwops__"), source);
+  }
+
+  if ((0 > mrb_sdl2_video_y4m_read_line(data->rwops, line, sizeof(line))) ||
+      !mrb_sdl2_video_y4m_parse_header(data, line)) {
+    mrb_sdl2_video_y4m_close(data);
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "not a 4:2:0 YUV4MPEG2 stream.");
+  }
+  data->chroma_width  = (data->width + 1) / 2;
+  data->chroma_height = (data->height + 1) / 2;
+  data->frame_size    = (size_t)data->width * data->height +
+                        (size_t)data->chroma_width * data->chroma_height * 2;
+  data->nslots = (0 < read_ahead) ? (int)SDL_min(read_ahead + 1, MRB_SDL2_Y4M_MAX_SLOTS) : 1;
+  data->slots  = (Uint8*)SDL_malloc(data->frame_size * data->nslots);
+  if (NULL == data->slots) {
+    mrb_sdl2_video_y4m_close(data);
+    mrb_raise(mrb, E_RUNTIME_ERROR, "insufficient memory.");
+  }
+
+  if (1 < data->nslots) {
+    data->lock = SDL_CreateMutex();
+    data->cond = SDL_CreateCond();
+    if ((NULL == data->lock) || (NULL == data->cond)) {
+      mrb_sdl2_video_y4m_close(data);
+      mruby_sdl2_raise_error(mrb);
+    }
+    data->thread = SDL_CreateThread(mrb_sdl2_video_y4m_worker, "mruby-sdl2-y4m", data);
+    if (NULL == data->thread) {
+      mrb_sdl2_video_y4m_close(data);
+      mruby_sdl2_raise_error(mrb);
+    }
+  }
+  return self;
+}
+
+/*
+ * SDL2::Video::Y4MReader#next_frame
+ *
+ * Releases the current frame and makes the next one current. Returns
+ * false at the end of the stream.
+ */
+static mrb_value
+mrb_sdl2_video_y4m_next_frame(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_data_t *data = mrb_sdl2_video_y4m_get_ptr(mrb, self);
+  bool ok = false;
+  if (NULL == data->slots) {
+    return mrb_false_value();
+  }
+  if (NULL == data->thread) {
+    int const result = data->eof ? 0 : mrb_sdl2_video_y4m_read_frame(data, data->slots);
+    data->held  = (0 < result);
+    data->eof   = (0 >= result);
+    data->error = (0 > result);
+    ok = data->held;
+  } else {
+    SDL_LockMutex(data->lock);
+    if (data->held) {
+      data->read_index = (data->read_index + 1) % data->nslots;
+      data->held = false;
+      SDL_CondBroadcast(data->cond);
+    }
+    while ((0 == data->filled) && !data->eof) {
+      SDL_CondWait(data->cond, data->lock);
+    }
+    if (0 < data->filled) {
+      --data->filled;
+      data->held = true;
+      ok = true;
+    }
+    SDL_UnlockMutex(data->lock);
+  }
+  if (!ok && data->error) {
+    mrb_raise(mrb, E_RUNTIME_ERROR, "malformed Y4M frame.");
+  }
+  if (ok) {
+    ++data->frame_number;
+  }
+  return mrb_bool_value(ok);
+}
+
+/*
+ * SDL2::Video::Y4MReader#update_texture(texture, rect = nil)
+ *
+ * Uploads the current frame to a YV12/IYUV texture with
+ * SDL_UpdateYUVTexture, straight from the plane buffers.
+ */
+static mrb_value
+mrb_sdl2_video_y4m_update_texture(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_data_t *data = mrb_sdl2_video_y4m_get_ptr(mrb, self);
+  mrb_value texture, rect = mrb_nil_value();
+  Uint8 const *y, *u, *v;
+  mrb_get_args(mrb, "o|o", &texture, &rect);
+  y = mrb_sdl2_video_y4m_current(mrb, data);
+  u = y + (size_t)data->width * data->height;
+  v = u + (size_t)data->chroma_width * data->chroma_height;
+  if (0 != SDL_UpdateYUVTexture(mrb_sdl2_video_texture_get_ptr(mrb, texture),
+                                mrb_sdl2_rect_get_ptr(mrb, rect),
+                                y, data->width, u, data->chroma_width, v, data->chroma_width)) {
+    mruby_sdl2_raise_error(mrb);
+  }
+  return self;
+}
+
+/*
+ * SDL2::Video::Y4MReader#to_surface(surface)
+ *
+ * Converts the current frame to RGB into a 32 bits per pixel surface.
+ */
+static mrb_value
+mrb_sdl2_video_y4m_to_surface(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_data_t *data = mrb_sdl2_video_y4m_get_ptr(mrb, self);
+  mrb_value surface;
+  SDL_Surface *s;
+  Uint8 const *y;
+  mrb_get_args(mrb, "o", &surface);
+  s = mrb_sdl2_video_surface_get_ptr(mrb, surface);
+  if (NULL == s) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "cannot convert into nil.");
+  }
+  if ((4 != s->format->BytesPerPixel) || (0 != s->format->Rloss) || (0 != s->format->Gloss) || (0 != s->format->Bloss)) {
+    mrb_raise(mrb, E_ARGUMENT_ERROR, "unsupported pixel format (expected 32 bits per pixel).");
+  }
+  y = mrb_sdl2_video_y4m_current(mrb, data);
+  mrb_sdl2_video_i420_to_surface(y,
+                                 y + (size_t)data->width * data->height,
+                                 y + (size_t)data->width * data->height + (size_t)data->chroma_width * data->chroma_height,
+                                 data->width, data->height, s);
+  return surface;
+}
+
+static mrb_value
+mrb_sdl2_video_y4m_close_method(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_close(mrb_sdl2_video_y4m_get_ptr(mrb, self));
+  return self;
+}
+
+static mrb_value
+mrb_sdl2_video_y4m_get_width(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_video_y4m_get_ptr(mrb, self)->width);
+}
+
+static mrb_value
+mrb_sdl2_video_y4m_get_height(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_video_y4m_get_ptr(mrb, self)->height);
+}
+
+static mrb_value
+mrb_sdl2_video_y4m_get_frame_rate(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_data_t *data = mrb_sdl2_video_y4m_get_ptr(mrb, self);
+  if (0 == data->rate_den) {
+    return mrb_float_value(mrb, 0.0);
+  }
+  return mrb_float_value(mrb, (mrb_float)data->rate_num / data->rate_den);
+}
+
+static mrb_value
+mrb_sdl2_video_y4m_get_frame_number(mrb_state *mrb, mrb_value self)
+{
+  return mrb_fixnum_value(mrb_sdl2_video_y4m_get_ptr(mrb, self)->frame_number);
+}
+
+static mrb_value
+mrb_sdl2_video_y4m_is_eof(mrb_state *mrb, mrb_value self)
+{
+  mrb_sdl2_video_y4m_data_t *data = mrb_sdl2_video_y4m_get_ptr(mrb, self);
+  bool eof;
+  if (NULL == data->lock) {
+    return mrb_bool_value(data->eof);
+  }
+  SDL_LockMutex(data->lock);
+  eof = data->eof && (0 == data->filled);
+  SDL_UnlockMutex(data->lock);
+  return mrb_bool_value(eof);
+}
+
+void
+mruby_sdl2_video_y4m_init(mrb_state *mrb, struct RClass *mod_Video)
+{
+  class_Y4MReader = mrb_define_class_under(mrb, mod_Video, "Y4MReader", mrb->object_class);
+
+  MRB_SET_INSTANCE_TT(class_Y4MReader, MRB_TT_DATA);
+
+  mrb_define_method(mrb, class_Y4MReader, "initialize",     mrb_sdl2_video_y4m_initialize,       MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Y4MReader, "next_frame",     mrb_sdl2_video_y4m_next_frame,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Y4MReader, "update_texture", mrb_sdl2_video_y4m_update_texture,   MRB_ARGS_REQ(1) | MRB_ARGS_OPT(1));
+  mrb_define_method(mrb, class_Y4MReader, "to_surface",     mrb_sdl2_video_y4m_to_surface,       MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, class_Y4MReader, "close",          mrb_sdl2_video_y4m_close_method,     MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Y4MReader, "width",          mrb_sdl2_video_y4m_get_width,        MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Y4MReader, "height",         mrb_sdl2_video_y4m_get_height,       MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Y4MReader, "frame_rate",     mrb_sdl2_video_y4m_get_frame_rate,   MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Y4MReader, "frame_number",   mrb_sdl2_video_y4m_get_frame_number, MRB_ARGS_NONE());
+  mrb_define_method(mrb, class_Y4MReader, "eof?",           mrb_sdl2_video_y4m_is_eof,           MRB_ARGS_NONE());
+}
+
+void
+mruby_sdl2_video_y4m_final(mrb_state *mrb, struct RClass *mod_Video)
+{
+}
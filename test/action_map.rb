@@ -0,0 +1,94 @@
+##
+# SDL2::Input::ActionMap test
+
+SDL2::init
+begin
+  assert('SDL2::Input::ActionMap#initialize') do
+    m = SDL2::Input::ActionMap.new(8)
+    m.count == 8 && SDL2::Input::ActionMap.new.count == 64
+  end
+  assert('SDL2::Input::ActionMap#initialize rejects bad counts') do
+    assert_raise(ArgumentError) { SDL2::Input::ActionMap.new(0) }
+    assert_raise(ArgumentError) { SDL2::Input::ActionMap.new(257) }
+    true
+  end
+  assert('SDL2::Input::ActionMap#bind_key') do
+    m = SDL2::Input::ActionMap.new(4)
+    m.bind_key(0, 4).bind_mouse(1, 1).bind_axis(2, 0, 8000).update
+    m.state(0) == 0 && !m.held?(0) && m.held_mask == 0
+  end
+  assert('SDL2::Input::ActionMap#bind_key rejects bad actions') do
+    m = SDL2::Input::ActionMap.new(4)
+    assert_raise(ArgumentError) { m.bind_key(4, 4) }
+    assert_raise(ArgumentError) { m.bind_mouse(0, 32) }
+    assert_raise(ArgumentError) { m.bind_axis(0, 0, 0) }
+    assert_raise(ArgumentError) { m.state(-1) }
+    true
+  end
+  input = SDL2::Input
+  # controller button events carry the button in the low byte of 'code'.
+  button = lambda { |type, b| input::UserEvent.new(type, b) }
+  down = input::SDL_CONTROLLERBUTTONDOWN
+  up = input::SDL_CONTROLLERBUTTONUP
+  assert('SDL2::Input::ActionMap#feed latches press, hold and release') do
+    m = SDL2::Input::ActionMap.new(4)
+    m.bind_button(0, 1)
+    m.feed(button.call(down, 1)).update
+    pressed = m.pressed?(0) && m.held?(0) && !m.released?(0)
+    m.update
+    held = !m.pressed?(0) && m.held?(0) && m.held_mask == 1
+    m.feed(button.call(up, 1)).update
+    released = m.released?(0) && !m.held?(0) && m.released_mask == 1
+    m.update
+    pressed && held && released && m.state(0) == 0
+  end
+  assert('SDL2::Input::ActionMap#feed sees taps shorter than a frame') do
+    m = SDL2::Input::ActionMap.new(4)
+    m.bind_button(0, 1)
+    m.feed(button.call(down, 1)).feed(button.call(up, 1)).update
+    m.state(0) == (SDL2::Input::ActionMap::PRESSED | SDL2::Input::ActionMap::RELEASED)
+  end
+  assert('SDL2::Input::ActionMap holds an action while any input holds it') do
+    m = SDL2::Input::ActionMap.new(4)
+    m.bind_button(2, 1).bind_button(2, 2).bind_joy_button(2, 3)
+    m.feed(button.call(down, 1)).feed(button.call(down, 2))
+    m.feed(button.call(input::SDL_JOYBUTTONDOWN, 3)).update
+    m.feed(button.call(up, 1)).feed(button.call(input::SDL_JOYBUTTONUP, 3)).update
+    partial = m.held?(2) && !m.released?(2) && !m.pressed?(2)
+    m.feed(button.call(up, 2)).update
+    partial && m.released?(2) && !m.held?(2)
+  end
+  assert('SDL2::Input::ActionMap#bind_button releases held actions') do
+    m = SDL2::Input::ActionMap.new(4)
+    m.bind_button(0, 1)
+    m.feed(button.call(down, 1)).update
+    m.bind_button(1, 2).update
+    m.released?(0) && !m.held?(0)
+  end
+  assert('SDL2::Input::ActionMap#attach follows the queue with axis coalescing on') do
+    filter = SDL2::Input::Filter
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    m = SDL2::Input::ActionMap.new(4)
+    m.bind_button(0, 1).attach
+    filter.install
+    filter.coalesce_axis = true
+    input.push(input::UserEvent.new(input::SDL_CONTROLLERAXISMOTION, 0))
+    input.push(button.call(down, 1))
+    m.update
+    held = m.held?(0)
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    filter.coalesce_axis = false
+    filter.uninstall
+    m.detach
+    held
+  end
+  assert('SDL2::Input::ActionMap#attach') do
+    m = SDL2::Input::ActionMap.new(4)
+    m.attach
+    a = m.attached?
+    m.detach
+    a && !m.attached?
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,67 @@
+##
+# SDL2::Input::Channel test
+
+SDL2::init
+begin
+  assert('SDL2::Input::Channel#post and #receive') do
+    c = SDL2::Input::Channel.new
+    payload = { :name => "a\0b", 1 => [1.5, nil, true, false, :sym], "h" => {} }
+    c.post(7, payload)
+    code, got = c.receive
+    code == 7 && got == payload && c.receive.nil?
+  end
+  assert('SDL2::Input::Channel keeps symbol names') do
+    c = SDL2::Input::Channel.new
+    c.post(0, [:"a b", :"x=", :plain])
+    c.receive == [0, [:"a b", :"x=", :plain]]
+  end
+  assert('SDL2::Input::Channel from a worker VM') do
+    c = SDL2::Input::Channel.new
+    id = c.id
+    t = SDL2::Thread.new do
+      out = SDL2::Input::Channel.open(id)
+      100.times { |i| out.post(i, { :index => i, :"a b" => [i, "m#{i}"] }) }
+      0
+    end
+    t.wait
+    codes = []
+    payloads_ok = true
+    n = c.each do |code, payload|
+      codes << code
+      payloads_ok &&= payload == { :index => code, :"a b" => [code, "m#{code}"] }
+    end
+    n == 100 && codes == (0...100).to_a && payloads_ok && c.pending == 0
+  end
+  assert('SDL2::Input::Channel#each') do
+    c = SDL2::Input::Channel.new
+    3.times { |i| c.post(i, "m#{i}") }
+    codes = []
+    n = c.each { |code, payload| codes << code }
+    n == 3 && codes == [0, 1, 2] && c.pending == 0 && c.posted == 3 && c.received == 3
+  end
+  assert('SDL2::Input::Channel.open') do
+    c = SDL2::Input::Channel.new
+    SDL2::Input::Channel.open(c.id).post(1, 2)
+    c.receive == [1, 2]
+  end
+  assert('SDL2::Input::Channel moves buffers') do
+    c = SDL2::Input::Channel.new
+    b = SDL2::IntBuffer.new([1, 2, 3])
+    c.post(0, b)
+    got = c.receive[1]
+    b.size == 0 && got.class == SDL2::IntBuffer && got.to_a == [1, 2, 3]
+  end
+  assert('SDL2::Input::Channel#post rejects a buffer sent twice') do
+    c = SDL2::Input::Channel.new
+    b = SDL2::IntBuffer.new([1, 2, 3])
+    assert_raise(ArgumentError) { c.post(0, [b, b]) }
+    c.pending == 0 && b.to_a == [1, 2, 3]
+  end
+  assert('SDL2::Input::Channel#post rejects unsupported payloads') do
+    c = SDL2::Input::Channel.new
+    assert_raise(TypeError) { c.post(0, Object.new) }
+    c.pending == 0
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,26 @@
+##
+# SDL2::Video::ColorLUT test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  assert('SDL2::Video::ColorLUT#apply grades direct colour surfaces') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *argb)
+    s.fill_rect(64, 64, 64, 255)
+    SDL2::Video::ColorLUT.gamma(2.0).apply(s)
+    c = s.get_pixel(1, 1)
+    (c >> 24) == 0xff && (c & 0xff) > 64 && (c & 0xff) == ((c >> 8) & 0xff)
+  end
+  assert('SDL2::Video::ColorLUT#apply leaves shared palettes alone') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 8, 0, 0, 0, 0)
+    shared = SDL2::Pixels::Palette.new(256)
+    shared.set_color(64, 64, 64, 255, 0, 1)
+    s.format.set_palette(shared)
+    SDL2::Video::ColorLUT.gamma(2.0).apply(s)
+    graded = s.format.get_rgb(0)
+    shared.set_color(10, 20, 30, 255, 0, 1)
+    graded[0] > 64 && s.format.get_rgb(0) == graded
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,62 @@
+##
+# SDL2::DirtyRegion test
+
+SDL2::init
+begin
+  assert('SDL2::DirtyRegion.add merges adjacent rects') do
+    d = SDL2::DirtyRegion.new(640, 480)
+    d.add(0, 0, 10, 10)
+    d.add(10, 0, 10, 10)
+    d.count == 1 && d.rects[0] == SDL2::Rect.new(0, 0, 20, 10)
+  end
+  assert('SDL2::DirtyRegion.add keeps distant rects apart') do
+    d = SDL2::DirtyRegion.new(640, 480)
+    d << SDL2::Rect.new(0, 0, 10, 10)
+    d << SDL2::Rect.new(300, 300, 10, 10)
+    d.count == 2 && !d.full?
+  end
+  assert('SDL2::DirtyRegion.add clips to the region') do
+    d = SDL2::DirtyRegion.new(100, 100)
+    d.add(-10, -10, 20, 20)
+    d.add(500, 500, 10, 10)
+    d.count == 1 && d.rects[0] == SDL2::Rect.new(0, 0, 10, 10)
+  end
+  assert('SDL2::DirtyRegion.full?') do
+    d = SDL2::DirtyRegion.new(100, 100, 0.5)
+    d.add(0, 0, 100, 60)
+    d.full? && d.count == 1 && d.rects[0] == SDL2::Rect.new(0, 0, 100, 100) &&
+    d.clear.empty?
+  end
+  assert('SDL2::DirtyRegion.max_rects') do
+    d = SDL2::DirtyRegion.new(1000, 1000)
+    d.merge_slack = 0
+    d.max_rects = 4
+    10.times { |i| d.add(i * 100, i * 100, 5, 5) }
+    d.count <= 4
+  end
+  assert('SDL2::DirtyRegion.threshold= validates its range') do
+    d = SDL2::DirtyRegion.new(100, 100)
+    d.threshold = 1.0
+    assert_raise(ArgumentError) { d.threshold = -0.1 }
+    assert_raise(ArgumentError) { d.threshold = 1.5 }
+    assert_raise(ArgumentError) { SDL2::DirtyRegion.new(100, 100, 2.0) }
+    d.threshold == 1.0
+  end
+  assert('SDL2::DirtyRegion.update_texture checks the texture format') do
+    argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+    target = SDL2::Video::Surface.new(0, 16, 16, 32, *argb)
+    renderer = SDL2::Video::Renderer.new(target)
+    surface = SDL2::Video::Surface.new(0, 16, 16, 32, *argb)
+    streaming = SDL2::Video::Texture::SDL_TEXTUREACCESS_STREAMING
+    same = SDL2::Video::Texture.new(renderer, SDL2::Pixels::SDL_PIXELFORMAT_ARGB8888, streaming, 16, 16)
+    other = SDL2::Video::Texture.new(renderer, SDL2::Pixels::SDL_PIXELFORMAT_ABGR8888, streaming, 16, 16)
+    small = SDL2::Video::Texture.new(renderer, SDL2::Pixels::SDL_PIXELFORMAT_ARGB8888, streaming, 8, 8)
+    d = SDL2::DirtyRegion.new(16, 16)
+    d.add(0, 0, 4, 4)
+    assert_raise(ArgumentError) { d.update_texture(other, surface) }
+    assert_raise(ArgumentError) { d.update_texture(small, surface) }
+    d.update_texture(same, surface) == 1 && d.empty?
+  end
+ensure
+  SDL2::quit
+end
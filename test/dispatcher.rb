@@ -0,0 +1,72 @@
+##
+# SDL2::Input::Dispatcher test
+
+SDL2::init
+begin
+  assert('SDL2::Input::Dispatcher#on') do
+    d = SDL2::Input::Dispatcher.new
+    d.on(SDL2::Input::SDL_KEYDOWN) { |e| e }
+    d.handles?(SDL2::Input::SDL_KEYDOWN) && !d.handles?(SDL2::Input::SDL_KEYUP)
+  end
+  assert('SDL2::Input::Dispatcher#off') do
+    d = SDL2::Input::Dispatcher.new
+    d.on(SDL2::Input::SDL_KEYDOWN) { |e| e }
+    d.on(SDL2::Input::SDL_KEYDOWN, 32) { |e| e }
+    d.off(SDL2::Input::SDL_KEYDOWN)
+    !d.handles?(SDL2::Input::SDL_KEYDOWN)
+  end
+  assert('SDL2::Input::Dispatcher#off keeps the other handlers in order') do
+    input = SDL2::Input
+    d = SDL2::Input::Dispatcher.new
+    seen = []
+    d.on(input::SDL_KEYDOWN) { |e| seen << :key }
+    d.on(input::SDL_USEREVENT) { |e| seen << 1 }
+    d.on(input::SDL_KEYDOWN, 32) { |e| seen << :space }
+    d.off(input::SDL_KEYDOWN)
+    d.on(input::SDL_USEREVENT) { |e| seen << 2 }
+    d.dispatch(input::UserEvent.new(input::SDL_USEREVENT, 0))
+    seen == [1, 2] && !d.handles?(input::SDL_KEYDOWN)
+  end
+  assert('SDL2::Input::Dispatcher#off reclaims handler slots') do
+    d = SDL2::Input::Dispatcher.new
+    70000.times do
+      d.on(SDL2::Input::SDL_KEYDOWN) { |e| e }
+      d.off(SDL2::Input::SDL_KEYDOWN)
+    end
+    !d.handles?(SDL2::Input::SDL_KEYDOWN)
+  end
+  assert('SDL2::Input::Dispatcher#on rejects bad arguments') do
+    d = SDL2::Input::Dispatcher.new
+    assert_raise(ArgumentError) { d.on(0) { } }
+    assert_raise(ArgumentError) { d.on(SDL2::Input::SDL_KEYDOWN) }
+    assert_raise(ArgumentError) { d.on(SDL2::Input::SDL_QUIT, 1) { } }
+    assert_raise(ArgumentError) { d.on(0x2000) { } } # SDL_RENDER_TARGETS_RESET
+    true
+  end
+  assert('SDL2::Input::Dispatcher#pump discards unhandled events') do
+    input = SDL2::Input
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    d = SDL2::Input::Dispatcher.new
+    d.on(input::SDL_USEREVENT) { |e| e }
+    input.push(input::UserEvent.new(input::SDL_USEREVENT + 1, 1, 'dropped'))
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 2))
+    d.pump == 1 && d.skipped == 1 && input.poll.nil?
+  end
+  assert('SDL2::Input::Dispatcher#pump requeues the batch when a handler raises') do
+    input = SDL2::Input
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    d = SDL2::Input::Dispatcher.new
+    d.on(input::SDL_USEREVENT) { |e| raise 'boom' if e.code == 1 }
+    (1..3).each { |code| input.push(input::UserEvent.new(input::SDL_USEREVENT, code)) }
+    assert_raise(RuntimeError) { d.pump }
+    rest = [input.poll, input.poll, input.poll]
+    rest[0].code == 2 && rest[1].code == 3 && rest[2].nil?
+  end
+  assert('SDL2::Input::Dispatcher#dispatch skips unhandled events') do
+    d = SDL2::Input::Dispatcher.new
+    d.on(SDL2::Input::SDL_KEYDOWN) { |e| e }
+    !d.dispatch(SDL2::Input::Event.new) && d.skipped == 1 && d.dispatched == 0
+  end
+ensure
+  SDL2::quit
+end
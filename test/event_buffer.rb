@@ -0,0 +1,51 @@
+##
+# SDL2::Input::EventBuffer test
+
+SDL2::init
+begin
+  first = SDL2::Input::SDL_USEREVENT
+  last = SDL2::Input::SDL_LASTEVENT
+  assert('SDL2::Input.poll_all fills the buffer') do
+    SDL2::Input.flush(SDL2::Input::SDL_FIRSTEVENT, last)
+    buf = SDL2::Input::EventBuffer.new(4)
+    3.times { |i| SDL2::Input.push(SDL2::Input::UserEvent.new(first, i)) }
+    SDL2::Input.poll_all(buf, first, last) == 3 && buf.size == 3 &&
+    buf.count(first) == 3 && buf.type(2) == first && buf.code(1) == 1
+  end
+  assert('SDL2::Input::EventBuffer#[] returns user events once') do
+    SDL2::Input.flush(SDL2::Input::SDL_FIRSTEVENT, last)
+    buf = SDL2::Input::EventBuffer.new
+    SDL2::Input.push(SDL2::Input::UserEvent.new(first, 7, 'payload', 42))
+    SDL2::Input.poll_all(buf, first, last)
+    e = buf[0]
+    e.data1 == 'payload' && e.data2 == 42 && buf[0].equal?(e) && buf[-1].equal?(e) &&
+    e.code == 7
+  end
+  assert('SDL2::Input.poll_all keeps data handed to user events') do
+    SDL2::Input.flush(SDL2::Input::SDL_FIRSTEVENT, last)
+    buf = SDL2::Input::EventBuffer.new
+    SDL2::Input.push(SDL2::Input::UserEvent.new(first, 1, 'kept'))
+    SDL2::Input.push(SDL2::Input::UserEvent.new(first, 2, 'dropped'))
+    SDL2::Input.poll_all(buf, first, last)
+    e = buf[0]
+    SDL2::Input.push(SDL2::Input::UserEvent.new(first, 3, 'cleared'))
+    n = SDL2::Input.poll_all(buf, first, last)
+    buf.clear
+    n == 1 && e.data1 == 'kept' && SDL2::Input.poll_all(buf, first, last) == 0
+  end
+  assert('SDL2::Input::EventBuffer#clear drops cached events') do
+    buf = SDL2::Input::EventBuffer.new
+    SDL2::Input.push(SDL2::Input::UserEvent.new(first, 1))
+    SDL2::Input.poll_all(buf, first, last)
+    buf[0]
+    buf.clear
+    assert_raise(IndexError) { buf[0] }
+    buf.size == 0
+  end
+  assert('SDL2::Input::EventBuffer#initialize checks the capacity') do
+    assert_raise(ArgumentError) { SDL2::Input::EventBuffer.new(0) }
+    SDL2::Input::EventBuffer.new(1).capacity == 1
+  end
+ensure
+  SDL2::quit
+end
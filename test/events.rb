@@ -0,0 +1,34 @@
+##
+# SDL2::Input test
+
+SDL2::init
+begin
+  assert('SDL2::Input.poll_into reuses and retags the event') do
+    SDL2::Input.flush(SDL2::Input::SDL_FIRSTEVENT, SDL2::Input::SDL_LASTEVENT)
+    SDL2::Input.push(SDL2::Input::UserEvent.new(SDL2::Input::SDL_USEREVENT, 5))
+    SDL2::Input.push(SDL2::Input::UserEvent.new(SDL2::Input::SDL_QUIT, 0))
+    e = SDL2::Input::Event.new
+    a = SDL2::Input.poll_into(e)
+    user = a.equal?(e) && e.class == SDL2::Input::UserEvent && e.code == 5
+    b = SDL2::Input.poll_into(e)
+    quit = b.equal?(e) && e.class == SDL2::Input::QuitEvent
+    user && quit && SDL2::Input.poll_into(e).nil? && e.class == SDL2::Input::QuitEvent
+  end
+  assert('SDL2::Input.poll_into frees user data the event still holds') do
+    first = SDL2::Input::SDL_USEREVENT
+    SDL2::Input.flush(SDL2::Input::SDL_FIRSTEVENT, SDL2::Input::SDL_LASTEVENT)
+    u = SDL2::Input::UserEvent.new(first, 1, 'first', 2.5)
+    SDL2::Input.push(u)
+    SDL2::Input.push(SDL2::Input::UserEvent.new(first, 2, 'second'))
+    SDL2::Input.push(SDL2::Input::UserEvent.new(first, 3, 'third'))
+    e = SDL2::Input::Event.new
+    SDL2::Input.poll_into(e)
+    kept = e.data1
+    SDL2::Input.poll_into(e)
+    SDL2::Input.poll_into(e)
+    third = e.data1
+    u.data1.nil? && kept == 'first' && third == 'third' && e.code == 3 && e.data1.nil?
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,77 @@
+##
+# SDL2::Input::Filter test
+
+SDL2::init
+begin
+  input = SDL2::Input
+  filter = SDL2::Input::Filter
+  motion = lambda { input.push(input::UserEvent.new(input::SDL_MOUSEMOTION, 0)) }
+  reset = lambda do
+    filter.uninstall
+    filter.allow_all
+    filter.coalesce_motion = false
+    filter.reset_stats
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+  end
+  assert('SDL2::Input::Filter.block drops events') do
+    reset.call
+    filter.install
+    filter.block(input::SDL_USEREVENT)
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 1))
+    blocked = !input.has_events?(input::SDL_USEREVENT) && filter.stats[:dropped] == 1
+    filter.allow(input::SDL_USEREVENT)
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 2))
+    ok = blocked && input.has_events?(input::SDL_USEREVENT) && filter.allowed?(input::SDL_USEREVENT)
+    reset.call
+    ok
+  end
+  assert('SDL2::Input::Filter.coalesce_motion merges motion') do
+    reset.call
+    filter.install
+    filter.coalesce_motion = true
+    3.times { motion.call }
+    held = !input.has_events?(input::SDL_MOUSEMOTION)
+    buf = input::EventBuffer.new
+    input.poll_all(buf)
+    ok = held && buf.count(input::SDL_MOUSEMOTION) == 1 && filter.stats[:coalesced] == 2
+    reset.call
+    ok
+  end
+  assert('SDL2::Input::Filter keeps held motion ahead of later events') do
+    reset.call
+    filter.install
+    filter.coalesce_motion = true
+    motion.call
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 3))
+    buf = input::EventBuffer.new
+    input.poll_all(buf)
+    ok = buf.size == 2 && buf.type(0) == input::SDL_MOUSEMOTION && buf.type(1) == input::SDL_USEREVENT
+    reset.call
+    ok
+  end
+  assert('SDL2::Input.wait_timeout returns held events') do
+    reset.call
+    filter.install
+    filter.coalesce_motion = true
+    motion.call
+    e = input.wait_timeout(100)
+    f = input::Event.new
+    motion.call
+    g = input.wait_timeout_into(f, 100)
+    ok = e.class == input::MouseMotionEvent && g.equal?(f) && f.class == input::MouseMotionEvent
+    reset.call
+    ok
+  end
+  assert('SDL2::Input::Filter.uninstall releases held events') do
+    reset.call
+    filter.install
+    filter.coalesce_motion = true
+    motion.call
+    filter.uninstall
+    ok = !filter.installed? && input.has_events?(input::SDL_MOUSEMOTION)
+    reset.call
+    ok
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,58 @@
+##
+# SDL2::Video::IndexedTexture test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  indexed = lambda do
+    s = SDL2::Video::Surface.new(0, 4, 2, 8, 0, 0, 0, 0)
+    s.format.palette.set_colors("\x00\x00\x00\xff\xff\x00\x00\xff\x00\xff\x00\xff\x00\x00\xff\xff")
+    s
+  end
+  assert('SDL2::Video::IndexedTexture#update uploads the whole surface first') do
+    target = SDL2::Video::Surface.new(0, 4, 2, 32, *argb)
+    renderer = SDL2::Video::Renderer.new(target)
+    s = indexed.call
+    s.set_pixel(1, 0, 1)
+    t = SDL2::Video::IndexedTexture.new(renderer, s)
+    n = t.update
+    renderer.copy(t.texture)
+    n == 1 && target.get_pixel(0, 0) == 0xff000000 && target.get_pixel(1, 0) == 0xffff0000
+  end
+  assert('SDL2::Video::IndexedTexture#update uploads only changed rows') do
+    target = SDL2::Video::Surface.new(0, 4, 2, 32, *argb)
+    renderer = SDL2::Video::Renderer.new(target)
+    s = indexed.call
+    t = SDL2::Video::IndexedTexture.new(renderer, s)
+    t.update
+    unchanged = t.update
+    s.set_pixel(2, 1, 3)
+    n = t.update
+    renderer.copy(t.texture)
+    unchanged == 0 && n == 1 && target.get_pixel(2, 1) == 0xff0000ff && target.get_pixel(2, 0) == 0xff000000
+  end
+  assert('SDL2::Video::IndexedTexture#update follows palette rotation') do
+    target = SDL2::Video::Surface.new(0, 4, 2, 32, *argb)
+    renderer = SDL2::Video::Renderer.new(target)
+    s = indexed.call
+    s.set_pixel(1, 0, 1)
+    s.set_pixel(2, 1, 3)
+    t = SDL2::Video::IndexedTexture.new(renderer, s)
+    t.update
+    s.format.palette.rotate(1..3)
+    n = t.update
+    renderer.copy(t.texture)
+    n == 1 && target.get_pixel(1, 0) == 0xff0000ff && target.get_pixel(2, 1) == 0xff00ff00 &&
+    target.get_pixel(0, 0) == 0xff000000
+  end
+  assert('SDL2::Video::IndexedTexture#update after the texture is destroyed') do
+    target = SDL2::Video::Surface.new(0, 4, 2, 32, *argb)
+    renderer = SDL2::Video::Renderer.new(target)
+    t = SDL2::Video::IndexedTexture.new(renderer, indexed.call)
+    t.texture.destroy
+    assert_raise(RuntimeError) { t.update }
+    true
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,33 @@
+##
+# SDL2::Input::Keyboard::Snapshot test
+
+SDL2::init
+begin
+  sc_a = SDL2::Input::Keyboard::SDL_SCANCODE_A
+  sc_b = SDL2::Input::Keyboard::SDL_SCANCODE_B
+
+  assert('SDL2::Input::Keyboard.state') do
+    s = SDL2::Input::Keyboard.state
+    s.equal?(SDL2::Input::Keyboard.state) && s.size > 0 && !s.pressed?(sc_a)
+  end
+  assert('SDL2::Input::Keyboard::Snapshot without input') do
+    k = SDL2::Input::Keyboard::Snapshot.new
+    k.update
+    !k.held?(sc_a) && !k.pressed_this_frame?(sc_a) && !k.released_this_frame?(sc_a) &&
+    !k.changed? && k.held_mask([sc_a, sc_b]) == 0
+  end
+  assert('SDL2::Input::Keyboard::Snapshot#bind') do
+    k = SDL2::Input::Keyboard::Snapshot.new
+    k.bind([sc_a, sc_b])
+    k.bindings == [sc_a, sc_b] && k.pressed_mask == 0 && k.released_mask == 0
+  end
+  assert('SDL2::Input::Keyboard::Snapshot rejects bad scancodes') do
+    k = SDL2::Input::Keyboard::Snapshot.new
+    assert_raise(ArgumentError) { k.held?(-1) }
+    assert_raise(ArgumentError) { k.held?(SDL2::Input::Keyboard::SDL_NUM_SCANCODES) }
+    assert_raise(ArgumentError) { k.bind([sc_a] * 64) }
+    true
+  end
+ensure
+  SDL2::quit
+end
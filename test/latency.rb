@@ -0,0 +1,42 @@
+##
+# SDL2::Input::Latency test
+
+SDL2::init
+begin
+  assert('SDL2::Input::Latency.enable') do
+    SDL2::Input::Latency.enable
+    e = SDL2::Input::Latency.enabled?
+    SDL2::Input::Latency.disable
+    e && !SDL2::Input::Latency.enabled?
+  end
+  assert('SDL2::Input::Latency.stats without samples') do
+    SDL2::Input::Latency.reset
+    s = SDL2::Input::Latency.stats
+    s[:poll][:count] == 0 && s[:present][:count] == 0 &&
+    SDL2::Input::Latency.poll_percentile(50).nil?
+  end
+  assert('SDL2::Input::Latency records polled and presented events') do
+    input = SDL2::Input
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    SDL2::Input::Latency.enable
+    SDL2::Input::Latency.reset
+    SDL2::delay(2) # a zero timestamp is treated as missing.
+    input.push(input::UserEvent.new(input::SDL_KEYDOWN, 0))
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 0))
+    polled = !input.poll.nil? && !input.poll.nil?
+    SDL2::Input::Latency.mark_present
+    s = SDL2::Input::Latency.stats
+    p100 = SDL2::Input::Latency.poll_percentile(100)
+    SDL2::Input::Latency.disable
+    polled && s[:poll][:count] == 1 && s[:present][:count] == 1 &&
+    s[:poll][:max] >= 0 && p100 == s[:poll][:max] &&
+    SDL2::Input::Latency.present_percentile(50) <= s[:present][:max]
+  end
+  assert('SDL2::Input::Latency.poll_percentile rejects bad percentiles') do
+    assert_raise(ArgumentError) { SDL2::Input::Latency.poll_percentile(101) }
+    assert_raise(ArgumentError) { SDL2::Input::Latency.present_percentile(-1) }
+    true
+  end
+ensure
+  SDL2::quit
+end
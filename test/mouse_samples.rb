@@ -0,0 +1,88 @@
+##
+# SDL2::Input::Mouse::SampleRecorder test
+
+SDL2::init
+begin
+  assert('SDL2::Input::Mouse::SampleRecorder#initialize') do
+    r = SDL2::Input::Mouse::SampleRecorder.new(16)
+    r.capacity == 16 && r.pending == 0 && r.dropped == 0 && !r.attached?
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#initialize rejects bad capacities') do
+    assert_raise(ArgumentError) { SDL2::Input::Mouse::SampleRecorder.new(1) }
+    assert_raise(ArgumentError) { SDL2::Input::Mouse::SampleRecorder.new(65537) }
+    true
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#take without samples') do
+    r = SDL2::Input::Mouse::SampleRecorder.new
+    b = r.take(1.5)
+    b.class == SDL2::IntBuffer && b.size == 0
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#take rejects a negative epsilon') do
+    assert_raise(ArgumentError) { SDL2::Input::Mouse::SampleRecorder.new.take(-1) }
+    true
+  end
+  motion = lambda { |x, y, xrel = 0, yrel = 0, state = 0| SDL2::Input::MouseMotionEvent.new(x, y, xrel, yrel, state) }
+  # x of each sample in a buffer returned by #take.
+  xs = lambda do |b|
+    a = b.to_a
+    (0...(a.size / SDL2::Input::Mouse::SampleRecorder::FIELDS)).map { |i| a[i * SDL2::Input::Mouse::SampleRecorder::FIELDS] }
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder overwrites the oldest samples when full') do
+    r = SDL2::Input::Mouse::SampleRecorder.new(4)
+    6.times { |i| r.feed(motion.call(i, 0)) }
+    full = r.pending == 4 && r.dropped == 2
+    full && xs.call(r.take) == [2, 3, 4, 5] && r.pending == 0
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#take keeps order across the ring end') do
+    r = SDL2::Input::Mouse::SampleRecorder.new(4)
+    3.times { |i| r.feed(motion.call(i, 0)) }
+    first = xs.call(r.take)
+    5.times { |i| r.feed(motion.call(10 + i, 0)) }
+    second = xs.call(r.take)
+    r.feed(motion.call(20, 0))
+    first == [0, 1, 2] && second == [11, 12, 13, 14] && xs.call(r.take) == [20]
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#take simplifies runs of one button state apart') do
+    r = SDL2::Input::Mouse::SampleRecorder.new(16)
+    5.times { |i| r.feed(motion.call(i, 0, 0, 0, 0)) }
+    4.times { |i| r.feed(motion.call(5 + i, 0, 0, 0, 1)) }
+    straight = xs.call(r.take(1.0))
+    [0, 0, 5, 0, 0].each_with_index { |y, i| r.feed(motion.call(i, y)) }
+    straight == [0, 4, 5, 8] && xs.call(r.take(1.0)) == [0, 2, 4]
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#take sums the motion of dropped samples') do
+    r = SDL2::Input::Mouse::SampleRecorder.new(16)
+    5.times { |i| r.feed(motion.call(i, 0, 1, 2)) }
+    a = r.take(1.0).to_a
+    # x, y, xrel, yrel, state, timestamp of the two samples kept.
+    a[0] == 0 && a[2] == 1 && a[3] == 2 && a[6] == 4 && a[8] == 4 && a[9] == 8
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#attach records coalesced motion') do
+    input = SDL2::Input
+    filter = SDL2::Input::Filter
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    r = SDL2::Input::Mouse::SampleRecorder.new(16)
+    r.attach
+    filter.install
+    filter.coalesce_motion = true
+    3.times { |i| input.push(motion.call(i, 0, 1, 0)) }
+    held = r.pending
+    event = input.poll
+    released = r.pending
+    a = r.take.to_a
+    filter.coalesce_motion = false
+    filter.uninstall
+    r.detach
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    held == 0 && event.xrel == 3 && released == 1 && a[0] == 2 && a[2] == 3
+  end
+  assert('SDL2::Input::Mouse::SampleRecorder#attach') do
+    r = SDL2::Input::Mouse::SampleRecorder.new
+    r.attach
+    a = r.attached?
+    r.detach
+    a && !r.attached? && SDL2::Input::Mouse::SampleRecorder::FIELDS == 6
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,52 @@
+##
+# SDL2::Pixels::Palette animation test
+
+SDL2::init
+begin
+  indexed = lambda do |palette|
+    format = SDL2::Pixels::PixelFormat.new(SDL2::Pixels::SDL_PIXELFORMAT_INDEX8)
+    format.set_palette(palette)
+    format
+  end
+  assert('SDL2::Pixels::Palette#set_colors copies RGBA bytes') do
+    p = SDL2::Pixels::Palette.new(4)
+    f = indexed.call(p)
+    n = p.set_colors("\x0a\x0b\x0c\xff\x14\x15\x16\xff\x1e\x1f\x20\xff", 1)
+    n == 3 && f.get_rgb(1) == [10, 11, 12] && f.get_rgb(3) == [30, 31, 32]
+  end
+  assert('SDL2::Pixels::Palette#set_colors clips to the palette') do
+    p = SDL2::Pixels::Palette.new(2)
+    p.set_colors("\x01\x01\x01\xff" * 4) == 2 &&
+    p.set_colors(SDL2::ByteBuffer.new([9, 9, 9, 255]), 1) == 1
+  end
+  assert('SDL2::Pixels::Palette#rotate cycles a range') do
+    p = SDL2::Pixels::Palette.new(5)
+    f = indexed.call(p)
+    p.set_colors("\x00\x00\x00\xff\x01\x01\x01\xff\x02\x02\x02\xff\x03\x03\x03\xff\x04\x04\x04\xff")
+    p.rotate(1..3)
+    a = (0...5).map { |i| f.get_rgb(i)[0] }
+    p.rotate(1...4, -1)
+    b = (0...5).map { |i| f.get_rgb(i)[0] }
+    a == [0, 3, 1, 2, 4] && b == [0, 1, 2, 3, 4]
+  end
+  assert('SDL2::Pixels::Palette#rotate rejects ranges outside the palette') do
+    p = SDL2::Pixels::Palette.new(4)
+    assert_raise(IndexError) { p.rotate(2..4) }
+    assert_raise(IndexError) { p.rotate(-1..2) }
+    true
+  end
+  assert('SDL2::Pixels::Palette#blend_to mixes from a base palette') do
+    base = SDL2::Pixels::Palette.new(1)
+    base.set_colors("\x00\x00\x00\xff")
+    other = SDL2::Pixels::Palette.new(1)
+    other.set_colors("\xc8\x64\x00\xff")
+    p = SDL2::Pixels::Palette.new(1)
+    f = indexed.call(p)
+    p.blend_to(other, 0.5, base)
+    half = f.get_rgb(0)
+    p.blend_to(other, 1.0, base)
+    half == [100, 50, 0] && f.get_rgb(0) == [200, 100, 0]
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,47 @@
+##
+# SDL2::Pixels::PixelFormat buffer conversion test
+
+SDL2::init
+begin
+  assert('SDL2::Pixels::PixelFormat#map_rgba_buffer to ARGB8888') do
+    f = SDL2::Pixels::PixelFormat.new(SDL2::Pixels::SDL_PIXELFORMAT_ARGB8888)
+    src = SDL2::ByteBuffer.new([0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x08])
+    dst = SDL2::IntBuffer.new(2)
+    n = f.map_rgba_buffer(src, dst)
+    n == 2 && dst[0] == 0x44112233 && dst[1] == 0x08556677
+  end
+  assert('SDL2::Pixels::PixelFormat#unpack_rgba_buffer from ARGB8888') do
+    f = SDL2::Pixels::PixelFormat.new(SDL2::Pixels::SDL_PIXELFORMAT_ARGB8888)
+    src = SDL2::IntBuffer.new([0x44112233])
+    dst = SDL2::ByteBuffer.new(4)
+    n = f.unpack_rgba_buffer(src, dst)
+    n == 1 && dst[0] == 0x11 && dst[1] == 0x22 && dst[2] == 0x33 && dst[3] == 0x44
+  end
+  assert('SDL2::Pixels::PixelFormat RGB565 round trip') do
+    f = SDL2::Pixels::PixelFormat.new(SDL2::Pixels::SDL_PIXELFORMAT_RGB565)
+    src = SDL2::ByteBuffer.new([0xff, 0x00, 0xff, 0x80])
+    packed = SDL2::ByteBuffer.new(2)
+    back = SDL2::ByteBuffer.new(4)
+    f.map_rgba_buffer(src, packed)
+    f.unpack_rgba_buffer(packed, back)
+    back[0] == 0xff && back[1] == 0x00 && back[2] == 0xff && back[3] == 0xff
+  end
+  assert('SDL2::Pixels::PixelFormat buffer conversion counts whole pixels') do
+    f = SDL2::Pixels::PixelFormat.new(SDL2::Pixels::SDL_PIXELFORMAT_ARGB8888)
+    f.map_rgba_buffer(SDL2::ByteBuffer.new(12), SDL2::ByteBuffer.new(9)) == 2
+  end
+  assert('SDL2::Pixels::PixelFormat buffer conversion rejects sub-byte formats') do
+    f = SDL2::Pixels::PixelFormat.new(SDL2::Pixels::SDL_PIXELFORMAT_INDEX1LSB)
+    assert_raise(ArgumentError) { f.map_rgba_buffer(SDL2::ByteBuffer.new(4), SDL2::ByteBuffer.new(4)) }
+    assert_raise(ArgumentError) { f.unpack_rgba_buffer(SDL2::ByteBuffer.new(4), SDL2::ByteBuffer.new(4)) }
+    true
+  end
+  assert('SDL2::Pixels::PixelFormat buffer conversion rejects wide channels') do
+    f = SDL2::Pixels::PixelFormat.new(SDL2::Pixels::SDL_PIXELFORMAT_ARGB2101010)
+    assert_raise(ArgumentError) { f.map_rgba_buffer(SDL2::ByteBuffer.new(4), SDL2::ByteBuffer.new(4)) }
+    assert_raise(ArgumentError) { f.unpack_rgba_buffer(SDL2::ByteBuffer.new(4), SDL2::ByteBuffer.new(4)) }
+    true
+  end
+ensure
+  SDL2::quit
+end
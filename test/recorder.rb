@@ -0,0 +1,54 @@
+##
+# SDL2::Input::Recorder / SDL2::Input::Player test
+
+SDL2::Hints.set('SDL_VIDEODRIVER', 'dummy')
+SDL2::init(SDL2::SDL_INIT_EVENTS)
+begin
+  input = SDL2::Input
+  path = "#{SDL2::FileSystem.get_pref_path('mruby-sdl2', 'test')}mruby_sdl2_recorder_test.sdle"
+  assert('SDL2::Input::Recorder and Player round-trip user events') do
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    recorder = input::Recorder.new(path)
+    recorder.start
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 1))
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 2))
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    recorder.stop
+    count = recorder.count
+    recorder.close
+    player = input::Player.new(path)
+    player.realtime = false
+    player.frame_ms = 0
+    player.update until player.finished?
+    codes = [input.poll, input.poll].map { |e| e.code }
+    pushed = player.pushed
+    player.close
+    count == 2 && pushed == 2 && codes == [1, 2] && input.poll.nil?
+  end
+  assert('SDL2::Input::Recorder skips events carrying data') do
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    recorder = input::Recorder.new(path)
+    recorder.start
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 1))
+    input.push(input::UserEvent.new(input::SDL_USEREVENT, 2, 'x'))
+    first = input.poll
+    second = input.poll
+    recorder.stop
+    count = recorder.count
+    recorder.close
+    first.code == 1 && second.code == 2 && second.data1 == 'x' && count == 1
+  end
+  assert('SDL2::Input::Player replays a recorded log') do
+    input.flush(input::SDL_FIRSTEVENT, input::SDL_LASTEVENT)
+    player = input::Player.new(path)
+    player.realtime = false
+    player.frame_ms = 0
+    player.update until player.finished?
+    event = input.poll
+    pushed = player.pushed
+    player.close
+    pushed == 1 && event.is_a?(input::UserEvent) && event.code == 1 && event.data1.nil? && input.poll.nil?
+  end
+ensure
+  SDL2::quit
+end
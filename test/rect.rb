@@ -118,6 +118,20 @@ begin
     u = SDL2::Rect.new(0, 0, 100, 100).union(SDL2::Rect.new(-10, -10, 20, 20))
     u.x == -10 && u.y == -10 && u.w == 110 && u.h == 110
   end
+  assert('SDL2::Rect.set') do
+    r = SDL2::Rect.new
+    r.set(1, 2, 3, 4).equal?(r) && r == SDL2::Rect.new(1, 2, 3, 4)
+  end
+  assert('SDL2::Point.set') do
+    p = SDL2::Point.new.set(5, 6)
+    p.x == 5 && p.y == 6
+  end
+  assert('SDL2::Rect.pool_stats') do
+    before = SDL2::Rect.pool_stats
+    r = SDL2::Rect.new(1, 2, 3, 4)
+    after = SDL2::Rect.pool_stats
+    after[:allocated] == before[:allocated] + 1 && after[:live] <= after[:capacity]
+  end
 ensure
   SDL2::quit
 end
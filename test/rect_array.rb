@@ -0,0 +1,55 @@
+##
+# SDL2::RectArray test
+
+SDL2::init
+begin
+  assert('SDL2::RectArray.push') do
+    a = SDL2::RectArray.new
+    a.push(1, 2, 3, 4)
+    a.push(SDL2::Rect.new(5, 6, 7, 8))
+    a.size == 2 && a[0] == SDL2::Rect.new(1, 2, 3, 4) && a[-1] == SDL2::Rect.new(5, 6, 7, 8)
+  end
+  assert('SDL2::RectArray.concat') do
+    a = SDL2::RectArray.new
+    a.concat([SDL2::Rect.new(0, 0, 1, 1), [1, 1, 2, 2]])
+    a.concat(a)
+    a.size == 4 && a[3] == SDL2::Rect.new(1, 1, 2, 2)
+  end
+  assert('SDL2::RectArray.slice') do
+    a = SDL2::RectArray.new
+    a.concat([[0, 0, 1, 1], [1, 1, 1, 1], [2, 2, 1, 1]])
+    s = a.slice(1, 5)
+    s.size == 2 && s[0] == SDL2::Rect.new(1, 1, 1, 1)
+  end
+  assert('SDL2::RectArray.intersecting') do
+    a = SDL2::RectArray.new
+    a.concat([[0, 0, 10, 10], [10, 0, 10, 10], [20, 0, 10, 10], [5, 5, 0, 0]])
+    q = SDL2::Rect.new(8, 2, 4, 4)
+    a.intersects_any?(q) && a.intersecting(q).to_a == [0, 1] &&
+    !a.intersects_any?(SDL2::Rect.new(100, 100, 5, 5))
+  end
+  assert('SDL2::RectArray.containing') do
+    a = SDL2::RectArray.new
+    a.concat([[0, 0, 10, 10], [5, 5, 10, 10]])
+    a.containing(7, 7).to_a == [0, 1] && a.containing(10, 10).to_a == [1]
+  end
+  assert('SDL2::RectArray.within') do
+    a = SDL2::RectArray.new
+    a.concat([[0, 0, 10, 10], [5, 5, 10, 10]])
+    a.within(SDL2::Rect.new(0, 0, 10, 10)).to_a == [0]
+  end
+  assert('SDL2::RectArray.bounds') do
+    a = SDL2::RectArray.new
+    empty = a.bounds.nil?
+    a.concat([[0, 0, 10, 10], [-10, 5, 5, 20]])
+    empty && a.bounds == SDL2::Rect.new(-10, 0, 20, 25)
+  end
+  assert('SDL2::Video::Surface#fill_rects with an empty RectArray') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000)
+    s.fill_rects(0xffffffff, SDL2::RectArray.new)
+    s.fill_rects(0xffffffff, [])
+    s.get_pixel(0, 0) == 0
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,58 @@
+##
+# SDL2::SpatialHash test
+
+SDL2::init
+begin
+  assert('SDL2::SpatialHash.query') do
+    h = SDL2::SpatialHash.new(16)
+    h.insert(0, SDL2::Rect.new(0, 0, 10, 10))
+    h.insert(1, 40, 40, 50, 50)
+    h.insert(2, -30, -30, 5, 5)
+    h.size == 3 &&
+    h.query(SDL2::Rect.new(5, 5, 40, 40)).to_a.sort == [0, 1] &&
+    h.query(SDL2::Rect.new(-100, -100, 300, 300)).to_a.sort == [0, 1, 2]
+  end
+  assert('SDL2::SpatialHash.query_point') do
+    h = SDL2::SpatialHash.new(16)
+    h.insert(3, SDL2::Rect.new(-20, -20, 40, 40))
+    h.query_point(-1, -1).to_a == [3] && h.query_point(20, 20).to_a == []
+  end
+  assert('SDL2::SpatialHash.move') do
+    h = SDL2::SpatialHash.new(16)
+    h.insert(0, SDL2::Rect.new(0, 0, 10, 10))
+    h.move(0, 100, 100)
+    h[0] == SDL2::Rect.new(100, 100, 10, 10) &&
+    h.query_point(5, 5).to_a == [] && h.query_point(105, 105).to_a == [0]
+  end
+  assert('SDL2::SpatialHash.pairs') do
+    h = SDL2::SpatialHash.new(8)
+    h.insert(0, SDL2::Rect.new(0, 0, 30, 30))
+    h.insert(1, SDL2::Rect.new(20, 20, 30, 30))
+    h.insert(2, SDL2::Rect.new(100, 0, 5, 5))
+    h.pairs.to_a == [0, 1]
+  end
+  assert('SDL2::SpatialHash.update_all') do
+    a = SDL2::RectArray.new
+    a.concat([[0, 0, 4, 4], [2, 2, 4, 4]])
+    h = SDL2::SpatialHash.new
+    h.insert(5, SDL2::Rect.new(0, 0, 1, 1))
+    h.update_all(a)
+    h.size == 2 && !h.include?(5) && h.remove(1) && h.size == 1
+  end
+  assert('SDL2::SpatialHash rejects rects covering too many cells') do
+    h = SDL2::SpatialHash.new(1)
+    assert_raise(ArgumentError) { h.insert(0, SDL2::Rect.new(0, 0, 65536, 65536)) }
+    assert_raise(ArgumentError) { h.insert(0, SDL2::Rect.new(0, 0, 1 << 20, 2)) }
+    h.size == 0
+  end
+  assert('SDL2::SpatialHash.query with huge and edge rects') do
+    h = SDL2::SpatialHash.new(1)
+    h.insert(0, SDL2::Rect.new(3, 3, 2, 2))
+    h.insert(1, SDL2::Rect.new(0x7ffffff0, 0, 8, 8))
+    h.query(SDL2::Rect.new(0, 0, 65536, 65536)).to_a == [0] &&
+    h.query(SDL2::Rect.new(-0x40000000, -0x40000000, 0x7fffffff, 0x7fffffff)).to_a == [0] &&
+    h.query(SDL2::Rect.new(0x7ffffff4, 2, 0x7fffffff, 1)).to_a == [1]
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,52 @@
+##
+# SDL2::Video::SurfaceCache test
+
+SDL2::init
+begin
+  argb8888 = SDL2::Pixels::SDL_PIXELFORMAT_ARGB8888
+  dir = SDL2::FileSystem.get_pref_path('mruby-sdl2', 'test')
+  source = "#{dir}mruby_sdl2_cache_src.bmp"
+  assert('SDL2::Video::SurfaceCache#load converts and maps on a miss') do
+    s = SDL2::Video::Surface.new(0, 4, 3, 24, 0xff0000, 0xff00, 0xff, 0)
+    s.fill_rect(10, 20, 30, 255)
+    SDL2::Video::Surface.save_bmp(s, source)
+    cache = SDL2::Video::SurfaceCache.new(dir, argb8888)
+    cache.invalidate(source)
+    c = cache.load(source)
+    c.format.format == argb8888 && c.width == 4 && c.height == 3 &&
+    (c.get_pixel(3, 2) & 0xffffff) == 0x0a141e &&
+    cache.valid?(source)
+  end
+  assert('SDL2::Video::SurfaceCache#load hits a valid entry') do
+    cache = SDL2::Video::SurfaceCache.new(dir, argb8888)
+    c = cache.load(source) { raise 'decoded again' }
+    ok = (c.get_pixel(0, 0) & 0xffffff) == 0x0a141e
+    cache.invalidate(source)
+    ok && !cache.valid?(source)
+  end
+  assert('SDL2::Video::SurfaceCache keeps entries per format') do
+    abgr8888 = SDL2::Pixels::SDL_PIXELFORMAT_ABGR8888
+    argb = SDL2::Video::SurfaceCache.new(dir, argb8888)
+    abgr = SDL2::Video::SurfaceCache.new(dir, abgr8888)
+    a = argb.load(source)
+    b = abgr.load(source)
+    ok = a.format.format == argb8888 && b.format.format == abgr8888 &&
+         argb.valid?(source) && abgr.valid?(source)
+    argb.invalidate(source)
+    abgr.invalidate(source)
+    ok
+  end
+  assert('SDL2::Video::SurfaceCache#load without a source file') do
+    cache = SDL2::Video::SurfaceCache.new(dir, argb8888)
+    c = cache.load("#{dir}mruby_sdl2_cache_missing.bmp") do
+      SDL2::Video::Surface.new(0, 2, 2, 32, 0xff0000, 0xff00, 0xff, 0xff000000)
+    end
+    c.format.format == argb8888 && c.width == 2
+  end
+  assert('SDL2::Video::SurfaceCache#initialize rejects indexed formats') do
+    assert_raise(ArgumentError) { SDL2::Video::SurfaceCache.new(dir, SDL2::Pixels::SDL_PIXELFORMAT_INDEX8) }
+    true
+  end
+ensure
+  SDL2::quit
+end
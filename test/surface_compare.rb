@@ -0,0 +1,47 @@
+##
+# SDL2::Video::Surface diff/hash64 test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  assert('SDL2::Video::Surface#diff of equal surfaces') do
+    a = SDL2::Video::Surface.new(0, 40, 40, 32, *argb)
+    b = SDL2::Video::Surface.new(0, 40, 40, 32, *argb)
+    count, max_delta, rects = a.diff(b)
+    count == 0 && max_delta == 0 && rects.empty?
+  end
+  assert('SDL2::Video::Surface#diff finds changed tiles') do
+    a = SDL2::Video::Surface.new(0, 40, 40, 32, *argb)
+    b = SDL2::Video::Surface.new(0, 40, 40, 32, *argb)
+    b.set_pixel(35, 5, 0x00000010)
+    b.set_pixel(36, 5, 0x00000002)
+    count, max_delta, rects = a.diff(b, 0, 8)
+    r = rects[0]
+    count == 2 && max_delta == 16 && rects.size == 1 &&
+    r.x == 32 && r.y == 0 && r.w == 8 && r.h == 8
+  end
+  assert('SDL2::Video::Surface#diff with tolerance') do
+    a = SDL2::Video::Surface.new(0, 16, 16, 32, *argb)
+    b = SDL2::Video::Surface.new(0, 16, 16, 32, *argb)
+    b.set_pixel(3, 3, 0x00000004)
+    count, max_delta, rects = a.diff(b, 4)
+    count == 0 && max_delta == 4 && rects.empty?
+  end
+  assert('SDL2::Video::Surface#diff rejects mismatched surfaces') do
+    a = SDL2::Video::Surface.new(0, 16, 16, 32, *argb)
+    b = SDL2::Video::Surface.new(0, 16, 8, 32, *argb)
+    assert_raise(ArgumentError) { a.diff(b) }
+    assert_raise(ArgumentError) { a.diff(a, 0, 0) }
+    assert_raise(ArgumentError) { a.diff(a, -1) }
+    true
+  end
+  assert('SDL2::Video::Surface#hash64') do
+    a = SDL2::Video::Surface.new(0, 7, 3, 32, *argb)
+    b = SDL2::Video::Surface.new(0, 7, 3, 32, *argb)
+    same = a.hash64 == b.hash64
+    b.set_pixel(6, 2, 1)
+    same && a.hash64 != b.hash64 && a.hash64.size == 16 && a.hash64(1) != a.hash64
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,39 @@
+##
+# SDL2::Video::Surface conversion test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  xrgb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0]
+  assert('SDL2::Video::Surface#convert_format converts pixels') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *argb)
+    s.fill_rect(0x11, 0x22, 0x33, 0xff)
+    d = s.convert_format(SDL2::Pixels::SDL_PIXELFORMAT_ABGR8888)
+    d.format.format == SDL2::Pixels::SDL_PIXELFORMAT_ABGR8888 &&
+    d.get_pixel(2, 2) == 0xff332211
+  end
+  assert('SDL2::Video::Surface#convert_format keeps the modulation state') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *xrgb)
+    s.alpha_mod = 100
+    s.color_mod = SDL2::RGB.new(10, 20, 30)
+    s.blend_mode = SDL2::Video::Surface::SDL_BLENDMODE_ADD
+    d = s.convert_format(SDL2::Pixels::SDL_PIXELFORMAT_RGB565)
+    c = d.color_mod
+    d.alpha_mod == 100 && c.r == 10 && c.g == 20 && c.b == 30 &&
+    d.blend_mode == SDL2::Video::Surface::SDL_BLENDMODE_BLEND
+  end
+  assert('SDL2::Video::Surface#convert_format keeps the blend mode') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *xrgb)
+    s.blend_mode = SDL2::Video::Surface::SDL_BLENDMODE_ADD
+    d = s.convert_format(SDL2::Pixels::SDL_PIXELFORMAT_RGB565)
+    d.blend_mode == SDL2::Video::Surface::SDL_BLENDMODE_ADD
+  end
+  assert('SDL2::Video::Surface#convert_into rejects size mismatches') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *argb)
+    d = SDL2::Video::Surface.new(0, 2, 4, 32, *argb)
+    assert_raise(ArgumentError) { s.convert_into(d) }
+    true
+  end
+ensure
+  SDL2::quit
+end
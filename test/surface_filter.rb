@@ -0,0 +1,95 @@
+##
+# SDL2::Video::Surface filter test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  abgr = [0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000]
+  assert('SDL2::Video::Surface#box_blur keeps a flat surface flat') do
+    s = SDL2::Video::Surface.new(0, 8, 8, 32, *argb)
+    s.fill_rect(40, 80, 120, 255)
+    before = s.get_pixel(3, 3)
+    s.box_blur(2, 3)
+    s.get_pixel(0, 0) == before && s.get_pixel(7, 7) == before
+  end
+  assert('SDL2::Video::Surface#box_blur with a huge radius') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *argb)
+    s.fill_rect(10, 20, 30, 255)
+    before = s.get_pixel(1, 1)
+    s.box_blur(0x3fffffff)
+    s.get_pixel(2, 2) == before
+  end
+  assert('SDL2::Video::Surface#gaussian_blur spreads a single pixel') do
+    s = SDL2::Video::Surface.new(0, 9, 9, 32, *argb)
+    s.set_pixel(4, 4, 0xffffffff)
+    s.gaussian_blur(1.0)
+    c = s.get_pixel(4, 4) & 0xff
+    n = s.get_pixel(5, 4) & 0xff
+    c < 255 && 0 < n && n < c && s.get_pixel(0, 0) == 0
+  end
+  assert('SDL2::Video::Surface#convolve keeps negative intermediate values') do
+    s = SDL2::Video::Surface.new(0, 3, 1, 32, *argb)
+    s.set_pixel(1, 0, 0xc8c8c8c8)
+    s.convolve([-1, -1, 1])
+    s.get_pixel(0, 0) == 0 && s.get_pixel(1, 0) == 0xc8c8c8c8 && s.get_pixel(2, 0) == 0xc8c8c8c8
+  end
+  assert('SDL2::Video::Surface#convolve with a 2D kernel') do
+    s = SDL2::Video::Surface.new(0, 3, 3, 32, *argb)
+    s.set_pixel(1, 1, 0x40404040)
+    s.convolve([[0, 0, 0], [0, 0, 1], [0, 0, 0]])
+    s.get_pixel(0, 1) == 0x40404040 && s.get_pixel(1, 1) == 0
+  end
+  assert('SDL2::Video::Surface#convolve rejects bad kernels') do
+    s = SDL2::Video::Surface.new(0, 3, 3, 32, *argb)
+    assert_raise(ArgumentError) { s.convolve([]) }
+    assert_raise(ArgumentError) { s.convolve([1, 1]) }
+    assert_raise(ArgumentError) { s.convolve([0.0 / 0.0]) }
+    assert_raise(ArgumentError) { s.convolve([1e9]) }
+    assert_raise(ArgumentError) { s.convolve([50, 0, 0]) }
+    s.convolve([[50]])
+    true
+  end
+  assert('SDL2::Video::Surface#gaussian_blur bounds sigma') do
+    s = SDL2::Video::Surface.new(0, 3, 3, 32, *argb)
+    s.fill_rect(40, 80, 120, 255)
+    before = s.get_pixel(1, 1)
+    assert_raise(ArgumentError) { s.gaussian_blur(0.0 / 0.0) }
+    s.gaussian_blur(1e-9)
+    s.gaussian_blur(1e9)
+    s.get_pixel(1, 1) == before
+  end
+  assert('SDL2::Video::Surface filters reject a different destination format') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *argb)
+    d = SDL2::Video::Surface.new(0, 4, 4, 32, *abgr)
+    assert_raise(ArgumentError) { s.box_blur(1, 1, d) }
+    assert_raise(ArgumentError) { s.gaussian_blur(1.0, d) }
+    true
+  end
+  assert('SDL2::Video::Surface#rotozoom by quarter turns') do
+    s = SDL2::Video::Surface.new(0, 3, 2, 32, *argb)
+    s.set_pixel(0, 0, 0xff112233)
+    r = s.rotozoom(90)
+    r.width == 2 && r.height == 3 && r.get_pixel(1, 0) == 0xff112233
+  end
+  assert('SDL2::Video::Surface#rotozoom scales') do
+    s = SDL2::Video::Surface.new(0, 4, 2, 32, *argb)
+    r = s.rotozoom(0, 2.0, 0.5)
+    r.width == 8 && r.height == 1
+  end
+  assert('SDL2::Video::Surface#rotozoom rejects oversized results') do
+    s = SDL2::Video::Surface.new(0, 64, 64, 32, *argb)
+    assert_raise(ArgumentError) { s.rotozoom(0, 1000.0) }
+    assert_raise(ArgumentError) { s.rotozoom(0, 1.0e300) }
+    assert_raise(ArgumentError) { s.rotozoom(0, 0.0) }
+    assert_raise(ArgumentError) { s.rotozoom(0, 0.0 / 0.0) }
+    true
+  end
+  assert('SDL2::Video::Surface#rotozoom with a large inverse step') do
+    s = SDL2::Video::Surface.new(0, 4, 4, 32, *argb)
+    s.fill_rect(10, 20, 30, 255)
+    r = s.rotozoom(45, 1.0 / 16384, 100.0, true)
+    r.width == r.height && 280 < r.width && r.get_pixel(0, 0) == 0
+  end
+ensure
+  SDL2::quit
+end
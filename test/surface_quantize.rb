@@ -0,0 +1,42 @@
+##
+# SDL2::Video::Surface#quantize test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  quadrants = lambda do
+    s = SDL2::Video::Surface.new(0, 8, 8, 32, *argb)
+    s.fill_rect(255, 0, 0, 255, SDL2::Rect.new(0, 0, 4, 4))
+    s.fill_rect(0, 255, 0, 255, SDL2::Rect.new(4, 0, 4, 4))
+    s.fill_rect(0, 0, 255, 255, SDL2::Rect.new(0, 4, 4, 4))
+    s.fill_rect(255, 255, 255, 255, SDL2::Rect.new(4, 4, 4, 4))
+    s
+  end
+  assert('SDL2::Video::Surface#quantize keeps exact colors') do
+    q = quadrants.call.quantize(4, dither: :none)
+    f = q.format
+    f.format == SDL2::Pixels::SDL_PIXELFORMAT_INDEX8 &&
+    f.get_rgb(q.get_pixel(1, 1)) == [255, 0, 0] &&
+    f.get_rgb(q.get_pixel(6, 1)) == [0, 255, 0] &&
+    f.get_rgb(q.get_pixel(1, 6)) == [0, 0, 255] &&
+    f.get_rgb(q.get_pixel(6, 6)) == [255, 255, 255]
+  end
+  assert('SDL2::Video::Surface#quantize accepts options without a color count') do
+    q = quadrants.call.quantize(dither: :none)
+    q.format.get_rgb(q.get_pixel(6, 6)) == [255, 255, 255]
+  end
+  assert('SDL2::Video::Surface#quantize accepts the dither mode as a symbol') do
+    q = quadrants.call.quantize(4, :ordered)
+    q.width == 8 && q.height == 8
+  end
+  assert('SDL2::Video::Surface#quantize validates its arguments') do
+    s = quadrants.call
+    assert_raise(ArgumentError) { s.quantize(1) }
+    assert_raise(ArgumentError) { s.quantize(257) }
+    assert_raise(ArgumentError) { s.quantize(16, dither: :bogus) }
+    assert_raise(ArgumentError) { SDL2::Video::Surface.new(0, 8, 8, 4, 0, 0, 0, 0).quantize(4) }
+    true
+  end
+ensure
+  SDL2::quit
+end
@@ -0,0 +1,37 @@
+##
+# SDL2::Video::Surface#view test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  assert('SDL2::Video::Surface#view aliases the parent pixels') do
+    s = SDL2::Video::Surface.new(0, 8, 8, 32, *argb)
+    v = s.view(SDL2::Rect.new(2, 3, 4, 2))
+    v.set_pixel(1, 1, 0xff445566)
+    v.width == 4 && v.height == 2 && v.parent.equal?(s) &&
+    s.get_pixel(3, 4) == 0xff445566 && v.pitch == s.pitch
+  end
+  assert('SDL2::Video::Surface#view clips to the parent') do
+    s = SDL2::Video::Surface.new(0, 8, 8, 32, *argb)
+    v = s.view(SDL2::Rect.new(6, -2, 10, 4))
+    v.width == 2 && v.height == 2
+  end
+  assert('SDL2::Video::Surface#view copies the alpha mod') do
+    s = SDL2::Video::Surface.new(0, 8, 8, 32, *argb)
+    s.alpha_mod = 128
+    s.view(SDL2::Rect.new(0, 0, 2, 2)).alpha_mod == 128
+  end
+  assert('SDL2::Video::Surface#view rejects rects outside the surface') do
+    s = SDL2::Video::Surface.new(0, 8, 8, 32, *argb)
+    assert_raise(ArgumentError) { s.view(SDL2::Rect.new(8, 8, 2, 2)) }
+    assert_raise(ArgumentError) { s.view(nil) }
+    true
+  end
+  assert('SDL2::Video::Surface#view rejects sub-byte surfaces') do
+    s = SDL2::Video::Surface.new(0, 16, 1, 1, 0, 0, 0, 0)
+    assert_raise(ArgumentError) { s.view(SDL2::Rect.new(8, 0, 8, 1)) }
+    true
+  end
+ensure
+  SDL2::quit
+end
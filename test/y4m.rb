@@ -0,0 +1,40 @@
+##
+# SDL2::Video::Y4MReader test
+
+SDL2::init
+begin
+  argb = [0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000]
+  path = '/tmp/mruby_sdl2_test.y4m'
+  write_y4m = lambda do |header, body|
+    io = SDL2::RWops.new(path, 'wb')
+    io.write(header + body)
+    io.close
+  end
+  assert('SDL2::Video::Y4MReader reads a 4:2:0 frame') do
+    [0, 3].all? do |read_ahead|
+      write_y4m.call("YUV4MPEG2 W2 H2 F30:1 C420jpeg\n", "FRAME\n" + "\xEB" * 4 + "\x80\x80")
+      r = SDL2::Video::Y4MReader.new(path, read_ahead)
+      s = SDL2::Video::Surface.new(0, 2, 2, 32, *argb)
+      ok = r.width == 2 && r.height == 2 && r.frame_rate == 30.0 && r.next_frame
+      r.to_surface(s)
+      ok &&= (0...4).all? { |i| (s.get_pixel(i % 2, i / 2) & 0xffffff) == 0xffffff }
+      ok &&= !r.next_frame
+      r.close
+      ok
+    end
+  end
+  assert('SDL2::Video::Y4MReader rejects high bit depth colour spaces') do
+    %w(C420p10 C420p12 C422 C444).each do |cs|
+      write_y4m.call("YUV4MPEG2 W2 H2 F30:1 #{cs}\n", "FRAME\n")
+      assert_raise(ArgumentError) { SDL2::Video::Y4MReader.new(path) }
+    end
+    true
+  end
+  assert('SDL2::Video::Y4MReader rejects oversized frames') do
+    write_y4m.call("YUV4MPEG2 W65536 H65536 F30:1\n", "FRAME\n")
+    assert_raise(ArgumentError) { SDL2::Video::Y4MReader.new(path) }
+    true
+  end
+ensure
+  SDL2::quit
+end